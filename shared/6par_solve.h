@@ -54,6 +54,10 @@
 #include "6par_newton.h"
 #include "lib_util.h"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 class notification_interface
 {
 public:
@@ -494,61 +498,120 @@ public:
 
 	}
 
-	template< typename Real >
-	int solve_with_sanity_and_heuristics( int max_iter, double tol,
-		notification_interface *nif = 0 )
+	/* number of starting points tried by solve_with_sanity_and_heuristics:
+	   the initial guess, the technology specific adjustments, then five Isc nudges */
+	int start_count() const
+	{
+		int n = 1;
+		if ( Type == Amorphous || Type == CdTe ) n += 12;
+		else if ( Type == multiSi ) n += 1;
+		return n + 5;
+	}
+
+	/* set up the k-th starting point, assuming Isc holds the rated value */
+	void start( int k )
 	{
+		int nadj = start_count() - 6;
+		if ( k > nadj )
+		{
+			// nudge Isc up by 1% per attempt
+			for( int i=0;i<k-nadj;i++ )
+				Isc *= 1.01;
+			guess();
+			return;
+		}
+
 		guess();
+		if ( k == 0 ) return;
 
-		int err = solve<Real>( max_iter, tol, nif );
-		
-		
-		if ( err < 0 && (Type == Amorphous || Type == CdTe) )
+		if ( Type == Amorphous || Type == CdTe )
 		{
-			// attempt decreasing 'a' and solving
-			int downattempt = 0;
-			while( err < 0 && ++downattempt <= 6 )
+			if ( k <= 6 )
 			{
-				guess();
-				a /= (1 + downattempt*0.2); // divide down by 1.2, 1.4, 1.6, 1.8, 2.0, 2.2
-				if( downattempt > 4 ) Io /= 100;
-				err = solve<Real>( max_iter, tol, nif );
+				// attempt decreasing 'a': divide down by 1.2, 1.4, 1.6, 1.8, 2.0, 2.2
+				a /= (1 + k*0.2);
+				if( k > 4 ) Io /= 100;
 			}
-
-			// attempt increasing 'a' and solving
-			int upattempt = 0;
-			while( err < 0 && ++upattempt <= 6 )
+			else
 			{
-				guess();
-				a *= (1 + upattempt*0.2); // multiply up by 1.2, 1.4, 1.6, 1.8, 2.0, 2.2
-				if( upattempt > 4 ) Io /= 100;
-				err = solve<Real>( max_iter, tol, nif );
+				// attempt increasing 'a': multiply up by 1.2, 1.4, 1.6, 1.8, 2.0, 2.2
+				int up = k - 6;
+				a *= (1 + up*0.2);
+				if( up > 4 ) Io /= 100;
 			}
 		}
-		else if ( err < 0 && Type == multiSi )
+		else if ( Type == multiSi )
 		{
-			guess();
 			Io /= 100;
 			Rsh /= 2;
-			err = solve<Real>( max_iter, tol, nif );
 		}
-		
+	}
+
+	template< typename Real >
+	int solve_with_sanity_and_heuristics( int max_iter, double tol,
+		notification_interface *nif = 0 )
+	{
 		double Isc_save = Isc;
-		int nattempt = 0;
-		while ( err < 0 && nattempt < 5 )
+		int n = start_count();
+		int err = -1;
+		for( int k=0;k<n && err < 0;k++ )
 		{
-				Isc *= 1.01;
-				guess();
-				err = solve<Real>( max_iter, tol, nif );
-				nattempt++;
+			Isc = Isc_save;
+			start( k );
+			err = solve<Real>( max_iter, tol, nif );
 		}
-		
 		Isc = Isc_save;
-		
-		
 		return err;
 	}
 
+	/* same as solve_with_sanity_and_heuristics, but if the initial guess fails the remaining
+	   starting points are solved nthreads at a time.  The first success in the serial order
+	   is kept, so the result does not depend on the number of threads. */
+	template< typename Real >
+	int solve_with_sanity_and_heuristics_mt( int max_iter, double tol, int nthreads )
+	{
+		if ( nthreads < 2 )
+			return solve_with_sanity_and_heuristics<Real>( max_iter, tol );
+
+		module6par base( *this );
+		start( 0 );
+		int err = solve<Real>( max_iter, tol );
+		if ( err >= 0 ) return err;
+
+		int n = start_count();
+		for( int k0=1;k0<n;k0+=nthreads )
+		{
+			int nk = std::min( nthreads, n-k0 );
+			std::vector<module6par> trial( nk, base );
+			std::vector<int> errs( nk, -1 );
+			std::vector<std::thread> threads;
+			for( int i=1;i<nk;i++ )
+				threads.push_back( std::thread( solve_start<Real>, &trial[i], k0+i, max_iter, tol, &errs[i] ) );
+			solve_start<Real>( &trial[0], k0, max_iter, tol, &errs[0] );
+			for( size_t i=0;i<threads.size();i++ )
+				threads[i].join();
+
+			for( int i=0;i<nk;i++ )
+			{
+				if ( errs[i] >= 0 || k0+i == n-1 )
+				{
+					*this = trial[i];
+					Isc = base.Isc;
+					return errs[i];
+				}
+			}
+		}
+
+		return err;
+	}
+
+private:
+	template< typename Real >
+	static void solve_start( module6par *m, int k, int max_iter, double tol, int *err )
+	{
+		m->start( k );
+		*err = m->solve<Real>( max_iter, tol );
+	}
 	
 };
 
@@ -52,6 +52,7 @@
 #include <cfloat>
 #include <sstream>
 #include <algorithm>
+#include <typeinfo>
 
 #include "lib_battery.h"
 
@@ -144,6 +145,38 @@ void capacity_t::copy(capacity_t * capacity)
 	_prev_charge = capacity->_prev_charge;
 	_charge = capacity->_charge;
 }
+void capacity_t::save_state(capacity_state_t &state) const
+{
+	state.q0 = _q0;
+	state.qmax = _qmax;
+	state.qmax_thermal = _qmax_thermal;
+	state.I = _I;
+	state.I_loss = _I_loss;
+	state.SOC = _SOC;
+	state.DOD = _DOD;
+	state.DOD_prev = _DOD_prev;
+	state.dt_hour = _dt_hour;
+	state.chargeChange = _chargeChange;
+	state.prev_charge = _prev_charge;
+	state.charge = _charge;
+	state.q1_0 = 0;
+	state.q2_0 = 0;
+}
+void capacity_t::restore_state(const capacity_state_t &state)
+{
+	_q0 = state.q0;
+	_qmax = state.qmax;
+	_qmax_thermal = state.qmax_thermal;
+	_I = state.I;
+	_I_loss = state.I_loss;
+	_SOC = state.SOC;
+	_DOD = state.DOD;
+	_DOD_prev = state.DOD_prev;
+	_dt_hour = state.dt_hour;
+	_chargeChange = state.chargeChange;
+	_prev_charge = state.prev_charge;
+	_charge = state.charge;
+}
 void capacity_t::check_charge_change()
 {
 	_charge = NO_CHARGE;
@@ -269,6 +302,18 @@ void capacity_kibam_t::copy(capacity_t * capacity)
 	_q20 = tmp->_q20;
 	_I20 = tmp->_I20;
 }
+void capacity_kibam_t::save_state(capacity_state_t &state) const
+{
+	capacity_t::save_state(state);
+	state.q1_0 = _q1_0;
+	state.q2_0 = _q2_0;
+}
+void capacity_kibam_t::restore_state(const capacity_state_t &state)
+{
+	capacity_t::restore_state(state);
+	_q1_0 = state.q1_0;
+	_q2_0 = state.q2_0;
+}
 
 void capacity_kibam_t::replace_battery()
 {
@@ -522,6 +567,8 @@ void voltage_t::copy(voltage_t * voltage)
 	// doesn't change;
 	//_batt_voltage_matrix = voltage->_batt_voltage_matrix;
 }
+void voltage_t::save_state(double &cell_voltage) const { cell_voltage = _cell_voltage; }
+void voltage_t::restore_state(double cell_voltage) { _cell_voltage = cell_voltage; }
 double voltage_t::battery_voltage(){ return _num_cells_series*_cell_voltage; }
 double voltage_t::battery_voltage_nominal(){ return _num_cells_series * _cell_voltage_nominal; }
 double voltage_t::cell_voltage(){ return _cell_voltage; }
@@ -801,6 +848,22 @@ void lifetime_t::copy(lifetime_t * lifetime)
 	_replacement_scheduled = lifetime->_replacement_scheduled;
 	_q = lifetime->_q;
 }
+void lifetime_t::save_state(lifetime_state_t &state) const
+{
+	_lifetime_cycle->save_state(state.cycle);
+	_lifetime_calendar->save_state(state.calendar);
+	state.q = _q;
+	state.replacements = _replacements;
+	state.replacement_scheduled = _replacement_scheduled;
+}
+void lifetime_t::restore_state(const lifetime_state_t &state)
+{
+	_lifetime_cycle->restore_state(state.cycle);
+	_lifetime_calendar->restore_state(state.calendar);
+	_q = state.q;
+	_replacements = state.replacements;
+	_replacement_scheduled = state.replacement_scheduled;
+}
 double lifetime_t::capacity_percent(){ return _q; }
 void lifetime_t::runLifetimeModels(size_t idx, capacity_t * capacity, double T_battery)
 {
@@ -866,6 +929,9 @@ lifetime_cycle_t::lifetime_cycle_t(const util::matrix_t<double> &batt_lifetime_m
 	_Ylt = 0;
 	_Range = 0;
 	_average_range = 0;
+	_Peaks.reserve(RAINFLOW_STACK_RESERVE);
+	for (int i = 0; i < RAINFLOW_HISTOGRAM_BINS; i++)
+		_histogram[i] = 0;
 }
 
 lifetime_cycle_t::~lifetime_cycle_t(){}
@@ -881,15 +947,37 @@ void lifetime_cycle_t::copy(lifetime_cycle_t * lifetime_cycle)
 	_capacities_vect = lifetime_cycle->_capacities_vect;
 	*/
 
-	_nCycles = lifetime_cycle->_nCycles;
-	_q = lifetime_cycle->_q;
-	_Dlt = lifetime_cycle->_Dlt;
-	_jlt = lifetime_cycle->_jlt;
-	_Xlt = lifetime_cycle->_Xlt;
-	_Ylt = lifetime_cycle->_Ylt;
-	_Peaks = lifetime_cycle->_Peaks;
-	_Range = lifetime_cycle->_Range;
-	_average_range = lifetime_cycle->_average_range;
+	lifetime_cycle_state_t state;
+	lifetime_cycle->save_state(state);
+	restore_state(state);
+}
+void lifetime_cycle_t::save_state(lifetime_cycle_state_t &state) const
+{
+	state.nCycles = _nCycles;
+	state.q = _q;
+	state.Dlt = _Dlt;
+	state.jlt = _jlt;
+	state.Xlt = _Xlt;
+	state.Ylt = _Ylt;
+	state.Range = _Range;
+	state.average_range = _average_range;
+	state.Peaks = _Peaks;
+	for (int i = 0; i < RAINFLOW_HISTOGRAM_BINS; i++)
+		state.histogram[i] = _histogram[i];
+}
+void lifetime_cycle_t::restore_state(const lifetime_cycle_state_t &state)
+{
+	_nCycles = state.nCycles;
+	_q = state.q;
+	_Dlt = state.Dlt;
+	_jlt = state.jlt;
+	_Xlt = state.Xlt;
+	_Ylt = state.Ylt;
+	_Range = state.Range;
+	_average_range = state.average_range;
+	_Peaks = state.Peaks;
+	for (int i = 0; i < RAINFLOW_HISTOGRAM_BINS; i++)
+		_histogram[i] = state.histogram[i];
 }
 double lifetime_cycle_t::computeCycleDamageAtDOD(double DOD)
 {
@@ -975,23 +1063,11 @@ int lifetime_cycle_t::rainflow_compareRanges()
 	// Step 5: Count range Y, discard peak & valley of Y, go to Step 2
 	if (!contained)
 	{
-		_Range = _Ylt;
-		_average_range = (_average_range*_nCycles + _Range) / (_nCycles + 1);		
-		_nCycles++;
-
-		// the capacity percent cannot increase
-		if (bilinear(_average_range, _nCycles) <= _q)
-			_q = bilinear(_average_range, _nCycles);
-
-		if (_q < 0)
-			_q = 0.;
+		rainflow_countCycle(_Ylt);
 		
 		// discard peak & valley of Y
-		double save = _Peaks[_jlt]; 
-		_Peaks.pop_back(); 
-		_Peaks.pop_back();
-		_Peaks.pop_back();
-		_Peaks.push_back(save);
+		_Peaks[_jlt - 2] = _Peaks[_jlt];
+		_Peaks.resize(_jlt - 1);
 		_jlt -= 2;
 		// stay in while loop
 		retCode = LT_RERANGE;
@@ -999,6 +1075,25 @@ int lifetime_cycle_t::rainflow_compareRanges()
 
 	return retCode;
 }
+void lifetime_cycle_t::rainflow_countCycle(double range)
+{
+	_Range = range;
+	_average_range = (_average_range*_nCycles + _Range) / (_nCycles + 1);
+	_nCycles++;
+
+	int bin = (int)(_Range * RAINFLOW_HISTOGRAM_BINS / 100.);
+	if (bin < 0) bin = 0;
+	if (bin >= RAINFLOW_HISTOGRAM_BINS) bin = RAINFLOW_HISTOGRAM_BINS - 1;
+	_histogram[bin]++;
+
+	// the capacity percent cannot increase
+	double q = bilinear(_average_range, _nCycles);
+	if (q <= _q)
+		_q = q;
+
+	if (_q < 0)
+		_q = 0.;
+}
 void lifetime_cycle_t::replaceBattery()
 {
 	_q = bilinear(0.,0);
@@ -1009,9 +1104,17 @@ void lifetime_cycle_t::replaceBattery()
 	_Ylt = 0;
 	_Range = 0;
 	_Peaks.clear();
+	for (int i = 0; i < RAINFLOW_HISTOGRAM_BINS; i++)
+		_histogram[i] = 0;
 }
 
 int lifetime_cycle_t::cycles_elapsed(){ return _nCycles; }
+int lifetime_cycle_t::cycles_in_range_bin(int bin)
+{
+	if (bin < 0 || bin >= RAINFLOW_HISTOGRAM_BINS)
+		return 0;
+	return _histogram[bin];
+}
 double lifetime_cycle_t::cycle_range(){ return _Range; }
 
 
@@ -1212,6 +1315,22 @@ void lifetime_calendar_t::copy(lifetime_calendar_t * lifetime_calendar)
 	_b = lifetime_calendar->_b;
 	_c = lifetime_calendar->_c;
 }
+void lifetime_calendar_t::save_state(lifetime_calendar_state_t &state) const
+{
+	state.day_age_of_battery = _day_age_of_battery;
+	state.last_idx = _last_idx;
+	state.q = _q;
+	state.dq_old = _dq_old;
+	state.dq_new = _dq_new;
+}
+void lifetime_calendar_t::restore_state(const lifetime_calendar_state_t &state)
+{
+	_day_age_of_battery = state.day_age_of_battery;
+	_last_idx = state.last_idx;
+	_q = state.q;
+	_dq_old = state.dq_old;
+	_dq_new = state.dq_new;
+}
 double lifetime_calendar_t::runLifetimeCalendarModel(size_t idx, double T, double SOC)
 {
 	if (_calendar_choice != lifetime_calendar_t::NONE)
@@ -1339,6 +1458,18 @@ void thermal_t::copy(thermal_t * thermal)
 	_capacity_percent = thermal->_capacity_percent;
 	_T_max = thermal->_T_max;
 }
+void thermal_t::save_state(thermal_state_t &state) const
+{
+	state.T_battery = _T_battery;
+	state.capacity_percent = _capacity_percent;
+	state.R = _R;
+}
+void thermal_t::restore_state(const thermal_state_t &state)
+{
+	_T_battery = state.T_battery;
+	_capacity_percent = state.capacity_percent;
+	_R = state.R;
+}
 void thermal_t::replace_battery()
 { 
 	_T_battery = _T_room; 
@@ -1435,6 +1566,8 @@ void losses_t::copy(losses_t * losses)
 	_idle_loss = losses->_idle_loss;
 	_full_loss = losses->_full_loss;*/
 }
+void losses_t::save_state(int &nCycle) const { nCycle = _nCycle; }
+void losses_t::restore_state(int nCycle) { _nCycle = nCycle; }
 
 void losses_t::replace_battery(){ _nCycle = 0; }
 void losses_t::run_losses(double dt_hour, size_t idx)
@@ -1459,9 +1592,10 @@ void losses_t::run_losses(double dt_hour, size_t idx)
 /* 
 Define Battery 
 */
-battery_t::battery_t(){};
+battery_t::battery_t(){ _run = &battery_t::run_polymorphic; };
 battery_t::battery_t(double dt_hour, int battery_chemistry)
 {
+	_run = &battery_t::run_polymorphic;
 	_dt_hour = dt_hour;
 	_dt_min = dt_hour * 60;
 	_battery_chemistry = battery_chemistry;
@@ -1489,6 +1623,7 @@ battery_t::battery_t(const battery_t& battery)
 	_dt_hour = battery._dt_hour;
 	_dt_min = battery._dt_min;
 	_last_idx = battery._last_idx;
+	select_engine();
 }
 
 battery_t::~battery_t()
@@ -1515,6 +1650,24 @@ void battery_t::copy(const battery_t * battery)
 	_dt_min = battery->_dt_min;
 	_last_idx = battery->_last_idx;
 }
+void battery_t::save_state(battery_state_t &state) const
+{
+	_capacity->save_state(state.capacity);
+	_voltage->save_state(state.cell_voltage);
+	_thermal->save_state(state.thermal);
+	_lifetime->save_state(state.lifetime);
+	_losses->save_state(state.losses_nCycle);
+	state.last_idx = _last_idx;
+}
+void battery_t::restore_state(const battery_state_t &state)
+{
+	_capacity->restore_state(state.capacity);
+	_voltage->restore_state(state.cell_voltage);
+	_thermal->restore_state(state.thermal);
+	_lifetime->restore_state(state.lifetime);
+	_losses->restore_state(state.losses_nCycle);
+	_last_idx = state.last_idx;
+}
 
 void battery_t::delete_clone()
 {
@@ -1538,9 +1691,85 @@ void battery_t::initialize(capacity_t *capacity, voltage_t * voltage, lifetime_t
 
 	_capacity_initial->copy(_capacity);
 	_thermal_initial->copy(_thermal);
+	select_engine();
+}
+
+void battery_t::select_engine()
+{
+	_run = &battery_t::run_polymorphic;
+
+	// the initial capacity model is used as scratch space each step, so it must be the same type
+	if (typeid(*_capacity) != typeid(*_capacity_initial))
+		return;
+
+	if (dynamic_cast<capacity_lithium_ion_t*>(_capacity))
+	{
+		if (dynamic_cast<voltage_dynamic_t*>(_voltage))
+			_run = &battery_t::run_engine<capacity_lithium_ion_t, voltage_dynamic_t>;
+		else if (dynamic_cast<voltage_table_t*>(_voltage))
+			_run = &battery_t::run_engine<capacity_lithium_ion_t, voltage_table_t>;
+		else if (dynamic_cast<voltage_vanadium_redox_t*>(_voltage))
+			_run = &battery_t::run_engine<capacity_lithium_ion_t, voltage_vanadium_redox_t>;
+	}
+	else if (dynamic_cast<capacity_kibam_t*>(_capacity))
+	{
+		if (dynamic_cast<voltage_dynamic_t*>(_voltage))
+			_run = &battery_t::run_engine<capacity_kibam_t, voltage_dynamic_t>;
+		else if (dynamic_cast<voltage_table_t*>(_voltage))
+			_run = &battery_t::run_engine<capacity_kibam_t, voltage_table_t>;
+	}
 }
 
 void battery_t::run(size_t idx, double I)
+{
+	(this->*_run)(idx, I);
+}
+
+template <class Capacity, class Voltage>
+void battery_t::run_engine(size_t idx, double I)
+{
+	// Same sequence as run_polymorphic, but with the model calls qualified so they bind statically.
+	// The whole capacity state is copied by assignment, which is what Capacity::copy does field by field.
+	Capacity * capacity = static_cast<Capacity*>(_capacity);
+	Capacity * capacity_initial = static_cast<Capacity*>(_capacity_initial);
+	Voltage * voltage = static_cast<Voltage*>(_voltage);
+
+	double I_initial = I;
+	size_t iterate_count = 0;
+	*capacity_initial = *capacity;
+	_thermal_initial->copy(_thermal);
+
+	while (iterate_count < 5)
+	{
+		_thermal->updateTemperature(I, voltage->R_battery(), _dt_hour);
+		if (fabs(I) > tolerance)
+			capacity->Capacity::updateCapacityForThermal(_thermal->capacity_percent());
+		capacity->Capacity::updateCapacity(I, _dt_hour);
+
+		if (fabs(I - I_initial)/fabs(I_initial) > tolerance)
+		{
+			_thermal->copy(_thermal_initial);
+			*capacity = *capacity_initial;
+			I_initial = I;
+			iterate_count++;
+		}
+		else {
+			break;
+		}
+	}
+	voltage->Voltage::updateVoltage(capacity, _thermal, _dt_hour);
+
+	_lifetime->runLifetimeModels(idx, capacity, _thermal->T_battery());
+	if (_lifetime->check_replaced())
+	{
+		capacity->Capacity::replace_battery();
+		_thermal->replace_battery();
+		_losses->replace_battery();
+	}
+	runLossesModel(idx);
+}
+
+void battery_t::run_polymorphic(size_t idx, double I)
 {	
 
 	// Temperature affects capacity, but capacity model can reduce current, which reduces temperature, need to iterate
@@ -84,6 +84,27 @@ protected:
 	std::vector<int> count;
 };
 
+/*
+Capacity state which changes with time.  The KiBaM fields are unused by the other models.
+*/
+struct capacity_state_t
+{
+	double q0;
+	double qmax;
+	double qmax_thermal;
+	double I;
+	double I_loss;
+	double SOC;
+	double DOD;
+	double DOD_prev;
+	double dt_hour;
+	bool chargeChange;
+	int prev_charge;
+	int charge;
+	double q1_0;
+	double q2_0;
+};
+
 /*
 Base class from which capacity models derive
 Note, all capacity models are based on the capacity of one battery
@@ -102,6 +123,10 @@ public:
 	// shallow copy from capacity to this
 	virtual void copy(capacity_t *);
 
+	// checkpoint and restore the state which changes with time
+	virtual void save_state(capacity_state_t &state) const;
+	virtual void restore_state(const capacity_state_t &state);
+
 	// virtual destructor
 	virtual ~capacity_t(){};
 	
@@ -170,6 +195,9 @@ public:
 	// copy from capacity to this
 	void copy(capacity_t *);
 
+	void save_state(capacity_state_t &state) const;
+	void restore_state(const capacity_state_t &state);
+
 	void updateCapacity(double &I, double dt);
 	void updateCapacityForThermal(double capacity_percent);
 	void updateCapacityForLifetime(double capacity_percent);
@@ -254,6 +282,9 @@ public:
 	// copy from voltage to this
 	virtual void copy(voltage_t *);
 
+	// checkpoint and restore the cell voltage
+	void save_state(double &cell_voltage) const;
+	void restore_state(double cell_voltage);
 
 	virtual ~voltage_t(){};
 
@@ -381,6 +412,30 @@ private:
 };
 
 
+/*
+Rainflow counter state.
+Only the residual reversals are kept, and their ranges strictly decrease toward the top of the
+stack, so it stays shallow.  Space for RAINFLOW_STACK_RESERVE reversals is reserved up front and
+the stack grows past that only for long damped oscillations, so a checkpoint that is reused does
+not allocate.  Counted cycles are also binned by range in the histogram.
+*/
+#define RAINFLOW_STACK_RESERVE 64
+#define RAINFLOW_HISTOGRAM_BINS 20
+
+struct lifetime_cycle_state_t
+{
+	int nCycles;
+	double q;
+	double Dlt;
+	int jlt;
+	double Xlt;
+	double Ylt;
+	double Range;
+	double average_range;
+	std::vector<double> Peaks;
+	int histogram[RAINFLOW_HISTOGRAM_BINS];
+};
+
 /*
 Lifetime cycling class.  
 */
@@ -409,11 +464,19 @@ public:
 	int cycles_elapsed();
 	double cycle_range();
 
+	// number of cycles counted with a range in [bin, bin+1)*100/RAINFLOW_HISTOGRAM_BINS % DOD
+	int cycles_in_range_bin(int bin);
+
+	// checkpoint and restore the counter and degradation state
+	void save_state(lifetime_cycle_state_t &state) const;
+	void restore_state(const lifetime_cycle_state_t &state);
+
 protected:
 	
 	void rainflow_ranges();
 	void rainflow_ranges_circular(int index);
 	int rainflow_compareRanges();
+	void rainflow_countCycle(double range);
 	double bilinear(double DOD, int cycle_number);
 
 	util::matrix_t<double> _cycles_vs_DOD;
@@ -432,6 +495,7 @@ protected:
 	std::vector<double> _Peaks;
 	double _Range;
 	double _average_range;
+	int _histogram[RAINFLOW_HISTOGRAM_BINS];
 
 	enum RETURN_CODES
 	{
@@ -440,6 +504,18 @@ protected:
 		LT_RERANGE
 	};
 };
+/*
+Lifetime calendar state
+*/
+struct lifetime_calendar_state_t
+{
+	int day_age_of_battery;
+	size_t last_idx;
+	double q;
+	double dq_old;
+	double dq_new;
+};
+
 /*
 Lifetime calendar model
 */
@@ -456,6 +532,10 @@ public:
 	// copy from lifetime_calendar to this
 	void copy(lifetime_calendar_t *);
 
+	// checkpoint and restore the calendar age and degradation state
+	void save_state(lifetime_calendar_state_t &state) const;
+	void restore_state(const lifetime_calendar_state_t &state);
+
 	/// Given the index of the simulation, the tempertature and SOC, return the effective capacity percent
 	double runLifetimeCalendarModel(size_t idx, double T, double SOC);
 
@@ -494,6 +574,18 @@ private:
 	float _c;  // K
 };
 
+/*
+Combined lifetime state
+*/
+struct lifetime_state_t
+{
+	double q;
+	int replacements;
+	bool replacement_scheduled;
+	lifetime_cycle_state_t cycle;
+	lifetime_calendar_state_t calendar;
+};
+
 /*
 Class to encapsulate multiple lifetime models, and linearly combined the associated degradation and handle replacements
 */
@@ -512,6 +604,10 @@ public:
 	// copy lifetime to this
 	void copy(lifetime_t *);
 
+	// checkpoint and restore the cycle, calendar and replacement state
+	void save_state(lifetime_state_t &state) const;
+	void restore_state(const lifetime_state_t &state);
+
 	void runLifetimeModels(size_t idx, capacity_t *, double T_battery);
 
 	double capacity_percent();
@@ -541,6 +637,16 @@ protected:
 };
 
 
+/*
+Thermal state
+*/
+struct thermal_state_t
+{
+	double T_battery;
+	double capacity_percent;
+	double R;
+};
+
 /*
 Thermal classes
 */
@@ -558,6 +664,10 @@ public:
 	// copy thermal to this
 	void copy(thermal_t *);
 
+	// checkpoint and restore the temperature state
+	void save_state(thermal_state_t &state) const;
+	void restore_state(const thermal_state_t &state);
+
 	void updateTemperature(double I, double R, double dt);
 	void replace_battery();
 
@@ -605,6 +715,10 @@ public:
 	// copy losses to this
 	void copy(losses_t *);
 
+	// checkpoint and restore the loss state
+	void save_state(int &nCycle) const;
+	void restore_state(int nCycle);
+
 	// main APIs
 	void run_losses(double dt_hour, size_t index);
 	void replace_battery();
@@ -626,6 +740,22 @@ protected:
 	double_vec  _full_loss;
 };
 
+/*
+Battery state snapshot.
+Everything the models advance during a step, so that dispatch can checkpoint and
+rewind the battery with an assignment instead of copying the model objects.  Model parameters and
+input tables don't change during a simulation and are not part of the state.
+*/
+struct battery_state_t
+{
+	capacity_state_t capacity;
+	double cell_voltage;
+	thermal_state_t thermal;
+	lifetime_state_t lifetime;
+	int losses_nCycle;
+	size_t last_idx;
+};
+
 /*
 Class which encapsulates a battery and all its models
 */
@@ -642,6 +772,10 @@ public:
 	// copy members from battery to this
 	void copy(const battery_t * battery);
 
+	// checkpoint and restore the state of all models, a reused state only allocates if the rainflow stack grows
+	void save_state(battery_state_t &state) const;
+	void restore_state(const battery_state_t &state);
+
 	// virtual destructor, does nothing as no memory allocated in constructor
 	virtual ~battery_t();
 
@@ -653,6 +787,13 @@ public:
 	// Run all
 	void run(size_t idx, double I);
 
+	// Run all through the virtual model interfaces, regardless of the engine selected in initialize()
+	void run_polymorphic(size_t idx, double I);
+
+	// Run all with the model calls bound at compile time to concrete capacity and voltage models
+	template <class Capacity, class Voltage>
+	void run_engine(size_t idx, double I);
+
 	// Run a component level model
 	void runCapacityModel(double &I);
 	void runVoltageModel();
@@ -688,6 +829,12 @@ public:
 
 
 private:
+	// choose the run_engine instantiation matching the capacity and voltage models
+	void select_engine();
+
+	typedef void (battery_t::*run_function)(size_t, double);
+	run_function _run;
+
 	capacity_t * _capacity;
 	capacity_t * _capacity_initial;
 	thermal_t * _thermal;
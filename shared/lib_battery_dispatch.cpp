@@ -50,6 +50,8 @@
 #include <algorithm>
 #include <numeric>
 
+#include "lp_lib.h"
+
 /*
 Dispatch base class
 */
@@ -68,9 +70,9 @@ dispatch_t::dispatch_t(battery_t * Battery, double dt_hour, double SOC_min, doub
 	m_batteryPower->powerBatteryDischargeMax = Pd_max;
 	m_batteryPower->meterPosition = battMeterPosition;
 
-	// initalize Battery and a copy of the Battery for iteration
+	// initalize Battery and checkpoint its state for iteration
 	_Battery = Battery;
-	_Battery_initial = new battery_t(*_Battery);
+	_Battery->save_state(_Battery_initial);
 
 	// Call the dispatch init method
 	init(_Battery, dt_hour, current_choice, t_min, mode);
@@ -114,7 +116,7 @@ dispatch_t::dispatch_t(const dispatch_t& dispatch)
 	m_batteryPower = m_batteryPowerFlow->getBatteryPower();
 
 	_Battery = new battery_t(*dispatch._Battery);
-	_Battery_initial = new battery_t(*dispatch._Battery_initial);
+	_Battery_initial = dispatch._Battery_initial;
 	init(_Battery, dispatch._dt_hour, dispatch._current_choice, dispatch._t_min, dispatch._mode);
 }
 
@@ -122,7 +124,7 @@ dispatch_t::dispatch_t(const dispatch_t& dispatch)
 void dispatch_t::copy(const dispatch_t * dispatch)
 {
 	_Battery->copy(dispatch->_Battery);
-	_Battery_initial->copy(dispatch->_Battery_initial);
+	_Battery_initial = dispatch->_Battery_initial;
 	init(_Battery, dispatch->_dt_hour,  dispatch->_current_choice, dispatch->_t_min, dispatch->_mode);
 
 	// can't create shallow copy of unique ptr
@@ -132,19 +134,16 @@ void dispatch_t::copy(const dispatch_t * dispatch)
 }
 void dispatch_t::delete_clone()
 {
-	// need to delete both, since allocated memory for both in deep copy 
+	// allocated memory for the battery in deep copy
 	if (_Battery) delete _Battery;
-	if (_Battery_initial) delete _Battery_initial;
 }
 dispatch_t::~dispatch_t()
 {
 	// original _Battery doesn't need deleted, since was a pointer passed in
-	_Battery_initial->delete_clone();
-	delete _Battery_initial;
 }
 void dispatch_t::finalize(size_t idx, double &I)
 {
-	_Battery->copy(_Battery_initial);
+	_Battery->restore_state(_Battery_initial);
 	m_batteryPower->powerBattery = 0;
 	m_batteryPower->powerGridToBattery = 0;
 	m_batteryPower->powerBatteryToGrid = 0;
@@ -209,7 +208,7 @@ bool dispatch_t::check_constraints(double &I, size_t count)
 	// reset
 	if (iterate)
 	{
-		_Battery->copy(_Battery_initial);
+		_Battery->restore_state(_Battery_initial);
 		m_batteryPower->powerBattery = 0;
 		m_batteryPower->powerGridToBattery = 0;
 		m_batteryPower->powerBatteryToGrid = 0;
@@ -340,7 +339,7 @@ void dispatch_t::runDispatch(size_t year, size_t hour_of_year, size_t step)
 	double I = current_controller(_Battery->battery_voltage_nominal());
 
 	// Setup battery iteration
-	_Battery_initial->copy(_Battery);
+	_Battery->save_state(_Battery_initial);
 	bool iterate = true;
 	size_t count = 0;
 	size_t idx = util::index_year_hour_step(year, hour_of_year, step, static_cast<size_t>(1 / _dt_hour));
@@ -543,7 +542,7 @@ bool dispatch_manual_t::check_constraints(double &I, size_t count)
 		// reset
 		if (iterate)
 		{
-			_Battery->copy(_Battery_initial);
+			_Battery->restore_state(_Battery_initial);
 			m_batteryPower->powerBattery = 0;
 			m_batteryPower->powerGridToBattery = 0;
 			m_batteryPower->powerBatteryToGrid = 0;
@@ -791,7 +790,7 @@ bool dispatch_automatic_t::check_constraints(double &I, size_t count)
 		// reset
 		if (iterate)
 		{
-			_Battery->copy(_Battery_initial);
+			_Battery->restore_state(_Battery_initial);
 			m_batteryPower->powerBattery = 0;
 			m_batteryPower->powerGridToBattery = 0;
 			m_batteryPower->powerBatteryToGrid = 0;
@@ -905,7 +904,7 @@ void dispatch_automatic_behind_the_meter_t::update_dispatch(size_t hour_of_year,
 			// setup vectors
 			initialize(hour_of_year);
 
-			// compute grid power, sort highest to lowest
+			// compute grid power, select the peak
 			sort_grid(p, debug, idx);
 
 			// Peak shaving scheme
@@ -1002,7 +1001,8 @@ void dispatch_automatic_behind_the_meter_t::sort_grid(FILE *p, bool debug, size_
 			count++;
 		}
 	}
-	std::sort(sorted_grid.begin(), sorted_grid.end(), byGrid());
+	// only the peak is needed to compare against the monthly target, the rest is ordered in target_power if a new target is computed
+	std::iter_swap(sorted_grid.begin(), std::min_element(sorted_grid.begin(), sorted_grid.end(), byGrid()));
 }
 
 void dispatch_automatic_behind_the_meter_t::compute_energy(FILE *p, bool debug, double & E_max)
@@ -1038,45 +1038,27 @@ void dispatch_automatic_behind_the_meter_t::target_power(FILE*p, bool debug, dou
 	// otherwise, compute one target for the next 24 hours.
 	else
 	{
-		// First compute target power which will allow battery to charge up to E_useful over 24 hour period
+		// sort highest to lowest, the peak is already in place
+		std::sort(sorted_grid.begin() + 1, sorted_grid.end(), byGrid());
+
+		// Energy which will allow battery to charge up to E_useful over 24 hour period at each candidate target,
+		// only computed for the targets the search below reaches
 		if (debug)
 			fprintf(p, "Index\tRecharge_target\t charge_energy\n");
 
-		double P_target = sorted_grid[0].Grid();
-		double P_target_min = 1e16;
-		double E_charge = 0.;
-		int index = (int)_num_steps - 1;
-		std::vector<double> E_charge_vec;
-		for (int jj = (int)_num_steps - 1; jj >= 0; jj--)
-		{
-			E_charge = 0.;
-			P_target_min = sorted_grid[index].Grid();
-
-			for (int ii = (int)_num_steps - 1; ii >= 0; ii--)
-			{
-				if (sorted_grid[ii].Grid() > P_target_min)
-					break;
-
-				E_charge += (P_target_min - sorted_grid[ii].Grid())*_dt_hour;
-			}
-			E_charge_vec.push_back(E_charge);
-			if (debug)
-				fprintf(p, "%u: index\t%.3f\t %.3f\n", index, P_target_min, E_charge);
-			index--;
+		double_vec E_charge_vec(_num_steps, -1.);
 
-			if (index < 0)
-				break;
+		// sums of grid power at and below each index, to estimate the recharge energy without walking the grid
+		double_vec grid_below(_num_steps + 1, 0.);
+		double_vec abs_grid_below(_num_steps + 1, 0.);
+		for (int ii = (int)_num_steps - 1; ii >= 0; ii--)
+		{
+			grid_below[ii] = grid_below[ii + 1] + sorted_grid[ii].Grid();
+			abs_grid_below[ii] = abs_grid_below[ii + 1] + fabs(sorted_grid[ii].Grid());
 		}
-		std::reverse(E_charge_vec.begin(), E_charge_vec.end());
 
 		// Calculate target power 
-		std::vector<double> sorted_grid_diff;
-		sorted_grid_diff.reserve(_num_steps - 1);
-
-		for (size_t ii = 0; ii != _num_steps - 1; ii++)
-			sorted_grid_diff.push_back(sorted_grid[ii].Grid() - sorted_grid[ii + 1].Grid());
-
-		P_target = sorted_grid[0].Grid(); // target power to shave to [kW]
+		double P_target = sorted_grid[0].Grid(); // target power to shave to [kW]
 		double sum = 0;			   // energy [kWh];
 		if (debug)
 			fprintf(p, "Step\tTarget_Power\tEnergy_Sum\tEnergy_charged\n");
@@ -1094,7 +1076,8 @@ void dispatch_automatic_behind_the_meter_t::target_power(FILE*p, bool debug, dou
 				fprintf(p, "%lu\t %.3f\t", (unsigned long)ii, P_target);
 
 			// implies a repeated power
-			if (sorted_grid_diff[ii] == 0)
+			double sorted_grid_diff = sorted_grid[ii].Grid() - sorted_grid[ii + 1].Grid();
+			if (sorted_grid_diff == 0)
 			{
 				if (debug)
 					fprintf(p, "\n");
@@ -1102,20 +1085,32 @@ void dispatch_automatic_behind_the_meter_t::target_power(FILE*p, bool debug, dou
 			}
 			// add to energy we are trimming
 			else
-				sum += sorted_grid_diff[ii] * (ii + 1)*_dt_hour;
+				sum += sorted_grid_diff * (ii + 1)*_dt_hour;
 
+			// far from the limits, a lower bound on the recharge energy is enough to keep going
+			if (!debug && sum < E_useful)
+			{
+				double n_below = (double)(_num_steps - ii - 1);
+				double E_estimate = (P_target * n_below - grid_below[ii + 1]) * _dt_hour;
+				double E_error = 1e-9 * (fabs(P_target) * n_below + abs_grid_below[ii + 1]) * _dt_hour;
+				if (sum < E_estimate - E_error)
+					continue;
+			}
+
+			double E_charge = recharge_energy(p, debug, E_charge_vec, ii + 1);
 			if (debug)
-				fprintf(p, "%.3f\t%.3f\n", sum, E_charge_vec[ii + 1]);
+				fprintf(p, "%.3f\t%.3f\n", sum, E_charge);
 
-			if (sum < E_charge_vec[ii + 1] && sum < E_useful)
+			if (sum < E_charge && sum < E_useful)
 				continue;
 			// we have limited power, we'll shave what more we can
-			else if (sum > E_charge_vec[ii + 1])
+			else if (sum > E_charge)
 			{
-				P_target += (sum - E_charge_vec[ii]) / ((ii + 1)*_dt_hour);
-				sum = E_charge_vec[ii];
+				E_charge = recharge_energy(p, debug, E_charge_vec, ii);
+				P_target += (sum - E_charge) / ((ii + 1)*_dt_hour);
+				sum = E_charge;
 				if (debug)
-					fprintf(p, "%lu\t %.3f\t%.3f\t%.3f\n", (unsigned long)ii, P_target, sum, E_charge_vec[ii]);
+					fprintf(p, "%lu\t %.3f\t%.3f\t%.3f\n", (unsigned long)ii, P_target, sum, E_charge);
 				break;
 			}
 			// only allow one cycle per day
@@ -1124,7 +1119,7 @@ void dispatch_automatic_behind_the_meter_t::target_power(FILE*p, bool debug, dou
 				P_target += (sum - E_useful) / ((ii + 1)*_dt_hour);
 				sum = E_useful;
 				if (debug)
-					fprintf(p, "%lu\t %.3f\t%.3f\t%.3f\n", (unsigned long)ii, P_target, sum, E_charge_vec[ii]);
+					fprintf(p, "%lu\t %.3f\t%.3f\t%.3f\n", (unsigned long)ii, P_target, sum, recharge_energy(p, debug, E_charge_vec, ii));
 				break;
 			}
 		}
@@ -1147,6 +1142,28 @@ void dispatch_automatic_behind_the_meter_t::target_power(FILE*p, bool debug, dou
 	}
 }
 
+double dispatch_automatic_behind_the_meter_t::recharge_energy(FILE *p, bool debug, double_vec &E_charge_vec, size_t index)
+{
+	// energy to charge from each lower grid power up to sorted_grid[index], summed from the lowest up.  Cached, since the
+	// target search asks for neighbouring indices
+	if (E_charge_vec[index] < 0)
+	{
+		double P_target_min = sorted_grid[index].Grid();
+		double E_charge = 0.;
+		for (int ii = (int)_num_steps - 1; ii >= 0; ii--)
+		{
+			if (sorted_grid[ii].Grid() > P_target_min)
+				break;
+
+			E_charge += (P_target_min - sorted_grid[ii].Grid())*_dt_hour;
+		}
+		E_charge_vec[index] = E_charge;
+		if (debug)
+			fprintf(p, "%zu: index\t%.3f\t %.3f\n", index, P_target_min, E_charge);
+	}
+	return E_charge_vec[index];
+}
+
 void dispatch_automatic_behind_the_meter_t::set_battery_power(FILE *p, bool debug)
 {
 	for (size_t i = 0; i != _P_target_use.size(); i++)
@@ -1194,6 +1211,9 @@ dispatch_automatic_front_of_meter_t::dispatch_automatic_front_of_meter_t(
 	if (_mode == dispatch_t::FOM_LOOK_BEHIND)
 		_look_ahead_hours = 24;
 
+	// linear program is built on the first dispatch update
+	m_lp = NULL;
+
 	_inverter_paco = inverter_paco;
 	_ppa_factors = ppa_factors;
 
@@ -1216,7 +1236,11 @@ dispatch_automatic_front_of_meter_t::dispatch_automatic_front_of_meter_t(
 	
 	setup_cost_vector(ppa_weekday_schedule, ppa_weekend_schedule);
 }
-dispatch_automatic_front_of_meter_t::~dispatch_automatic_front_of_meter_t(){ /* NOTHING TO DO */}
+dispatch_automatic_front_of_meter_t::~dispatch_automatic_front_of_meter_t()
+{
+	if (m_lp)
+		delete_lp(m_lp);
+}
 void dispatch_automatic_front_of_meter_t::init_with_pointer(const dispatch_automatic_front_of_meter_t* tmp)
 {
 	_look_ahead_hours = tmp->_look_ahead_hours;
@@ -1228,6 +1252,10 @@ void dispatch_automatic_front_of_meter_t::init_with_pointer(const dispatch_autom
 	m_etaPVCharge = tmp->m_etaPVCharge;
 	m_etaGridCharge = tmp->m_etaGridCharge;
 	m_etaDischarge = tmp->m_etaDischarge;
+
+	// the optimized plan for the current update window, the linear program itself is not shared
+	if (_mode == dispatch_t::FOM_OPTIMIZED_LOOK_AHEAD)
+		_P_battery_use = tmp->_P_battery_use;
 }
 
 void dispatch_automatic_front_of_meter_t::setup_cost_vector(util::matrix_t<size_t> ppa_weekday_schedule, util::matrix_t<size_t> ppa_weekend_schedule)
@@ -1259,6 +1287,7 @@ void dispatch_automatic_front_of_meter_t::setup_cost_vector(util::matrix_t<size_
 dispatch_automatic_front_of_meter_t::dispatch_automatic_front_of_meter_t(const dispatch_t & dispatch) :
 dispatch_automatic_t(dispatch)
 {
+	m_lp = NULL;
 	const dispatch_automatic_front_of_meter_t * tmp = dynamic_cast<const dispatch_automatic_front_of_meter_t *>(&dispatch);
 	init_with_pointer(tmp);
 }
@@ -1288,14 +1317,30 @@ void dispatch_automatic_front_of_meter_t::dispatch(size_t year,
 	dispatch_automatic_t::dispatch(year, hour_of_year, step, P_system, P_system_clipped, P_load_ac);
 }
 
-void dispatch_automatic_front_of_meter_t::update_dispatch(size_t hour_of_year, size_t , size_t idx)
+void dispatch_automatic_front_of_meter_t::update_dispatch(size_t hour_of_year, size_t step, size_t idx)
 {
 	// Initialize
 	m_batteryPower->powerBattery = 0;
 	m_batteryPower->powerBatteryTarget = 0;
 
 
-	if (_mode != dispatch_t::FOM_CUSTOM_DISPATCH)
+	if (_mode == dispatch_t::FOM_OPTIMIZED_LOOK_AHEAD)
+	{
+		if (idx == _index_last_updated + _d_index_update || idx == 0)
+		{
+			if (idx > 0) {
+				_index_last_updated += _d_index_update;
+			}
+
+			/*! Cost to cycle the battery at all, using maximum DOD or user input */
+			costToCycle();
+			optimize_dispatch(hour_of_year, step, idx);
+		}
+		size_t offset = idx - _index_last_updated;
+		if (offset < _P_battery_use.size())
+			m_batteryPower->powerBatteryTarget = _P_battery_use[offset];
+	}
+	else if (_mode != dispatch_t::FOM_CUSTOM_DISPATCH)
 	{
 
 		// Power to charge (<0) or discharge (>0)
@@ -1413,6 +1458,144 @@ void dispatch_automatic_front_of_meter_t::update_cliploss_data(double_vec P_clip
 		_P_cliploss_dc.push_back(P_cliploss[i]);
 }
 
+namespace
+{
+	/*! Columns per linear program period: charge from PV, charge from clipped PV, charge from grid, discharge, stored energy.
+	    Charge and discharge are the power drawn from the source and delivered to the grid, the stored energy is on the battery side. */
+	const int lpColumnsPerPeriod = 5;
+
+	/*! Rows per linear program period: total charge limit, energy balance */
+	const int lpRowsPerPeriod = 2;
+}
+
+void dispatch_automatic_front_of_meter_t::setup_optimization()
+{
+	// The update window is resolved at the simulation time step, the rest of the horizon in hourly periods
+	// since prices are hourly.  This keeps the problem small at sub-hourly time steps.
+	size_t stepsHorizon = std::max(_look_ahead_hours * _steps_per_hour, _d_index_update);
+	m_lpPeriodSteps.clear();
+	for (size_t i = 0; i != _d_index_update; i++)
+		m_lpPeriodSteps.push_back(1);
+	for (size_t i = _d_index_update; i < stepsHorizon; i += _steps_per_hour)
+		m_lpPeriodSteps.push_back(std::min(_steps_per_hour, stepsHorizon - i));
+
+	int nPeriods = (int)m_lpPeriodSteps.size();
+	m_lp = make_lp(0, lpColumnsPerPeriod * nPeriods);
+	set_verbose(m_lp, 0);
+	set_maxim(m_lp);
+
+	// Constraint matrix is fixed, only bounds, objective and right-hand sides change between horizons
+	REAL row[6];
+	int col[6];
+	set_add_rowmode(m_lp, TRUE);
+	for (int t = 0; t != nPeriods; t++)
+	{
+		int c = lpColumnsPerPeriod * t + 1;
+		double dtPeriod = m_lpPeriodSteps[t] * _dt_hour;
+
+		// eta_pv * (c_pv + c_clip) + eta_grid * c_grid <= P_charge_max
+		row[0] = row[1] = m_etaPVCharge; row[2] = m_etaGridCharge;
+		col[0] = c; col[1] = c + 1; col[2] = c + 2;
+		add_constraintex(m_lp, 3, row, col, LE, 0.);
+
+		// E_t - E_(t-1) - dt * (eta_pv * (c_pv + c_clip) + eta_grid * c_grid) + dt * d / eta_d = 0, E_(-1) moved to the right-hand side
+		int n = 0;
+		row[n] = 1.; col[n++] = c + 4;
+		if (t > 0) {
+			row[n] = -1.; col[n++] = c + 4 - lpColumnsPerPeriod;
+		}
+		row[n] = -dtPeriod * m_etaPVCharge; col[n++] = c;
+		row[n] = -dtPeriod * m_etaPVCharge; col[n++] = c + 1;
+		row[n] = -dtPeriod * m_etaGridCharge; col[n++] = c + 2;
+		row[n] = dtPeriod / m_etaDischarge; col[n++] = c + 3;
+		add_constraintex(m_lp, n, row, col, EQ, 0.);
+	}
+	set_add_rowmode(m_lp, FALSE);
+
+	_P_battery_use.clear();
+	_P_battery_use.resize(_d_index_update, 0.);
+}
+
+void dispatch_automatic_front_of_meter_t::optimize_dispatch(size_t hour_of_year, size_t step, size_t idx)
+{
+	if (!m_lp)
+		setup_optimization();
+
+	// Battery energy limits (kWh)
+	double energyMax = _Battery->battery_charge_maximum() * _Battery->battery_voltage_nominal() * util::watt_to_kilowatt;
+	double energyNow = energyMax * _Battery->battery_soc() * 0.01;
+	double energyLow = std::min(energyMax * m_batteryPower->stateOfChargeMin * 0.01, energyNow);
+	double energyHigh = std::max(energyMax * m_batteryPower->stateOfChargeMax * 0.01, energyNow);
+	double powerChargeMax = m_batteryPower->powerBatteryChargeMax;
+	double powerDischargeMax = m_batteryPower->powerBatteryDischargeMax;
+
+	size_t nPeriods = m_lpPeriodSteps.size();
+	std::vector<REAL> objective(lpColumnsPerPeriod * nPeriods + 1, 0.);
+	size_t stepOfYear = hour_of_year * _steps_per_hour + step;
+	size_t k = 0;
+	for (size_t t = 0; t != nPeriods; t++)
+	{
+		// Period averages of the forecast, the current step uses the actual PV and clipping
+		double powerPV = 0, powerClipped = 0, powerDischarge = 0, ppaCost = 0, usageCost = 0;
+		for (size_t s = 0; s != m_lpPeriodSteps[t]; s++, k++)
+		{
+			double pv = 0, clipped = 0;
+			if (k == 0) {
+				pv = m_batteryPower->powerPV;
+				clipped = m_batteryPower->powerPVClipped;
+			}
+			else {
+				if (_P_pv_dc.size() > 0)
+					pv = _P_pv_dc[(idx + k) % _P_pv_dc.size()];
+				if (_P_cliploss_dc.size() > idx + k)
+					clipped = _P_cliploss_dc[idx + k];
+			}
+			size_t hour = (stepOfYear + k) / _steps_per_hour;
+			double cost = _ppa_cost_vector[hour < _ppa_cost_vector.size() ? hour : hour % 8760];
+			powerPV += pv;
+			powerClipped += clipped;
+			powerDischarge += std::fmin(powerDischargeMax * m_etaDischarge, std::fmax(0., _inverter_paco - pv));
+			ppaCost += cost;
+			usageCost += m_utilityRateCalculator ? m_utilityRateCalculator->getEnergyRate(hour % 8760) : cost;
+		}
+		double n = (double)m_lpPeriodSteps[t];
+		double dtPeriod = n * _dt_hour;
+		ppaCost /= n;
+		usageCost /= n;
+
+		int c = lpColumnsPerPeriod * (int)t + 1;
+		set_upbo(m_lp, c, m_batteryPower->canPVCharge ? std::fmax(0., powerPV / n) : 0.);
+		set_upbo(m_lp, c + 1, m_batteryPower->canClipCharge ? std::fmax(0., powerClipped / n) : 0.);
+		set_upbo(m_lp, c + 2, m_batteryPower->canGridCharge ? powerChargeMax : 0.);
+		set_upbo(m_lp, c + 3, powerDischarge / n);
+		set_bounds(m_lp, c + 4, energyLow, energyHigh);
+		set_rh(m_lp, lpRowsPerPeriod * (int)t + 1, powerChargeMax);
+
+		// Revenue ($) of each decision, clipped PV is free and the cycling cost is per kWh discharged from the battery
+		objective[c] = -ppaCost * dtPeriod;
+		objective[c + 1] = 0.;
+		objective[c + 2] = -usageCost * dtPeriod;
+		objective[c + 3] = (ppaCost - m_cycleCost / m_etaDischarge) * dtPeriod;
+		objective[c + 4] = 0.;
+	}
+	set_obj_fn(m_lp, &objective[0]);
+	set_rh(m_lp, 2, energyNow);
+
+	// lp_solve keeps the final basis of the previous horizon, which warm-starts this solve
+	std::vector<REAL> x(objective.size() - 1, 0.);
+	int ret = solve(m_lp);
+	if (ret == OPTIMAL || ret == SUBOPTIMAL)
+		get_variables(m_lp, &x[0]);
+	else
+		default_basis(m_lp);
+
+	for (size_t i = 0; i != _P_battery_use.size(); i++)
+	{
+		size_t c = lpColumnsPerPeriod * i;
+		_P_battery_use[i] = x[c + 3] / m_etaDischarge - (m_etaPVCharge * (x[c] + x[c + 1]) + m_etaGridCharge * x[c + 2]);
+	}
+}
+
 void dispatch_automatic_front_of_meter_t::costToCycle()
 {
 	if (m_battCycleCostChoice == dispatch_t::MODEL_CYCLE_COST)
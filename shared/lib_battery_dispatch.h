@@ -56,6 +56,9 @@
 #ifndef __LIB_BATTERY_DISPATCH_H__
 #define __LIB_BATTERY_DISPATCH_H__
 
+// lp_solve problem, defined in lp_lib.h
+struct _lprec;
+
 namespace battery_dispatch
 {
 	const size_t constraintCount = 10;
@@ -68,7 +71,7 @@ class dispatch_t
 {
 public:
 
-	enum FOM_MODES { FOM_LOOK_AHEAD, FOM_LOOK_BEHIND, FOM_FORECAST, FOM_CUSTOM_DISPATCH, FOM_MANUAL };
+	enum FOM_MODES { FOM_LOOK_AHEAD, FOM_LOOK_BEHIND, FOM_FORECAST, FOM_CUSTOM_DISPATCH, FOM_MANUAL, FOM_OPTIMIZED_LOOK_AHEAD };
 	enum BTM_MODES { LOOK_AHEAD, LOOK_BEHIND, MAINTAIN_TARGET, CUSTOM_DISPATCH, MANUAL };
 	enum METERING { BEHIND, FRONT };
 	enum PV_PRIORITY { MEET_LOAD, CHARGE_BATTERY };
@@ -173,7 +176,7 @@ protected:
 	bool restrict_power(double &I);
 
 	battery_t * _Battery;
-	battery_t * _Battery_initial;
+	battery_state_t _Battery_initial;  // battery state at the start of the step, to rewind to while iterating
 
 	double _dt_hour;
 
@@ -504,6 +507,7 @@ protected:
 	void sort_grid(FILE *p, bool debug, size_t idx);
 	void compute_energy(FILE *p, bool debug, double & E_max);
 	void target_power(FILE*p, bool debug, double E_max, size_t idx);
+	double recharge_energy(FILE *p, bool debug, double_vec &E_charge_vec, size_t index);
 	void set_battery_power(FILE *p, bool debug);
 	void check_new_month(size_t hour_of_year, size_t step);
 
@@ -525,7 +529,7 @@ protected:
 	/* Vector of length (24 hours * steps_per_hour) containing grid calculation [P_grid, hour, step] */
 	grid_vec grid; 
 
-	/* Vector of length (24 hours * steps_per_hour) containing sorted grid calculation [P_grid, hour, step] */
+	/* Vector of length (24 hours * steps_per_hour) containing sorted grid calculation [P_grid, hour, step], peak first, fully sorted only when a new target is computed */
 	grid_vec sorted_grid;
 };
 
@@ -540,6 +544,8 @@ public:
 	 2. Charging from the grid during times of low electricity buy-rates (if grid charging allowed)
 	 3. Charging from the PV array during times of low PPA sell rates
 	 4. Charging from the PV array during times where the PV power would be clipped due to inverter limits (if DC-connected)
+
+	 In FOM_OPTIMIZED_LOOK_AHEAD mode the heuristic is replaced by a linear program over the look-ahead horizon, solved with lp_solve
 	*/
 	dispatch_automatic_front_of_meter_t(
 		battery_t * Battery,
@@ -599,6 +605,9 @@ public:
 	/*! Calculate the cost to cycle */
 	void costToCycle();
 
+	/*! Solve the look-ahead linear program and store the battery power for the steps until the next update */
+	void optimize_dispatch(size_t hour_of_year, size_t step, size_t idx);
+
 	/*! Return the calculated cost to cycle ($/cycle)*/
 	double cost_to_cycle() { return m_cycleCost; }
 
@@ -607,6 +616,9 @@ protected:
 	void init_with_pointer(const dispatch_automatic_front_of_meter_t* tmp);
 	void setup_cost_vector(util::matrix_t<size_t> ppa_weekday_schedule, util::matrix_t<size_t> ppa_weekend_schedule);
 
+	/*! Build the look-ahead linear program structure, which is re-used for every horizon */
+	void setup_optimization();
+
 	/*! Full clipping loss due to AC power limits vector */
 	double_vec _P_cliploss_dc;
 
@@ -631,6 +643,10 @@ protected:
 	double m_etaPVCharge;
 	double m_etaGridCharge;
 	double m_etaDischarge;
+
+	/*! Look-ahead linear program, and the number of time steps in each of its periods */
+	struct _lprec * m_lp;
+	std::vector<size_t> m_lpPeriodSteps;
 };
 
 /*! Battery metrics class */
@@ -1,6 +1,26 @@
+#include <stdexcept>
+
 #include "lib_battery_powerflow.h"
 #include "lib_power_electronics.h"
 
+namespace {
+	/// AC power flow with an idle battery: PV serves the load first and the remainder goes to the grid
+	inline void idleACPowerFlow(double P_pv_ac, double P_load_ac, double P_inverter_draw_ac, double P_system_loss_ac, double tolerance,
+		double &P_pv_to_load_ac, double &P_pv_to_grid_ac, double &P_grid_to_load_ac, double &P_gen_ac, double &P_grid_ac)
+	{
+		P_pv_to_load_ac = P_pv_ac > P_load_ac ? P_load_ac : P_pv_ac;
+		P_pv_to_grid_ac = P_pv_ac - P_pv_to_load_ac;
+		P_grid_to_load_ac = P_load_ac - P_pv_to_load_ac;
+		P_gen_ac = P_pv_ac + P_inverter_draw_ac - P_system_loss_ac;
+		P_grid_ac = P_gen_ac - P_load_ac;
+
+		if (fabs(P_grid_to_load_ac) < tolerance)
+			P_grid_to_load_ac = 0;
+		if (fabs(P_grid_ac) < tolerance)
+			P_grid_ac = 0;
+	}
+}
+
 BatteryPower::BatteryPower(double dtHour) :
 		dtHour(dtHour),
 		powerPV(0),
@@ -82,12 +102,85 @@ BatteryPower * BatteryPowerFlow::getBatteryPower()
 void BatteryPowerFlow::calculate()
 {
 	if (m_BatteryPower->connectionMode == ChargeController::AC_CONNECTED) {
-		calculateACConnected();
+		// the battery is idle whenever the dispatch settles on zero current
+		if (m_BatteryPower->powerBattery == 0)
+			calculateACIdle();
+		else
+			calculateACConnected();
 	}
 	else if (m_BatteryPower->connectionMode == ChargeController::DC_CONNECTED) {
 		calculateDCConnected();
 	}
 }
+void BatteryPowerFlow::calculate(BatteryPowerSeries & series)
+{
+	size_t count = series.powerPV.size();
+	if (series.powerLoad.size() != count || series.powerBattery.size() != count)
+		throw std::invalid_argument("BatteryPowerSeries PV, load and battery power must be the same length.");
+
+	bool hasInverterDraw = !series.powerPVInverterDraw.empty();
+	bool hasSystemLoss = !series.powerSystemLoss.empty();
+	bool hasVoltage = !series.voltageSystem.empty();
+	if ((hasInverterDraw && series.powerPVInverterDraw.size() != count) ||
+		(hasSystemLoss && series.powerSystemLoss.size() != count) ||
+		(hasVoltage && series.voltageSystem.size() != count))
+		throw std::invalid_argument("BatteryPowerSeries optional inputs must be empty or the same length as the PV power.");
+
+	series.powerGrid.resize(count);
+	series.powerGeneratedBySystem.resize(count);
+	series.powerPVToLoad.resize(count);
+	series.powerPVToBattery.resize(count);
+	series.powerPVToGrid.resize(count);
+	series.powerGridToBattery.resize(count);
+	series.powerGridToLoad.resize(count);
+	series.powerBatteryToLoad.resize(count);
+	series.powerBatteryToGrid.resize(count);
+	series.powerConversionLoss.resize(count);
+
+	BatteryPower * power = m_BatteryPower.get();
+	bool isACConnected = power->connectionMode == ChargeController::AC_CONNECTED;
+	for (size_t i = 0; i < count; i++)
+	{
+		double P_inverter_draw_ac = hasInverterDraw ? series.powerPVInverterDraw[i] : power->powerPVInverterDraw;
+		double P_system_loss_ac = hasSystemLoss ? series.powerSystemLoss[i] : power->powerSystemLoss;
+
+		// idle steps of an AC-connected system leave the battery flows and losses at zero
+		if (isACConnected && series.powerBattery[i] == 0 && i + 1 < count)
+		{
+			series.powerBattery[i] = 0;
+			series.powerPVToBattery[i] = 0;
+			series.powerGridToBattery[i] = 0;
+			series.powerBatteryToLoad[i] = 0;
+			series.powerBatteryToGrid[i] = 0;
+			series.powerConversionLoss[i] = 0;
+			idleACPowerFlow(series.powerPV[i], series.powerLoad[i], P_inverter_draw_ac, P_system_loss_ac, power->tolerance,
+				series.powerPVToLoad[i], series.powerPVToGrid[i], series.powerGridToLoad[i], series.powerGeneratedBySystem[i], series.powerGrid[i]);
+			continue;
+		}
+
+		// all other steps, and the last one so that the BatteryPower holds it
+		power->powerPV = series.powerPV[i];
+		power->powerLoad = series.powerLoad[i];
+		power->powerBattery = series.powerBattery[i];
+		power->powerPVInverterDraw = P_inverter_draw_ac;
+		power->powerSystemLoss = P_system_loss_ac;
+		if (hasVoltage)
+			power->voltageSystem = series.voltageSystem[i];
+		calculate();
+
+		series.powerBattery[i] = power->powerBattery;
+		series.powerGrid[i] = power->powerGrid;
+		series.powerGeneratedBySystem[i] = power->powerGeneratedBySystem;
+		series.powerPVToLoad[i] = power->powerPVToLoad;
+		series.powerPVToBattery[i] = power->powerPVToBattery;
+		series.powerPVToGrid[i] = power->powerPVToGrid;
+		series.powerGridToBattery[i] = power->powerGridToBattery;
+		series.powerGridToLoad[i] = power->powerGridToLoad;
+		series.powerBatteryToLoad[i] = power->powerBatteryToLoad;
+		series.powerBatteryToGrid[i] = power->powerBatteryToGrid;
+		series.powerConversionLoss[i] = power->powerConversionLoss;
+	}
+}
 void BatteryPowerFlow::initialize(double stateOfCharge)
 {
 	// If the battery is allowed to discharge, do so
@@ -229,6 +322,26 @@ void BatteryPowerFlow::calculateACConnected()
 	m_BatteryPower->powerConversionLoss = P_batt_to_load_loss_ac + P_grid_to_batt_loss_ac + P_pv_to_batt_loss_ac;
 }
 
+void BatteryPowerFlow::calculateACIdle()
+{
+	double P_pv_to_load_ac, P_pv_to_grid_ac, P_grid_to_load_ac, P_gen_ac, P_grid_ac;
+	idleACPowerFlow(m_BatteryPower->powerPV, m_BatteryPower->powerLoad, m_BatteryPower->powerPVInverterDraw, m_BatteryPower->powerSystemLoss,
+		m_BatteryPower->tolerance, P_pv_to_load_ac, P_pv_to_grid_ac, P_grid_to_load_ac, P_gen_ac, P_grid_ac);
+
+	// assign outputs
+	m_BatteryPower->powerBattery = 0;
+	m_BatteryPower->powerGrid = P_grid_ac;
+	m_BatteryPower->powerGeneratedBySystem = P_gen_ac;
+	m_BatteryPower->powerPVToLoad = P_pv_to_load_ac;
+	m_BatteryPower->powerPVToBattery = 0;
+	m_BatteryPower->powerPVToGrid = P_pv_to_grid_ac;
+	m_BatteryPower->powerGridToBattery = 0;
+	m_BatteryPower->powerGridToLoad = P_grid_to_load_ac;
+	m_BatteryPower->powerBatteryToLoad = 0;
+	m_BatteryPower->powerBatteryToGrid = 0;
+	m_BatteryPower->powerConversionLoss = 0;
+}
+
 void BatteryPowerFlow::calculateDCConnected()
 {
 	// Quantities are AC in KW unless otherwise specified
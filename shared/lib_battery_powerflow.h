@@ -2,9 +2,11 @@
 #define _LIB_BATTERY_POWERFLOW_H_
 
 #include <memory>
+#include <vector>
 #include "lib_shared_inverter.h"
 
 struct BatteryPower;
+struct BatteryPowerSeries;
 
 /**
 * \class BatteryPowerFlow
@@ -44,6 +46,13 @@ public:
 	/// Calculate the power flow for the battery system
 	void calculate();
 
+	/**
+	* Calculate the power flow for a span of time steps in one call.  The constraints, efficiencies and topology are taken
+	* from the BatteryPower, which is left holding the last step.  Idle steps of an AC-connected system are computed in bulk,
+	* all other steps go through calculate().
+	*/
+	void calculate(BatteryPowerSeries & series);
+
 	/// Get Battery Power object
 	BatteryPower * getBatteryPower();
 
@@ -66,6 +75,9 @@ private:
 	*/
 	void calculateACConnected();
 
+	/// Calculate the power flow for an AC connected battery system which neither charges nor discharges
+	void calculateACIdle();
+
 	/// Calculate the power flow for an DC connected battery system
 	void calculateDCConnected();
 
@@ -149,5 +161,38 @@ public:
 	double tolerance;  ///< A numerical tolerance. Below this value, zero out the power flow
 };
 
+/**
+* \struct BatteryPowerSeries
+*
+* \brief
+*
+*  The BatteryPowerSeries structure holds the time series passed to BatteryPowerFlow::calculate(BatteryPowerSeries &).
+*  powerPV, powerLoad and powerBattery must be the same length.  powerBattery is the DC battery power on input and the AC
+*  battery power on output, as in BatteryPower.  The optional inputs are either empty, in which case the value in
+*  BatteryPower is used for every step, or the same length as powerPV.  The outputs are resized by the calculation.
+*/
+struct BatteryPowerSeries
+{
+	// inputs
+	std::vector<double> powerPV;				///< The power production of the PV array (kW)
+	std::vector<double> powerLoad;				///< The power required by the electric load (kW)
+	std::vector<double> powerBattery;			///< The power flow to and from the battery (> 0, discharging, < 0 charging) (kW)
+	std::vector<double> powerPVInverterDraw;	///< Optional, the power draw from the PV inverter (kW)
+	std::vector<double> powerSystemLoss;		///< Optional, the parasitic power loss in the system (kW)
+	std::vector<double> voltageSystem;			///< Optional, the system voltage, only used for DC-connected systems
+
+	// outputs
+	std::vector<double> powerGrid;				///< The power flow to and from the grid (> 0, to grid, < 0 from grid) (kW)
+	std::vector<double> powerGeneratedBySystem; ///< The power generated by the combined power generator and battery (kW)
+	std::vector<double> powerPVToLoad;			///< The power from PV to the electric load (kW)
+	std::vector<double> powerPVToBattery;		///< The power from PV to the battery (kW)
+	std::vector<double> powerPVToGrid;			///< The power from PV to the grid (kW)
+	std::vector<double> powerGridToBattery;		///< The power from the grid to the battery (kW)
+	std::vector<double> powerGridToLoad;		///< The power from the grid to the electric load (kW)
+	std::vector<double> powerBatteryToLoad;		///< The power from the battery to the electric load (kW)
+	std::vector<double> powerBatteryToGrid;		///< The power from the battery to the grid (kW)
+	std::vector<double> powerConversionLoss;	///< The power loss due to conversions in the battery power electronics (kW)
+};
+
 
 #endif
@@ -48,45 +48,162 @@
 *******************************************************************************************************/
 
 #include <math.h>
+#include <cmath>
 #include <limits>
 #include "lib_financial.h"
 
 using namespace libfin;
 
 /* financial code here */
-/* ported from http://code.google.com/p/irr-newtonraphson-calculator/ */
 
-static bool is_valid_iter_bound(double estimatedReturnRate)
+/* rates scanned for a sign change of the npv before refining, denser where returns usually fall */
+static const double irr_scan_rates[] = { -0.9999, -0.999, -0.99, -0.95, -0.9, -0.8, -0.7, -0.6, -0.5, -0.4, -0.3, -0.2, -0.15, -0.1, -0.05,
+	0, 0.05, 0.1, 0.15, 0.2, 0.25, 0.3, 0.4, 0.5, 0.75, 1, 1.5, 2, 3, 5, 10, 100, 1e3, 1e4, 1e6 };
+static const int irr_scan_count = (int)(sizeof(irr_scan_rates) / sizeof(irr_scan_rates[0]));
+/* subintervals of each scanned interval when the scan finds no sign change, for two roots within one interval */
+static const int irr_scan_split = 16;
+
+/* npv of years 0 through Count at Rate */
+static double irr_npv(const double *CashFlows, int Count, double Rate)
+{
+	double x = 1.0 / (1.0 + Rate);
+	double npv = 0;
+	for (int j = Count; j >= 0; j--)
+		npv = npv * x + CashFlows[j];
+	return npv;
+}
+
+/* npv of years 0 through Count at Rate and its derivative with respect to Rate, sharing the discount factors */
+static void irr_npv_slope(const double *CashFlows, int Count, double Rate, double &Npv, double &Slope)
+{
+	double x = 1.0 / (1.0 + Rate);
+	double xj = 1.0;
+	Npv = CashFlows[0];
+	Slope = 0;
+	for (int j = 1; j <= Count; j++)
+	{
+		xj *= x;
+		Npv += CashFlows[j] * xj;
+		Slope -= j * CashFlows[j] * xj;
+	}
+	Slope *= x;
+}
+
+/* scanned interval nearest Guess over which the npv changes sign, Scan[k*Stride] is the npv at Rates[k].
+   Intervals where the npv falls through zero are preferred, an interval where it rises is only taken when there is none. */
+static bool irr_bracket(const double *Rates, int RateCount, const double *Scan, int Stride, double Guess, double &Lower, double &Upper, bool &Falling)
 {
-	return estimatedReturnRate != -1 && (estimatedReturnRate < std::numeric_limits<int>::max()) && (estimatedReturnRate > std::numeric_limits<int>::min());
+	double distance = std::numeric_limits<double>::max();
+	Lower = Upper = std::numeric_limits<double>::quiet_NaN();
+	for (int pass = 0; pass < 2 && distance == std::numeric_limits<double>::max(); pass++)
+	{
+		Falling = (pass == 0);
+		for (int k = 0; k + 1 < RateCount; k++)
+		{
+			double a = Scan[k*Stride], b = Scan[(k + 1)*Stride];
+			if (Falling ? !(a > 0 && b <= 0) : !(a < 0 && b >= 0))
+				continue;
+			double d = 0;
+			if (Guess < Rates[k]) d = Rates[k] - Guess;
+			else if (Guess > Rates[k + 1]) d = Guess - Rates[k + 1];
+			if (d < distance)
+			{
+				distance = d;
+				Lower = Rates[k];
+				Upper = Rates[k + 1];
+			}
+		}
+	}
+	return distance < std::numeric_limits<double>::max();
+}
+
+/* Newton steps from Guess that fall back to bisection whenever they leave the bracket */
+static double irr_refine(const double *CashFlows, int Count, double Guess, double Lower, double Upper, bool Falling, double Tolerance, int MaxIterations)
+{
+	double rate = (Guess > Lower && Guess < Upper) ? Guess : 0.5 * (Lower + Upper);
+	for (int n = 0; n < MaxIterations; n++)
+	{
+		double npv, slope;
+		irr_npv_slope(CashFlows, Count, rate, npv, slope);
+		if (npv == 0)
+			break;
+		if ((npv > 0) == Falling)
+			Lower = rate;
+		else
+			Upper = rate;
+
+		double next = rate - npv / slope;
+		if (!(next > Lower && next < Upper))
+			next = 0.5 * (Lower + Upper);
+		bool converged = (fabs(next - rate) <= Tolerance) || (Upper - Lower <= Tolerance);
+		rate = next;
+		if (converged)
+			break;
+	}
+	return rate;
 }
 
-static double irr_poly_sum(double estimatedReturnRate, const std::vector<double> &CashFlows, int Count)
+double libfin::irr_bracketed(const double *CashFlows, int Count, double Guess, double Tolerance, int MaxIterations)
 {
-    double sumOfPolynomial = 0;
-    if (is_valid_iter_bound(estimatedReturnRate))
+	if (Count < 1)
+		return std::numeric_limits<double>::quiet_NaN();
+
+	double scan[irr_scan_count];
+	for (int k = 0; k < irr_scan_count; k++)
+		scan[k] = irr_npv(CashFlows, Count, irr_scan_rates[k]);
+
+	double lower = 0, upper = 0;
+	bool falling = true;
+	if (!irr_bracket(irr_scan_rates, irr_scan_count, scan, 1, Guess, lower, upper, falling))
 	{
-		for (int j = 0; j < Count && j<(int)CashFlows.size(); j++)
-        {
-			double val = (pow((1 + estimatedReturnRate), j));
-			if (val != 0.0)
-				sumOfPolynomial += CashFlows[j]/val;
-			else
-				break;
-        }
+		// no sign change at the scanned rates, two roots may lie within one interval
+		std::vector<double> rates, fine;
+		for (int k = 0; k + 1 < irr_scan_count; k++)
+			for (int m = 0; m < irr_scan_split; m++)
+				rates.push_back(irr_scan_rates[k] + (irr_scan_rates[k + 1] - irr_scan_rates[k]) * m / irr_scan_split);
+		rates.push_back(irr_scan_rates[irr_scan_count - 1]);
+		for (size_t k = 0; k < rates.size(); k++)
+			fine.push_back(irr_npv(CashFlows, Count, rates[k]));
+		if (!irr_bracket(&rates[0], (int)rates.size(), &fine[0], 1, Guess, lower, upper, falling))
+			return std::numeric_limits<double>::quiet_NaN();
 	}
-    return sumOfPolynomial;
+	return irr_refine(CashFlows, Count, Guess, lower, upper, falling, Tolerance, MaxIterations);
 }
 
-static double irr_derivative_sum(double estimatedReturnRate, const std::vector<double> &CashFlows, int Count)
+void libfin::irr_running(const double *CashFlows, int Count, double *Irr, double Guess, double Tolerance, int MaxIterations)
 {
-    double sumOfDerivative = 0;
-    if (is_valid_iter_bound(estimatedReturnRate))
-		for (int i = 1; i < Count && i < (int)CashFlows.size(); i++)
-        {
-            sumOfDerivative += CashFlows[i]*(i)/pow((1 + estimatedReturnRate), i);
-        }
-    return sumOfDerivative*-1;
+	if (Count < 1)
+		return;
+
+	// every year's npv at a scanned rate comes from one running sum
+	std::vector<double> scan(irr_scan_count * (Count + 1));
+	for (int k = 0; k < irr_scan_count; k++)
+	{
+		double x = 1.0 / (1.0 + irr_scan_rates[k]);
+		double xj = 1.0;
+		double npv = CashFlows[0];
+		double *row = &scan[k * (Count + 1)];
+		row[0] = npv;
+		for (int j = 1; j <= Count; j++)
+		{
+			xj *= x;
+			npv += CashFlows[j] * xj;
+			row[j] = npv;
+		}
+	}
+
+	// each year starts from the previous year's return, which is usually within a few steps of its own
+	for (int i = 1; i <= Count; i++)
+	{
+		double lower = 0, upper = 0;
+		bool falling = true;
+		if (irr_bracket(irr_scan_rates, irr_scan_count, &scan[i], Count + 1, Guess, lower, upper, falling))
+			Irr[i] = irr_refine(CashFlows, i, Guess, lower, upper, falling, Tolerance, MaxIterations);
+		else
+			Irr[i] = irr_bracketed(CashFlows, i, Guess, Tolerance, MaxIterations);
+		if (std::isfinite(Irr[i]))
+			Guess = Irr[i];
+	}
 }
 
 double libfin::irr(double tolerance, int maxIterations, const std::vector<double> &CashFlows, int Count)
@@ -97,34 +214,17 @@ double libfin::irr(double tolerance, int maxIterations, const std::vector<double
 		Messages.Add( "Cash flow for the first period  must be negative and there should");
     }
 */
-	int numberOfIterations=0;
-	double calculatedIRR=0;
 	double initialGuess = 0.1; // 10% is default used in Excel IRR function
 
 	if (CashFlows.size() < 3) 
 		return initialGuess;
 
-    if ( (Count > 1) && (CashFlows[0] <= 0))
-    {
-		double deriv_sum = irr_derivative_sum(initialGuess,CashFlows,Count);
-		if (deriv_sum != 0)
-			calculatedIRR = initialGuess - irr_poly_sum(initialGuess,CashFlows,Count)/deriv_sum;
-		else
-			return initialGuess;
-
-		numberOfIterations++;
-		while (!(fabs(irr_poly_sum(calculatedIRR,CashFlows,Count)) <= tolerance) && (numberOfIterations < maxIterations))
-		{
-			deriv_sum = irr_derivative_sum(initialGuess,CashFlows,Count);
-			if (deriv_sum != 0.0)
-				calculatedIRR = calculatedIRR - irr_poly_sum(calculatedIRR,CashFlows,Count)/deriv_sum;
-			else
-				break;
+	if (Count > (int)CashFlows.size())
+		Count = (int)CashFlows.size();
 
-			numberOfIterations++;
-		}
-	}
-    return calculatedIRR;
+	if ((Count > 1) && (CashFlows[0] <= 0))
+		return irr_bracketed(&CashFlows[0], Count - 1, initialGuess, tolerance, maxIterations);
+	return 0;
 }
 
   
@@ -55,6 +55,17 @@
 namespace libfin {
 
 double irr(double tolerance, int maxIterations, const std::vector<double> &CashFlows, int Count);
+
+/* internal rate of return of CashFlows[0..Count], year 0 undiscounted.  The npv is scanned at fixed rates
+   from -99.99% to 1e8%, and safeguarded Newton steps refine the root in one scanned interval to Tolerance on
+   the rate.  Root selection when the npv changes sign more than once:
+   - intervals where the npv falls through zero with increasing rate (an investment) are taken first,
+   - of those, the interval nearest Guess, so a guess inside an interval selects its root,
+   - only when the npv never falls through zero, the interval nearest Guess where it rises (a loan).
+   NaN when the npv does not change sign between the scanned rates */
+double irr_bracketed(const double *CashFlows, int Count, double Guess = 0.1, double Tolerance = 1e-6, int MaxIterations = 100);
+/* Irr[i] = irr_bracketed of CashFlows[0..i] for i = 1..Count in one pass, Irr[0] is not set */
+void irr_running(const double *CashFlows, int Count, double *Irr, double Guess = 0.1, double Tolerance = 1e-6, int MaxIterations = 100);
 double npv(double Rate, const std::vector<double> &CashFlows, int Count);
 double payback(const std::vector<double> &CumulativePayback, const std::vector<double> &Payback, int Count);
 
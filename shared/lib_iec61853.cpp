@@ -76,6 +76,7 @@ iec61853_module_t::iec61853_module_t()
 
 	NcellSer = 0;
 	GlassAR = false;
+	nthreads = 1;
 	for( int i=0;i<5;i++ )
 		AMA[i] = std::numeric_limits<double>::quiet_NaN();
 
@@ -428,23 +429,52 @@ double Io_fit_eqn( double _x, double *par, void * )
 	return pow((Tref+dT)/Tref,3)*exp( 11600 * (Egref/Tref - Eg/(Tref+dT)));
 }
 
+void Io_fit_deriv( double _x, double *par, void *, double *dfdp )
+{
+	double T = _x;
+	const double Tref = 298.15;
+	double dT = (T+273.15)-Tref;
+	dfdp[0] = Io_fit_eqn( _x, par, 0 ) * 11600 * ( 1/Tref - (1-0.0002677*T)/(Tref+dT) );
+}
+
 double Rsh_fit_eqn( double _x, double *par, void * )
 {
 	return par[0] + par[1]*( pow(1000/_x, par[2]) - 1 );
 }
 
+void Rsh_fit_deriv( double _x, double *par, void *, double *dfdp )
+{
+	double p = pow(1000/_x, par[2]);
+	dfdp[0] = 1;
+	dfdp[1] = p - 1;
+	dfdp[2] = par[1]*p*log(1000/_x);
+}
+
 double Rsh_fit_eqn_2par( double _x, double *par, void *arg )
 {
 	double *Rsh_stc = (double*)arg;
 	return *Rsh_stc + par[0]*( pow(1000/_x, par[1]) - 1 );
 }
 
+void Rsh_fit_deriv_2par( double _x, double *par, void *, double *dfdp )
+{
+	double p = pow(1000/_x, par[1]);
+	dfdp[0] = p - 1;
+	dfdp[1] = par[0]*p*log(1000/_x);
+}
+
 
 double Rs_fit_eqn( double _x, double *par, void * )
 {
 	return par[0] + ( 1-_x/1000) *par[1]*pow(1000/_x, 2.0);
 }
 
+void Rs_fit_deriv( double _x, double *, void *, double *dfdp )
+{
+	dfdp[0] = 1;
+	dfdp[1] = ( 1-_x/1000)*pow(1000/_x, 2.0);
+}
+
 
 
 bool iec61853_module_t::calculate( util::matrix_t<double> &input, int nseries, int Type, 
@@ -701,11 +731,12 @@ bool iec61853_module_t::calculate( util::matrix_t<double> &input, int nseries, i
 	}
 
 	// do a nonlinear least squares to fit the Io equation as a function of temperature
-	// free parameter is Egref. initial guess is 1.0
-	double Egref_fit[1] = { 1.0 };
-	if ( !lsqfit( Io_fit_eqn, 0, Egref_fit, 1, 
+	// free parameter is Egref. the fit starts from 1.0, with a few alternates tried concurrently
+	double Egref_fit[1];
+	static const double Egref_starts[3] = { 1.0, 0.8, 1.2 };
+	if ( !lsqfit_multistart( Io_fit_eqn, Io_fit_deriv, 0, Egref_fit, 1, Egref_starts, 3,
 		&Io_temps[0], &Io_avgs[0], Io_temps.size(), 
-		1e-9, 200, 20000 ) )
+		1e-9, 200, 20000, nthreads ) )
 	{
 		OUTLN("error in nonlinear least squares fit for Io equation");
 		return false;
@@ -765,20 +796,22 @@ bool iec61853_module_t::calculate( util::matrix_t<double> &input, int nseries, i
 	}
 
 #ifdef CPAR_3
-	double C[3] = { 1000, 100, 0.25 }; // initial guesses for lsqfit
-	if ( !lsqfit( Rsh_fit_eqn, 0, C, 3, 
+	double C[3];
+	static const double C_starts[9] = { 1000, 100, 0.25,   1000, 1000, 0.5,   100, 10, 1.0 };
+	if ( !lsqfit_multistart( Rsh_fit_eqn, Rsh_fit_deriv, 0, C, 3, C_starts, 3,
 			&Rsh_irrads[0], &Rsh_avgs[0], Rsh_irrads.size(), 
-			1.0e-9, 500, 50000 ) )
+			1.0e-9, 500, 50000, nthreads ) )
 	{
 		OUTLN("error in nonlinear least squares fit for Rsh equation");
 		return false;
 	}
 #else
-	double C[3] = { 100, 0.25, 0 };
+	double C[3];
+	static const double C_starts[6] = { 100, 0.25,   1000, 0.5,   10, 1.0 };
 	
-	if ( !lsqfit( Rsh_fit_eqn_2par, &Rsh_stc, C, 2, 
+	if ( !lsqfit_multistart( Rsh_fit_eqn_2par, Rsh_fit_deriv_2par, &Rsh_stc, C, 2, C_starts, 3,
 			&Rsh_irrads[0], &Rsh_avgs[0], Rsh_irrads.size(), 
-			1.0e-9, 500, 50000 ) )
+			1.0e-9, 500, 50000, nthreads ) )
 	{
 		OUTLN("error in nonlinear least squares fit for Rsh equation");
 		return false;
@@ -817,10 +850,11 @@ bool iec61853_module_t::calculate( util::matrix_t<double> &input, int nseries, i
 
 		if ( Ivec.size() >= 3 )
 		{
-			double Dpr[2] = { 5.0, 1.0 };
-			if ( !lsqfit( Rs_fit_eqn, 0, Dpr, 2, 
+			double Dpr[2];
+			static const double Dpr_starts[6] = { 5.0, 1.0,   0.5, 0.1,   1.0, 10.0 };
+			if ( !lsqfit_multistart( Rs_fit_eqn, Rs_fit_deriv, 0, Dpr, 2, Dpr_starts, 3,
 				&Ivec[0], &Rsvec[0], Ivec.size(), 
-				1.0e-9, 400, 40000 ) )
+				1.0e-9, 400, 40000, nthreads ) )
 			{ 
 				PRINTF("error in nonlinear least squares fit for Rs equation at %lg C", temps[i] );
 				return false;
@@ -96,6 +96,9 @@ public:
 
 	Imessage_api *_imsg;
 
+	// threads for the multi-start least squares fits in calculate(), 0 for all cores
+	int nthreads;
+
 
 	#define ROW_MAX 30
 	enum { COL_IRR, COL_TC, COL_PMP, COL_VMP, COL_VOC, COL_ISC, COL_MAX };
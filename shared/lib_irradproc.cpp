@@ -47,6 +47,7 @@
 *  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *******************************************************************************************************/
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <limits>
@@ -54,6 +55,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <thread>
 #include <vector>
 
 #include "lib_irradproc.h"
@@ -513,14 +515,27 @@ double Max( double v1, double v2){
 	else return v2;
 }
 
-double GTI_DIRINT( const double poa[3], const double inc[3], double zen, double tilt, double ext, double alb, int doy, double tDew, double elev, double& dnOut, double& dfOut, double& ghOut, double poaCompOut[3]){
+/* Iteratively adjusts the GTI passed to DIRINT until the Perez model reproduces the measured POA.
+   If gtiScale is given, the initial GTI is the measured POA times *gtiScale, and on return it holds the
+   ratio of the best GTI to the measured POA, so that consecutive steps can be warm-started.
+   At most iterLimit (up to 30) iterations are run. */
+double GTI_DIRINT( const double poa[3], const double inc[3], double zen, double tilt, double ext, double alb, int doy, double tDew, double elev, double& dnOut, double& dfOut, double& ghOut, double poaCompOut[3], double *gtiScale = 0, int *iterations = 0, int iterLimit = 30 ){
 	
 	double diff = 1E6;
 	double bestDiff = 1E6;
 	double Ktp=0;
 	double GTI[] = { poa[0], poa[1], poa[2] };
 
-	double Ci[30] = {1., 1., 1., 0.5, 0.5,
+	if (gtiScale != 0)
+	{
+		for (int k = 0; k < 3; k++)
+			if (poa[k] > -998.0)
+				GTI[k] = Max(1.0, poa[k] * (*gtiScale));
+	}
+	double gtiBest = GTI[1];
+
+	const int maxIter = 30;
+	double Ci[maxIter] = {1., 1., 1., 0.5, 0.5,
 					 0.5, 0.5, 0.5, 0.5, 0.5,
 					 0.25, 0.25, 0.25, 0.25, 0.25, 
 					 0.25, 0.25, 0.25, 0.25, 0.25,
@@ -534,13 +549,15 @@ double GTI_DIRINT( const double poa[3], const double inc[3], double zen, double
 	double cz = cos(zen);
 	int i = 0;
 	
-	while (fabs(diff) > 1.0 && i++ < 30 ){
+	if (iterLimit > maxIter) iterLimit = maxIter;
+	while (fabs(diff) > 1.0 && i < iterLimit ){
+		i++;
 
 		// Calculate Kt using GTI and Eq. 2
 //		double Kt_inc = GTI[1] / (Io * Max(0.065, cos(inc[1])));
 
 		//Calculate DNI using Kt and DIRINT Eq.s
-		double dn_tmp;
+		double dn_tmp = 0;
 		double Ktp_tmp = ModifiedDISC( GTI, inc, tDew, elev, doy, dn_tmp);
 
 		//Calculate DHI using Eq. 3
@@ -562,13 +579,18 @@ double GTI_DIRINT( const double poa[3], const double inc[3], double zen, double
 			poaBest[0] = poa_tmp[0];
 			poaBest[1] = poa_tmp[1];
 			poaBest[2] = poa_tmp[2];
+			gtiBest = GTI[1];
 		}
 
 		// Adjust GTI using Eq. 4
 		// Apply the same change to previous/ subsequent GTI's as well (based on Bill's email)
-		GTI[0] = Max( 1.0, GTI[0] - Ci[i] * diff);
-		GTI[1] = Max( 1.0, GTI[1] - Ci[i] * diff);
-		GTI[2] = Max( 1.0, GTI[2] - Ci[i] * diff);
+		// (the adjustment after the last iteration is never used, and Ci has only maxIter entries)
+		if (i < maxIter)
+		{
+			GTI[0] = Max( 1.0, GTI[0] - Ci[i] * diff);
+			GTI[1] = Max( 1.0, GTI[1] - Ci[i] * diff);
+			GTI[2] = Max( 1.0, GTI[2] - Ci[i] * diff);
+		}
 
 	}
 
@@ -578,85 +600,156 @@ double GTI_DIRINT( const double poa[3], const double inc[3], double zen, double
 
 	ghOut = dnOut * cos(inc[1]) + dfOut;
 
+	if (gtiScale != 0 && poa[1] >= 1.0)
+		*gtiScale = gtiBest / poa[1];
+	if (iterations != 0)
+		*iterations = i;
+
 	return Ktp;
 }
 
-int poaDecomp( double , double angle[], double sun[], double alb, poaDecompReq *pA, double &dn, double &df, double &gh, double poa[3], double diffc[3]){
+// last half-day average Kt prime computed for steps with the sun behind the array
+struct poaKtpCache {
+	poaKtpCache() : valid(false), start(0), doy(0), tDew(0), alb(0), avgKtp(0) {}
+	bool valid;
+	size_t start;
+	int doy;
+	double tDew, alb, avgKtp;
+};
+
+static void poa_neighbors( const std::vector<double> &v, size_t j, double out[3] )
+{
+	// steps outside the series are treated as missing
+	out[0] = (j > 0) ? v[j - 1] : -999;
+	out[1] = v[j];
+	out[2] = (j + 1 < v.size()) ? v[j + 1] : -999;
+}
+
+static size_t poa_steps_in_day( const poaDecompReq *pA )
+{
+	size_t stepsInDay = 24;
+	if( pA->stepScale == 'm'){
+		stepsInDay *= 60 / (unsigned int)pA->stepSize;
+	}
+	return stepsInDay;
+}
 
+/* Decomposes step i of the POA series. inc, tilt, zen and ext are the incidence and surface tilt angles,
+   solar zenith angle (radians) and extraterrestrial irradiance for the step. */
+static int poa_decomp_step( const poaDecompReq *pA, size_t i, size_t dayStart, int doy, double tDew,
+	double inc, double tilt, double zen, double ext, double alb,
+	double &dn, double &df, double &gh, double poa[3], double diffc[3],
+	double *gtiScale, int *iterations, poaKtpCache *cache )
+{
 	int errorcode = 0; //code to return whether the decomposition method succeeded or failed
 
 	/* Decomposes POA into direct normal and diffuse irradiances */
 
 	double r90(M_PI/2), r80( 80.0/180*M_PI ), r65(65.0/180*M_PI);
 
-	if ( angle[0] < r90 ){  // Check if incident angle if greater than 90 degrees
+	int iter = 0;
+	if ( inc < r90 ){  // Check if incident angle if greater than 90 degrees
 		
-		double gti[] = { pA->POA[ pA->i-1 ], pA->POA[ pA->i ],pA->POA[ pA->i+1 ]};
-		double inc[] = { pA->inc[ pA->i-1 ], pA->inc[ pA->i ], pA->inc[ pA->i+1 ]};
+		double gti[3], incs[3];
+		poa_neighbors( pA->POA, i, gti );
+		poa_neighbors( pA->inc, i, incs );
 
-		GTI_DIRINT( gti, inc, sun[1], angle[1], sun[8], alb, pA->doy, pA->tDew, pA->elev, dn, df, gh, poa );
+		if ( gtiScale != 0 )
+		{
+			// a warm start is only worth a few iterations, otherwise solve again from the measured POA
+			const int warmIterLimit = 5;
+			double scale = *gtiScale;
+			GTI_DIRINT( gti, incs, zen, tilt, ext, alb, doy, tDew, pA->elev, dn, df, gh, poa, &scale, &iter, warmIterLimit );
+			if ( fabs( poa[0] + poa[1] + poa[2] - gti[1] ) > 1.0 )
+			{
+				int iterCold = 0;
+				scale = 1.0;
+				GTI_DIRINT( gti, incs, zen, tilt, ext, alb, doy, tDew, pA->elev, dn, df, gh, poa, &scale, &iterCold );
+				iter += iterCold;
+			}
+			*gtiScale = scale;
+		}
+		else
+			GTI_DIRINT( gti, incs, zen, tilt, ext, alb, doy, tDew, pA->elev, dn, df, gh, poa, 0, &iter );
 
 	} else {
 
-		size_t stepsInDay = 24;
-		if( pA->stepScale == 'm'){
-			stepsInDay *= 60 / (unsigned int)pA->stepSize;
-		}
+		size_t stepsInDay = poa_steps_in_day( pA );
 		 
-		size_t noon = pA->dayStart + stepsInDay/2;
+		size_t noon = dayStart + stepsInDay/2;
 		size_t start, stop;
 		// Check for a morning value or evening, set looping bounds accordingly
-		if( pA->i < noon ){ // Calculate morning value
-			start = pA->dayStart;
+		if( i < noon ){ // Calculate morning value
+			start = dayStart;
 			stop = noon;
 		} else {
 			start = noon;
-			stop = pA->dayStart + stepsInDay;
+			stop = dayStart + stepsInDay;
 		}
+		if ( stop > pA->inc.size() ) stop = pA->inc.size();
 
-
-		// Determine an average Kt prime value
-		int count = 0;
+		// Determine an average Kt prime value, reusing the last one if it was found with the same inputs
 		double avgKtp = 0;
+		if ( cache != 0 && cache->valid && cache->start == start && cache->doy == doy && cache->tDew == tDew && cache->alb == alb )
+			avgKtp = cache->avgKtp;
+		else
+		{
+			int count = 0;
 
-		for( size_t j = start; j < stop; j++ ){
+			for( size_t j = start; j < stop; j++ ){
 
 
-			if( (pA->inc[j] < r80) && (pA->inc[j] > r65) ){
-				count++;
-				double gti[] = { pA->POA[ j-1 ], pA->POA[ j ], pA->POA[ j+1 ]};
-				double inc[] = { pA->inc[ j-1 ], pA->inc[ j ], pA->inc[ j+1 ]};
+				if( (pA->inc[j] < r80) && (pA->inc[j] > r65) ){
+					count++;
+					double gti[3], incs[3];
+					poa_neighbors( pA->POA, j, gti );
+					poa_neighbors( pA->inc, j, incs );
 
-				double dnTmp, dfTmp, ghTmp, poaTmp[3];
-				avgKtp += GTI_DIRINT( gti, inc, pA->zen[j], pA->tilt[j], pA->exTer[j], alb, pA->doy, pA->tDew, pA->elev, dnTmp, dfTmp, ghTmp, poaTmp );
+					double dnTmp, dfTmp, ghTmp, poaTmp[3];
+					int iterTmp = 0;
+					avgKtp += GTI_DIRINT( gti, incs, pA->zen[j], pA->tilt[j], pA->exTer[j], alb, doy, tDew, pA->elev, dnTmp, dfTmp, ghTmp, poaTmp, 0, &iterTmp );
+					iter += iterTmp;
+				}
 			}
-		}
 
-		avgKtp /= count;
+			avgKtp /= count;
+
+			if ( cache != 0 )
+			{
+				cache->valid = true;
+				cache->start = start;
+				cache->doy = doy;
+				cache->tDew = tDew;
+				cache->alb = alb;
+				cache->avgKtp = avgKtp;
+			}
+		}
 
 		//Calculate Kt
-		double am = Min(15.25, 1.0 / (cos(sun[1]) + 0.15 * (pow(93.9 - sun[1]*180/M_PI, -1.253)))); // air mass
+		double am = Min(15.25, 1.0 / (cos(zen) + 0.15 * (pow(93.9 - zen*180/M_PI, -1.253)))); // air mass
         double ktpam = am * exp(-0.0001184 * pA->elev);
 		double Kt = avgKtp *( 1.031 * exp( -1.4/ (0.9 + 9.4/ktpam) ) + 0.1);
 
 		//Calculate DNI using DIRINT
 		double Kt_[3]  = {-999, Kt,               -999 };
 		double Ktp_[3] = {-999, avgKtp,           -999 };
-		double gti[3]  = {-999, pA->POA[ pA->i ], -999 };
-		double zen[3]  = {-999, sun[1]          , -999 }; // Might need to be Zenith angle instead of inciden
+		double gti[3]  = {-999, pA->POA[ i ], -999 };
+		double zens[3]  = {-999, zen          , -999 }; // Might need to be Zenith angle instead of inciden
 
-		ModifiedDISC( Kt_, Ktp_, gti, zen, pA->tDew, pA->elev, pA->doy, dn);
+		ModifiedDISC( Kt_, Ktp_, gti, zens, tDew, pA->elev, doy, dn);
 		
 		// Calculate DHI and GHI
-		double ct = cos(angle[1]);
-		df = (2* pA->POA[pA->i] - dn*cos(sun[1])*alb*(1-ct)) / (1 + ct + alb*(1-ct)) ;
-		gh = dn * cos( angle[0] ) + df;
+		double ct = cos(tilt);
+		df = (2* pA->POA[i] - dn*cos(zen)*alb*(1-ct)) / (1 + ct + alb*(1-ct)) ;
+		gh = dn * cos( inc ) + df;
 
 		// Get component poa from Perez
-		perez( sun[8], dn, df, alb, angle[0], angle[1], sun[1], poa, diffc );
+		perez( ext, dn, df, alb, inc, tilt, zen, poa, diffc );
 
 	}
 
+	if ( iterations != 0 ) *iterations = iter;
+
 	//Check for bad values and return an error code as applicable
 	if (gh < 0)
 	{
@@ -677,6 +770,117 @@ int poaDecomp( double , double angle[], double sun[], double alb, poaDecompReq *
 	return errorcode;
 }
 
+int poaDecomp( double , double angle[], double sun[], double alb, poaDecompReq *pA, double &dn, double &df, double &gh, double poa[3], double diffc[3]){
+
+	// return the batch result if it was computed for this step with the same inputs (first simulation year)
+	size_t i = pA->i;
+	const poaDecompSeries &b = pA->batch;
+	if ( pA->useBatch && i < b.solved.size() && b.solved[i]
+		&& pA->dayStart == i - i % poa_steps_in_day( pA ) && pA->doy == (int)( i / poa_steps_in_day( pA ) )
+		&& b.alb[i] == alb && b.tDew[i] == pA->tDew
+		&& angle[0] == pA->inc[i] && angle[1] == pA->tilt[i] && sun[1] == pA->zen[i] && sun[8] == pA->exTer[i] )
+	{
+		dn = b.dn[i];
+		df = b.df[i];
+		gh = b.gh[i];
+		for ( int k = 0; k < 3; k++ )
+			poa[k] = b.poa[k][i];
+		if ( angle[0] >= M_PI/2 && diffc != 0 )
+			for ( int k = 0; k < 3; k++ )
+				diffc[k] = b.diffc[k][i];
+		return b.errorcode[i];
+	}
+
+	return poa_decomp_step( pA, i, pA->dayStart, pA->doy, pA->tDew, angle[0], angle[1], sun[1], sun[8], alb,
+		dn, df, gh, poa, diffc, 0, 0, 0 );
+}
+
+// decomposes days first, first+stride, first+2*stride, ... of the series
+static void poa_decomp_days( const poaDecompReq *pA, const std::vector<double> *alb, const std::vector<double> *tDew,
+	bool warmStart, size_t first, size_t stride, poaDecompSeries *out, size_t *iterTotal )
+{
+	size_t n = pA->POA.size();
+	size_t stepsInDay = poa_steps_in_day( pA );
+	size_t ndays = (n + stepsInDay - 1) / stepsInDay;
+	size_t total = 0;
+
+	for ( size_t d = first; d < ndays; d += stride )
+	{
+		double gtiScale = 1.0;
+		poaKtpCache cache;
+		size_t dayStart = d * stepsInDay;
+		size_t dayEnd = std::min( n, dayStart + stepsInDay );
+		for ( size_t i = dayStart; i < dayEnd; i++ )
+		{
+			// sun down steps have no angles (-999) and are not decomposed
+			if ( pA->zen[i] < -998.0 || pA->inc[i] < -998.0 )
+				continue;
+
+			double poa[3] = { 0, 0, 0 }, diffc[3] = { 0, 0, 0 };
+			int iter = 0;
+			out->errorcode[i] = poa_decomp_step( pA, i, dayStart, (int)d, (*tDew)[i],
+				pA->inc[i], pA->tilt[i], pA->zen[i], pA->exTer[i], (*alb)[i],
+				out->dn[i], out->df[i], out->gh[i], poa, diffc, warmStart ? &gtiScale : 0, &iter, &cache );
+
+			for ( int k = 0; k < 3; k++ )
+			{
+				out->poa[k][i] = poa[k];
+				out->diffc[k][i] = diffc[k];
+			}
+			out->iterations[i] = iter;
+			out->solved[i] = 1;
+			total += iter;
+		}
+	}
+	*iterTotal = total;
+}
+
+size_t poaDecompBatch( const poaDecompReq &pA, const std::vector<double> &alb, const std::vector<double> &tDew, bool warmStart, int nthreads, poaDecompSeries &out )
+{
+	size_t n = pA.POA.size();
+	out.dn.assign( n, 0.0 );
+	out.df.assign( n, 0.0 );
+	out.gh.assign( n, 0.0 );
+	for ( int k = 0; k < 3; k++ )
+	{
+		out.poa[k].assign( n, 0.0 );
+		out.diffc[k].assign( n, 0.0 );
+	}
+	out.alb = alb;
+	out.tDew = tDew;
+	out.errorcode.assign( n, 0 );
+	out.iterations.assign( n, 0 );
+	out.solved.assign( n, 0 );
+
+	if ( n == 0 || alb.size() != n || tDew.size() != n || pA.inc.size() != n || pA.tilt.size() != n
+		|| pA.zen.size() != n || pA.exTer.size() != n )
+		return 0;
+
+	size_t stepsInDay = poa_steps_in_day( &pA );
+	size_t ndays = (n + stepsInDay - 1) / stepsInDay;
+	size_t nthr = nthreads > 0 ? (size_t)nthreads : (size_t)std::thread::hardware_concurrency();
+	if ( nthr < 1 ) nthr = 1;
+	if ( nthr > ndays ) nthr = ndays;
+
+	// each thread handles every nthr-th day and writes only to its own steps
+	std::vector<size_t> iters( nthr, 0 );
+	if ( nthr == 1 )
+		poa_decomp_days( &pA, &alb, &tDew, warmStart, 0, 1, &out, &iters[0] );
+	else
+	{
+		std::vector<std::thread> threads;
+		for ( size_t t = 0; t < nthr; t++ )
+			threads.push_back( std::thread( poa_decomp_days, &pA, &alb, &tDew, warmStart, t, nthr, &out, &iters[t] ) );
+		for ( size_t t = 0; t < nthr; t++ )
+			threads[t].join();
+	}
+
+	size_t total = 0;
+	for ( size_t t = 0; t < nthr; t++ )
+		total += iters[t];
+	return total;
+}
+
 void isotropic( double , double dn, double df, double alb, double inc, double tilt, double zen, double poa[3], double diffc[3] )
 {
 /* added aug2011 by aron dobos. Defines isotropic sky model for diffuse irradiance on a tilted surface
@@ -862,6 +1066,7 @@ void irrad::setup()
 	planeOfArrayIrradianceRear[0] = planeOfArrayIrradianceRear[1] = planeOfArrayIrradianceRear[2] = diffuseIrradianceRear[0] = diffuseIrradianceRear[1] = diffuseIrradianceRear[2] = std::numeric_limits<double>::quiet_NaN();
 	timeStepSunPosition[0] = timeStepSunPosition[1] = timeStepSunPosition[2] = -999;
 	planeOfArrayIrradianceRearAverage = 0;
+	sharedViewFactors = NULL;
 
 	calculatedDirectNormal = directNormal;
 	calculatedDiffuseHorizontal = 0.0;
@@ -1232,8 +1437,7 @@ int irrad::calc_rear_side(double transmissionFactor, double bifaciality, double
 		double horizontalLength = slopeLength * cos(tiltRadian);
 
 		// Determine the factors for points on the ground from the leading edge of one row of PV panels to the edge of the next row of panels behind
-		std::vector<double> rearSkyConfigFactors, frontSkyConfigFactors;
-		this->getSkyConfigurationFactors(rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, rearSkyConfigFactors, frontSkyConfigFactors);
+		const bifacialViewFactors & viewFactors = getViewFactors(rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, tiltRadian);
 
 		// Determine if ground is shading from direct beam radio for points on the ground from leading edge of PV panels to leading edge of next row behind
 		double pvBackShadeFraction, pvFrontShadeFraction, maxShadow;
@@ -1243,7 +1447,7 @@ int irrad::calc_rear_side(double transmissionFactor, double bifaciality, double
 
 		// Get the rear ground GHI
 		std::vector<double> rearGroundGHI, frontGroundGHI;
-		this->getGroundGHI(transmissionFactor, rearSkyConfigFactors, frontSkyConfigFactors, rearGroundShade, frontGroundShade, rearGroundGHI, frontGroundGHI);
+		this->getGroundGHI(transmissionFactor, viewFactors.skyConfigFactors, viewFactors.skyConfigFactors, rearGroundShade, frontGroundShade, rearGroundGHI, frontGroundGHI);
 
 		// Calculate the irradiance on the front of the PV module (to get front reflected)
 		std::vector<double> frontIrradiancePerCellrow, frontReflected;
@@ -1259,6 +1463,310 @@ int irrad::calc_rear_side(double transmissionFactor, double bifaciality, double
 	return true;
 }
 
+int irrad::calc_rear_side_series(double transmissionFactor, double bifaciality, double groundClearanceHeight, double slopeLength,
+	const std::vector<double> & solarAzimuthRadians, const std::vector<double> & solarZenithRadians, const std::vector<double> & solarElevationRadians,
+	const std::vector<double> & beam, const std::vector<double> & diffuse, std::vector<double> & rearIrradiance)
+{
+	size_t n = solarAzimuthRadians.size();
+	if (solarZenithRadians.size() != n || solarElevationRadians.size() != n || beam.size() != n || diffuse.size() != n)
+		return -1;
+
+	rearIrradiance.assign(n, 0.0);
+	for (size_t t = 0; t < n; t++)
+	{
+		if (solarElevationRadians[t] <= 0)
+			continue;
+
+		sunAnglesRadians[0] = solarAzimuthRadians[t];
+		sunAnglesRadians[1] = solarZenithRadians[t];
+		sunAnglesRadians[2] = solarElevationRadians[t];
+		timeStepSunPosition[2] = 1;
+		calculatedDirectNormal = beam[t];
+		calculatedDiffuseHorizontal = diffuse[t];
+
+		// the view factors are only recomputed when the surface tilt changes, which is never for fixed-tilt systems
+		incidence(trackingMode, tiltDegrees, surfaceAzimuthDegrees, rotationLimitDegrees, sunAnglesRadians[1], sunAnglesRadians[0], enableBacktrack, groundCoverageRatio, surfaceAnglesRadians);
+		calc_rear_side(transmissionFactor, bifaciality, groundClearanceHeight, slopeLength);
+		rearIrradiance[t] = planeOfArrayIrradianceRearAverage;
+	}
+	return 0;
+}
+
+void irrad::set_bifacial_view_factors(bifacialViewFactors * viewFactors)
+{
+	sharedViewFactors = viewFactors;
+}
+
+bifacialViewFactors::bifacialViewFactors() : valid(false)
+{
+	for (size_t i = 0; i < 6; i++)
+		geometry[i] = 0;
+}
+
+bool bifacialViewFactors::matches(double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, double tiltRadians) const
+{
+	if (!valid)
+		return false;
+
+	// the surface angles are round-tripped through degrees between calls, so allow for round-off
+	double in[6] = { rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, tiltRadians };
+	for (size_t i = 0; i < 6; i++) {
+		if (fabs(in[i] - geometry[i]) > 1e-9 * fmax(1.0, fabs(geometry[i])))
+			return false;
+	}
+	return true;
+}
+
+bifacialViewFactors & irrad::getViewFactors(double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, double tiltRadians)
+{
+	bifacialViewFactors & vf = sharedViewFactors ? *sharedViewFactors : localViewFactors;
+	if (vf.matches(rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, tiltRadians))
+		return vf;
+
+	const size_t intervals = bifacialViewFactors::intervals;
+	const size_t cellRows = bifacialViewFactors::cellRows;
+
+	// front surface assumed to be glass
+	double n2 = 1.526;
+	double reflectanceNormalIncidence = pow((n2 - 1.0) / (n2 + 1.0), 2.0);
+
+	// Fraction of the hemisphere seen through each whole degree of the 180 degree field of view, weighted by the glass angle of incidence correction
+	double arcWeight[180], arcWeightTransmitted[180], arcWeightReflected[180];
+	for (size_t j = 0; j != 180; j++)
+	{
+		arcWeight[j] = 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR));
+		arcWeightTransmitted[j] = arcWeight[j] * MarionAOICorrectionFactorsGlass[j];
+		arcWeightReflected[j] = arcWeight[j] * (1.0 - MarionAOICorrectionFactorsGlass[j] * (1.0 - reflectanceNormalIncidence));
+	}
+
+	std::vector<double> rearSkyConfigFactors;
+	vf.skyConfigFactors.clear();
+	getSkyConfigurationFactors(rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, rearSkyConfigFactors, vf.skyConfigFactors);
+
+	vf.frontSkyIsotropic.assign(cellRows, 0.0);
+	vf.frontSkyHorizon.assign(cellRows, 0.0);
+	vf.frontReflectedSkyIsotropic.assign(cellRows, 0.0);
+	vf.frontReflectedSkyHorizon.assign(cellRows, 0.0);
+	vf.frontGround.assign(cellRows * intervals, 0.0);
+	vf.frontReflectedGround.assign(cellRows * intervals, 0.0);
+	vf.rearSkyIsotropic.assign(cellRows, 0.0);
+	vf.rearSkyHorizon.assign(cellRows, 0.0);
+	vf.rearGround.assign(cellRows * 2 * intervals, 0.0);
+	vf.rearPVReflected.assign(cellRows * cellRows, 0.0);
+
+	// Front surface, the row in front of the desired row is in the negative x direction
+	double PbotX = -rowToRow;
+	double PbotY = clearanceGround;
+	double PtopX = -distanceBetweenRows;
+	double PtopY = verticalHeight + clearanceGround;
+	for (size_t i = 0; i != cellRows; i++)
+	{
+		double PcellX = horizontalLength * (i + 0.5) / ((double)cellRows);
+		double PcellY = clearanceGround + verticalHeight * (i + 0.5) / ((double)cellRows);
+		double elevationAngleUp = atan((PtopY - PcellY) / (PcellX - PtopX));
+		double elevationAngleDown = atan((PcellY - PbotY) / (PcellX - PbotX));
+		size_t iStopIso = (size_t)round((M_PI - tiltRadians - elevationAngleUp) / DTOR);
+		size_t iHorBright = (size_t)round(fmax(0.0, 6.0 - elevationAngleUp / DTOR));
+		size_t iStartGrd = (size_t)round((M_PI - tiltRadians + elevationAngleDown) / DTOR);
+
+		for (size_t j = 0; j != iStopIso; j++)
+		{
+			vf.frontSkyIsotropic[i] += arcWeightTransmitted[j];
+			vf.frontReflectedSkyIsotropic[i] += arcWeightReflected[j];
+			if ((iStopIso - j) <= iHorBright)
+			{
+				vf.frontSkyHorizon[i] += arcWeightTransmitted[j] / 0.052246; // 0.052246 = 0.5 * [cos(84) - cos(90)]
+				vf.frontReflectedSkyHorizon[i] += arcWeightReflected[j] / 0.052246;
+			}
+		}
+
+		double * ground = &vf.frontGround[i * intervals];
+		double * groundReflected = &vf.frontReflectedGround[i * intervals];
+		for (size_t j = iStartGrd; j < 180; j++)
+		{
+			double startElevationDown = (j - iStartGrd) * DTOR + elevationAngleDown;
+			double stopElevationDown = (j + 1 - iStartGrd) * DTOR + elevationAngleDown;
+			double projectedX1 = PcellX - PcellY / tan(startElevationDown);
+			double projectedX2 = PcellX - PcellY / tan(stopElevationDown);
+
+			if (fabs(projectedX1 - projectedX2) > 0.99 * rowToRow)
+			{
+				// Use average value if projection approximates the rtr
+				for (size_t k = 0; k != intervals; k++)
+				{
+					ground[k] += arcWeightTransmitted[j] / intervals;
+					groundReflected[k] += arcWeightReflected[j] / intervals;
+				}
+				continue;
+			}
+
+			projectedX1 = intervals * projectedX1 / rowToRow;
+			projectedX2 = intervals * projectedX2 / rowToRow;
+
+			// offset so array indexes are positive
+			while (projectedX1 < 0.0 || projectedX2 < 0.0)
+			{
+				projectedX1 += intervals;
+				projectedX2 += intervals;
+			}
+
+			size_t index1 = static_cast<size_t>(projectedX1);
+			size_t index2 = static_cast<size_t>(projectedX2);
+
+			if (index1 == index2)
+			{
+				ground[index1 % intervals] += arcWeightTransmitted[j];
+				groundReflected[index1 % intervals] += arcWeightReflected[j];
+				continue;
+			}
+
+			// Weight of each ground segment in the 1-degree field of view
+			double span = projectedX2 - projectedX1;
+			for (size_t k = index1; k <= index2; k++)
+			{
+				double weight = 1.0;
+				if (k == index1) {
+					weight = k + 1.0 - projectedX1;
+				}
+				else if (k == index2) {
+					weight = projectedX2 - k;
+				}
+				ground[k % intervals] += arcWeightTransmitted[j] * weight / span;
+				groundReflected[k % intervals] += arcWeightReflected[j] * weight / span;
+			}
+		}
+	}
+
+	// Rear surface, the row in back of the desired row is in the positive x direction
+	PbotX = rowToRow;
+	PbotY = clearanceGround;
+	PtopX = rowToRow + horizontalLength;
+	PtopY = verticalHeight + clearanceGround;
+	for (size_t i = 0; i != cellRows; i++)
+	{
+		double PcellX = horizontalLength * (i + 0.5) / ((double)cellRows);
+		double PcellY = clearanceGround + verticalHeight * (i + 0.5) / ((double)cellRows);
+		double elevationAngleUp = atan((PtopY - PcellY) / (PtopX - PcellX));
+		double elevationAngleDown = atan((PcellY - PbotY) / (PbotX - PcellX));
+		size_t iStopIso = (size_t)round((tiltRadians - elevationAngleUp) / DTOR);
+		size_t iHorBright = (size_t)round(fmax(0.0, 6.0 - elevationAngleUp / DTOR));
+		size_t iStartGrd = (size_t)round((tiltRadians + elevationAngleDown) / DTOR);
+
+		for (size_t j = 0; j != iStopIso; j++)
+		{
+			vf.rearSkyIsotropic[i] += arcWeightTransmitted[j];
+			if ((iStopIso - j) <= iHorBright) {
+				vf.rearSkyHorizon[i] += arcWeightTransmitted[j] / 0.052264; // 0.052246 = 0.5 * [cos(84) - cos(90)]
+			}
+		}
+
+		// Relections from PV module front surfaces of the row behind
+		double * pvReflected = &vf.rearPVReflected[i * cellRows];
+		for (size_t j = iStopIso; j < iStartGrd; j++)
+		{
+			double diagonalDistance = (PbotX - PcellX) / cos(elevationAngleDown);
+			double startAlpha = -(double)(j - iStopIso) * DTOR + elevationAngleUp + elevationAngleDown;
+			double stopAlpha = -(double)(j + 1 - iStopIso) * DTOR + elevationAngleUp + elevationAngleDown;
+			double m = diagonalDistance * sin(startAlpha);
+			double theta = M_PI - elevationAngleDown - (M_PI / 2.0 - startAlpha) - tiltRadians;
+			double projectedX2 = m / cos(theta);
+
+			m = diagonalDistance * sin(stopAlpha);
+			theta = M_PI - elevationAngleDown - (M_PI / 2.0 - stopAlpha) - tiltRadians;
+			double projectedX1 = m / cos(theta);
+			projectedX1 = fmax(0.0, projectedX1);
+
+			double deltaCell = 1.0 / cellRows;
+			double tolerance = 0.0001;
+			for (size_t k = 0; k < cellRows; k++)
+			{
+				double cellBottom = k * deltaCell;
+				double cellTop = (k + 1) * deltaCell;
+				double cellLengthSeen = 0.0;
+
+				if (cellBottom >= projectedX1 - tolerance && cellTop <= projectedX2 + tolerance) {
+					cellLengthSeen = cellTop - cellBottom;
+				}
+				else if (cellBottom <= projectedX1 + tolerance && cellTop >= projectedX2 - tolerance) {
+					cellLengthSeen = projectedX2 - projectedX1;
+				}
+				else if (cellBottom >= projectedX1 - tolerance && projectedX2 > cellBottom - tolerance && cellTop >= projectedX2 - tolerance) {
+					cellLengthSeen = projectedX2 - cellBottom;
+				}
+				else if (cellBottom <= projectedX1 + tolerance && projectedX1 < cellTop + tolerance && cellTop <= projectedX2 + tolerance) {
+					cellLengthSeen = cellTop - projectedX1;
+				}
+				pvReflected[k] += arcWeightTransmitted[j] * cellLengthSeen / (projectedX2 - projectedX1);
+			}
+		}
+
+		// Ground reflected component, columns [0, intervals) are front ground segments and [intervals, 2*intervals) are rear ground segments
+		double * ground = &vf.rearGround[i * 2 * intervals];
+		for (size_t j = iStartGrd; j < 180; j++)
+		{
+			double startElevationDown = (double)(j - iStartGrd) * DTOR + elevationAngleDown;
+			double stopElevationDown = (double)(j + 1 - iStartGrd) * DTOR + elevationAngleDown;
+			double projectedX2 = PcellX + PcellY / tan(startElevationDown);
+			double projectedX1 = PcellX + PcellY / tan(stopElevationDown);
+
+			if (fabs(projectedX1 - projectedX2) > 0.99 * rowToRow)
+			{
+				// Use average value of the rear ground if projection approximates the rtr
+				for (size_t k = 0; k != intervals; k++) {
+					ground[intervals + k] += arcWeightTransmitted[j] / intervals;
+				}
+				continue;
+			}
+
+			projectedX1 = intervals * projectedX1 / rowToRow;
+			projectedX2 = intervals * projectedX2 / rowToRow;
+
+			// offset so array indexed are less than number of intervals
+			while (projectedX1 >= intervals || projectedX2 >= intervals)
+			{
+				projectedX1 -= intervals;
+				projectedX2 -= intervals;
+			}
+			while (projectedX1 < -(int)intervals || projectedX2 < -(int)intervals)
+			{
+				projectedX1 += intervals;
+				projectedX2 += intervals;
+			}
+			int index1 = static_cast<int>(projectedX1 + intervals) - (int)intervals;
+			int index2 = static_cast<int>(projectedX2 + intervals) - (int)intervals;
+
+			// negative indexes fall on the front ground, at column index + intervals
+			if (index1 == index2)
+			{
+				ground[index1 + (int)intervals] += arcWeightTransmitted[j];
+				continue;
+			}
+
+			double span = projectedX2 - projectedX1;
+			for (int k = index1; k <= index2; k++)
+			{
+				double weight = 1.0;
+				if (k == index1) {
+					weight = k + 1.0 - projectedX1;
+				}
+				else if (k == index2) {
+					weight = projectedX2 - k;
+				}
+				ground[k + (int)intervals] += arcWeightTransmitted[j] * weight / span;
+			}
+		}
+	}
+
+	vf.geometry[0] = rowToRow;
+	vf.geometry[1] = verticalHeight;
+	vf.geometry[2] = clearanceGround;
+	vf.geometry[3] = distanceBetweenRows;
+	vf.geometry[4] = horizontalLength;
+	vf.geometry[5] = tiltRadians;
+	vf.valid = true;
+	return vf;
+}
+
 void irrad::getSkyConfigurationFactors(double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, std::vector<double> & rearSkyConfigFactors, std::vector<double> & frontSkyConfigFactors)
 {
 	// Calculate sky configuration factors using 100 intervals
@@ -1444,7 +1952,7 @@ void irrad::getGroundShadeFactors(double rowToRow, double verticalHeight, double
 	maxShadow = fmax(shadingStart1, shadingEnd1);
 }
 
-void irrad::getGroundGHI(double transmissionFactor, std::vector<double> rearSkyConfigFactors, std::vector<double> frontSkyConfigFactors, std::vector<int> rearGroundShade, std::vector<int> frontGroundShade, std::vector<double> & rearGroundGHI, std::vector<double> & frontGroundGHI)
+void irrad::getGroundGHI(double transmissionFactor, const std::vector<double> & rearSkyConfigFactors, const std::vector<double> & frontSkyConfigFactors, const std::vector<int> & rearGroundShade, const std::vector<int> & frontGroundShade, std::vector<double> & rearGroundGHI, std::vector<double> & frontGroundGHI)
 {
 	// Calculate the diffuse components of irradiance
 	perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal,albedo, sunAnglesRadians[1], 0.0, sunAnglesRadians[1], planeOfArrayIrradianceRear, diffuseIrradianceRear);
@@ -1480,21 +1988,20 @@ void irrad::getGroundGHI(double transmissionFactor, std::vector<double> rearSkyC
 	}
 }
 
-void irrad::getFrontSurfaceIrradiances(double pvFrontShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, std::vector<double> frontGroundGHI, std::vector<double> & frontIrradiance, double & frontAverageIrradiance, std::vector<double> & frontReflected)
+void irrad::getFrontSurfaceIrradiances(double pvFrontShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, const std::vector<double> & frontGroundGHI, std::vector<double> & frontIrradiance, double & frontAverageIrradiance, std::vector<double> & frontReflected)
 {
 	// front surface assumed to be glass
 	double n2 = 1.526;
 
-	size_t intervals = 100;
+	size_t intervals = bifacialViewFactors::intervals;
+	size_t cellRows = bifacialViewFactors::cellRows;
 	double solarAzimuthRadians = sunAnglesRadians[0];
 	double solarZenithRadians = sunAnglesRadians[1];
 	double tiltRadians = surfaceAnglesRadians[1]; 
 	double surfaceAzimuthRadians = surfaceAnglesRadians[2];
 
-	// Average GHI on ground under PV array for cases when x projection exceed 2*rtr
-	double averageGroundGHI = 0.0;
-	for (size_t i = 0; i != frontGroundGHI.size(); i++)
-		averageGroundGHI += frontGroundGHI[i] / frontGroundGHI.size();
+	// Geometric factors relating each cell row to the sky and ground segments, see getViewFactors()
+	const bifacialViewFactors & viewFactors = getViewFactors(rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, tiltRadians);
 
 	// Calculate diffuse isotropic irradiance for a horizontal surface
 	double * poa = planeOfArrayIrradianceRear;
@@ -1508,117 +2015,35 @@ void irrad::getFrontSurfaceIrradiances(double pvFrontShadeFraction, double rowTo
 	perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, angleTmp[0], angleTmp[1], solarZenithRadians, poa, diffc);
 	double horizonDiffuse = diffc[2];
 
-	// Calculate x,y coordinates of bottom and top edges of PV row in back of desired PV row so that portions of sky and ground viewed by the 
-	// PV cell may be determined. Origin of x-y axis is the ground point below the lower front edge of the desired PV row. The row in back of 
-	// the desired row is in the positive x direction.
-	double PbotX = -rowToRow;                        // x value for point on bottom edge of PV module/panel of row in front of (in PV panel slope lengths)
-	double PbotY = clearanceGround;                  // y value for point on bottom edge of PV module/panel of row in front of (in PV panel slope lengths)
-	double PtopX = -distanceBetweenRows;			 // x value for point on top edge of PV module/panel of row in front of (in PV panel slope lengths)
-	double PtopY = verticalHeight + clearanceGround; // y value for point on top edge of PV module/panel of row in front of (in PV panel slope lengths)
+	// Calculate direct and circumsolar irradiance components, which are the same for all cell rows
+	incidence(0, tiltRadians * RTOD, surfaceAzimuthRadians * RTOD, 45.0, solarZenithRadians, solarAzimuthRadians, this->enableBacktrack, this->groundCoverageRatio, surfaceAnglesRadians);
+	perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, surfaceAnglesRadians[0], surfaceAnglesRadians[1], solarZenithRadians, poa, diffc);
+	double directCircumsolar = 0.0;
+	if (surfaceAnglesRadians[0] < M_PI / 2.0) {
+		directCircumsolar = (poa[0] + diffc[1]) * iamSjerpsKoomen(n2, surfaceAnglesRadians[0]);
+	}
 
 	// Calculate diffuse and direct component irradiances for each cell row (assuming 6 rows)
-	size_t cellRows = 6;
+	frontIrradiance.assign(cellRows, 0.0);
+	frontReflected.assign(cellRows, 0.0);
 	for (size_t i = 0; i != cellRows; i++)
 	{
-		// Calculate diffuse irradiances and reflected amounts for each cell row over its field of view of 180 degrees, 
-		// beginning with the angle providing the upper most view of the sky (j=0)
-		double PcellX = horizontalLength * (i + 0.5) / ((double)cellRows);				   // x value for location of PV cell with OFFSET FOR SARA REFERENCE CELLS     4/26/2016
-		double PcellY = clearanceGround + verticalHeight * (i + 0.5) / ((double)cellRows); // y value for location of PV cell with OFFSET FOR SARA REFERENCE CELLS     4/26/2016
-		double elevationAngleUp = atan((PtopY - PcellY) / (PcellX - PtopX));          // Elevation angle up from PV cell to top of PV module/panel, radians
-		double elevationAngleDown = atan((PcellY - PbotY) / (PcellX - PbotX));        // Elevation angle down from PV cell to bottom of PV module/panel, radians
-		size_t iStopIso = (size_t)round((M_PI - tiltRadians - elevationAngleUp) / DTOR);							   // Last whole degree in arc range that sees sky, first is 0
-		size_t iHorBright = (size_t)round(fmax(0.0, 6.0 - elevationAngleUp / DTOR));	   			       // Number of whole degrees for which horizon brightening occurs
-		size_t iStartGrd = (size_t)round((M_PI - tiltRadians + elevationAngleDown) / DTOR);                          // First whole degree in arc range that sees ground, last is 180
-
-		frontIrradiance.push_back(0.);
-		frontReflected.push_back(0.);
-		double reflectanceNormalIncidence = pow((n2 - 1.0) / (n2 + 1.0), 2.0);
-
 		// Add sky diffuse component and horizon brightening if present
-		for (size_t j = 0; j != iStopIso; j++)
-		{
-			frontIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1)*DTOR)) * MarionAOICorrectionFactorsGlass[j] * isotropicSkyDiffuse;
-			frontReflected[i] += 0.5 * (cos(j * DTOR) - cos((j + 1)*DTOR)) * isotropicSkyDiffuse * (1.0 - MarionAOICorrectionFactorsGlass[j] * (1.0 - reflectanceNormalIncidence));
-
-			if ((iStopIso - j) <= iHorBright)
-			{
-				frontIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * MarionAOICorrectionFactorsGlass[j] * horizonDiffuse / 0.052246; // 0.052246 = 0.5 * [cos(84) - cos(90)]
-				frontReflected[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * (horizonDiffuse / 0.052246) * (1.0 - MarionAOICorrectionFactorsGlass[j] * (1.0 - reflectanceNormalIncidence));
-			}
-		}
-
+		double irradiance = viewFactors.frontSkyIsotropic[i] * isotropicSkyDiffuse + viewFactors.frontSkyHorizon[i] * horizonDiffuse;
+		double reflected = viewFactors.frontReflectedSkyIsotropic[i] * isotropicSkyDiffuse + viewFactors.frontReflectedSkyHorizon[i] * horizonDiffuse;
 
 		// Add ground reflected component
-		for (size_t j = iStartGrd; j < 180; j++)
+		const double * ground = &viewFactors.frontGround[i * intervals];
+		const double * groundReflected = &viewFactors.frontReflectedGround[i * intervals];
+		double groundIrradiance = 0.0;
+		double groundReflectedIrradiance = 0.0;
+		for (size_t k = 0; k != intervals; k++)
 		{
-			double startElevationDown = (j - iStartGrd) * DTOR + elevationAngleDown;
-			double stopElevationDown = (j + 1 - iStartGrd) * DTOR + elevationAngleDown;
-			double projectedX1 = PcellX - PcellY / tan(startElevationDown);
-			double projectedX2 = PcellX - PcellY / tan(stopElevationDown);
-			double actualGroundGHI = 0.0;
-
-			if (fabs(projectedX1 - projectedX2) > 0.99 * rowToRow)
-			{
-				// Use average value if projection approximates the rtr      
-				actualGroundGHI = averageGroundGHI;
-			}
-			else
-			{
-				projectedX1 = intervals * projectedX1 / rowToRow;
-				projectedX2 = intervals * projectedX2 / rowToRow;
-
-				// offset so array indexes are positive
-				while (projectedX1 < 0.0 || projectedX2 < 0.0)
-				{
-					projectedX1 += intervals;
-					projectedX2 += intervals;
-				}
-				
-				size_t index1 = static_cast<size_t>(projectedX1);
-				size_t index2 = static_cast<size_t>(projectedX2);
-
-				if (index1 == index2)
-				{
-					actualGroundGHI = frontGroundGHI[index1];		
-				}
-				else
-				{
-					// Sum irradiances on the ground if projects are in different groundGHI elements
-					for (size_t k = index1; k <= index2; k++)
-					{
-						if (k == index1)
-						{
-							actualGroundGHI += frontGroundGHI[k] * (k + 1.0 - projectedX1);
-						}
-						else if (k == index2)
-						{
-							if (k < intervals) {
-								actualGroundGHI += frontGroundGHI[k] * (projectedX2 - k);
-							} 
-							else {
-								actualGroundGHI += frontGroundGHI[k - 100] * (projectedX2 - k);
-							}
-						}
-						else
-						{
-							if (k < intervals) {
-								actualGroundGHI += frontGroundGHI[k];
-							}
-							else {
-								actualGroundGHI += frontGroundGHI[k - 100];
-							}
-						}
-					}
-					// Irradiance on the ground in the 1-degree field of view
-					actualGroundGHI /= projectedX2 - projectedX1;
-				}
-			}
-			frontIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * MarionAOICorrectionFactorsGlass[j] * actualGroundGHI * this->albedo;
-			frontReflected[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * actualGroundGHI * this->albedo * (1.0 - MarionAOICorrectionFactorsGlass[j] * (1.0 - reflectanceNormalIncidence));
+			groundIrradiance += ground[k] * frontGroundGHI[k];
+			groundReflectedIrradiance += groundReflected[k] * frontGroundGHI[k];
 		}
-		// Calculate and add direct and circumsolar irradiance components
-		incidence(0, tiltRadians * RTOD, surfaceAzimuthRadians * RTOD, 45.0, solarZenithRadians, solarAzimuthRadians, this->enableBacktrack, this->groundCoverageRatio, surfaceAnglesRadians);
-		perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, surfaceAnglesRadians[0], surfaceAnglesRadians[1], solarZenithRadians, poa, diffc);
+		irradiance += groundIrradiance * this->albedo;
+		reflected += groundReflectedIrradiance * this->albedo;
 
 		double cellShade = pvFrontShadeFraction * cellRows - i;
 
@@ -1631,30 +2056,30 @@ void irrad::getFrontSurfaceIrradiances(double pvFrontShadeFraction, double rowTo
 		}
 
 		// Cell not shaded entirely and incidence angle < 90 degrees 
-		if (cellShade < 1.0 && surfaceAnglesRadians[0] < M_PI / 2.0)
+		if (cellShade < 1.0)
 		{
-			double cor = iamSjerpsKoomen(n2, surfaceAnglesRadians[0]);
-			frontIrradiance[i] += (1.0 - cellShade) * (poa[0] + diffc[1]) * cor;
+			irradiance += (1.0 - cellShade) * directCircumsolar;
 		}
+		frontIrradiance[i] = irradiance;
+		frontReflected[i] = reflected;
 		frontAverageIrradiance += frontIrradiance[i] / cellRows;
 	}
 }
 
-void irrad::getBackSurfaceIrradiances(double pvBackShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double , double horizontalLength, std::vector<double> rearGroundGHI, std::vector<double> frontGroundGHI, std::vector<double> frontReflected, std::vector<double> & rearIrradiance, double & rearAverageIrradiance)
+void irrad::getBackSurfaceIrradiances(double pvBackShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, const std::vector<double> & rearGroundGHI, const std::vector<double> & frontGroundGHI, const std::vector<double> & frontReflected, std::vector<double> & rearIrradiance, double & rearAverageIrradiance)
 {
 	// front surface assumed to be glass
 	double n2 = 1.526;
 
-	size_t intervals = 100;
+	size_t intervals = bifacialViewFactors::intervals;
+	size_t cellRows = bifacialViewFactors::cellRows;
 	double solarAzimuthRadians = sunAnglesRadians[0];
 	double solarZenithRadians = sunAnglesRadians[1];
 	double tiltRadians = surfaceAnglesRadians[1];
 	double surfaceAzimuthRadians = surfaceAnglesRadians[2];
 
-	// Average GHI on ground under PV array for cases when x projection exceed 2*rtr
-	double averageGroundGHI = 0.0;          
-	for (size_t i = 0; i != rearGroundGHI.size(); i++)
-		averageGroundGHI += rearGroundGHI[i] / rearGroundGHI.size();
+	// Geometric factors relating each cell row to the sky, ground segments and front of the row behind, see getViewFactors()
+	const bifacialViewFactors & viewFactors = getViewFactors(rowToRow, verticalHeight, clearanceGround, distanceBetweenRows, horizontalLength, tiltRadians);
 
 	// Calculate diffuse isotropic irradiance for a horizontal surface
 	perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, solarZenithRadians, 0, solarZenithRadians, planeOfArrayIrradianceRear, diffuseIrradianceRear);
@@ -1666,166 +2091,36 @@ void irrad::getBackSurfaceIrradiances(double pvBackShadeFraction, double rowToRo
 	perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, surfaceAnglesRadians[0], surfaceAnglesRadians[1], solarZenithRadians, planeOfArrayIrradianceRear, diffuseIrradianceRear);
 	double horizonDiffuse = diffuseIrradianceRear[2];
 
-	// Calculate x,y coordinates of bottom and top edges of PV row in back of desired PV row so that portions of sky and ground viewed by the 
-	// PV cell may be determined. Origin of x-y axis is the ground point below the lower front edge of the desired PV row. The row in back of 
-	// the desired row is in the positive x direction.
-	double PbotX = rowToRow;                         // x value for point on bottom edge of PV module/panel of row in back of (in PV panel slope lengths)
-	double PbotY = clearanceGround;                  // y value for point on bottom edge of PV module/panel of row in back of (in PV panel slope lengths)
-	double PtopX = rowToRow + horizontalLength;      // x value for point on top edge of PV module/panel of row in back of (in PV panel slope lengths)
-	double PtopY = verticalHeight + clearanceGround; // y value for point on top edge of PV module/panel of row in back of (in PV panel slope lengths)
+	// Calculate direct and circumsolar irradiance components, which are the same for all cell rows
+	incidence(0, 180.0 - tiltRadians * RTOD, (surfaceAzimuthRadians * RTOD - 180.0), 45.0, solarZenithRadians, solarAzimuthRadians, this->enableBacktrack, this->groundCoverageRatio, surfaceAnglesRadians);
+	perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, surfaceAnglesRadians[0], surfaceAnglesRadians[1], solarZenithRadians, planeOfArrayIrradianceRear, diffuseIrradianceRear);
+	double directCircumsolar = 0.0;
+	if (surfaceAnglesRadians[0] < M_PI / 2.0) {
+		directCircumsolar = (planeOfArrayIrradianceRear[0] + diffuseIrradianceRear[1]) * iamSjerpsKoomen(n2, surfaceAnglesRadians[0]);
+	}
 
 	// Calculate diffuse and direct component irradiances for each cell row (assuming 6 rows)
-	size_t cellRows = 6;
+	rearIrradiance.assign(cellRows, 0.0);
 	for (size_t i = 0; i != cellRows; i++)
 	{
-		// Calculate diffuse irradiances and reflected amounts for each cell row over its field of view of 180 degrees, 
-		// beginning with the angle providing the upper most view of the sky (j=0)
-		double PcellX = horizontalLength * (i + 0.5) / ((double)cellRows);				   // x value for location of PV cell with OFFSET FOR SARA REFERENCE CELLS     4/26/2016
-		double PcellY = clearanceGround + verticalHeight * (i + 0.5) / ((double)cellRows); // y value for location of PV cell with OFFSET FOR SARA REFERENCE CELLS     4/26/2016
-		double elevationAngleUp = atan((PtopY - PcellY) / (PtopX - PcellX));          // Elevation angle up from PV cell to top of PV module/panel, radians
-		double elevationAngleDown = atan((PcellY - PbotY) / (PbotX - PcellX));        // Elevation angle down from PV cell to bottom of PV module/panel, radians
-		size_t iStopIso = (size_t)round((tiltRadians - elevationAngleUp) / DTOR);							   // Last whole degree in arc range that sees sky, first is 0
-		size_t iHorBright = (size_t)round(fmax(0.0, 6.0 - elevationAngleUp / DTOR));	   			       // Number of whole degrees for which horizon brightening occurs
-		size_t iStartGrd = (size_t)round((tiltRadians + elevationAngleDown) / DTOR);                          // First whole degree in arc range that sees ground, last is 180
-
-		rearIrradiance.push_back(0);
-		for (size_t j = 0; j != iStopIso; j++)
-		{
-			rearIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1)*DTOR)) * MarionAOICorrectionFactorsGlass[j]* isotropicSkyDiffuse;
-			if ((iStopIso - j) <= iHorBright)
-			{
-				rearIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * MarionAOICorrectionFactorsGlass[j]* horizonDiffuse / 0.052264; // 0.052246 = 0.5 * [cos(84) - cos(90)]
-			}
-		}
+		// Add sky diffuse component and horizon brightening if present
+		double irradiance = viewFactors.rearSkyIsotropic[i] * isotropicSkyDiffuse + viewFactors.rearSkyHorizon[i] * horizonDiffuse;
 
 		// Add relections from PV module front surfaces
-		for (size_t j = iStopIso; j < iStartGrd; j++)
-		{
-			double diagonalDistance = (PbotX - PcellX) / cos(elevationAngleDown);
-			double startAlpha = -(double)(j - iStopIso) * DTOR + elevationAngleUp + elevationAngleDown;
-			double stopAlpha = -(double)(j + 1 - iStopIso) * DTOR + elevationAngleUp + elevationAngleDown;
-			double m = diagonalDistance * sin(startAlpha);
-			double theta = M_PI - elevationAngleDown - (M_PI / 2.0 - startAlpha) - tiltRadians;
-			double projectedX2 = m / cos(theta);
-
-			m = diagonalDistance * sin(stopAlpha);
-			theta = M_PI - elevationAngleDown - (M_PI / 2.0 - stopAlpha) - tiltRadians;
-			double projectedX1 = m / cos(theta);
-			projectedX1 = fmax(0.0, projectedX1);
-
-			double PVreflectedIrradiance = 0.0;
-			double deltaCell = 1.0 / cellRows;
-			double tolerance = 0.0001;
-			for (size_t k = 0; k < cellRows; k++)
-			{
-				double cellBottom = k * deltaCell;
-				double cellTop = (k + 1) * deltaCell;
-				double cellLengthSeen = 0.0;
-
-				if (cellBottom >= projectedX1 - tolerance && cellTop <= projectedX2 + tolerance) {
-					cellLengthSeen = cellTop - cellBottom;
-				}
-				else if (cellBottom <= projectedX1 + tolerance && cellTop >= projectedX2 - tolerance) {
-					cellLengthSeen = projectedX2 - projectedX1;
-				}
-				else if (cellBottom >= projectedX1 - tolerance && projectedX2 > cellBottom - tolerance && cellTop >= projectedX2 - tolerance) {
-					cellLengthSeen = projectedX2 - cellBottom;
-				}
-				else if (cellBottom <= projectedX1 + tolerance && projectedX1 < cellTop + tolerance && cellTop <= projectedX2 + tolerance) {
-					cellLengthSeen = cellTop - projectedX1;
-				}
-
-				PVreflectedIrradiance += cellLengthSeen * frontReflected[k];
-			}
-			PVreflectedIrradiance /= projectedX2 - projectedX1;
-			rearIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * MarionAOICorrectionFactorsGlass[j] * PVreflectedIrradiance;
+		const double * pvReflected = &viewFactors.rearPVReflected[i * cellRows];
+		for (size_t k = 0; k != cellRows; k++) {
+			irradiance += pvReflected[k] * frontReflected[k];
 		}
 
-
 		// Add ground reflected component
-		for (size_t j = iStartGrd; j < 180; j++)
+		const double * ground = &viewFactors.rearGround[i * 2 * intervals];
+		double groundIrradiance = 0.0;
+		for (size_t k = 0; k != intervals; k++)
 		{
-			double startElevationDown = (double)(j - iStartGrd) * DTOR + elevationAngleDown;
-			double stopElevationDown = (double)(j + 1 - iStartGrd) * DTOR + elevationAngleDown;
-			double projectedX2 = PcellX + PcellY / tan(startElevationDown);
-			double projectedX1 = PcellX + PcellY / tan(stopElevationDown);
-			double actualGroundGHI = 0.0;
-
-			if (fabs(projectedX1 - projectedX2) > 0.99 * rowToRow)
-			{
-				// Use average value if projection approximates the rtr      
-				actualGroundGHI = averageGroundGHI;
-			}
-			else
-			{
-				projectedX1 = intervals * projectedX1 / rowToRow;
-				projectedX2 = intervals * projectedX2 / rowToRow;
-
-				// offset so array indexed are less than number of intervals
-				while (projectedX1 >= intervals || projectedX2 >= intervals)
-				{
-					projectedX1 -= intervals;
-					projectedX2 -= intervals;
-				}
-				while (projectedX1 < -(int)intervals || projectedX2 < -(int)intervals)
-				{
-					projectedX1 += intervals;
-					projectedX2 += intervals;
-				}
-				int index1 = static_cast<int>(projectedX1 + intervals) - (int)intervals;
-				int index2 = static_cast<int>(projectedX2 + intervals) - (int)intervals;
-
-				if (index1 == index2)
-				{
-					if (index1 < 0){
-						actualGroundGHI = frontGroundGHI[index1 + 100];
-					}
-					else {
-						actualGroundGHI = rearGroundGHI[index1];
-					}
-				}
-				else
-				{
-					// Sum irradiances on the ground if projects are in different groundGHI elements
-					for (int k = index1; k <= index2; k++)
-					{
-						if (k == index1)
-						{
-							if (k < 0) {
-								actualGroundGHI += frontGroundGHI[k + intervals] * (k + 1.0 - projectedX1);
-							}
-							else {
-								actualGroundGHI += rearGroundGHI[k] * (k + 1.0 - projectedX1);
-							}
-						}
-						else if (k == index2)
-						{
-							if (k < 0) {
-								actualGroundGHI += frontGroundGHI[k + intervals] * (projectedX2 - k);
-							}
-							else {
-								actualGroundGHI += rearGroundGHI[k] * (projectedX2 - k);
-							}
-						}
-						else
-						{
-							if (k < 0) {
-								actualGroundGHI += frontGroundGHI[k + 100];
-							}
-							else {
-								actualGroundGHI += rearGroundGHI[k];
-							}
-						}
-					}
-					// Irradiance on the ground in the 1-degree field of view
-					actualGroundGHI /= projectedX2 - projectedX1;
-				}
-			}
-			rearIrradiance[i] += 0.5 * (cos(j * DTOR) - cos((j + 1) * DTOR)) * MarionAOICorrectionFactorsGlass[j] * actualGroundGHI * this->albedo;
+			groundIrradiance += ground[k] * frontGroundGHI[k];
+			groundIrradiance += ground[intervals + k] * rearGroundGHI[k];
 		}
-		// Calculate and add direct and circumsolar irradiance components
-		incidence(0, 180.0 - tiltRadians * RTOD, (surfaceAzimuthRadians * RTOD - 180.0), 45.0, solarZenithRadians, solarAzimuthRadians, this->enableBacktrack, this->groundCoverageRatio, surfaceAnglesRadians);
-		perez(0, calculatedDirectNormal, calculatedDiffuseHorizontal, albedo, surfaceAnglesRadians[0], surfaceAnglesRadians[1], solarZenithRadians, planeOfArrayIrradianceRear, diffuseIrradianceRear);
+		irradiance += groundIrradiance * this->albedo;
 
 		double cellShade = pvBackShadeFraction * cellRows - i;
 		
@@ -1838,11 +2133,11 @@ void irrad::getBackSurfaceIrradiances(double pvBackShadeFraction, double rowToRo
 		}
 
 		// Cell not shaded entirely and incidence angle < 90 degrees 
-		if (cellShade < 1.0 && surfaceAnglesRadians[0] < M_PI / 2.0)
+		if (cellShade < 1.0)
 		{
-			double iamMod = iamSjerpsKoomen(n2, surfaceAnglesRadians[0]);
-			rearIrradiance[i] += (1.0 - cellShade) * (planeOfArrayIrradianceRear[0] + diffuseIrradianceRear[1]) * iamMod;
+			irradiance += (1.0 - cellShade) * directCircumsolar;
 		}
+		rearIrradiance[i] = irradiance;
 		rearAverageIrradiance += rearIrradiance[i] / cellRows;
 	}
 }
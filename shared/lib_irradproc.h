@@ -51,10 +51,12 @@
 #define __irradproc_h
 
 #include <memory>
+#include <vector>
 
 #include "lib_weatherfile.h"
 
 struct poaDecompReq;
+struct poaDecompSeries;
 
 /**
 * \file
@@ -206,6 +208,23 @@ void hdkr( double hextra, double dn, double df, double alb, double inc, double t
 */
 int poaDecomp( double wfPOA, double angle[], double sun[], double alb, poaDecompReq* pA, double &dn, double &df, double &gh, double poa[3], double diffc[3]);
 
+/**
+* poaDecompBatch decomposes every time step of the plane-of-array series held in pA at once, using the
+* same model as poaDecomp. Days are independent of each other, so they are split across threads. Within a
+* day, each GTI_DIRINT solve can optionally start from the GTI correction found at the previous step, which
+* usually converges in fewer iterations but can shift results within the 1 W/m2 convergence tolerance.
+* Steps with the sun down are left at zero and flagged as not solved.
+*
+* \param[in] pA POA, angle, and timestep data for the whole series (the i, dayStart, doy, and tDew members are not used)
+* \param[in] alb albedo for each time step (0-1)
+* \param[in] tDew dew point temperature for each time step (C)
+* \param[in] warmStart start each GTI_DIRINT solve from the previous step's solution within the same day
+* \param[in] nthreads number of threads to split days across, 0 to use the hardware concurrency
+* \param[out] out decomposition results for each time step
+* \return total number of GTI_DIRINT iterations
+*/
+size_t poaDecompBatch( const poaDecompReq &pA, const std::vector<double> &alb, const std::vector<double> &tDew, bool warmStart, int nthreads, poaDecompSeries &out );
+
 /**
 * ModifiedDISC calculates direct normal (beam) radiation from global horizontal radiation.
 *  This function uses a disc beam model to calculate the beam irradiance returned. 
@@ -275,6 +294,41 @@ double shadeFraction1x(double solazi, double solzen, double tilt, double azimuth
 */
 double backtrack(double solazi, double solzen, double tilt, double azimuth, double rotlim, double gcr, double rotation);
 
+/**
+* \struct bifacialViewFactors
+*
+* Geometric view factors used by \link irrad::calc_rear_side(). The factors depend only on the row geometry and the surface tilt,
+* so they are computed once per configuration and the per-timestep work reduces to small dense matrix-vector products.
+* An instance may be kept by the caller and attached to successive irrad objects with \link irrad::set_bifacial_view_factors()
+*/
+struct bifacialViewFactors
+{
+	static const size_t intervals = 100;	///< Number of ground segments between the front of one row and the front of the next
+	static const size_t cellRows = 6;		///< Number of cell rows along the module slope
+
+	bifacialViewFactors();
+
+	/// Return true if the factors were computed for the given geometry
+	bool matches(double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, double tiltRadians) const;
+
+	bool valid;								///< Whether the factors have been computed
+	double geometry[6];						///< Row to row, vertical height, ground clearance, distance between rows, horizontal length, tilt (radians)
+
+	std::vector<double> skyConfigFactors;	///< [intervals] Sky configuration factors of each ground segment
+
+	std::vector<double> frontSkyIsotropic;	///< [cellRows] Front irradiance per unit isotropic sky diffuse
+	std::vector<double> frontSkyHorizon;	///< [cellRows] Front irradiance per unit horizon diffuse
+	std::vector<double> frontReflectedSkyIsotropic;	///< [cellRows] Front reflected irradiance per unit isotropic sky diffuse
+	std::vector<double> frontReflectedSkyHorizon;	///< [cellRows] Front reflected irradiance per unit horizon diffuse
+	std::vector<double> frontGround;		///< [cellRows x intervals] Front irradiance per unit albedo-weighted front ground GHI
+	std::vector<double> frontReflectedGround; ///< [cellRows x intervals] Front reflected irradiance per unit albedo-weighted front ground GHI
+
+	std::vector<double> rearSkyIsotropic;	///< [cellRows] Rear irradiance per unit isotropic sky diffuse
+	std::vector<double> rearSkyHorizon;		///< [cellRows] Rear irradiance per unit horizon diffuse
+	std::vector<double> rearGround;			///< [cellRows x 2*intervals] Rear irradiance per unit albedo-weighted ground GHI, front ground segments followed by rear ground segments
+	std::vector<double> rearPVReflected;	///< [cellRows x cellRows] Rear irradiance per unit front reflected irradiance of the row behind
+};
+
 
 /**
 * \class irrad
@@ -329,6 +383,13 @@ protected:
 	int timeStepSunPosition[3];				///< [0] effective hour of day used for sun position, [1] effective minute of hour used for sun position, [2] is sun up?  (0=no, 1=midday, 2=sunup, 3=sundown)
 	double planeOfArrayIrradianceRearAverage; ///< Average rear side plane-of-array irradiance (W/m2)
 
+	// Bifacial geometry
+	bifacialViewFactors localViewFactors;	///< View factors owned by this object, used if none are attached
+	bifacialViewFactors * sharedViewFactors;	///< View factors attached by the caller to persist across timesteps
+
+	/// Return the view factors for the given geometry, recomputing them only if the geometry has changed
+	bifacialViewFactors & getViewFactors(double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, double tiltRadians);
+
 public:
 
 	/// Directive to indicate that if delt_hr is less than zero, do not interpolate sunrise and sunset hours
@@ -389,6 +450,15 @@ public:
 
 	/// Run the irradiance processor for the rear-side of the surface to calculate rear-side plane-of-array irradiance
 	int calc_rear_side(double transmissionFactor, double bifaciality, double groundClearanceHeight, double slopeLength);
+
+	/// Run calc_rear_side() once per timestep over a series of sun angles (radians) and beam and diffuse irradiance, returning the rear-side average irradiance (W/m2) at each step.
+	/// This is a convenience loop: it updates the sun and surface angles of this object at each step, and only shares the cached view factors between steps.
+	int calc_rear_side_series(double transmissionFactor, double bifaciality, double groundClearanceHeight, double slopeLength,
+		const std::vector<double> & solarAzimuthRadians, const std::vector<double> & solarZenithRadians, const std::vector<double> & solarElevationRadians,
+		const std::vector<double> & beam, const std::vector<double> & diffuse, std::vector<double> & rearIrradiance);
+
+	/// Attach view factors owned by the caller, so that they are reused by subsequent irrad objects for the same subarray
+	void set_bifacial_view_factors(bifacialViewFactors * viewFactors);
 	
 	/// Return the calculated sun angles, some of which are converted to degrees
 	void get_sun( double *solazi,
@@ -435,13 +505,13 @@ public:
 	void getGroundShadeFactors(double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, double solarAzimuthRadians, double solarElevationRadians, std::vector<int> & rearGroundFactors, std::vector<int> & frontGroundFactors, double & maxShadow, double & pvBackShadeFraction, double & pvFrontShadeFraction);
 
 	/// Return the ground global-horizonal irradiance, used by \link calc_rear_side()
-	void getGroundGHI(double transmissionFactor, std::vector<double> rearSkyConfigFactors, std::vector<double> frontSkyConfigFactors, std::vector<int> rearGroundShadeFactors, std::vector<int> frontGroundShadeFactors, std::vector<double> & rearGroundGHI, std::vector<double> & frontGroundGHI);
+	void getGroundGHI(double transmissionFactor, const std::vector<double> & rearSkyConfigFactors, const std::vector<double> & frontSkyConfigFactors, const std::vector<int> & rearGroundShadeFactors, const std::vector<int> & frontGroundShadeFactors, std::vector<double> & rearGroundGHI, std::vector<double> & frontGroundGHI);
 
 	/// Return the back surface irradiances, used by \link calc_rear_side()
-	void getBackSurfaceIrradiances(double pvBackShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, std::vector<double> rearGroundGHI, std::vector<double> frontGroundGHI, std::vector<double> frontReflected, std::vector<double> & rearIrradiance, double & rearAverageIrradiance);
+	void getBackSurfaceIrradiances(double pvBackShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, const std::vector<double> & rearGroundGHI, const std::vector<double> & frontGroundGHI, const std::vector<double> & frontReflected, std::vector<double> & rearIrradiance, double & rearAverageIrradiance);
 
 	/// Return the front surface irradiances, used by \link calc_rear_side()
-	void getFrontSurfaceIrradiances(double pvBackShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, std::vector<double> frontGroundGHI, std::vector<double> & frontIrradiance, double & frontAverageIrradiance, std::vector<double> & frontReflected);
+	void getFrontSurfaceIrradiances(double pvBackShadeFraction, double rowToRow, double verticalHeight, double clearanceGround, double distanceBetweenRows, double horizontalLength, const std::vector<double> & frontGroundGHI, std::vector<double> & frontIrradiance, double & frontAverageIrradiance, std::vector<double> & frontReflected);
 
 	enum RADMODE { DN_DF, DN_GH, GH_DF, POA_R, POA_P };
 	enum SKYMODEL { ISOTROPIC, HDKR, PEREZ };
@@ -449,9 +519,20 @@ public:
 
 };
 
+// results of poaDecompBatch for each time step
+struct poaDecompSeries {
+	std::vector<double> dn, df, gh; // decomposed irradiance (W/m2)
+	std::vector<double> poa[3]; // modeled POA (beam, sky diffuse, ground diffuse) (W/m2)
+	std::vector<double> diffc[3]; // diffuse components, only computed when the sun is behind the array
+	std::vector<double> alb, tDew; // step inputs the results were computed with
+	std::vector<int> errorcode; // 0, 40, 41, or 42 as returned by poaDecomp
+	std::vector<int> iterations; // GTI_DIRINT iterations spent on the step
+	std::vector<char> solved; // 1 if the step was decomposed (sun up)
+};
+
 // allow for the poa decomp model to take all daily POA measurements into consideration
 struct poaDecompReq {
-	poaDecompReq() : i(0), dayStart(0), stepSize(1), stepScale('h'), doy(-1) {}
+	poaDecompReq() : i(0), dayStart(0), stepSize(1), stepScale('h'), doy(-1), useBatch(false) {}
 	size_t i; // Current time index
 	size_t dayStart; // time index corresponding to the start of the current day
 	double stepSize;
@@ -464,6 +545,8 @@ struct poaDecompReq {
 	double tDew;
 	int doy;
 	double elev;
+	bool useBatch; // poaDecomp returns results from batch when the step inputs match
+	poaDecompSeries batch;
 };
 
 #endif
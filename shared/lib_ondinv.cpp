@@ -64,6 +64,7 @@
 
 
 const int TEMP_DERATE_ARRAY_LENGTH = 6;
+const int EFF_TABLE_INTERVALS = 2000;
 // test commit
 
 ond_inverter::ond_inverter()
@@ -296,6 +297,15 @@ void ond_inverter::initializeManual()
 			}
 			m_bspline3[j] = BSpline::Builder(samples).degree(3).build();
 
+			// tabulate the spline so that calcEfficiency does not need to evaluate it
+			m_effTable[j].resize(EFF_TABLE_INTERVALS + 1);
+			m_effTableStep[j] = (x_max[j] - x_lim[j]) / EFF_TABLE_INTERVALS;
+			for (int k = 0; k <= EFF_TABLE_INTERVALS; k++)
+			{
+				xSamples(0) = (k == EFF_TABLE_INTERVALS) ? x_max[j] : x_lim[j] + k * m_effTableStep[j];
+				m_effTable[j][k] = m_bspline3[j].eval(xSamples);
+			}
+
 		}
 		ondIsInitialized = true;
 	}
@@ -304,7 +314,6 @@ void ond_inverter::initializeManual()
 double ond_inverter::calcEfficiency(double Pdc, int index_eta) {
 	double eta;
 //	int splineIndex;
-	DenseVector x(1);
 //	if (Pdc > (Pdc_threshold * PNomDC_eff)) {
 //		splineIndex = 1;
 //	}
@@ -325,8 +334,17 @@ double ond_inverter::calcEfficiency(double Pdc, int index_eta) {
 	else if (Pdc >= x_lim[index_eta]) 
 	{
 //		eta = effSpline[splineIndex][index_eta](Pdc);
-		x(0) = Pdc;
-		eta = (m_bspline3[index_eta]).eval(x);
+		// linear interpolation in the tabulated spline
+		const std::vector<double> &table = m_effTable[index_eta];
+		if (m_effTableStep[index_eta] > 0)
+		{
+			double pos = (Pdc - x_lim[index_eta]) / m_effTableStep[index_eta];
+			int k = (int)pos;
+			if (k > EFF_TABLE_INTERVALS - 1) k = EFF_TABLE_INTERVALS - 1;
+			eta = table[k] + (pos - k) * (table[k + 1] - table[k]);
+		}
+		else
+			eta = table[0];
 	}
 	else 
 	{
@@ -510,3 +528,23 @@ bool ond_inverter::acpower(
 	*Plr = Pdc_eff / PNomDC_eff;
 	return true;
 }
+
+void ond_inverter::acpower_batch(
+	size_t n,
+	/* inputs */
+	const double *Pdc,
+	const double *Vdc,
+	const double *Tamb,
+
+	/* outputs */
+	double *Pac,
+	double *Eff,
+	double *Pcliploss,
+	double *Psoloss,
+	double *Pntloss
+)
+{
+	double Ppar, Plr, dcloss, acloss;
+	for (size_t i = 0; i < n; i++)
+		acpower(Pdc[i], Vdc[i], Tamb[i], &Pac[i], &Ppar, &Plr, &Eff[i], &Pcliploss[i], &Psoloss[i], &Pntloss[i], &dcloss, &acloss);
+}
@@ -115,6 +115,22 @@ public:
 		double *dcloss,		/* DC power loss (Wdc) */
 		double *acloss		/* AC power loss (Wac) */
 	);
+	// calculates AC power for n timesteps, each with one MPPT input, by calling acpower for each.
+	// there is no separate kernel: the temperature derate, DC cable loss and efficiency curve selection all depend on the step inputs.
+	void acpower_batch(
+		size_t n,
+		/* inputs */
+		const double *Pdc,	/* Input power to inverter (Wdc) */
+		const double *Vdc,	/* Voltage input to inverter (Vdc) */
+		const double *Tamb,	/* Ambient temperature (C) */
+
+		/* outputs */
+		double *Pac,		/* AC output power (Wac) */
+		double *Eff,		/* Conversion efficiency (0..1) */
+		double *Pcliploss,	/* Power loss due to clipping loss (Wac) */
+		double *Psoloss,	/* Power loss due to operating power consumption (Wdc) */
+		double *Pntloss		/* Power loss due to night time tare loss (Wac), equal to the parasitic consumption */
+	);
 	double calcEfficiency(
 		double Pdc,
 		int index_eta
@@ -133,6 +149,9 @@ private:
 //	tk::spline effSpline[2][3];
 //	BSpline m_bspline3[2][3];
 	BSpline m_bspline3[3];
+	// spline efficiency curves tabulated on a uniform Pdc grid from x_lim to x_max, for constant time lookup
+	std::vector<double> m_effTable[3];
+	double m_effTableStep[3];
 	double x_max[3];
 	double x_lim[3];
 	double Pdc_threshold;
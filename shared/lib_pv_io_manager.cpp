@@ -143,6 +143,8 @@ Irradiance_IO::Irradiance_IO(compute_module* cm, std::string cmName)
 
 	useWeatherFileAlbedo = cm->as_boolean("use_wf_albedo");
 	userSpecifiedMonthlyAlbedo = cm->as_vector_double("albedo");
+	poaDecompWarmStart = cm->as_boolean("poa_decomp_warm_start");
+	poaDecompThreads = cm->as_integer("poa_decomp_nthreads");
 	
 	checkWeatherFile(cm, cmName);
 }
@@ -445,6 +447,10 @@ void PVSystem_IO::SetupPOAInput()
 			}
 
 
+			// albedo and dew point for the batch decomposition, chosen the same way irrad does for each step
+			std::vector<double> albedo(8760 * Irradiance->stepsPerHour, 0.0);
+			std::vector<double> tDew(8760 * Irradiance->stepsPerHour, 0.0);
+
 			double ts_hour = Simulation->dtHour;
 			weather_header hdr = Irradiance->weatherHeader;
 			weather_data_provider * wdprov = Irradiance->weatherDataProvider.get();
@@ -460,6 +466,12 @@ void PVSystem_IO::SetupPOAInput()
 					}
 					int month_idx = wf.month - 1;
 
+					if (Irradiance->useWeatherFileAlbedo && std::isfinite(wf.alb) && wf.alb > 0 && wf.alb < 1)
+						albedo[ii] = wf.alb;
+					else if (month_idx >= 0 && month_idx < 12)
+						albedo[ii] = Irradiance->userSpecifiedMonthlyAlbedo[month_idx];
+					tDew[ii] = wf.tdew;
+
 					if (Subarrays[nn]->trackMode == irrad::SEASONAL_TILT)
 						Subarrays[nn]->tiltDegrees = Subarrays[nn]->monthlyTiltDegrees[month_idx]; //overwrite the tilt input with the current tilt to be used in calculations
 
@@ -550,6 +562,13 @@ void PVSystem_IO::SetupPOAInput()
 				}
 			}
 			wdprov->rewind();
+
+			// with warm start, decompose the whole year up front, poaDecomp falls back to the per-step solution where inputs differ
+			if (Irradiance->poaDecompWarmStart)
+			{
+				poaDecompBatch(*Subarrays[nn]->poa.poaAll, albedo, tDew, true, Irradiance->poaDecompThreads, Subarrays[nn]->poa.poaAll->batch);
+				Subarrays[nn]->poa.poaAll->useBatch = true;
+			}
 		}
 	}
 }
@@ -198,6 +198,8 @@ struct Irradiance_IO
 	int skyModel;												  /// Specify which sky diffuse model should be used: 0=isotropic, 1=hdkr, 2=perez
 	flag useWeatherFileAlbedo;									  /// Specify whether to use the weather file albedo
 	std::vector<double> userSpecifiedMonthlyAlbedo;				  /// User can provide monthly ground albedo values (0-1)
+	flag poaDecompWarmStart;									  /// Warm-start the POA decomposition from the previous time step
+	int poaDecompThreads;										  /// Threads for the warm-started POA decomposition, 0 for all cores
 	
 	// Irradiance data Outputs (p_ is just a convention to organize all pointer outputs)
 	ssc_number_t * p_weatherFileGHI;			/// The Global Horizonal Irradiance from the weather file [W/m2]
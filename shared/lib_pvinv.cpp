@@ -100,6 +100,23 @@ bool partload_inverter_t::acpower(
 		Pdc_total += Pdc[m];
 	if ( Pdco <= 0 ) return false;
 
+	acpower_total(Pdc_total, Pac, Ppar, Plr, Eff, Pcliploss, Pntloss);
+	return true;
+}
+
+void partload_inverter_t::acpower_total(
+	/* inputs */
+	double Pdc_total,
+
+	/* outputs */
+	double *Pac,
+	double *Ppar,
+	double *Plr,
+	double *Eff,
+	double *Pcliploss,
+	double *Pntloss
+	)
+{
 	// handle limits - can send error back or record out of range values
 //	if ( Pdc < 0 ) Pdc = 0;
 //	if ( Pdc > Pdco ) Pdc = Pdco;
@@ -169,9 +186,25 @@ bool partload_inverter_t::acpower(
 	}
 
 	*Plr = Pdc_total / Pdco;
-
-	return true;
 }
 
+bool partload_inverter_t::acpower_batch(
+	size_t n,
+	/* inputs */
+	const double *Pdc,
 
+	/* outputs */
+	double *Pac,
+	double *Eff,
+	double *Pcliploss,
+	double *Pntloss
+	)
+{
+	if ( Pdco <= 0 ) return false;
+
+	double Ppar, Plr;
+	for (size_t i = 0; i < n; i++)
+		acpower_total(Pdc[i], &Pac[i], &Ppar, &Plr, &Eff[i], &Pcliploss[i], &Pntloss[i]);
 
+	return true;
+}
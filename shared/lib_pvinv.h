@@ -95,6 +95,35 @@ public:
 		double *Pntloss /* Power loss due to night time tare loss (Wac) */
 		);
 
+	//function that calculates AC power and inverter losses for n timesteps, each a single inverter with one MPPT input.
+	//gives the same results as calling acpower for each, without its per-call allocations.
+	bool acpower_batch(
+		size_t n,
+		/* inputs */
+		const double *Pdc,     /* Input power to a SINGLE inverter (Wdc) */
+
+		/* outputs */
+		double *Pac,    /* AC output power (Wac) */
+		double *Eff,	    /* Conversion efficiency (0..1) */
+		double *Pcliploss, /* Power loss due to clipping loss (Wac) */
+		double *Pntloss /* Power loss due to night time tare loss (Wac) */
+		);
+
+private:
+	//calculates AC power and inverter losses for the total DC power of all MPPT inputs, shared by acpower and acpower_batch
+	void acpower_total(
+		/* inputs */
+		double Pdc_total,	/* Total input power to inverter (Wdc) */
+
+		/* outputs */
+		double *Pac,    /* AC output power (Wac) */
+		double *Ppar,   /* AC parasitic power consumption (Wac) */
+		double *Plr,    /* Part load ratio (Pdc_in/Pdc_rated, 0..1) */
+		double *Eff,	    /* Conversion efficiency (0..1) */
+		double *Pcliploss, /* Power loss due to clipping loss (Wac) */
+		double *Pntloss /* Power loss due to night time tare loss (Wac) */
+		);
+
 } ;
 
 #endif
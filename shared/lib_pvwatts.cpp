@@ -99,6 +99,7 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "lib_irradproc.h"
 #include "lib_pvwatts.h"
 
 #ifndef M_PI
@@ -387,3 +388,112 @@ double dctoac(double pcrate,double efffp,double dc)
 
 	return(ac);
 }
+
+pvwatts_engine::params::params()
+{
+	lat = lon = tz = 0;
+	system_size = 1;
+	derate = 0.77;
+	track_mode = 0;
+	azimuth = 180;
+	tilt = -999; /* use latitude */
+	rotlim = 45.0;
+	t_noct = 45.0;
+	t_ref = 25.0;
+	gamma = -0.5;
+	inv_eff = 0.92;
+	fd = 1.0;
+	i_ref = 1000;
+	poa_cutin = 0;
+	w_stow = 0;
+	time_step = 1.0;
+}
+
+pvwatts_engine::pvwatts_engine( const params &p )
+	: m_p( p ),
+	m_tccalc( p.t_noct + 273.15, PVWATTS_HEIGHT, p.time_step )
+{
+	/* all losses except inverter, decimal.  calculated before the derate
+		bounds check below, as the pvwattsv1_1ts compute module always has */
+	m_tmloss = 1.0 - m_p.derate/m_p.inv_eff;
+
+	/* same input bounds as the pvwattsv1_1ts compute module */
+	m_p.tilt = fabs( m_p.tilt );
+	if ( m_p.system_size < 0.1 ) m_p.system_size = 0.1;
+	if ( m_p.derate < 0.0 || m_p.derate > 1.0 ) m_p.derate = 0.77;
+	if ( m_p.track_mode < 0 || m_p.track_mode > 3 ) m_p.track_mode = 0;
+	if ( m_p.tilt < 0 || m_p.tilt > 90 ) m_p.tilt = m_p.lat;
+	if ( m_p.azimuth < 0 || m_p.azimuth > 360 ) m_p.azimuth = 180.0;
+
+	m_pcrate = m_p.system_size * 1000.0;
+	m_refpwr = m_p.system_size * 1000.0;
+	m_pwrdgr = m_p.gamma / 100.0;
+
+	m_poa = m_dc = m_ac = 0;
+	m_tcell = 0;
+}
+
+void pvwatts_engine::set_last_values( double tcell, double poa )
+{
+	m_tccalc.set_last_values( tcell, poa );
+}
+
+int pvwatts_engine::step( int year, int month, int day, int hour, double minute,
+	double ghi, double dni, double dhi, double tamb, double wspd, double snow )
+{
+	m_poa = 0;
+	m_tcell = tamb;
+	m_dc = 0;
+	m_ac = 0;
+
+	irrad irr;
+	irr.set_time( year, month, day, hour, minute, IRRADPROC_NO_INTERPOLATE_SUNRISE_SUNSET );
+	irr.set_location( m_p.lat, m_p.lon, m_p.tz );
+
+	double alb = 0.2;
+	if (snow > 0 && snow < 150)
+		alb = 0.6;
+
+	irr.set_sky_model( 2, alb );
+	if ( dhi < 0 )
+		irr.set_global_beam( ghi, dni );
+	else
+		irr.set_beam_diffuse( dni, dhi );
+	irr.set_surface( m_p.track_mode, m_p.tilt, m_p.azimuth, m_p.rotlim, true, -1 );
+
+	int code = irr.calc();
+	if ( code != 0 )
+		return code;
+
+	int sunup;
+	irr.get_sun( 0, 0, 0, 0, 0, 0, &sunup, 0, 0, 0 );
+	if ( sunup > 0 )
+	{
+		double aoi, ibeam, iskydiff, ignddiff;
+		irr.get_angles( &aoi, 0, 0, 0, 0 );
+		irr.get_poa( &ibeam, &iskydiff, &ignddiff, 0, 0, 0 );
+
+		double poa = ibeam + m_p.fd*(iskydiff + ignddiff);
+
+		if ( m_p.poa_cutin > 0 && poa < m_p.poa_cutin )
+			poa = 0;
+
+		double wspd_corr = wspd < 0 ? 0 : wspd;
+
+		if ( m_p.w_stow > 0 && wspd >= m_p.w_stow )
+			poa = 0;
+
+		double tpoa = transpoa( poa, dni, aoi*3.14159265358979/180, false );
+		m_tcell = m_tccalc( poa, wspd_corr, tamb );
+		m_dc = dcpowr( m_p.t_ref, m_refpwr, m_pwrdgr, m_tmloss, tpoa, m_tcell, m_p.i_ref );
+		m_ac = dctoac( m_pcrate, m_p.inv_eff, m_dc );
+		m_poa = poa;
+	}
+	else
+	{
+		/* sun down: module returns to ambient, as if tcell and poa were fed back by the caller */
+		m_tccalc( 0, wspd, tamb );
+	}
+
+	return 0;
+}
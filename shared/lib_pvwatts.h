@@ -135,4 +135,55 @@ public:
 	void set_last_values( double Tc, double poa );
 };
 
+/*
+	Persistent single time step PVWatts (V1) model.  Holds the system configuration
+	and the module thermal state between calls, so a long running caller can step it
+	once per new weather observation without rebuilding any inputs.  Gives the same
+	results as the pvwattsv1_1ts compute module with tcell and poa fed back each step.
+*/
+class pvwatts_engine
+{
+public:
+	/* system configuration and advanced parameters, defaults match pvwattsv1_1ts */
+	struct params
+	{
+		double lat, lon, tz;
+		double system_size;	/* kWdc */
+		double derate;		/* 0..1 */
+		int track_mode;		/* 0=fixed, 1=1axis, 2=2axis, 3=azimuth axis */
+		double azimuth, tilt;	/* deg */
+		double rotlim;		/* deg */
+		double t_noct, t_ref;	/* C */
+		double gamma;		/* %/C */
+		double inv_eff;		/* 0..1 */
+		double fd;			/* diffuse fraction */
+		double i_ref;		/* W/m2 */
+		double poa_cutin;	/* W/m2 */
+		double w_stow;		/* m/s */
+		double time_step;	/* hours */
+
+		params();
+	};
+
+	pvwatts_engine( const params &p );
+
+	/* returns irrad::calc error code, 0 on success.  ghi is only used when dhi is negative (missing) */
+	int step( int year, int month, int day, int hour, double minute,
+		double ghi, double dni, double dhi, double tamb, double wspd, double snow = 0 );
+
+	/* set the module temperature (C) and POA irradiance (W/m2) of the previous time step */
+	void set_last_values( double tcell, double poa );
+
+	double poa() const { return m_poa; }
+	double tcell() const { return m_tcell; }
+	double dc() const { return m_dc; }
+	double ac() const { return m_ac; }
+
+private:
+	params m_p;
+	double m_pcrate, m_refpwr, m_tmloss, m_pwrdgr;
+	pvwatts_celltemp m_tccalc;
+	double m_poa, m_tcell, m_dc, m_ac;
+};
+
 #endif
@@ -479,6 +479,56 @@ bool sandia_inverter_t::acpower(
 	return true;
 }
 
+void sandia_inverter_t::acpower_batch(
+	size_t n,
+	/* inputs */
+	const double *Pdc,
+	const double *Vdc,
+
+	/* outputs */
+	double *Pac,
+	double *Eff,
+	double *Pcliploss,
+	double *Psoloss,
+	double *Pntloss
+	)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		double A = Pdco * (1.0 + C1 * (Vdc[i] - Vdco));
+		double B = Pso * (1.0 + C2 * (Vdc[i] - Vdco));
+		double C = C0 * (1.0 + C3 * (Vdc[i] - Vdco));
+
+		// same limits on B as the single timestep calculation
+		if (B < 0.5 * Pso) B = 0.5 * Pso;
+		if (B > 2.0 * Pso) B = 2.0 * Pso;
+
+		double pac = ((Paco / (A - B)) - C * (A - B)) * (Pdc[i] - B) + C0 * (Pdc[i] - B) * (Pdc[i] - B);
+		double pacNoPso = ((Paco / A) - C * A) * Pdc[i] + C0 * Pdc[i] * Pdc[i];
+
+		Psoloss[i] = 0.0;
+		Pntloss[i] = 0.0;
+		Pcliploss[i] = 0.0;
+		if (Pdc[i] <= Pso)
+		{
+			pac = -Pntare;
+			Pntloss[i] = Pntare;
+		}
+		else
+			Psoloss[i] = pacNoPso - pac;
+
+		if (pac > Paco)
+		{
+			Pcliploss[i] = pac - Paco;
+			pac = Paco;
+		}
+
+		Pac[i] = pac;
+		Eff[i] = pac / Pdc[i];
+		if (Eff[i] < 0.0) Eff[i] = 0.0;
+	}
+}
+
 
 double sandia_celltemp_t::sandia_tcell_from_tmodule( double Tm, double poaIrr, double , double DT0)
 {
@@ -156,6 +156,23 @@ public:
 		double *Pntloss /* Power loss due to night time tare loss (Wac) */
 	);
 
+	//function that calculates AC power and inverter losses for n timesteps, each a single inverter with one MPPT input.
+	//gives the same results as calling acpower for each, without its per-call allocations.
+	//the parasitic consumption equals the night time loss, and the part load ratio is Pdc/Pdco.
+	void acpower_batch(
+		size_t n,
+		/* inputs */
+		const double *Pdc,     /* Input power to a SINGLE inverter (Wdc) */
+		const double *Vdc,     /* Voltage input to inverter (Vdc) */
+
+		/* outputs */
+		double *Pac,    /* AC output power (Wac) */
+		double *Eff,	    /* Conversion efficiency (0..1) */
+		double *Pcliploss, /* Power loss due to clipping loss (Wac) */
+		double *Psoloss, /* Power loss due to operating power consumption (Wdc) */
+		double *Pntloss /* Power loss due to night time tare loss (Wac) */
+	);
+
 } ;
 
 #endif
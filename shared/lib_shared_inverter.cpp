@@ -1,6 +1,7 @@
 #include "lib_shared_inverter.h"
 #include "lib_util.h"
 #include <algorithm>
+#include <stdexcept>
 
 SharedInverter::SharedInverter(int inverterType, size_t numberOfInverters,
 	sandia_inverter_t * sandiaInverter, partload_inverter_t * partloadInverter, ond_inverter * ondInverter)
@@ -215,6 +216,46 @@ void SharedInverter::calculateACPower(const std::vector<double> powerDC_kW_in, c
 	convertOutputsToKWandScale(tempLoss, powerAC_Watts);
 }
 
+void SharedInverter::calculateACPowerBatch(const std::vector<double> &powerDC_kW_in, const std::vector<double> &DCStringVoltage, const std::vector<double> &T,
+	std::vector<double> &powerAC_kW_out, std::vector<double> &efficiencyAC_out)
+{
+	size_t n = powerDC_kW_in.size();
+	if (DCStringVoltage.size() != n || T.size() != n)
+		throw std::invalid_argument("SharedInverter batch DC power, voltage and temperature must be the same length.");
+
+	// Power quantities go in and come out of the inverter models in units of W, for a single inverter
+	std::vector<double> powerDC_Watts_one_inv(n);
+	for (size_t i = 0; i < n; i++)
+		powerDC_Watts_one_inv[i] = std::fabs(powerDC_kW_in[i] * util::kilowatt_to_watt) / m_numInverters;
+
+	powerAC_kW_out.assign(n, 0.0);
+	efficiencyAC_out.assign(n, 0.0);
+	if (n == 0) return;
+	std::vector<double> clipLoss(n), consumptionLoss(n), nightLoss(n);
+
+	if (m_inverterType == SANDIA_INVERTER || m_inverterType == DATASHEET_INVERTER || m_inverterType == COEFFICIENT_GENERATOR)
+		m_sandiaInverter->acpower_batch(n, &powerDC_Watts_one_inv[0], &DCStringVoltage[0], &powerAC_kW_out[0], &efficiencyAC_out[0], &clipLoss[0], &consumptionLoss[0], &nightLoss[0]);
+	else if (m_inverterType == PARTLOAD_INVERTER)
+		m_partloadInverter->acpower_batch(n, &powerDC_Watts_one_inv[0], &powerAC_kW_out[0], &efficiencyAC_out[0], &clipLoss[0], &nightLoss[0]);
+	else if (m_inverterType == OND_INVERTER)
+		m_ondInverter->acpower_batch(n, &powerDC_Watts_one_inv[0], &DCStringVoltage[0], &T[0], &powerAC_kW_out[0], &efficiencyAC_out[0], &clipLoss[0], &consumptionLoss[0], &nightLoss[0]);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		double powerAC_Watts = powerAC_kW_out[i];
+		double tempLoss = 0.0;
+		if (m_tempEnabled)
+			calculateTempDerate(DCStringVoltage[i], T[i], powerAC_Watts, efficiencyAC_out[i], tempLoss);
+
+		powerAC_kW_out[i] = powerAC_Watts * m_numInverters * util::watt_to_kilowatt;
+		efficiencyAC_out[i] *= 100;
+
+		// In event shared inverter is charging a battery only, need to re-convert to negative power
+		if (powerDC_kW_in[i] < 0)
+			powerAC_kW_out[i] *= -1.0;
+	}
+}
+
 double SharedInverter::getInverterDCNominalVoltage()
 {
 	if (m_inverterType == SANDIA_INVERTER || m_inverterType == DATASHEET_INVERTER || m_inverterType == COEFFICIENT_GENERATOR)
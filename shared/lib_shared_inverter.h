@@ -35,6 +35,10 @@ public:
 	/// Given the combined PV plus battery DC power (kW), voltage and ambient T, compute the AC power (kW) for a single inverter with multiple MPPT inputs
 	void calculateACPower(const std::vector<double> powerDC_kW, const std::vector<double> DCStringVoltage, double ambientT);
 
+	/// Compute the AC power (kW) and efficiency (%) for a series of timesteps with one MPPT input each, as calculateACPower would for each step.  The current timestep values are not updated.  Throws std::invalid_argument if the inputs differ in length.
+	void calculateACPowerBatch(const std::vector<double> &powerDC_kW, const std::vector<double> &DCStringVoltage, const std::vector<double> &ambientT,
+		std::vector<double> &powerAC_kW_out, std::vector<double> &efficiencyAC_out);
+
 	/// Return the nominal DC voltage input
 	double getInverterDCNominalVoltage();
 
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
+#include <utility>
 #include "lib_utility_rate.h"
 
 
@@ -7,6 +10,210 @@ UtilityRate::UtilityRate(util::matrix_t<size_t> ecWeekday, util::matrix_t<size_t
 	m_ecWeekday = ecWeekday;
 	m_ecWeekend = ecWeekend;
 	m_ecRatesMatrix = ecRatesMatrix;
+	m_dcSinglePeak = false;
+}
+
+UtilityRate::UtilityRate(util::matrix_t<size_t> ecWeekday, util::matrix_t<size_t> ecWeekend, util::matrix_t<double> ecRatesMatrix,
+	util::matrix_t<size_t> dcWeekday, util::matrix_t<size_t> dcWeekend, util::matrix_t<double> dcRatesMatrix,
+	util::matrix_t<double> dcFlatMatrix, bool dcSinglePeak)
+{
+	m_ecWeekday = ecWeekday;
+	m_ecWeekend = ecWeekend;
+	m_ecRatesMatrix = ecRatesMatrix;
+	m_dcWeekday = dcWeekday;
+	m_dcWeekend = dcWeekend;
+	m_dcRatesMatrix = dcRatesMatrix;
+	m_dcFlatMatrix = dcFlatMatrix;
+	m_dcSinglePeak = dcSinglePeak;
+}
+
+DemandChargeTracker::DemandChargeTracker() :
+	m_enabled(false), m_singlePeak(false), m_stepsPerHour(1), m_month(0), m_flatPeak(0), m_flatPeakPeriod(0)
+{
+}
+
+DemandChargeTracker::DemandChargeTracker(util::matrix_t<size_t> dcWeekday, util::matrix_t<size_t> dcWeekend, util::matrix_t<double> dcRatesMatrix,
+	util::matrix_t<double> dcFlatMatrix, bool dcSinglePeak, size_t stepsPerHour) :
+	m_enabled(false), m_singlePeak(dcSinglePeak), m_stepsPerHour(std::max(stepsPerHour, (size_t)1)), m_month(0), m_flatPeak(0), m_flatPeakPeriod(0)
+{
+	// rows of (number, tier, max demand, charge), sorted by number then tier
+	typedef std::pair<std::pair<size_t, size_t>, std::pair<double, double>> tier_row;
+	std::vector<tier_row> touRows, flatRows;
+	if (dcRatesMatrix.ncols() >= 4)
+	{
+		for (size_t r = 0; r != dcRatesMatrix.nrows(); r++)
+			touRows.push_back(tier_row(std::make_pair((size_t)dcRatesMatrix(r, 0), (size_t)dcRatesMatrix(r, 1)),
+				std::make_pair(dcRatesMatrix(r, 2), dcRatesMatrix(r, 3))));
+	}
+	if (dcFlatMatrix.ncols() >= 4)
+	{
+		for (size_t r = 0; r != dcFlatMatrix.nrows(); r++)
+			flatRows.push_back(tier_row(std::make_pair((size_t)dcFlatMatrix(r, 0), (size_t)dcFlatMatrix(r, 1)),
+				std::make_pair(dcFlatMatrix(r, 2), dcFlatMatrix(r, 3))));
+	}
+	std::sort(touRows.begin(), touRows.end());
+	std::sort(flatRows.begin(), flatRows.end());
+	m_enabled = !touRows.empty() || !flatRows.empty();
+
+	m_flatUpperBound.resize(12);
+	m_flatCharge.resize(12);
+	for (size_t r = 0; r != flatRows.size(); r++)
+	{
+		size_t month = flatRows[r].first.first;
+		if (month >= 12)
+			throw std::invalid_argument("DemandChargeTracker flat demand charge month must be between 0 and 11.");
+		m_flatUpperBound[month].push_back(flatRows[r].second.first);
+		m_flatCharge[month].push_back(flatRows[r].second.second);
+	}
+
+	for (size_t r = 0; r != touRows.size(); r++)
+	{
+		if (m_periods.empty() || m_periods.back() != touRows[r].first.first)
+		{
+			m_periods.push_back(touRows[r].first.first);
+			m_touUpperBound.push_back(std::vector<double>());
+			m_touCharge.push_back(std::vector<double>());
+		}
+		m_touUpperBound.back().push_back(touRows[r].second.first);
+		m_touCharge.back().push_back(touRows[r].second.second);
+	}
+	m_touPeak.assign(m_periods.size(), 0);
+
+	// resolve the month and period index of every hour once, so updates and queries do not search the schedules
+	m_hourMonth.resize(8760);
+	m_hourPeriod.assign(8760, 0);
+	for (size_t hour = 0; hour != 8760; hour++)
+	{
+		size_t month, hourOfDay;
+		util::month_hour(hour, month, hourOfDay);
+		m_hourMonth[hour] = (unsigned char)(month - 1);
+		if (m_periods.empty())
+			continue;
+
+		const util::matrix_t<size_t> & schedule = util::weekday(hour) ? dcWeekday : dcWeekend;
+		size_t period;
+		if (schedule.nrows() == 1 && schedule.ncols() == 1)
+			period = schedule.at(0, 0);
+		else if (schedule.nrows() == 12 && schedule.ncols() == 24)
+			period = schedule.at(month - 1, hourOfDay - 1);
+		else
+			throw std::invalid_argument("DemandChargeTracker demand charge schedules must be 12x24.");
+
+		std::vector<size_t>::const_iterator it = std::lower_bound(m_periods.begin(), m_periods.end(), period);
+		if (it == m_periods.end() || *it != period)
+			throw std::invalid_argument("DemandChargeTracker period " + util::to_string((int)period) + " is in the demand charge schedule but not in the demand rate table.");
+		m_hourPeriod[hour] = (size_t)(it - m_periods.begin());
+	}
+}
+
+size_t DemandChargeTracker::monthOfSimulation(size_t step) const
+{
+	size_t year = step / (8760 * m_stepsPerHour);
+	return year * 12 + m_hourMonth[hourOfYear(step)];
+}
+
+void DemandChargeTracker::startMonth(size_t step)
+{
+	size_t month = monthOfSimulation(step);
+	if (month == m_month)
+		return;
+	m_month = month;
+	m_flatPeak = 0;
+	m_flatPeakPeriod = 0;
+	std::fill(m_touPeak.begin(), m_touPeak.end(), 0.);
+}
+
+void DemandChargeTracker::updateLoad(size_t step, double gridPower)
+{
+	if (!m_enabled)
+		return;
+	startMonth(step);
+
+	// strict comparisons keep the first time step of a peak, as in the utility rate compute modules
+	size_t period = m_hourPeriod[hourOfYear(step)];
+	if (gridPower > m_flatPeak)
+	{
+		m_flatPeak = gridPower;
+		m_flatPeakPeriod = period;
+	}
+	if (!m_touPeak.empty() && gridPower > m_touPeak[period])
+		m_touPeak[period] = gridPower;
+}
+
+double DemandChargeTracker::tierCharge(const std::vector<double> & upperBound, const std::vector<double> & charge, double demand)
+{
+	double total = 0;
+	double lower = 0;
+	for (size_t tier = 0; tier != upperBound.size(); tier++)
+	{
+		if (demand < upperBound[tier])
+			return total + (demand - lower) * charge[tier];
+		total += (upperBound[tier] - lower) * charge[tier];
+		lower = upperBound[tier];
+	}
+	return total;
+}
+
+double DemandChargeTracker::demandCharge() const
+{
+	if (!m_enabled)
+		return 0;
+	size_t month = m_month % 12;
+	double charge = tierCharge(m_flatUpperBound[month], m_flatCharge[month], m_flatPeak);
+	if (m_singlePeak)
+	{
+		if (!m_touPeak.empty())
+			charge += tierCharge(m_touUpperBound[m_flatPeakPeriod], m_touCharge[m_flatPeakPeriod], m_flatPeak);
+	}
+	else
+	{
+		for (size_t p = 0; p != m_touPeak.size(); p++)
+			charge += tierCharge(m_touUpperBound[p], m_touCharge[p], m_touPeak[p]);
+	}
+	return charge;
+}
+
+double DemandChargeTracker::marginalDemandCost(size_t step, double gridPower) const
+{
+	if (!m_enabled)
+		return 0;
+
+	// a time step in a month not yet started is measured against empty peaks
+	bool sameMonth = (monthOfSimulation(step) == m_month);
+	size_t hour = hourOfYear(step);
+	size_t month = m_hourMonth[hour];
+	size_t period = m_hourPeriod[hour];
+	double flatPeak = sameMonth ? m_flatPeak : 0;
+	if (!(gridPower > flatPeak) && (m_singlePeak || m_touPeak.empty()))
+		return 0;
+
+	double cost = 0;
+	if (gridPower > flatPeak)
+		cost += tierCharge(m_flatUpperBound[month], m_flatCharge[month], gridPower) - tierCharge(m_flatUpperBound[month], m_flatCharge[month], flatPeak);
+
+	if (m_touPeak.empty())
+		return cost;
+	if (m_singlePeak)
+	{
+		// the single charged period moves to this time step
+		size_t peakPeriod = sameMonth ? m_flatPeakPeriod : period;
+		cost += tierCharge(m_touUpperBound[period], m_touCharge[period], gridPower) - tierCharge(m_touUpperBound[peakPeriod], m_touCharge[peakPeriod], flatPeak);
+	}
+	else
+	{
+		double touPeak = sameMonth ? m_touPeak[period] : 0;
+		if (gridPower > touPeak)
+			cost += tierCharge(m_touUpperBound[period], m_touCharge[period], gridPower) - tierCharge(m_touUpperBound[period], m_touCharge[period], touPeak);
+	}
+	return cost;
+}
+
+double DemandChargeTracker::periodPeak(size_t period) const
+{
+	std::vector<size_t>::const_iterator it = std::lower_bound(m_periods.begin(), m_periods.end(), period);
+	if (it == m_periods.end() || *it != period)
+		return 0;
+	return m_touPeak[it - m_periods.begin()];
 }
 
 UtilityRateCalculator::UtilityRateCalculator(UtilityRate * rate, size_t stepsPerHour) :
@@ -38,11 +245,16 @@ void UtilityRateCalculator::initializeRate()
 		if (tier == 1)
 			m_energyUsagePerPeriod.push_back(0);
 	}
+
+	m_demandTracker = DemandChargeTracker(m_dcWeekday, m_dcWeekend, m_dcRatesMatrix, m_dcFlatMatrix, m_dcSinglePeak, m_stepsPerHour);
+	for (size_t idx = 0; idx != m_loadProfile.size(); idx++)
+		m_demandTracker.updateLoad(idx, m_loadProfile[idx]);
 }
 
 void UtilityRateCalculator::updateLoad(double loadPower)
 {
 	m_loadProfile.push_back(loadPower);
+	m_demandTracker.updateLoad(m_loadProfile.size() - 1, loadPower);
 }
 void UtilityRateCalculator::calculateEnergyUsagePerPeriod()
 {
@@ -89,3 +301,11 @@ size_t UtilityRateCalculator::getEnergyPeriod(size_t hourOfYear)
 	}
 	return period;
 }
+double UtilityRateCalculator::getDemandCharge()
+{
+	return m_demandTracker.demandCharge();
+}
+double UtilityRateCalculator::getMarginalDemandCost(double loadPower)
+{
+	return m_demandTracker.marginalDemandCost(m_loadProfile.size(), loadPower);
+}
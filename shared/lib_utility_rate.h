@@ -3,15 +3,21 @@
 
 #include "lib_util.h"
 #include <map>
+#include <vector>
 
 class UtilityRate
 {
 public:
 	
-	UtilityRate(){};
+	UtilityRate() : m_dcSinglePeak(false) {};
 
 	UtilityRate(util::matrix_t<size_t> ecWeekday, util::matrix_t<size_t> ecWeekend, util::matrix_t<double> ecRatesMatrix);
 
+	/// Constructor for a rate with both energy and demand charges
+	UtilityRate(util::matrix_t<size_t> ecWeekday, util::matrix_t<size_t> ecWeekend, util::matrix_t<double> ecRatesMatrix,
+		util::matrix_t<size_t> dcWeekday, util::matrix_t<size_t> dcWeekend, util::matrix_t<double> dcRatesMatrix,
+		util::matrix_t<double> dcFlatMatrix, bool dcSinglePeak = false);
+
 	virtual ~UtilityRate() {/* nothing to do */ };
 
 protected:
@@ -26,6 +32,96 @@ protected:
 
 	/// Energy Tiers per period
 	std::map<size_t, size_t> m_energyTiersPerPeriod;
+
+	/// Demand charge schedule for weekdays
+	util::matrix_t<size_t> m_dcWeekday;
+
+	/// Demand charge schedule for weekends
+	util::matrix_t<size_t> m_dcWeekend;
+
+	/// Demand charge periods, tiers, max demand (kW), charge ($/kW)
+	util::matrix_t<double> m_dcRatesMatrix;
+
+	/// Flat demand charge months, tiers, max demand (kW), charge ($/kW)
+	util::matrix_t<double> m_dcFlatMatrix;
+
+	/// Only the TOU period holding the monthly peak is charged
+	bool m_dcSinglePeak;
+};
+
+/**
+* \class DemandChargeTracker
+*
+* \brief
+*
+*  Tracks the monthly flat peak and the peak of every demand charge TOU period as grid power arrives one time step
+*  at a time, so the demand charge of the month to date and the marginal demand charge of a candidate grid power are
+*  available without rescanning the month.  Periods and months are resolved once per hour of year at construction.
+*/
+class DemandChargeTracker
+{
+public:
+	DemandChargeTracker();
+
+	DemandChargeTracker(util::matrix_t<size_t> dcWeekday, util::matrix_t<size_t> dcWeekend, util::matrix_t<double> dcRatesMatrix,
+		util::matrix_t<double> dcFlatMatrix, bool dcSinglePeak, size_t stepsPerHour);
+
+	/// Whether any demand charges are defined
+	bool enabled() const { return m_enabled; }
+
+	/// Record the grid power (kW, positive for power drawn from the grid) at the given time step of the simulation
+	void updateLoad(size_t step, double gridPower);
+
+	/// Demand charge ($) for the month of the last recorded time step, given the peaks recorded so far
+	double demandCharge() const;
+
+	/// Change in the monthly demand charge ($) if the grid power at the given time step were gridPower (kW)
+	double marginalDemandCost(size_t step, double gridPower) const;
+
+	/// Current monthly flat peak (kW)
+	double flatPeak() const { return m_flatPeak; }
+
+	/// Current peak (kW) of the TOU period as numbered in the demand rate table
+	double periodPeak(size_t period) const;
+
+	/// Charge for a peak demand through a tier table with upper bounds and $/kW charges
+	static double tierCharge(const std::vector<double> & upperBound, const std::vector<double> & charge, double demand);
+
+protected:
+
+	/// Reset the peaks when the time step starts a new month
+	void startMonth(size_t step);
+
+	/// Month of the simulation (0 for the first January) containing a time step
+	size_t monthOfSimulation(size_t step) const;
+
+	/// Hour of year (0-8759) for a time step
+	size_t hourOfYear(size_t step) const { return (step / m_stepsPerHour) % 8760; }
+
+	bool m_enabled;
+	bool m_singlePeak;
+	size_t m_stepsPerHour;
+
+	/// Month (0-11) and period index for every hour of year
+	std::vector<unsigned char> m_hourMonth;
+	std::vector<size_t> m_hourPeriod;
+
+	/// Period numbers from the demand rate table, sorted
+	std::vector<size_t> m_periods;
+
+	/// Flat demand tiers for each month
+	std::vector<std::vector<double>> m_flatUpperBound;
+	std::vector<std::vector<double>> m_flatCharge;
+
+	/// TOU demand tiers for each period index
+	std::vector<std::vector<double>> m_touUpperBound;
+	std::vector<std::vector<double>> m_touCharge;
+
+	/// Peaks of the current month
+	size_t m_month;
+	double m_flatPeak;
+	size_t m_flatPeakPeriod;
+	std::vector<double> m_touPeak;
 };
 
 class UtilityRateCalculator : protected UtilityRate
@@ -52,6 +148,12 @@ public:
 	/// Get the period for a given hour of year
 	size_t getEnergyPeriod(size_t hourOfYear);
 
+	/// Get the demand charge ($) of the current month for the load input so far
+	double getDemandCharge();
+
+	/// Get the increase in the current month demand charge ($) if the next time step had the given load (kW)
+	double getMarginalDemandCost(double loadPower);
+
 	virtual ~UtilityRateCalculator() {/* nothing to do*/ };
 
 protected:
@@ -67,6 +169,9 @@ protected:
 
 	/// The energy usage per period
 	std::vector<double> m_energyUsagePerPeriod;
+
+	/// Monthly and TOU demand peaks of the load input so far
+	DemandChargeTracker m_demandTracker;
 };
 
 
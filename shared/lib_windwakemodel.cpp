@@ -300,10 +300,23 @@ double eddyViscosityWakeModel::wakeDeficit(int upwindTurbine, double distCrosswi
 	double dRadius = rotorDiameter / 2.0;
 	double dStep = rotorDiameter / dSteps;
 
+	// more than four widths off the centerline every term is below 1e-24, which rounds away against the free stream speed
+	if (fabs(dCrossWindDistanceInMeters) - dRadius > 4.0 * dWidth)
+		return 0.0;
+
+	// exp(-a*y*y) at evenly spaced y, each term is the last times a ratio that itself shrinks by a constant factor
+	double a = 3.56 / (dWidth*dWidth);
+	double y0 = dCrossWindDistanceInMeters - dRadius;
+	double term = exp(-a*y0*y0);
+	double ratio = exp(-a*dStep*(2.0*y0 + dStep));
+	double ratioStep = exp(-2.0*a*dStep*dStep);
+
 	double dTotal = 0.0;
-	for (double y = dCrossWindDistanceInMeters - dRadius; y <= dCrossWindDistanceInMeters + dRadius; y += dStep)
+	for (double y = y0; y <= dCrossWindDistanceInMeters + dRadius; y += dStep)
 	{
-		dTotal += dDef * exp(-3.56*(((y*y)) / (dWidth*dWidth)));  // exp term ranges from >zero to one
+		dTotal += dDef * term;  // exp term ranges from >zero to one
+		term *= ratio;
+		ratio *= ratioStep;
 	}
 
 	dTotal /= (dSteps + 1.0); // average of all terms above will be zero to dDef
@@ -410,6 +423,19 @@ double eddyViscosityWakeModel::totalTurbulenceIntensity(double ambientTI, double
 	//	return f;
 }
 
+void eddyViscosityWakeModel::setupFilterFunction()
+{
+	filterFunction.resize(matEVWakeDeficits.ncols());
+	for (size_t j = 0; j < filterFunction.size(); j++)
+	{
+		double x = MIN_DIAM_EV + (double)(j)* axialResolution; // actual distance in rotor diameters
+		if (x >= 5.5 || !useFilterFx)
+			filterFunction[j] = 1.0;
+		else
+			filterFunction[j] = x < 4.5 ? 0.65 - pow(-(x - 4.5) / 23.32, 1.0 / 3.0) : 0.65 + pow((x - 4.5) / 23.32, 1.0 / 3.0); // for some reason pow() does not deal with -ve numbers even though excel does
+	}
+}
+
 bool eddyViscosityWakeModel::fillWakeArrays(int turbineIndex, double ambientVelocity, double velocityAtTurbine, double power, double thrustCoeff, double turbulenceIntensity, double metersToFurthestDownwindTurbine) {
 	if (power <= 0.0)
 		return true; // no wake effect - wind speed is below cut-in, or above cut-out
@@ -429,13 +455,7 @@ bool eddyViscosityWakeModel::fillWakeArrays(int turbineIndex, double ambientVelo
 																// dimensionless constant K1
 	const double K1 = 0.015;									// Ainslee 1988 (page 217: input parameters)
 
-	double F, x = MIN_DIAM_EV; // actual distance in rotor diameters
-
-							   // Filter function F
-	if (x >= 5.5 || !useFilterFx)
-		F = 1.0;
-	else
-		x < 4.5 ? F = 0.65 - pow(-(x - 4.5) / 23.32, 1.0 / 3.0) : F = 0.65 + pow((x - 4.5) / 23.32, 1.0 / 3.0);
+	double F = filterFunction[0]; // Filter function F at MIN_DIAM_EV
 
 	// calculate the ambient eddy viscocity term
 	double Km = F*K*K*turbulenceIntensity / 100.0;  // also known as the ambient eddy viscosity???
@@ -470,14 +490,11 @@ bool eddyViscosityWakeModel::fillWakeArrays(int turbineIndex, double ambientVelo
 	//	int iterations = 5;
 	for (size_t j = 0; j<matEVWakeDeficits.ncols() - 1; j++)
 	{
-		x = MIN_DIAM_EV + (double)(j)* axialResolution;
+		double x = MIN_DIAM_EV + (double)(j)* axialResolution;
 
 		// deficit = Dm at the beginning of each timestep
 
-		if (x >= 5.5 || !useFilterFx)
-			F = 1.0;
-		else
-			x < 4.5 ? F = 0.65 - pow(-(x - 4.5) / 23.32, 1.0 / 3.0) : F = 0.65 + pow((x - 4.5) / 23.32, 1.0 / 3.0); // for some reason pow() does not deal with -ve numbers even though excel does
+		F = filterFunction[j];
 
 		Km = F*K*K*turbulenceIntensity / 100.0;
 
@@ -485,7 +502,8 @@ bool eddyViscosityWakeModel::fillWakeArrays(int turbineIndex, double ambientVelo
 		E = F*K1*Bw*(Dm*EV_SCALE) + Km;
 
 		// calculate the change in velocity at distance x downstream
-		double dUdX = 16.0*(pow(m_d2U[j], 3.0) - pow(m_d2U[j], 2.0) - m_d2U[j] + 1.0)*E / (m_d2U[j] * thrustCoeff);
+		double U = m_d2U[j];
+		double dUdX = 16.0*(U*U*U - U*U - U + 1.0)*E / (U * thrustCoeff);
 		m_d2U[j + 1] = m_d2U[j] + dUdX*axialResolution;
 
 		// calculate Dm at distance X downstream....
@@ -558,7 +576,16 @@ void eddyViscosityWakeModel::wakeCalculations(/*INPUTS */ const double air_densi
 		eff[i] = wTurbine->calculateEff(power[i], power[0]);
 
 		// now that turbine[i] wind speed, output, thrust, etc. have been calculated, calculate wake characteristics for it, because downwind turbines will need the info
-		if (!fillWakeArrays((int)i, adWindSpeed[0], adWindSpeed[i], power[i], Thrust[i], aTurbulence_intensity[i], fabs(aDistanceDownwind[nTurbines - 1] - aDistanceDownwind[i])*dTurbineRadius))
+		// a turbine outside every wake sees the same inflow as turbine[0], whose wake reaches at least as far downwind, so it has the same wake
+		if (i > 0 && adWindSpeed[i] == adWindSpeed[0] && Thrust[i] == Thrust[0] && aTurbulence_intensity[i] == aTurbulence_intensity[0])
+		{
+			for (size_t k = 0; k < matEVWakeDeficits.ncols(); k++)
+			{
+				matEVWakeDeficits.at(i, k) = matEVWakeDeficits.at(0, k);
+				matEVWakeWidths.at(i, k) = matEVWakeWidths.at(0, k);
+			}
+		}
+		else if (!fillWakeArrays((int)i, adWindSpeed[0], adWindSpeed[i], power[i], Thrust[i], aTurbulence_intensity[i], fabs(aDistanceDownwind[nTurbines - 1] - aDistanceDownwind[i])*dTurbineRadius))
 		{
 			if (errDetails.length() == 0) errDetails = "Could not calculate the turbine wake arrays in the Eddy-Viscosity model.";
 		}
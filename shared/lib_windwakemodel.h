@@ -207,6 +207,7 @@ private:
 	// EV wake matrices: each turbine is row, each col is wake data for that turbine at dist
 	util::matrix_t<double> matEVWakeDeficits;	// wind velocity deficit behind each turbine, indexed by axial distance downwind
 	util::matrix_t<double> matEVWakeWidths;		// width of wake (in diameters) for each turbine, indexed by axial distance downwind
+	std::vector<double> filterFunction;			// filter function F at each axial distance of the wake matrices, which depends on nothing else
 
 	struct VMLN
 	{
@@ -239,6 +240,9 @@ private:
 	
 	double totalTurbulenceIntensity(double ambientTI, double additionalTI, double Uo, double Uw, double partial);
 
+	/// tabulate the filter function at the axial distances of the wake matrices
+	void setupFilterFunction();
+
 	bool fillWakeArrays(int turbineIndex, double ambientVelocity, double velocityAtTurbine, double power, double thrustCoeff, double turbulenceIntensity, double maxX);
 
 	/// Using Ii, ambient turbulence intensity, and thrust coeff, calculates the length of the near wake region
@@ -269,6 +273,7 @@ public:
 		useFilterFx = true;
 		matEVWakeDeficits.resize_fill(nTurbines, (int)(maxRotorDiameters / axialResolution) + 1, 0.0); // each turbine is row, each col is wake deficit for that turbine at dist
 		matEVWakeWidths.resize_fill(nTurbines, (int)(maxRotorDiameters / axialResolution) + 1, 0.0); // each turbine is row, each col is wake deficit for that turbine at dist
+		setupFilterFunction();
 	}
 
 	std::string getModelName(){ return "FastEV"; }
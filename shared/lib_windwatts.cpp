@@ -140,6 +140,12 @@ void windPowerCalculator::coordtrans(double metersNorth, double metersEast, doub
 	*metersCrosswind = metersEast*sin(fWind_dir_radians) + (metersNorth * cos(fWind_dir_radians));
 }
 
+double windPowerCalculator::airDensity(double airPressureAtm, double TdryC)
+{
+	// convert barometric pressure in ATM to air density
+	return (airPressureAtm * physics::Pa_PER_Atm) / (physics::R_GAS_DRY_AIR * physics::CelciusToKelvin(TdryC));   //!Air Density, kg/m^3
+}
+
 int windPowerCalculator::windPowerUsingResource(/*INPUTS */ double windSpeed, double windDirDeg, double airPressureAtm, double TdryC,
 	/*OUTPUTS*/ double *farmPower, double power[], double thrust[], double eff[], double adWindSpeed[], double TI[],
 	double distanceDownwind[], double distanceCrosswind[])
@@ -157,8 +163,7 @@ int windPowerCalculator::windPowerUsingResource(/*INPUTS */ double windSpeed, do
 	for (i = 0; i<nTurbines; i++)
 		wt_id[i] = i;
 
-	// convert barometric pressure in ATM to air density
-	double fAirDensity = (airPressureAtm * physics::Pa_PER_Atm) / (physics::R_GAS_DRY_AIR * physics::CelciusToKelvin(TdryC));   //!Air Density, kg/m^3
+	double fAirDensity = airDensity(airPressureAtm, TdryC);
 
 	// calculate output power of a turbine
 	double fTurbine_output(0.0), fThrust_coeff(0.0);
@@ -354,3 +359,104 @@ double windPowerCalculator::windPowerUsingWeibull(double weibull_k, double avg_s
 	// calculate output accounting for losses
 	return total_energy_turbine;
 }
+
+
+farmEfficiencyTable::farmEfficiencyTable(double directionBin, double speedBin, double maxWindSpeed)
+{
+	nDirections = (size_t)max_of(1.0, ceil(360.0 / directionBin - 1e-9));
+	directionStep = 360.0 / nDirections;
+	speedStep = speedBin;
+	nSpeeds = (size_t)ceil(maxWindSpeed / speedStep) + 2;
+	referenceDensity = windPowerCalculator::airDensity(1.0, 15.0);
+	efficiency.resize(nDirections * nSpeeds, -1.0);
+}
+
+bool farmEfficiencyTable::fill(windPowerCalculator &wpc, size_t first, size_t stride)
+{
+	std::vector<double> power(wpc.nTurbines), thrust(wpc.nTurbines), eff(wpc.nTurbines), windSpeed(wpc.nTurbines),
+		turbulence(wpc.nTurbines), distanceDownwind(wpc.nTurbines), distanceCrosswind(wpc.nTurbines);
+
+	for (size_t k = first; k < efficiency.size(); k += stride)
+	{
+		double speed = (k % nSpeeds) * speedStep;
+		double direction = (k / nSpeeds) * directionStep;
+
+		double turbinePower, thrustCoeff;
+		wpc.windTurb->turbinePower(speed, referenceDensity, &turbinePower, &thrustCoeff);
+		if (wpc.windTurb->errDetails.length() > 0)
+			return false;
+		if (turbinePower <= 0.0)
+			continue;
+
+		double farm;
+		if ((int)wpc.nTurbines != wpc.windPowerUsingResource(speed, direction, 1.0, 15.0, &farm, &power[0], &thrust[0], &eff[0],
+			&windSpeed[0], &turbulence[0], &distanceDownwind[0], &distanceCrosswind[0]))
+			return false;
+		efficiency[k] = farm / (wpc.nTurbines * turbinePower);
+	}
+	return true;
+}
+
+void farmEfficiencyTable::finish()
+{
+	for (size_t d = 0; d < nDirections; d++)
+	{
+		double *row = &efficiency[d * nSpeeds];
+		size_t lowest = nSpeeds, highest = 0;
+		for (size_t s = 0; s < nSpeeds; s++)
+		{
+			if (row[s] < 0.0)
+				continue;
+			if (lowest == nSpeeds) lowest = s;
+			highest = s;
+		}
+		if (lowest == nSpeeds)
+			continue;
+		for (size_t s = 0; s < nSpeeds; s++)
+		{
+			if (row[s] >= 0.0)
+				continue;
+			if (s < lowest)
+				row[s] = row[lowest];
+			else if (s > highest)
+				row[s] = row[highest];
+			else
+			{
+				// a gap inside the power curve takes the closer edge
+				size_t below = s, above = s;
+				while (row[below] < 0.0) below--;
+				while (row[above] < 0.0) above++;
+				row[s] = (s - below <= above - s) ? row[below] : row[above];
+			}
+		}
+	}
+}
+
+bool farmEfficiencyTable::farmPower(windPowerCalculator &wpc, double windSpeed, double windDirDeg, double airPressureAtm, double TdryC, double *farmPower)
+{
+	double density = windPowerCalculator::airDensity(airPressureAtm, TdryC);
+	double turbinePower, thrustCoeff;
+	wpc.windTurb->turbinePower(windSpeed, density, &turbinePower, &thrustCoeff);
+	if (wpc.windTurb->errDetails.length() > 0)
+		return false;
+
+	*farmPower = 0.0;
+	if (turbinePower <= 0.0)
+		return true;
+
+	// the speed with the same turbine output at the reference density
+	double speed = max_of(0.0, min_of(windSpeed * cbrt(density / referenceDensity) / speedStep, (double)(nSpeeds - 1)));
+	size_t s = min_of((double)(nSpeeds - 2), floor(speed));
+	speed -= s;
+
+	double direction = fmod(windDirDeg, 360.0);
+	if (direction < 0.0) direction += 360.0;
+	direction /= directionStep;
+	size_t d0 = (size_t)direction % nDirections, d1 = (d0 + 1) % nDirections;
+	direction -= floor(direction);
+
+	double lower = efficiency[d0 * nSpeeds + s] * (1.0 - speed) + efficiency[d0 * nSpeeds + s + 1] * speed;
+	double upper = efficiency[d1 * nSpeeds + s] * (1.0 - speed) + efficiency[d1 * nSpeeds + s + 1] * speed;
+	*farmPower = wpc.nTurbines * turbinePower * (lower * (1.0 - direction) + upper * direction);
+	return true;
+}
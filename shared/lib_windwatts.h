@@ -99,6 +99,9 @@ public:
 
 	std::vector<double> XCoords, YCoords;
 
+	/// Air density (kg/m^3) from barometric pressure (Atm) and dry bulb temperature ('C)
+	static double airDensity(double airPressureAtm, double TdryC);
+
 	size_t GetMaxTurbines() {return MAX_WIND_TURBINES;}
 	bool InitializeModel(std::shared_ptr<wakeModelBase>selectedWakeModel);
 	std::string GetWakeModelName();
@@ -130,4 +133,35 @@ public:
 	);
 };
 
+/**
+ * farmEfficiencyTable stores farm output as a fraction of nTurbines free stream turbines, by wind direction and by the wind speed that
+ * gives the same turbine output at the reference air density (1 Atm, 15 'C). The power curve is corrected for density by scaling its wind
+ * speeds and the wake models reduce wind speeds by fractions, so for a given turbulence intensity these two coordinates determine the farm
+ * output. Cells are computed by fill(), which may run on several threads with their own windPowerCalculator and windTurbine copies, and
+ * the table must be finished before farmPower() interpolates it.
+ */
+
+class farmEfficiencyTable
+{
+private:
+	size_t nDirections, nSpeeds;
+	double directionStep, speedStep, referenceDensity;
+	std::vector<double> efficiency;		// each direction is a row, each speed a column, negative where a free stream turbine has no output
+
+public:
+	/// directionBin is rounded so that a whole number of bins fills 360 degrees, speeds run from zero past maxWindSpeed
+	farmEfficiencyTable(double directionBin, double speedBin, double maxWindSpeed);
+
+	size_t cells(){ return efficiency.size(); }
+
+	/// run the farm model for cells first, first + stride, ...
+	bool fill(windPowerCalculator &wpc, size_t first, size_t stride);
+
+	/// give cells without free stream output the efficiency of the nearest speed with output, so interpolation next to them is defined
+	void finish();
+
+	/// interpolated farm output (kW), using the turbine of wpc for the free stream output
+	bool farmPower(windPowerCalculator &wpc, double windSpeed, double windDirDeg, double airPressureAtm, double TdryC, double *farmPower);
+};
+
 #endif
@@ -20,6 +20,11 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
 #include "lsqfit.h"
 
 /* Forward declarations of functions in this module */
@@ -2294,22 +2299,37 @@ struct lsq_vars_struct {
   double *x;
   double *y;
   double (*function)( double _x, double *par, void *user_data );
+  void (*deriv)( double _x, double *par, void *user_data, double *dfdp );
   void *user_data;
+  int npar;
+  double *dfdp;
 };
 
-static int mpcall(int m, int , double *p, double *dy, double **, void *vars)
+static int mpcall(int m, int , double *p, double *dy, double **dvec, void *vars)
 {
   struct lsq_vars_struct *v = (struct lsq_vars_struct *) vars;
   double *x = v->x;
   double *y = v->y;
   for (int i=0; i<m; i++)
     dy[i] = y[i] - v->function( x[i], p, v->user_data );
+
+  if ( dvec && v->deriv )
+  {
+    /* residual is y - f, so its derivative is -df/dp */
+    for (int i=0; i<m; i++)
+    {
+      v->deriv( x[i], p, v->user_data, v->dfdp );
+      for (int j=0; j<v->npar; j++)
+        if ( dvec[j] ) dvec[j][i] = -v->dfdp[j];
+    }
+  }
   return 0;
 }
 
-int lsqfit( double (*function)( double _x, double *par, void *user_data ), void *user_data,
+static int lsqfit_run( double (*function)( double _x, double *par, void *user_data ),
+	void (*deriv)( double _x, double *par, void *user_data, double *dfdp ), void *user_data,
 	double par[], size_t npar, double *xdata, double *ydata, size_t len,
-	double tol, int maxit, int maxfc )
+	double tol, int maxit, int maxfc, double *chisq )
 {
 	// use cmpfit library based on MINPACK from
 	// http://cow.physics.wisc.edu/~craigm/idl/cmpfit.html
@@ -2328,25 +2348,130 @@ int lsqfit( double (*function)( double _x, double *par, void *user_data ), void
 	cfg.nofinitecheck = 0;
 	cfg.iterproc = 0;
 
-	double *perror = new double[npar];
+	std::vector<double> perror( npar ), dfdp( npar );
+	std::vector<mp_par> pars;
+	if ( deriv )
+	{
+		// side = 3: user-computed analytical derivatives for every parameter
+		pars.resize( npar );
+		memset( &pars[0], 0, sizeof(mp_par)*npar );
+		for( size_t j=0;j<npar;j++ )
+			pars[j].side = 3;
+	}
 
 	memset(&result,0,sizeof(result));       /* Zero results structure */
-	result.xerror = perror;       
+	result.xerror = &perror[0];
 
 	v.x = xdata;
 	v.y = ydata;
 	v.function = function;
+	v.deriv = deriv;
 	v.user_data = user_data;
+	v.npar = (int)npar;
+	v.dfdp = &dfdp[0];
 
-	/* Call fitting function for 10 data points and 2 parameters */
-	int info = mpfit( mpcall, (int)len, (int)npar, par, 0, &cfg, (void *) &v, &result) > 0;
+	int info = mpfit( mpcall, (int)len, (int)npar, par, deriv ? &pars[0] : 0, &cfg, (void *) &v, &result) > 0;
 
-	// free memory allocated above
-	delete [] perror;
+	if ( chisq ) *chisq = result.bestnorm;
 
 	return info;
 }
 
+int lsqfit( double (*function)( double _x, double *par, void *user_data ), void *user_data,
+	double par[], size_t npar, double *xdata, double *ydata, size_t len,
+	double tol, int maxit, int maxfc )
+{
+	return lsqfit_run( function, 0, user_data, par, npar, xdata, ydata, len, tol, maxit, maxfc, 0 );
+}
+
+int lsqfit_deriv( double (*function)( double _x, double *par, void *user_data ),
+	void (*deriv)( double _x, double *par, void *user_data, double *dfdp ), void *user_data,
+	double par[], size_t npar, double *xdata, double *ydata, size_t len,
+	double tol, int maxit, int maxfc, double *chisq )
+{
+	return lsqfit_run( function, deriv, user_data, par, npar, xdata, ydata, len, tol, maxit, maxfc, chisq );
+}
+
+struct lsq_start_struct {
+	double (*function)( double _x, double *par, void *user_data );
+	void (*deriv)( double _x, double *par, void *user_data, double *dfdp );
+	void *user_data;
+	size_t npar;
+	double *xdata, *ydata;
+	size_t len;
+	double tol;
+	int maxit, maxfc;
+	double *par;     /* nstart x npar, starting points on input, solutions on output */
+	int *info;
+	double *chisq;
+	size_t first, stride, nstart;
+};
+
+static void lsqfit_starts( lsq_start_struct s )
+{
+	for( size_t k=s.first;k<s.nstart;k+=s.stride )
+		s.info[k] = lsqfit_run( s.function, s.deriv, s.user_data, s.par + k*s.npar, s.npar,
+			s.xdata, s.ydata, s.len, s.tol, s.maxit, s.maxfc, &s.chisq[k] );
+}
+
+int lsqfit_multistart( double (*function)( double _x, double *par, void *user_data ),
+	void (*deriv)( double _x, double *par, void *user_data, double *dfdp ), void *user_data,
+	double par[], size_t npar, const double *starts, size_t nstart,
+	double *xdata, double *ydata, size_t len,
+	double tol, int maxit, int maxfc, int nthreads )
+{
+	if ( nstart < 1 ) return 0;
+
+	std::vector<double> trial( starts, starts + nstart*npar );
+	std::vector<int> info( nstart, 0 );
+	std::vector<double> chisq( nstart, 0.0 );
+
+	if ( nthreads <= 0 ) nthreads = (int)std::thread::hardware_concurrency();
+	if ( nthreads <= 0 ) nthreads = 1;
+	if ( (size_t)nthreads > nstart ) nthreads = (int)nstart;
+
+	lsq_start_struct s;
+	s.function = function;
+	s.deriv = deriv;
+	s.user_data = user_data;
+	s.npar = npar;
+	s.xdata = xdata;
+	s.ydata = ydata;
+	s.len = len;
+	s.tol = tol;
+	s.maxit = maxit;
+	s.maxfc = maxfc;
+	s.par = &trial[0];
+	s.info = &info[0];
+	s.chisq = &chisq[0];
+	s.stride = (size_t)nthreads;
+	s.nstart = nstart;
+
+	std::vector<std::thread> threads;
+	for( int t=1;t<nthreads;t++ )
+	{
+		s.first = (size_t)t;
+		threads.push_back( std::thread( lsqfit_starts, s ) );
+	}
+	s.first = 0;
+	lsqfit_starts( s );
+	for( size_t t=0;t<threads.size();t++ )
+		threads[t].join();
+
+	// lowest chi^2 of the converged fits, ties go to the earlier starting point
+	int best = -1;
+	for( size_t k=0;k<nstart;k++ )
+		if ( info[k] > 0 && std::isfinite( chisq[k] ) && ( best < 0 || chisq[k] < chisq[best] ) )
+			best = (int)k;
+
+	if ( best < 0 ) return 0;
+
+	for( size_t j=0;j<npar;j++ )
+		par[j] = trial[best*npar + j];
+
+	return info[best];
+}
+
 int linlsqfit(double *slope, double *intercept, double *xdata, double *ydata, size_t len)
 {
 	/* linear least squares */
@@ -225,6 +225,30 @@ int lsqfit( double (*function)( double _x, double *par, void *user_data ), void
 	int maxit = 200, // max iterations
 	int maxfc = 0 ); // max function calls
 
+/*
+	same as lsqfit, but with analytical derivatives instead of finite differences.
+	deriv(x, par, user_data, dfdp) fills dfdp[0..npar-1] with the partial derivatives of
+	function(x, par, user_data) with respect to each parameter.  if chisq is given, it
+	receives the final sum of squared residuals.
+*/
+int lsqfit_deriv( double (*function)( double _x, double *par, void *user_data ),
+	void (*deriv)( double _x, double *par, void *user_data, double *dfdp ), void *user_data,
+	double par[], size_t npar, double *xdata, double *ydata, size_t len,
+	double tol = 1e-9, int maxit = 200, int maxfc = 0, double *chisq = 0 );
+
+/*
+	fits from each of nstart starting points (starts is nstart x npar, row major) on up to
+	nthreads threads (0 for all cores), and returns in par the converged fit with the lowest
+	chi^2.  ties go to the earlier starting point, so the result does not depend on the
+	number of threads.  deriv may be 0 to use finite differences.  returns the 'info' code
+	of the selected fit, or 0 if none converged.
+*/
+int lsqfit_multistart( double (*function)( double _x, double *par, void *user_data ),
+	void (*deriv)( double _x, double *par, void *user_data, double *dfdp ), void *user_data,
+	double par[], size_t npar, const double *starts, size_t nstart,
+	double *xdata, double *ydata, size_t len,
+	double tol = 1e-9, int maxit = 200, int maxfc = 0, int nthreads = 0 );
+
 
 
 /* linear least squares fit */
@@ -51,6 +51,8 @@
 
 #include <limits>
 #include <cmath>
+#include <cstdio>
+#include <thread>
 
 #include "6par_jacobian.h"
 #include "6par_lu.h"
@@ -135,3 +137,154 @@ public:
 };
 
 DEFINE_MODULE_ENTRY( 6parsolve, "Solver for CEC/6 parameter PV module coefficients", 1 )
+
+
+static var_info _cm_vtab_6parsolve_batch[] = {
+/*   VARTYPE           DATATYPE         NAME                           LABEL                                UNITS     META                      GROUP                      REQUIRED_IF                 CONSTRAINTS                      UI_HINTS*/
+	{ SSC_INPUT,         SSC_ARRAY,       "celltype",               "Cell technology type",           "",        "0=monoSi,1=multiSi/polySi,2=cdte,3=cis,4=cigs,5=amorphous", "6 Parameter Solver", "*", "",              "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "Vmp",                    "Maximum power point voltage",    "V",       "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "Imp",                    "Maximum power point current",    "A",       "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "Voc",                    "Open circuit voltage",           "V",       "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "Isc",                    "Short circuit current",          "A",       "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "alpha_isc",              "Temp coeff of current at SC",    "A/'C",    "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "beta_voc",               "Temp coeff of voltage at OC",    "V/'C",    "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "gamma_pmp",              "Temp coeff of power at MP",      "%/'C",    "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_ARRAY,       "Nser",                   "Number of cells in series",      "",        "",                      "6 Parameter Solver",      "*",                       "LENGTH_EQUAL=celltype", "" },
+	{ SSC_INPUT,         SSC_NUMBER,      "Tref",                   "Reference cell temperature",     "'C",      "",                      "6 Parameter Solver",      "?=25",                    "",      "" },
+	{ SSC_INPUT,         SSC_NUMBER,      "max_iter",               "Maximum solver iterations",      "",        "",                      "6 Parameter Solver",      "?=300",                   "INTEGER,POSITIVE",      "" },
+	{ SSC_INPUT,         SSC_NUMBER,      "tol",                    "Solver tolerance",               "",        "",                      "6 Parameter Solver",      "?=1e-7",                  "POSITIVE",      "" },
+	{ SSC_INPUT,         SSC_NUMBER,      "nthreads",               "Number of threads",              "",        "0=all cores",           "6 Parameter Solver",      "?=0",                     "INTEGER,MIN=0",      "" },
+	{ SSC_INPUT,         SSC_STRING,      "output_file",            "CSV file for fitted coefficients","",       "",                      "6 Parameter Solver",      "?",                       "",      "" },
+
+// outputs
+	{ SSC_OUTPUT,        SSC_ARRAY,       "a",                      "Modified nonideality factor",    "1/V",    "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_ARRAY,       "Il",                     "Light current",                  "A",      "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_ARRAY,       "Io",                     "Saturation current",             "A",      "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_ARRAY,       "Rs",                     "Series resistance",              "ohm",    "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_ARRAY,       "Rsh",                    "Shunt resistance",               "ohm",    "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_ARRAY,       "Adj",                    "OC SC temp coeff adjustment",    "%",      "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_ARRAY,       "status",                 "Solver status",                  "",       "0=solved,<0=failed",    "6 Parameter Solver",      "*",                        "",                      "" },
+	{ SSC_OUTPUT,        SSC_NUMBER,      "nsolved",                "Number of modules solved",       "",       "",                      "6 Parameter Solver",      "*",                        "",                      "" },
+
+var_info_invalid };
+
+class cm_6parsolve_batch : public compute_module
+{
+private:
+	struct fit_job
+	{
+		std::vector<module6par> *mods;
+		std::vector<int> *status;
+		size_t first, stride;
+		int max_iter, start_threads;
+		double tol;
+	};
+
+	/* fits every stride-th module, spreading the starting points of each over start_threads */
+	static void fit_modules( fit_job job )
+	{
+		std::vector<module6par> &mods = *job.mods;
+		for( size_t i=job.first;i<mods.size();i+=job.stride )
+			(*job.status)[i] = mods[i].solve_with_sanity_and_heuristics_mt<double>( job.max_iter, job.tol, job.start_threads );
+	}
+
+public:
+
+	cm_6parsolve_batch()
+	{
+		add_var_info( _cm_vtab_6parsolve_batch );
+	}
+	
+	void exec( ) throw( general_error )
+	{
+		size_t count = 0;
+		ssc_number_t *celltype = as_array( "celltype", &count );
+		ssc_number_t *Vmp = as_array( "Vmp", 0 );
+		ssc_number_t *Imp = as_array( "Imp", 0 );
+		ssc_number_t *Voc = as_array( "Voc", 0 );
+		ssc_number_t *Isc = as_array( "Isc", 0 );
+		ssc_number_t *aIsc = as_array( "alpha_isc", 0 );
+		ssc_number_t *bVoc = as_array( "beta_voc", 0 );
+		ssc_number_t *gPmp = as_array( "gamma_pmp", 0 );
+		ssc_number_t *nser = as_array( "Nser", 0 );
+		double Tref = as_double( "Tref" );
+
+		std::vector<module6par> mods( count );
+		for( size_t i=0;i<count;i++ )
+		{
+			int tech_id = (int)celltype[i];
+			if ( tech_id < module6par::monoSi || tech_id > module6par::Amorphous )
+				throw exec_error( "6parsolve_batch", util::format( "invalid cell type %d for module %d", tech_id, (int)i ) );
+
+			mods[i] = module6par( tech_id, Vmp[i], Imp[i], Voc[i], Isc[i], bVoc[i], aIsc[i], gPmp[i], (int)nser[i], Tref+273.15 );
+		}
+
+		int nthreads = as_integer( "nthreads" );
+		if ( nthreads <= 0 )
+			nthreads = (int)std::thread::hardware_concurrency();
+		if ( nthreads <= 0 )
+			nthreads = 1;
+
+		// one worker per module while there are enough modules, leftover threads go to the multi-start search
+		int nworkers = (int)std::min( (size_t)nthreads, count );
+		if ( nworkers < 1 ) nworkers = 1;
+
+		std::vector<int> status( count, -1 );
+		fit_job job;
+		job.mods = &mods;
+		job.status = &status;
+		job.stride = (size_t)nworkers;
+		job.max_iter = as_integer( "max_iter" );
+		job.tol = as_double( "tol" );
+		job.start_threads = nthreads / nworkers;
+
+		std::vector<std::thread> threads;
+		for( int t=1;t<nworkers;t++ )
+		{
+			job.first = (size_t)t;
+			threads.push_back( std::thread( fit_modules, job ) );
+		}
+		job.first = 0;
+		fit_modules( job );
+		for( size_t t=0;t<threads.size();t++ )
+			threads[t].join();
+
+		ssc_number_t *p_a = allocate( "a", count );
+		ssc_number_t *p_Il = allocate( "Il", count );
+		ssc_number_t *p_Io = allocate( "Io", count );
+		ssc_number_t *p_Rs = allocate( "Rs", count );
+		ssc_number_t *p_Rsh = allocate( "Rsh", count );
+		ssc_number_t *p_Adj = allocate( "Adj", count );
+		ssc_number_t *p_status = allocate( "status", count );
+		int nsolved = 0;
+		for( size_t i=0;i<count;i++ )
+		{
+			p_a[i] = (ssc_number_t)mods[i].a;
+			p_Il[i] = (ssc_number_t)mods[i].Il;
+			p_Io[i] = (ssc_number_t)mods[i].Io;
+			p_Rs[i] = (ssc_number_t)mods[i].Rs;
+			p_Rsh[i] = (ssc_number_t)mods[i].Rsh;
+			p_Adj[i] = (ssc_number_t)mods[i].Adj;
+			p_status[i] = (ssc_number_t)status[i];
+			if ( status[i] >= 0 ) nsolved++;
+		}
+		assign( "nsolved", var_data( (ssc_number_t)nsolved ) );
+
+		if ( is_assigned( "output_file" ) )
+		{
+			std::string file = as_string( "output_file" );
+			FILE *fp = fopen( file.c_str(), "w" );
+			if ( !fp )
+				throw exec_error( "6parsolve_batch", "could not open output file for writing: " + file );
+
+			// full precision so the coefficients can be read back without loss
+			fprintf( fp, "a,Il,Io,Rs,Rsh,Adj,status\n" );
+			for( size_t i=0;i<count;i++ )
+				fprintf( fp, "%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%d\n",
+					mods[i].a, mods[i].Il, mods[i].Io, mods[i].Rs, mods[i].Rsh, mods[i].Adj, status[i] );
+			fclose( fp );
+		}
+	}
+};
+
+DEFINE_MODULE_ENTRY( 6parsolve_batch, "Batch solver for CEC/6 parameter coefficients of a module library", 1 )
@@ -48,6 +48,8 @@
 *******************************************************************************************************/
 
 #include <math.h>
+#include <list>
+#include <thread>
 
 #include "common.h"
 #include "core.h"
@@ -159,7 +161,7 @@ var_info vtab_battery_inputs[] = {
 	{ SSC_INPUT,        SSC_ARRAY,      "batt_target_power_monthly",                   "Grid target power on monthly basis",                     "kW",       "",                     "Battery",       "en_batt=1&batt_meter_position=0&batt_dispatch_choice=2",                        "",                             "" },
 	{ SSC_INPUT,        SSC_NUMBER,     "batt_target_choice",                          "Target power input option",                              "0/1",      "0=InputMonthlyTarget,1=InputFullTimeSeries", "Battery", "en_batt=1&batt_meter_position=0&batt_dispatch_choice=2",                        "",                             "" },
 	{ SSC_INPUT,        SSC_ARRAY,      "batt_custom_dispatch",                        "Custom battery power for every time step",               "kW",       "",                     "Battery",       "en_batt=1&batt_dispatch_choice=3","",                         "" },
-	{ SSC_INPUT,        SSC_NUMBER,     "batt_dispatch_choice",                        "Battery dispatch algorithm",                             "0/1/2/3/4", "If behind the meter: 0=PeakShavingLookAhead,1=PeakShavingLookBehind,2=InputGridTarget,3=InputBatteryPower,4=ManualDispatch, if front of meter: 0=AutomatedLookAhead,1=AutomatedLookBehind,2=AutomatedInputForecast,3=InputBatteryPower,4=ManualDispatch",                    "Battery",       "en_batt=1",                        "",                             "" },
+	{ SSC_INPUT,        SSC_NUMBER,     "batt_dispatch_choice",                        "Battery dispatch algorithm",                             "0/1/2/3/4/5", "If behind the meter: 0=PeakShavingLookAhead,1=PeakShavingLookBehind,2=InputGridTarget,3=InputBatteryPower,4=ManualDispatch, if front of meter: 0=AutomatedLookAhead,1=AutomatedLookBehind,2=AutomatedInputForecast,3=InputBatteryPower,4=ManualDispatch,5=OptimizedLookAhead",                    "Battery",       "en_batt=1",                        "",                             "" },
 	{ SSC_INPUT,        SSC_ARRAY,      "batt_pv_clipping_forecast",                   "PV clipping forecast",                                   "kW",       "",                     "Battery",       "en_batt=1&batt_meter_position=1&batt_dispatch_choice=2",  "",          "" },
 	{ SSC_INPUT,        SSC_ARRAY,      "batt_pv_dc_forecast",                         "PV dc power forecast",                                   "kW",       "",                     "Battery",       "en_batt=1&batt_meter_position=1&batt_dispatch_choice=2",  "",          "" },
 	{ SSC_INPUT,        SSC_NUMBER,     "batt_dispatch_auto_can_gridcharge",           "Grid charging allowed for automated dispatch?",          "kW",       "",                     "Battery",       "",                           "",                             "" },
@@ -388,7 +390,8 @@ battstor::battstor(compute_module &cm, bool setup_model, size_t nrec, double dt_
 
 				if (batt_vars->batt_dispatch == dispatch_t::FOM_LOOK_AHEAD || 
 					batt_vars->batt_dispatch == dispatch_t::FOM_FORECAST || 
-					batt_vars->batt_dispatch == dispatch_t::FOM_LOOK_BEHIND)
+					batt_vars->batt_dispatch == dispatch_t::FOM_LOOK_BEHIND ||
+					batt_vars->batt_dispatch == dispatch_t::FOM_OPTIMIZED_LOOK_AHEAD)
 				{
 					batt_vars->batt_look_ahead_hours = cm.as_unsigned_long("batt_look_ahead_hours");
 					batt_vars->batt_dispatch_update_frequency_hours = cm.as_double("batt_dispatch_update_frequency_hours");
@@ -401,6 +404,9 @@ battstor::battstor(compute_module &cm, bool setup_model, size_t nrec, double dt_
 			// Automated behind-the-meter
 			else
 			{
+				if (batt_vars->batt_dispatch == dispatch_t::FOM_OPTIMIZED_LOOK_AHEAD)
+					throw compute_module::exec_error("battery", "optimized look ahead dispatch (batt_dispatch_choice=5) is only available for front of meter batteries");
+
 				if (batt_vars->batt_dispatch == dispatch_t::MAINTAIN_TARGET)
 				{
 					batt_vars->batt_target_choice = cm.as_integer("batt_target_choice");
@@ -932,7 +938,7 @@ void battstor::parse_configuration()
 		}
 		else if (batt_meter_position == dispatch_t::FRONT)
 		{
-			if (batt_dispatch == dispatch_t::FOM_LOOK_AHEAD) {
+			if (batt_dispatch == dispatch_t::FOM_LOOK_AHEAD || batt_dispatch == dispatch_t::FOM_OPTIMIZED_LOOK_AHEAD) {
 				look_ahead = true;
 			}
 			else if (batt_dispatch == dispatch_t::FOM_LOOK_BEHIND) {
@@ -1389,3 +1395,372 @@ public:
 };
 
 DEFINE_MODULE_ENTRY(battery, "Battery storage standalone model .", 10)
+
+///////////////////////////////////////////////////
+static var_info _cm_vtab_battery_sizing[] = {
+	/*   VARTYPE           DATATYPE         NAME                                            LABEL                                                   UNITS      META                           GROUP                  REQUIRED_IF                 CONSTRAINTS                      UI_HINTS*/
+	{ SSC_INPUT,        SSC_NUMBER,      "en_batt",                                    "Enable battery storage model",                            "0/1",        "Battery inputs are checked when 1, every case is run with the battery enabled", "Battery", "?=1", "BOOLEAN",                "" },
+	{ SSC_INPUT,        SSC_ARRAY,       "gen",                                        "System power generated",                                  "kW",         "",                     "",                             "*",                      "",                               "" },
+	{ SSC_INPUT,        SSC_ARRAY,       "load",                                       "Electricity load (year 1)",                               "kW",         "",                     "",                             "",                       "",                               "" },
+	{ SSC_INPUT,        SSC_ARRAY,       "sizing_bank_capacity",                       "Battery bank capacity for each case",                     "kWh",        "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_INPUT,        SSC_ARRAY,       "sizing_power",                               "Battery charge and discharge power for each case",        "kW",         "",                     "Battery Sizing",               "*",                      "LENGTH_EQUAL=sizing_bank_capacity", "" },
+	{ SSC_INPUT,        SSC_ARRAY,       "sizing_dispatch_choice",                     "Battery dispatch algorithm for each case",                "",           "Same codes as batt_dispatch_choice", "Battery Sizing", "?",                "LENGTH_EQUAL=sizing_bank_capacity", "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "sizing_en_rate",                             "Run utility rate calculation for each case",              "0/1",        "Uses the utilityrate5 inputs", "Battery Sizing",       "?=0",                    "BOOLEAN",                        "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "nthreads",                                   "Number of threads",                                       "",           "0=all cores",          "Battery Sizing",               "?=0",                    "INTEGER,MIN=0",                  "" },
+
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_status",                              "Simulation status for each case",                         "",           "0=success,-1=failed",  "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_bank_capacity_computed",              "Battery bank capacity after rounding to whole strings",   "kWh",        "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_annual_energy",                       "Annual system energy with battery",                       "kWh",        "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_annual_discharge_energy",             "Battery annual discharge energy (year 1)",                "kWh",        "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_annual_import_energy",                "Annual energy imported from the grid (year 1)",           "kWh",        "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_annual_export_energy",                "Annual energy exported to the grid (year 1)",             "kWh",        "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_roundtrip_efficiency",                "Average battery roundtrip efficiency",                    "%",          "",                     "Battery Sizing",               "*",                      "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_elec_cost_with_system_year1",         "Electricity bill with system (year 1)",                   "$/yr",       "",                     "Battery Sizing",               "sizing_en_rate=1",       "",                               "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sizing_savings_year1",                       "Electricity bill savings with system (year 1)",           "$/yr",       "",                     "Battery Sizing",               "sizing_en_rate=1",       "",                               "" },
+
+	// battery inputs are those of the battery module, utility rate inputs those of utilityrate5
+	var_info_invalid };
+
+/* utilityrate5 inputs not already declared by battery_sizing, required only when sizing_en_rate=1.
+   Inputs shared with the battery, like the energy charge schedules, keep the battery declaration.
+   Defaults are left to utilityrate5, which assigns them when each case is billed. */
+class battery_sizing_rate_vtab
+{
+private:
+	std::list<std::string> m_required_if;
+	std::vector<var_info> m_vtab;
+
+	static bool declared(const var_info vtab[], const std::string &name)
+	{
+		for (int i = 0; vtab[i].data_type != SSC_INVALID && vtab[i].name != NULL; i++)
+			if (name == vtab[i].name)
+				return true;
+		return false;
+	}
+
+public:
+	battery_sizing_rate_vtab()
+	{
+		ssc_module_t p_mod = ssc_module_create("utilityrate5");
+		ssc_info_t p_inf;
+		int i = 0;
+		while (p_mod && (p_inf = ssc_module_var_info(p_mod, i++)) != 0)
+		{
+			int var_type = ssc_info_var_type(p_inf);
+			const char *name = ssc_info_name(p_inf);
+			if ((var_type != SSC_INPUT && var_type != SSC_INOUT) || declared(_cm_vtab_battery_sizing, name) || declared(vtab_battery_inputs, name))
+				continue;
+
+			std::string required = ssc_info_required(p_inf);
+			if (required == "*")
+				required = "sizing_en_rate=1";
+			else if (required.length() > 0 && required[0] == '?')
+				required = "?";
+			else if (required.length() > 0)
+				required = "sizing_en_rate=1&" + required;
+			m_required_if.push_back(required);
+
+			var_info vi = { SSC_INPUT, (unsigned char)ssc_info_data_type(p_inf), name, ssc_info_label(p_inf), ssc_info_units(p_inf), ssc_info_meta(p_inf),
+				ssc_info_group(p_inf), m_required_if.back().c_str(), ssc_info_constraints(p_inf), ssc_info_uihint(p_inf) };
+			m_vtab.push_back(vi);
+		}
+		if (p_mod)
+			ssc_module_free(p_mod);
+		m_vtab.push_back(var_info_invalid);
+	}
+
+	var_info *vtab() { return &m_vtab[0]; }
+};
+
+class cm_battery_sizing : public compute_module
+{
+private:
+	/* one battery size and dispatch setting, and its results */
+	struct sizing_case
+	{
+		double bank_capacity;
+		double power;
+		int dispatch_choice;
+
+		int status;
+		std::string error;
+		double bank_capacity_computed;
+		double annual_energy;
+		double discharge_energy;
+		double import_energy;
+		double export_energy;
+		double roundtrip_efficiency;
+		double elec_cost_with_system;
+		double savings;
+	};
+
+	/* base battery design which each case is scaled from */
+	struct sizing_base
+	{
+		int chem;
+		int strings;
+		double bank_capacity;
+		double power;
+		double current_charge_max;
+		double current_discharge_max;
+		double q20, q10, qn;
+		double Qfull_flow;
+		double mass;
+	};
+
+	struct sizing_job
+	{
+		const var_table *inputs;
+		const sizing_base *base;
+		std::vector<sizing_case> *cases;
+		size_t first, stride;
+		bool en_rate;
+	};
+
+	/* copies the inputs of module 'name' which are assigned in this module into 'vt' */
+	void copy_module_inputs(const char *name, var_table &vt)
+	{
+		ssc_module_t p_mod = ssc_module_create(name);
+		if (!p_mod)
+			throw exec_error("battery_sizing", util::format("could not create module %s", name));
+
+		int i = 0;
+		ssc_info_t p_inf;
+		while ((p_inf = ssc_module_var_info(p_mod, i++)) != 0)
+		{
+			int var_type = ssc_info_var_type(p_inf);
+			if (var_type != SSC_INPUT && var_type != SSC_INOUT)
+				continue;
+
+			const char *var_name = ssc_info_name(p_inf);
+			if (var_data *value = lookup(var_name))
+				vt.assign(var_name, *value);
+		}
+		ssc_module_free(p_mod);
+	}
+
+	/* runs module 'name' on 'vt' without logging, returns the first error on failure */
+	static bool run_module(const char *name, var_table &vt, std::string &error)
+	{
+		ssc_module_t p_mod = ssc_module_create(name);
+		if (!p_mod)
+		{
+			error = util::format("could not create module %s", name);
+			return false;
+		}
+
+		bool success = ssc_module_exec_with_handler(p_mod, static_cast<ssc_data_t>(&vt), 0, 0) != 0;
+		if (!success)
+		{
+			error = util::format("%s failed", name);
+			int type, i = 0;
+			const char *text;
+			while ((text = ssc_module_log(p_mod, i++, &type, 0)) != 0)
+			{
+				if (type == SSC_ERROR)
+				{
+					error = text;
+					break;
+				}
+			}
+		}
+		ssc_module_free(p_mod);
+		return success;
+	}
+
+	/* year one value of an annual output, which has a year zero entry for lifetime simulations */
+	static double year_one_value(var_table &vt, const char *name)
+	{
+		var_data *value = vt.lookup(name);
+		if (!value)
+			return 0.;
+		if (value->type == SSC_NUMBER)
+			return value->num;
+		if (value->type == SSC_ARRAY && value->num.length() > 0)
+			return value->num.length() > 1 ? value->num[1] : value->num[0];
+		return 0.;
+	}
+
+	/* simulates every stride-th case on its own copy of the inputs */
+	static void run_cases(sizing_job job)
+	{
+		const sizing_base &base = *job.base;
+		std::vector<sizing_case> &cases = *job.cases;
+		for (size_t i = job.first; i < cases.size(); i += job.stride)
+		{
+			sizing_case &c = cases[i];
+			var_table vt;
+			vt = *job.inputs;
+
+			// capacity is changed in whole strings, so bank voltage and cell properties are unchanged
+			double scale_capacity = c.bank_capacity / base.bank_capacity;
+			int strings = (int)std::max(1., std::floor(base.strings * scale_capacity + 0.5));
+			double scale_strings = (double)strings / base.strings;
+			double scale_power = c.power / base.power;
+			if (base.chem == battery_t::VANADIUM_REDOX || base.chem == battery_t::IRON_FLOW)
+			{
+				c.bank_capacity_computed = c.bank_capacity;
+				vt.assign("batt_Qfull_flow", var_data((ssc_number_t)(base.Qfull_flow * scale_capacity)));
+				vt.assign("batt_mass", var_data((ssc_number_t)(base.mass * scale_capacity)));
+			}
+			else
+			{
+				c.bank_capacity_computed = base.bank_capacity * scale_strings;
+				vt.assign("batt_computed_strings", var_data((ssc_number_t)strings));
+				vt.assign("LeadAcid_q20_computed", var_data((ssc_number_t)(base.q20 * scale_strings)));
+				vt.assign("LeadAcid_q10_computed", var_data((ssc_number_t)(base.q10 * scale_strings)));
+				vt.assign("LeadAcid_qn_computed", var_data((ssc_number_t)(base.qn * scale_strings)));
+				vt.assign("batt_mass", var_data((ssc_number_t)(base.mass * scale_strings)));
+			}
+			vt.assign("en_batt", var_data((ssc_number_t)1));
+			vt.assign("batt_computed_bank_capacity", var_data((ssc_number_t)c.bank_capacity_computed));
+			vt.assign("batt_power_charge_max", var_data((ssc_number_t)c.power));
+			vt.assign("batt_power_discharge_max", var_data((ssc_number_t)c.power));
+			vt.assign("batt_current_charge_max", var_data((ssc_number_t)(base.current_charge_max * scale_power)));
+			vt.assign("batt_current_discharge_max", var_data((ssc_number_t)(base.current_discharge_max * scale_power)));
+			if (c.dispatch_choice >= 0)
+				vt.assign("batt_dispatch_choice", var_data((ssc_number_t)c.dispatch_choice));
+
+			c.status = -1;
+			if (!run_module("battery", vt, c.error))
+				continue;
+
+			c.annual_energy = year_one_value(vt, "annual_energy");
+			c.discharge_energy = year_one_value(vt, "batt_annual_discharge_energy");
+			c.import_energy = year_one_value(vt, "annual_import_to_grid_energy");
+			c.export_energy = year_one_value(vt, "annual_export_to_grid_energy");
+			c.roundtrip_efficiency = year_one_value(vt, "average_battery_roundtrip_efficiency");
+
+			// battery module replaced "gen" with the system output including the battery
+			if (job.en_rate)
+			{
+				// cases already run in parallel
+				vt.assign("nthreads", var_data((ssc_number_t)1));
+				if (!run_module("utilityrate5", vt, c.error))
+					continue;
+				c.elec_cost_with_system = year_one_value(vt, "elec_cost_with_system_year1");
+				c.savings = year_one_value(vt, "savings_year1");
+			}
+			c.status = 0;
+		}
+	}
+
+public:
+
+	cm_battery_sizing()
+	{
+		static battery_sizing_rate_vtab rate_vtab;
+		add_var_info(_cm_vtab_battery_sizing);
+		add_var_info(vtab_battery_inputs);
+		add_var_info(rate_vtab.vtab());
+	}
+
+	void exec() throw(general_error)
+	{
+		bool en_rate = as_boolean("sizing_en_rate");
+
+		// inputs shared by all cases, copied once so the workers never touch this module's data
+		var_table inputs;
+		copy_module_inputs("battery", inputs);
+		if (en_rate)
+			copy_module_inputs("utilityrate5", inputs);
+
+		sizing_base base;
+		base.chem = as_integer("batt_chem");
+		base.strings = as_integer("batt_computed_strings");
+		base.bank_capacity = as_double("batt_computed_bank_capacity");
+		base.power = as_double("batt_power_discharge_max");
+		base.current_charge_max = as_double("batt_current_charge_max");
+		base.current_discharge_max = as_double("batt_current_discharge_max");
+		base.q20 = is_assigned("LeadAcid_q20_computed") ? as_double("LeadAcid_q20_computed") : 0.;
+		base.q10 = is_assigned("LeadAcid_q10_computed") ? as_double("LeadAcid_q10_computed") : 0.;
+		base.qn = is_assigned("LeadAcid_qn_computed") ? as_double("LeadAcid_qn_computed") : 0.;
+		base.Qfull_flow = is_assigned("batt_Qfull_flow") ? as_double("batt_Qfull_flow") : 0.;
+		base.mass = is_assigned("batt_mass") ? as_double("batt_mass") : 0.;
+		if (base.strings <= 0 || base.bank_capacity <= 0 || base.power <= 0)
+			throw exec_error("battery_sizing", "base battery must have positive strings, bank capacity and power");
+
+		std::vector<ssc_number_t> bank_capacity = as_vector_ssc_number_t("sizing_bank_capacity");
+		std::vector<ssc_number_t> power = as_vector_ssc_number_t("sizing_power");
+		std::vector<int> dispatch_choice;
+		if (is_assigned("sizing_dispatch_choice"))
+			dispatch_choice = as_vector_integer("sizing_dispatch_choice");
+
+		size_t count = bank_capacity.size();
+		std::vector<sizing_case> cases(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (bank_capacity[i] <= 0 || power[i] <= 0)
+				throw exec_error("battery_sizing", util::format("case %d must have positive bank capacity and power", (int)i));
+
+			sizing_case &c = cases[i];
+			c.bank_capacity = bank_capacity[i];
+			c.power = power[i];
+			c.dispatch_choice = dispatch_choice.size() > 0 ? dispatch_choice[i] : -1;
+			c.bank_capacity_computed = c.annual_energy = c.discharge_energy = 0.;
+			c.import_energy = c.export_energy = c.roundtrip_efficiency = 0.;
+			c.elec_cost_with_system = c.savings = 0.;
+		}
+
+		int nthreads = as_integer("nthreads");
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads <= 0)
+			nthreads = 1;
+		int nworkers = (int)std::min((size_t)nthreads, count);
+		if (nworkers < 1) nworkers = 1;
+
+		sizing_job job;
+		job.inputs = &inputs;
+		job.base = &base;
+		job.cases = &cases;
+		job.stride = (size_t)nworkers;
+		job.en_rate = en_rate;
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < nworkers; t++)
+		{
+			job.first = (size_t)t;
+			threads.push_back(std::thread(run_cases, job));
+		}
+		job.first = 0;
+		run_cases(job);
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		ssc_number_t *p_status = allocate("sizing_status", count);
+		ssc_number_t *p_capacity = allocate("sizing_bank_capacity_computed", count);
+		ssc_number_t *p_energy = allocate("sizing_annual_energy", count);
+		ssc_number_t *p_discharge = allocate("sizing_annual_discharge_energy", count);
+		ssc_number_t *p_import = allocate("sizing_annual_import_energy", count);
+		ssc_number_t *p_export = allocate("sizing_annual_export_energy", count);
+		ssc_number_t *p_roundtrip = allocate("sizing_roundtrip_efficiency", count);
+		ssc_number_t *p_cost = 0, *p_savings = 0;
+		if (en_rate)
+		{
+			p_cost = allocate("sizing_elec_cost_with_system_year1", count);
+			p_savings = allocate("sizing_savings_year1", count);
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			const sizing_case &c = cases[i];
+			if (c.status != 0)
+				log(util::format("case %d: %s", (int)i, c.error.c_str()), SSC_WARNING);
+
+			p_status[i] = (ssc_number_t)c.status;
+			p_capacity[i] = (ssc_number_t)c.bank_capacity_computed;
+			p_energy[i] = (ssc_number_t)c.annual_energy;
+			p_discharge[i] = (ssc_number_t)c.discharge_energy;
+			p_import[i] = (ssc_number_t)c.import_energy;
+			p_export[i] = (ssc_number_t)c.export_energy;
+			p_roundtrip[i] = (ssc_number_t)c.roundtrip_efficiency;
+			if (en_rate)
+			{
+				p_cost[i] = (ssc_number_t)c.elec_cost_with_system;
+				p_savings[i] = (ssc_number_t)c.savings;
+			}
+		}
+	}
+};
+
+DEFINE_MODULE_ENTRY(battery_sizing, "Battery size and dispatch sweep on fixed generation and load", 1)
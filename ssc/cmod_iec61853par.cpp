@@ -57,6 +57,7 @@ static var_info vtab_iec61853[] =
 	{ SSC_INPUT,        SSC_NUMBER,      "nser",                   "Number of cells in series",  "",         "",                                              "IEC61853",    "*",           "",         "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "type",                   "Cell technology type",       "0..5",     "monoSi,multiSi/polySi,cdte,cis,cigs,amorphous", "IEC61853",    "*",           "",         "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "verbose",                "Output solver messages",     "0/1",      "",                                              "IEC61853",    "*",           "",         "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "nthreads",               "Threads for multi-start fits","",        "0=all cores",                                   "IEC61853",    "?=1",         "INTEGER,MIN=0", "" },
 																								 											                			   
 	{ SSC_OUTPUT,       SSC_NUMBER,      "alphaIsc",               "SC temp coefficient @ STC",  "A/C",      "",                                              "IEC61853",    "*",           "",         "" },
 	{ SSC_OUTPUT,       SSC_NUMBER,      "betaVoc",                "OC temp coefficient @ STC",  "V/C",      "",                                              "IEC61853",    "*",           "",         "" },
@@ -111,6 +112,7 @@ public:
 		iec61853_module_t solver;
 		msg_handler msgs( *this );
 		solver._imsg = &msgs;
+		solver.nthreads = as_integer("nthreads");
 
 		util::matrix_t<double> input = as_matrix("input"), par;
 		if ( input.ncols() != iec61853_module_t::COL_MAX )
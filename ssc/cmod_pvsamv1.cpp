@@ -81,6 +81,8 @@ static var_info _cm_vtab_pvsamv1[] = {
 	{ SSC_INPUT,        SSC_NUMBER,      "use_wf_albedo",                               "Use albedo in weather file if provided",               "0/1",      "",                              "pvsamv1",              "?=1",                      "BOOLEAN",                       "" },
 	{ SSC_INPUT,        SSC_ARRAY,       "albedo",                                      "User specified ground albedo",                         "0..1",     "",                              "pvsamv1",              "*",						  "LENGTH=12",					  "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "irrad_mode",                                  "Irradiance input translation mode",                     "",        "0=beam&diffuse,1=total&beam,2=total&diffuse,3=poa_reference,4=poa_pyranometer", "pvsamv1", "?=0", "INTEGER,MIN=0,MAX=4", "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "poa_decomp_warm_start",                       "Warm-start POA decomposition from previous time step",  "0/1",     "",                      "pvsamv1",              "?=0",                      "BOOLEAN",                       "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "poa_decomp_nthreads",                         "Threads for the warm-started POA decomposition",         "",        "0=all cores",            "pvsamv1",              "?=1",                      "INTEGER,MIN=0",                 "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "sky_model",                                   "Diffuse sky model",                                     "",        "0=isotropic,1=hkdr,2=perez",    "pvsamv1",              "?=2",                      "INTEGER,MIN=0,MAX=2",           "" },
 
 	{ SSC_INPUT,        SSC_NUMBER,      "inverter_count",                              "Number of inverters",                                   "",        "",                              "pvsamv1",              "*",                        "INTEGER,POSITIVE",              "" },
@@ -995,6 +997,9 @@ void cm_pvsamv1::exec( ) throw (compute_module::general_error)
 		nameplate_kw += Subarrays[nn]->nModulesPerString * Subarrays[nn]->nStrings * module_watts_stc * util::watt_to_kilowatt;
 	}
 
+	// bifacial view factors depend only on row geometry, so keep them across timesteps for each subarray
+	std::vector<bifacialViewFactors> bifacialViewFactorsBySubarray(num_subarrays);
+
 	// Warning workaround
 	static bool is32BitLifetime = (__ARCHBITS__ == 32 && system_use_lifetime_output);
 	if (is32BitLifetime)
@@ -1180,6 +1185,7 @@ void cm_pvsamv1::exec( ) throw (compute_module::general_error)
 						Irradiance->dtHour, Subarrays[nn]->tiltDegrees, Subarrays[nn]->azimuthDegrees, Subarrays[nn]->trackerRotationLimitDegrees, Subarrays[nn]->groundCoverageRatio,
 						Subarrays[nn]->monthlyTiltDegrees, Irradiance->userSpecifiedMonthlyAlbedo,
 						Subarrays[nn]->poa.poaAll.get());
+					irr.set_bifacial_view_factors(&bifacialViewFactorsBySubarray[nn]);
 											
 					int code = irr.calc();
 
@@ -64,14 +64,27 @@ static var_info _cm_vtab_pvwattsv1_1ts[] = {
 	{ SSC_INPUT,        SSC_NUMBER,      "day",                      "Day",                                         "dy",     "1-days in month",         "PVWatts",      "*",                       "",                          "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "hour",                     "Hour",                                        "hr",     "0-23",                    "PVWatts",      "*",                       "",                          "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "minute",                   "Minute",                                      "min",    "0-59",                    "PVWatts",      "*",                       "",                          "" },
-	{ SSC_INPUT,        SSC_NUMBER,      "lat",                      "Latitude",                                    "deg",    "",                        "PVWatts",      "*",                        "",                      "" },
-	{ SSC_INPUT,        SSC_NUMBER,      "lon",                      "Longitude",                                   "deg",    "",                        "PVWatts",      "*",                        "",                      "" },
-	{ SSC_INPUT,        SSC_NUMBER,      "tz",                       "Time zone",                                   "hr",     "",                        "PVWatts",      "*",                        "",                      "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "beam",                     "Beam normal irradiance",                      "W/m2",   "",                        "PVWatts",      "*",                       "",                          "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "diffuse",                  "Diffuse irradiance",                          "W/m2",   "",                        "PVWatts",      "*",                       "",                          "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "tamb",                     "Ambient temperature",                         "C",      "",                        "PVWatts",      "*",                       "",                          "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "wspd",                     "Wind speed",                                  "m/s",    "",                        "PVWatts",      "*",                       "",                          "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "snow",                     "Snow cover",                                  "cm",     "",                        "PVWatts",      "?=0",                     "",                          "" },
+
+	/* input/output variable: tcell & poa from previous time must be given */
+	{ SSC_INOUT,        SSC_NUMBER,      "tcell",                    "Module temperature",                          "C",      "",                        "PVWatts",      "*",                       "",                          "" },	
+	{ SSC_INOUT,        SSC_NUMBER,      "poa",                      "Plane of array irradiance",                   "W/m2",   "",                        "PVWatts",      "*",                       "",                          "" },
+			
+	/* outputs */
+	{ SSC_OUTPUT,       SSC_NUMBER,      "dc",                      "DC array output",                             "Wdc",    "",                        "PVWatts",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,      "ac",                      "AC system output",                            "Wac",    "",                        "PVWatts",      "*",                       "",                          "" },
+
+var_info_invalid };
+
+static var_info _cm_vtab_pvwattsv1_1ts_system[] = {
+/*   VARTYPE           DATATYPE         NAME                         LABEL                                               UNITS     META                      GROUP          REQUIRED_IF                 CONSTRAINTS                      UI_HINTS*/
+	{ SSC_INPUT,        SSC_NUMBER,      "lat",                      "Latitude",                                    "deg",    "",                        "PVWatts",      "*",                        "",                      "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "lon",                      "Longitude",                                   "deg",    "",                        "PVWatts",      "*",                        "",                      "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "tz",                       "Time zone",                                   "hr",     "",                        "PVWatts",      "*",                        "",                      "" },
 	
 	{ SSC_INPUT,        SSC_NUMBER,      "time_step",                "Time step of input data",                     "hr",    "",                         "PVWatts",      "?=1",                     "POSITIVE",                  "" },
 	
@@ -92,17 +105,33 @@ static var_info _cm_vtab_pvwattsv1_1ts[] = {
 	{ SSC_INPUT,        SSC_NUMBER,      "poa_cutin",                "Min reqd irradiance for operation",           "W/m2",   "",                        "PVWatts",      "?=0",                     "MIN=0",                                    "" },
 	{ SSC_INPUT,        SSC_NUMBER,      "w_stow",                   "Wind stow speed",                             "m/s",    "",                        "PVWatts",      "?=0",                     "MIN=0",                                    "" },
 
-
-	/* input/output variable: tcell & poa from previous time must be given */
-	{ SSC_INOUT,        SSC_NUMBER,      "tcell",                    "Module temperature",                          "C",      "",                        "PVWatts",      "*",                       "",                          "" },	
-	{ SSC_INOUT,        SSC_NUMBER,      "poa",                      "Plane of array irradiance",                   "W/m2",   "",                        "PVWatts",      "*",                       "",                          "" },
-			
-	/* outputs */
-	{ SSC_OUTPUT,       SSC_NUMBER,      "dc",                      "DC array output",                             "Wdc",    "",                        "PVWatts",      "*",                       "",                          "" },
-	{ SSC_OUTPUT,       SSC_NUMBER,      "ac",                      "AC system output",                            "Wac",    "",                        "PVWatts",      "*",                       "",                          "" },
-
 var_info_invalid };
 
+/* reads the system inputs shared by the single time step module and the persistent model */
+static void pvwattsv1_1ts_params( compute_module *cm, pvwatts_engine::params &p )
+{
+	p.lat = cm->as_double("lat");
+	p.lon = cm->as_double("lon");
+	p.tz = cm->as_double("tz");
+	p.system_size = cm->as_double("system_size");
+	p.derate = cm->as_double("derate");
+	p.track_mode = cm->as_integer("track_mode"); // 0, 1, 2, 3
+	p.azimuth = cm->as_double("azimuth");
+	p.tilt = cm->as_double("tilt");
+
+	/* PV RELATED SPECIFICATIONS */
+	p.t_noct = cm->as_double("t_noct");	/* Installed normal operating cell temperature (deg C) */
+	p.t_ref = cm->as_double("t_ref");	/* Reference module temperature (deg C) */
+	p.gamma = cm->as_double("gamma");	/* Power degradation due to temperature (%/C), si approx -0.4 */
+	p.inv_eff = cm->as_double("inv_eff");	/* Efficiency of inverter at rated output (decimal fraction) */
+	p.rotlim = cm->as_double("rotlim");	/* +/- rotation in degrees permitted by physical constraint of tracker */
+	p.fd = cm->as_double("fd"); // diffuse fraction
+	p.i_ref = cm->as_double("i_ref"); // reference irradiance for rating condition
+	p.poa_cutin = cm->as_double("poa_cutin"); // minimum POA irradiance level required for any operation
+	p.w_stow = cm->as_double("w_stow"); // maximum wind speed before stowing.  stowing causes all output to be lost
+	p.time_step = cm->as_double("time_step");
+}
+
 class cm_pvwattsv1_1ts : public compute_module
 {
 public:
@@ -110,6 +139,7 @@ public:
 	cm_pvwattsv1_1ts()
 	{
 		add_var_info( _cm_vtab_pvwattsv1_1ts );
+		add_var_info( _cm_vtab_pvwattsv1_1ts_system );
 	}
 
 	void exec( ) throw( general_error )
@@ -120,116 +150,26 @@ public:
 		int day = as_integer("day");
 		int hour = as_integer("hour");
 		double minute = as_double("minute");
-		double lat = as_double("lat");
-		double lon = as_double("lon");
-		double tz = as_double("tz");
 		double beam = as_double("beam");
 		double diff = as_double("diffuse");
 		double tamb = as_double("tamb");
 		double wspd = as_double("wspd");
-
-		//double time_step = as_double("time_step");
 		double snow = as_double("snow");
 
-		double dcrate = as_double("system_size");
-		double derate = as_double("derate");
-		int track_mode = as_integer("track_mode"); // 0, 1, 2, 3
-		double azimuth = as_double("azimuth");
-		double tilt = fabs( as_double("tilt") );
-		
-
-		/* PV RELATED SPECIFICATIONS */
-		
-		double inoct = as_double("t_noct") + 273.15; // PVWATTS_INOCT;        /* Installed normal operating cell temperature (deg K) */
-		double reftem = as_double("t_ref"); // PVWATTS_REFTEM;                /* Reference module temperature (deg C) */
-		double pwrdgr = as_double("gamma") / 100.0; // PVWATTS_PWRDGR;              /* Power degradation due to temperature (decimal fraction), si approx -0.004 */
-		double efffp = as_double("inv_eff"); // PVWATTS_EFFFP;                 /* Efficiency of inverter at rated output (decimal fraction) */
-
-		double height = PVWATTS_HEIGHT;                 /* Average array height (meters) */
-		double tmloss = 1.0 - derate/efffp;  /* All losses except inverter,decimal */
-		double rlim = as_double("rotlim");             /* +/- rotation in degrees permitted by physical constraint of tracker */
-		double fd = as_double("fd"); // diffuse fraction
-		double i_ref = as_double("i_ref"); // reference irradiance for rating condition
-		double poa_cutin = as_double("poa_cutin"); // minimum POA irradiance level required for any operation
-		double wind_stow = as_double("w_stow"); // maximum wind speed before stowing.  stowing causes all output to be lost
-		
-		// check system size
-		if ( dcrate < 0.1 ) dcrate = 0.1;
-
-	// bounds of (0,09999, 0.99001) are consistent with online PVWatts http://rredc.nrel.gov/solar/codes_algs/PVWATTS/version1/US/code/pvwattsv1.cgi
-	//    if ( derate < 0.09999 || derate > 0.99001 ) // Use if default ac to dc derate factor out of range
-		if ( derate < 0.0 || derate > 1.0 ) // Use if default ac to dc derate factor out of range
-			derate = 0.77;
-        
-		double pcrate = dcrate * 1000.0;      // rated output of inverter in a.c. watts; 6/29/2005
-		double refpwr = dcrate * 1000.0;      // nameplate in watts; 6/29/2005
-
-		if( track_mode < 0 || track_mode > 3 )
-			track_mode = 0;
-		if( tilt < 0 || tilt > 90 )
-			tilt = lat;
-		if( azimuth < 0 || azimuth > 360 )
-			azimuth = 180.0;
-						
-
-		double last_tcell = as_double("tcell");
-		double last_poa = as_double("poa");
-		
-		pvwatts_celltemp tccalc( inoct, height, 1.0 );
-		tccalc.set_last_values( last_tcell, last_poa );
-	
-		irrad irr;
-		irr.set_time( year, month, day, hour, minute, IRRADPROC_NO_INTERPOLATE_SUNRISE_SUNSET );
-		irr.set_location( lat, lon, tz );
-				
-		double alb = 0.2;
-		if (snow > 0 && snow < 150)
-			alb = 0.6;
-
-		irr.set_sky_model( 2, alb );
-		irr.set_beam_diffuse( beam, diff );
-		irr.set_surface( track_mode, tilt, azimuth, rlim, true, -1 );
-			
-		double ibeam, iskydiff, ignddiff;
-		double solazi, solzen, solalt, aoi, stilt, sazi, rot, btd;
-		int sunup;		
-
-		int code = irr.calc();
-		if ( code != 0 )
-			throw exec_error( "pvwattsv1_1ts", "failed to calculate POA irradiance with given input parameters" );
-	
-		double out_poa = 0;
-		double out_tcell = tamb;
-		double out_dc = 0;
-		double out_ac = 0;
-			
-		irr.get_sun( &solazi, &solzen, &solalt, 0, 0, 0, &sunup, 0, 0, 0 );
-		if (sunup > 0)
-		{
-			irr.get_angles( &aoi, &stilt, &sazi, &rot, &btd );
-			irr.get_poa( &ibeam, &iskydiff, &ignddiff, 0, 0, 0);
-
-			double poa = ibeam + fd*(iskydiff +ignddiff);
-			
-			if (poa_cutin > 0 && poa < poa_cutin)
-				poa = 0;
+		pvwatts_engine::params p;
+		pvwattsv1_1ts_params( this, p );
+		p.time_step = 1.0;
 
-			double wspd_corr = wspd < 0 ? 0 : wspd;
+		pvwatts_engine pvw( p );
+		pvw.set_last_values( as_double("tcell"), as_double("poa") );
 
-			if (wind_stow > 0 && wspd >= wind_stow)
-				poa = 0;
-
-			double tpoa = transpoa(poa, beam, aoi*3.14159265358979/180, false);
-			double pvt = tccalc( poa, wspd_corr, tamb );
-			double dc = dcpowr(reftem,refpwr,pwrdgr,tmloss,tpoa,pvt,i_ref);
-			double ac = dctoac(pcrate,efffp,dc);
-			
-			out_poa = poa;
-			out_tcell = pvt;
-			out_dc = dc;
-			out_ac = ac;
-		}
+		if ( pvw.step( year, month, day, hour, minute, -1, beam, diff, tamb, wspd, snow ) != 0 )
+			throw exec_error( "pvwattsv1_1ts", "failed to calculate POA irradiance with given input parameters" );
 
+		double out_poa = pvw.poa();
+		double out_tcell = pvw.tcell();
+		double out_dc = pvw.dc();
+		double out_ac = pvw.ac();
 
 		assign("poa", var_data((ssc_number_t)out_poa));
 		assign("tcell", var_data((ssc_number_t)out_tcell));
@@ -238,4 +178,46 @@ public:
 	}
 };
 
+/* checks only the system inputs of pvwattsv1_1ts, applying their defaults, and builds a persistent model from them */
+class cm_pvwattsv1_1ts_system : public compute_module
+{
+public:
+	pvwatts_engine *engine;
+
+	cm_pvwattsv1_1ts_system() : engine(0)
+	{
+		add_var_info( _cm_vtab_pvwattsv1_1ts_system );
+	}
+
+	void exec( ) throw( general_error )
+	{
+		pvwatts_engine::params p;
+		pvwattsv1_1ts_params( this, p );
+		engine = new pvwatts_engine( p );
+	}
+};
+
+class pvwattsv1_1ts_system_handler : public handler_interface
+{
+public:
+	pvwattsv1_1ts_system_handler( compute_module *cm ) : handler_interface( cm ) { }
+	virtual void on_log( const std::string &, int, float ) { }
+	virtual bool on_update( const std::string &, float, float ) { return true; }
+};
+
+/* used by ssc_pvwatts_create: returns NULL if a system input is missing or violates its constraints */
+pvwatts_engine *pvwattsv1_1ts_create_engine( var_table *data )
+{
+	// defaults are assigned into a copy so the caller's data is not modified
+	var_table inputs;
+	inputs = *data;
+
+	cm_pvwattsv1_1ts_system cm;
+	pvwattsv1_1ts_system_handler handler( &cm );
+	if ( !cm.compute( &handler, &inputs ) )
+		return 0;
+
+	return cm.engine;
+}
+
 DEFINE_MODULE_ENTRY( pvwattsv1_1ts, "pvwattsv1_1ts- single timestep calculation of PV system performance.", 1 )
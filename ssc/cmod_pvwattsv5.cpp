@@ -136,6 +136,38 @@ static var_info _cm_vtab_pvwattsv5_part2[] = {
 
 	var_info_invalid };
 
+static void module_type_parameters( int module_type, double &gamma, bool &use_ar_glass )
+{
+	switch( module_type )
+	{
+	case 0: // standard module
+		gamma = -0.0047; use_ar_glass = false; break;
+	case 1: // premium module
+		gamma = -0.0035; use_ar_glass = true; break;
+	case 2: // thin film module
+		gamma = -0.0020; use_ar_glass = false; break;
+	}
+}
+
+static void array_type_parameters( int array_type, int &track_mode, double &inoct, int &shade_mode_1x )
+{
+	switch( array_type )
+	{
+	case FIXED_OPEN_RACK: // fixed open rack
+		track_mode = 0; inoct = 45; shade_mode_1x = 0; break;
+	case FIXED_ROOF_MOUNT: // fixed roof mount
+		track_mode = 0; inoct = 49; shade_mode_1x = 0; break;
+	case ONE_AXIS_SELF_SHADED: // 1 axis self-shaded
+		track_mode = 1; inoct = 45; shade_mode_1x = 0; break;
+	case ONE_AXIS_BACKTRACKED: // 1 axis backtracked
+		track_mode = 1; inoct = 45; shade_mode_1x = 1; break;
+	case TWO_AXIS: // 2 axis
+		track_mode = 2; inoct = 45; shade_mode_1x = 0; break;
+	case AZIMUTH_AXIS: // azimuth axis
+		track_mode = 3; inoct = 45; shade_mode_1x = 0; break;
+	}
+}
+
 class cm_pvwattsv5_base : public compute_module
 {
 protected:
@@ -194,42 +226,82 @@ public:
 		use_ar_glass = false;
 
 		module_type = as_integer("module_type");
-		switch( module_type )
-		{
-		case 0: // standard module
-			gamma = -0.0047; use_ar_glass = false; break;
-		case 1: // premium module
-			gamma = -0.0035; use_ar_glass = true; break;
-		case 2: // thin film module
-			gamma = -0.0020; use_ar_glass = false; break;
-		}
+		module_type_parameters( module_type, gamma, use_ar_glass );
 
 		track_mode =  0;
 		inoct = 45;
 		shade_mode_1x = 0; // self shaded
 		
 		array_type = as_integer("array_type"); // 0, 1, 2, 3, 4		
-		switch( array_type )
-		{
-		case FIXED_OPEN_RACK: // fixed open rack
-			track_mode = 0; inoct = 45; shade_mode_1x = 0; break;
-		case FIXED_ROOF_MOUNT: // fixed roof mount
-			track_mode = 0; inoct = 49; shade_mode_1x = 0; break;
-		case ONE_AXIS_SELF_SHADED: // 1 axis self-shaded
-			track_mode = 1; inoct = 45; shade_mode_1x = 0; break;
-		case ONE_AXIS_BACKTRACKED: // 1 axis backtracked
-			track_mode = 1; inoct = 45; shade_mode_1x = 1; break;
-		case TWO_AXIS: // 2 axis
-			track_mode = 2; inoct = 45; shade_mode_1x = 0; break;
-		case AZIMUTH_AXIS: // azimuth axis
-			track_mode = 3; inoct = 45; shade_mode_1x = 0; break;
-		}
+		array_type_parameters( array_type, track_mode, inoct, shade_mode_1x );
 
 		
 		gcr = 0.4;
 		if ( track_mode == 1 && is_assigned("gcr") ) gcr = as_double("gcr");
 	}
 
+	weather_data_provider *open_weather( const char *cmod_name )
+	{
+		std::unique_ptr<weather_data_provider> wdprov;
+
+		if ( is_assigned( "solar_resource_file" ) )
+		{
+			const char *file = as_string("solar_resource_file");
+			wdprov = std::unique_ptr<weather_data_provider>( new weatherfile( file ) );
+
+			weatherfile *wfile = dynamic_cast<weatherfile*>(wdprov.get());
+			if (!wfile->ok()) throw exec_error(cmod_name, wfile->message());
+			if( wfile->has_message() ) log( wfile->message(), SSC_WARNING);
+		}
+		else if ( is_assigned( "solar_resource_data" ) )
+		{
+			wdprov = std::unique_ptr<weather_data_provider>( new weatherdata( lookup("solar_resource_data") ) );
+		}
+		else
+			throw exec_error(cmod_name, "no weather data supplied");
+
+		return wdprov.release();
+	}
+
+	// determines the time step and timestamp convention of the weather data,
+	// assigns "ts_shift_hours", and returns the number of records per hour
+	size_t setup_time_steps( const char *cmod_name, weather_data_provider *wdprov, bool &instantaneous )
+	{
+		// assumes instantaneous values, unless hourly file with no minute column specified
+		double ts_shift_hours = 0.0;
+		instantaneous = true;
+		if ( wdprov->has_data_column( weather_data_provider::MINUTE ) )
+		{
+			// if we have an file with a minute column, then
+			// the starting time offset equals the time 
+			// of the first record (for correct plotting)
+			// this holds true even for hourly data with a minute column
+			weather_record rec;
+			if ( wdprov->read( &rec ) )
+				ts_shift_hours = rec.minute/60.0;
+
+			wdprov->rewind();
+		}
+		else if ( wdprov->nrecords() == 8760 )
+		{
+			// hourly file with no minute data column.  assume
+			// integrated/averaged values and use mid point convention for interpreting results
+			instantaneous = false;
+			ts_shift_hours = 0.5;
+		}
+		else
+			throw exec_error(cmod_name, "subhourly weather files must specify the minute for each record" );
+
+		assign( "ts_shift_hours", var_data( (ssc_number_t)ts_shift_hours ) );
+
+		size_t nrec = wdprov->nrecords();
+		size_t step_per_hour = nrec/8760;
+		if ( step_per_hour < 1 || step_per_hour > 60 || step_per_hour*8760 != nrec )
+			throw exec_error( cmod_name, util::format("invalid number of data records (%d): must be an integer multiple of 8760", (int)nrec ) );
+
+		return step_per_hour;
+	}
+
 	void initialize_cell_temp( double ts_hour, double last_tcell = -9999, double last_poa = -9999 )
 	{
 		tccalc = new pvwatts_celltemp ( inoct+273.15, PVWATTS_HEIGHT, ts_hour );
@@ -384,23 +456,7 @@ public:
 		if (!as_boolean("batt_simple_enable"))
 			add_var_info(vtab_technology_outputs);
 
-		std::unique_ptr<weather_data_provider> wdprov;
-
-		if ( is_assigned( "solar_resource_file" ) )
-		{
-			const char *file = as_string("solar_resource_file");
-			wdprov = std::unique_ptr<weather_data_provider>( new weatherfile( file ) );
-
-			weatherfile *wfile = dynamic_cast<weatherfile*>(wdprov.get());
-			if (!wfile->ok()) throw exec_error("pvwattsv5", wfile->message());
-			if( wfile->has_message() ) log( wfile->message(), SSC_WARNING);
-		}
-		else if ( is_assigned( "solar_resource_data" ) )
-		{
-			wdprov = std::unique_ptr<weather_data_provider>( new weatherdata( lookup("solar_resource_data") ) );
-		}
-		else
-			throw exec_error("pvwattsv5", "no weather data supplied");
+		std::unique_ptr<weather_data_provider> wdprov( open_weather( "pvwattsv5" ) );
 
 		setup_system_inputs(); // setup all basic system specifications
 				
@@ -416,39 +472,12 @@ public:
 		weather_header hdr;
 		wdprov->header( &hdr );
 					
-		// assumes instantaneous values, unless hourly file with no minute column specified
-		double ts_shift_hours = 0.0;
 		bool instantaneous = true;
-		if ( wdprov->has_data_column( weather_data_provider::MINUTE ) )
-		{
-			// if we have an file with a minute column, then
-			// the starting time offset equals the time 
-			// of the first record (for correct plotting)
-			// this holds true even for hourly data with a minute column
-			weather_record rec;
-			if ( wdprov->read( &rec ) )
-				ts_shift_hours = rec.minute/60.0;
-
-			wdprov->rewind();
-		}
-		else if ( wdprov->nrecords() == 8760 )
-		{
-			// hourly file with no minute data column.  assume
-			// integrated/averaged values and use mid point convention for interpreting results
-			instantaneous = false;
-			ts_shift_hours = 0.5;
-		}
-		else
-			throw exec_error("pvwattsv5", "subhourly weather files must specify the minute for each record" );
-
-		assign( "ts_shift_hours", var_data( (ssc_number_t)ts_shift_hours ) );
+		size_t step_per_hour = setup_time_steps( "pvwattsv5", wdprov.get(), instantaneous );
 
 		weather_record wf;
 		
 		size_t nrec = wdprov->nrecords();
-		size_t step_per_hour = nrec/8760;
-		if ( step_per_hour < 1 || step_per_hour > 60 || step_per_hour*8760 != nrec )
-			throw exec_error( "pvwattsv5", util::format("invalid number of data records (%d): must be an integer multiple of 8760", (int)nrec ) );
 		
 		/* allocate output arrays */		
 		ssc_number_t *p_gh = allocate("gh", nrec);
@@ -678,3 +707,261 @@ public:
 };
 
 DEFINE_MODULE_ENTRY( pvwattsv5_1ts, "pvwattsv5_1ts- single timestep calculation of PV system performance.", 1 )
+
+
+
+/* *****************************************************************************
+			FLEET VERSION
+ ***************************************************************************** */
+
+static var_info _cm_vtab_pvwattsv5_fleet[] = {
+/*   VARTYPE           DATATYPE          NAME                         LABEL                                               UNITS        META                      GROUP          REQUIRED_IF                 CONSTRAINTS                      UI_HINTS*/
+	{ SSC_INPUT,        SSC_MATRIX,      "fleet_systems",                  "System configurations, one row per system",   "",          "system_capacity(kW),module_type,dc_ac_ratio,inv_eff(%),losses(%),array_type,tilt(deg),azimuth(deg),gcr", "PVWatts", "*", "", "" },
+
+	{ SSC_OUTPUT,       SSC_MATRIX,      "gen",                            "System power generated",                      "kW",        "Rows are time steps, columns are systems",             "Time Series",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "sunup",                          "Sun up over horizon",                         "0/1",       "",                     "Time Series",      "*",                       "",                          "" },
+
+	{ SSC_OUTPUT,       SSC_ARRAY,       "annual_energy",                  "Annual energy",                               "kWh",       "One value per system", "Annual",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "capacity_factor",                "Capacity factor",                             "%",         "One value per system", "Annual",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "kwh_per_kw",                     "First year kWh/kW",                           "",          "One value per system", "Annual",      "*",                       "",                          "" },
+
+	{ SSC_OUTPUT,       SSC_NUMBER,      "lat",                            "Latitude",                                    "deg", "",                        "Location",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,      "lon",                            "Longitude",                                   "deg", "",                        "Location",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,      "tz",                             "Time zone",                                   "hr",  "",                        "Location",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,      "elev",                           "Site elevation",                              "m",   "",                        "Location",      "*",                       "",                          "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,      "ts_shift_hours",                 "Time offset for interpreting time series outputs",  "hours", "",                 "Miscellaneous", "*",                       "",                          "" },
+
+	var_info_invalid };
+
+/*
+	Evaluates many PVWatts systems against a single weather file.  The weather
+	data is read once, and the sun position and horizontal beam/diffuse inputs
+	are computed once per time step and shared by every system.  Per-system
+	state is held in contiguous arrays so that the DC and inverter stages run as
+	a straight loop over the fleet.  Shading and adjustment factors are not
+	supported: each system is equivalent to a pvwattsv5 run with neither enabled.
+*/
+class cm_pvwattsv5_fleet : public cm_pvwattsv5_base
+{
+public:
+	
+	cm_pvwattsv5_fleet()
+	{
+		add_var_info( _cm_vtab_pvwattsv5_part1 );
+		add_var_info( _cm_vtab_pvwattsv5_fleet );
+	}
+
+	void exec( ) throw( general_error )
+	{
+		std::unique_ptr<weather_data_provider> wdprov( open_weather( "pvwattsv5_fleet" ) );
+
+		util::matrix_t<double> systems = as_matrix( "fleet_systems" );
+		size_t nsys = systems.nrows();
+		if ( nsys < 1 || systems.ncols() != 9 )
+			throw exec_error( "pvwattsv5_fleet", "fleet_systems must have one row per system and 9 columns" );
+
+		// per-system parameters, laid out contiguously for the power calculation
+		std::vector<double> sys_dc_nameplate( nsys ), sys_ac_nameplate( nsys ), sys_pdc0( nsys ), sys_etanom( nsys ), sys_loss( nsys ), sys_gamma( nsys );
+		std::vector<double> sys_tilt( nsys ), sys_azimuth( nsys ), sys_gcr( nsys );
+		std::vector<int> sys_track_mode( nsys ), sys_shade_mode_1x( nsys );
+		std::vector<bool> sys_ar_glass( nsys );
+		std::vector<pvwatts_celltemp> sys_tccalc;
+
+		weather_header hdr;
+		wdprov->header( &hdr );
+
+		bool instantaneous = true;
+		size_t step_per_hour = setup_time_steps( "pvwattsv5_fleet", wdprov.get(), instantaneous );
+		size_t nrec = wdprov->nrecords();
+		double ts_hour = 1.0/step_per_hour;
+
+		for( size_t s=0;s<nsys;s++ )
+		{
+			int sys_module_type = (int)systems(s,1);
+			int sys_array_type = (int)systems(s,5);
+			// same ranges as the single system inputs
+			if ( sys_module_type < 0 || sys_module_type > 2 || sys_array_type < 0 || sys_array_type > 4
+				|| systems(s,0) <= 0 || systems(s,2) <= 0
+				|| systems(s,3) < 90 || systems(s,3) > 99.5 || systems(s,4) < -5 || systems(s,4) > 99
+				|| systems(s,6) < 0 || systems(s,6) > 90 || systems(s,7) < 0 || systems(s,7) >= 360
+				|| systems(s,8) < 0 || systems(s,8) > 3 )
+				throw exec_error( "pvwattsv5_fleet", util::format("invalid configuration for system %d", (int)s ) );
+
+			sys_dc_nameplate[s] = systems(s,0)*1000;
+			sys_ac_nameplate[s] = sys_dc_nameplate[s] / systems(s,2);
+			sys_etanom[s] = systems(s,3)/100.0;
+			sys_pdc0[s] = sys_ac_nameplate[s]/sys_etanom[s];
+			sys_loss[s] = systems(s,4);
+			sys_tilt[s] = systems(s,6);
+			sys_azimuth[s] = systems(s,7);
+
+			double gamma = 0;
+			bool use_ar_glass = false;
+			module_type_parameters( sys_module_type, gamma, use_ar_glass );
+			sys_gamma[s] = gamma;
+			sys_ar_glass[s] = use_ar_glass;
+
+			int track = 0, shade_1x = 0;
+			double noct = 45;
+			array_type_parameters( sys_array_type, track, noct, shade_1x );
+			sys_track_mode[s] = track;
+			sys_shade_mode_1x[s] = shade_1x;
+			if ( track == 1 && systems(s,8) <= 0 )
+				throw exec_error( "pvwattsv5_fleet", util::format("system %d: ground coverage ratio must be positive for 1-axis tracking", (int)s ) );
+			sys_gcr[s] = ( track == 1 ) ? systems(s,8) : 0.4;
+
+			sys_tccalc.push_back( pvwatts_celltemp( noct+273.15, PVWATTS_HEIGHT, ts_hour ) );
+		}
+
+		ssc_number_t *p_gen = allocate( "gen", nrec, nsys );
+		ssc_number_t *p_sunup = allocate( "sunup", nrec );
+		std::vector<double> annual_kwh( nsys, 0.0 );
+
+		// per time step, per system working arrays
+		std::vector<double> sys_poa( nsys ), sys_tpoa( nsys ), sys_pvt( nsys );
+
+		weather_record wf;
+		size_t hour=0, idx=0;
+		while( hour < 8760 )
+		{
+			if ( hour % (8760/NSTATUS_UPDATES) == 0 )
+			{
+				float percent = 100.0f * ((float)hour+1) / ((float)8760);
+				if ( !update( "", percent , (float)hour ) )
+					throw exec_error("pvwattsv5_fleet", "simulation canceled at hour " + util::to_string(hour+1.0) );
+			}
+
+			for( size_t jj=0;jj<step_per_hour;jj++)
+			{
+				if (!wdprov->read( &wf ))
+					throw exec_error("pvwattsv5_fleet", util::format("could not read data line %d of %d in weather file", (int)(idx+1), (int)nrec ));
+
+				double alb = 0.2;
+				if ( std::isfinite( wf.alb ) && wf.alb > 0 && wf.alb < 1 )
+					alb = wf.alb;
+
+				// sun position and horizontal irradiance checks are independent of the surface,
+				// so they are calculated once for the whole fleet on a horizontal reference surface
+				irrad irr;
+				irr.set_time( wf.year, wf.month, wf.day, wf.hour, wf.minute, instantaneous ? IRRADPROC_NO_INTERPOLATE_SUNRISE_SUNSET : ts_hour );
+				irr.set_location( hdr.lat, hdr.lon, hdr.tz );
+				irr.set_sky_model( 2, alb );
+				irr.set_beam_diffuse( wf.dn, wf.df );
+				irr.set_surface( 0, 0, 180, 45.0, false, 0.4 );
+
+				int code = irr.calc();
+				if ( -1 == code )
+				{
+					log(  util::format("beam irradiance exceeded extraterrestrial value at record [y:%d m:%d d:%d h:%d]", 
+							 wf.year, wf.month, wf.day, wf.hour) );
+				}
+				else if ( 0 != code )
+					throw exec_error( "pvwattsv5_fleet", 
+						util::format("failed to process irradiation on surface (code: %d) [y:%d m:%d d:%d h:%d]", 
+							code, wf.year, wf.month, wf.day, wf.hour));
+
+				double solazi, solzen, hextra;
+				int sunup;
+				irr.get_sun( &solazi, &solzen, 0, 0, 0, 0, &sunup, 0, 0, &hextra );
+				double solazi_rad = irr.get_sun_component( 0 ), solzen_rad = irr.get_sun_component( 1 );
+				p_sunup[idx] = (ssc_number_t)sunup;
+
+				if ( sunup > 0 )
+				{
+					double wspd_corr = wf.wspd < 0 ? 0 : wf.wspd;
+
+					for( size_t s=0;s<nsys;s++ )
+					{
+						double angle[5] = { 0, 0, 0, 0, 0 };
+						double poa_front[3] = { 0, 0, 0 };
+						incidence( sys_track_mode[s], sys_tilt[s], sys_azimuth[s], 45.0, solzen_rad, solazi_rad,
+							sys_shade_mode_1x[s] == 1, sys_gcr[s], angle );
+
+						// beam exceeding extraterrestrial leaves the plane of array irradiance at zero, as in irrad::calc
+						if ( code == 0 )
+							perez( hextra, wf.dn, wf.df, alb, angle[0], angle[1], solzen_rad, poa_front, 0 );
+
+						double aoi_deg = angle[0] * (180/M_PI);
+						double stilt_deg = angle[1] * (180/M_PI);
+						double ibeam = poa_front[0], iskydiff = poa_front[1], ignddiff = poa_front[2];
+
+						if ( sys_track_mode[s] == 1 && sys_shade_mode_1x[s] == 0 ) // selfshaded mode
+						{
+							ibeam *= 1 - shadeFraction1x( solazi, solzen, sys_tilt[s], sys_azimuth[s], sys_gcr[s], angle[3] * (180/M_PI) );
+
+							if ( iskydiff > 0 )
+							{
+								double reduced_skydiff = iskydiff, Fskydiff = 1.0;
+								double reduced_gnddiff = ignddiff, Fgnddiff = 1.0;
+								double phi0 = 180/3.1415926*atan2( sind( stilt_deg ), 1/sys_gcr[s] - cosd( stilt_deg ) );
+
+								diffuse_reduce( solzen, stilt_deg,
+									wf.dn, iskydiff+ignddiff,
+									sys_gcr[s], phi0, alb, 1000,
+									reduced_skydiff, Fskydiff,
+									reduced_gnddiff, Fgnddiff );
+
+								if ( Fskydiff >= 0 && Fskydiff <= 1 ) iskydiff *= Fskydiff;
+								if ( Fgnddiff >= 0 && Fgnddiff <= 1 ) ignddiff *= Fgnddiff;
+							}
+						}
+
+						double poa = ibeam + iskydiff + ignddiff;
+						double tpoa = poa;
+						if ( aoi_deg > AOI_MIN && aoi_deg < AOI_MAX )
+						{
+							double mod = iam( aoi_deg, sys_ar_glass[s] );
+							tpoa = poa - ( 1.0 - mod )*wf.dn*cosd(aoi_deg);
+							if( tpoa < 0.0 ) tpoa = 0.0;
+							if( tpoa > poa ) tpoa = poa;
+						}
+
+						sys_poa[s] = poa;
+						sys_tpoa[s] = tpoa;
+						sys_pvt[s] = sys_tccalc[s]( poa, wspd_corr, wf.tdry );
+					}
+
+					// dc power, losses, and inverter curve: branch free over the fleet
+					const double etaref = 0.9637, A = -0.0162, B = -0.0059, C = 0.9858;
+					ssc_number_t *p_gen_row = p_gen + idx*nsys;
+					for( size_t s=0;s<nsys;s++ )
+					{
+						double dc = sys_dc_nameplate[s]*(1.0+sys_gamma[s]*(sys_pvt[s]-25.0))*sys_tpoa[s]/1000.0;
+						dc = dc*(1-sys_loss[s]/100);
+						double plr = dc / sys_pdc0[s];
+						double eta = (A*plr + B/plr + C)*sys_etanom[s]/etaref;
+						double ac = plr > 0 ? dc*eta : 0.0;
+						ac = ac > sys_ac_nameplate[s] ? sys_ac_nameplate[s] : ac;
+						ac = ac < 0 ? 0.0 : ac;
+						p_gen_row[s] = (ssc_number_t)(ac * 0.001); // W to kW
+					}
+
+					for( size_t s=0;s<nsys;s++ )
+						annual_kwh[s] += p_gen_row[s];
+				}
+
+				idx++;
+			}
+
+			hour++;
+		}
+
+		ssc_number_t *p_annual = allocate( "annual_energy", nsys );
+		ssc_number_t *p_cf = allocate( "capacity_factor", nsys );
+		ssc_number_t *p_kwhkw = allocate( "kwh_per_kw", nsys );
+		for( size_t s=0;s<nsys;s++ )
+		{
+			double kWhperkW = 1000.0*annual_kwh[s]*ts_hour / sys_dc_nameplate[s];
+			p_annual[s] = (ssc_number_t)(annual_kwh[s]*ts_hour);
+			p_cf[s] = (ssc_number_t)(kWhperkW / 87.6);
+			p_kwhkw[s] = (ssc_number_t)kWhperkW;
+		}
+
+		assign( "lat", var_data( (ssc_number_t)hdr.lat ) );
+		assign( "lon", var_data( (ssc_number_t)hdr.lon ) );
+		assign( "tz", var_data( (ssc_number_t)hdr.tz ) );
+		assign( "elev", var_data( (ssc_number_t)hdr.elev ) );
+	}
+};
+
+DEFINE_MODULE_ENTRY( pvwattsv5_fleet, "PVWatts V5 - many systems evaluated against one weather file.", 1 )
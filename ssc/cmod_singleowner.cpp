@@ -51,6 +51,10 @@
 #include "lib_financial.h"
 using namespace libfin;
 #include <sstream>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
 
 #ifndef WIN32
 #include <float.h>
@@ -821,6 +825,8 @@ static var_info _cm_vtab_singleowner[] = {
 	{ SSC_OUTPUT,       SSC_NUMBER,     "flip_target_irr",                        "IRR target",                                "%",                   "", "Metrics", "*", "", "" },
 	{ SSC_OUTPUT,       SSC_NUMBER,     "flip_actual_year",                       "Year target IRR was achieved",              "year",                    "", "Metrics", "*", "", "" },
 	{ SSC_OUTPUT,       SSC_NUMBER,     "flip_actual_irr",                        "IRR in target year",                        "%",                   "", "Metrics", "*", "", "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,     "ppa_soln_iterations",                    "PPA solution evaluations of the cash flow", "",                    "", "Metrics", "*", "", "" },
+	{ SSC_OUTPUT,       SSC_NUMBER,     "ppa_soln_time",                          "PPA solution time",                         "s",                   "", "Metrics", "*", "", "" },
 	{ SSC_OUTPUT,       SSC_NUMBER,     "lcoe_real",                              "Levelized cost (real)",                               "cents/kWh",               "", "Metrics", "*", "", "" },
 	{ SSC_OUTPUT,       SSC_NUMBER,     "lcoe_nom",                               "Levelized cost (nominal)",                            "cents/kWh",               "", "Metrics", "*", "", "" },
 	{ SSC_OUTPUT,       SSC_NUMBER,     "lppa_real",                              "Levelized PPA price (real)",                         "cents/kWh",               "", "Metrics", "*", "", "" },
@@ -1893,6 +1899,12 @@ public:
 		double ppa_min=as_double("ppa_soln_min");
 		double ppa_max=as_double("ppa_soln_max");
 		int its=0;
+		// closed form price from the PPA independent and proportional parts of the target return
+		ppa_price_split ppa_split;
+		int ppa_split_trials = 0;
+		bool ppa_split_trial = false;
+		double ppa_split_price = 0;
+		double ppa_resume = 0;
 		double irr_weighting_factor = DBL_MAX;
 		bool irr_is_minimally_met = false;
 		bool irr_greater_than_target = false;
@@ -2087,6 +2099,8 @@ public:
 
 
 
+		std::chrono::steady_clock::time_point ppa_soln_start = std::chrono::steady_clock::now();
+
 /***************** begin iterative solution *********************************************************************/
 
 	do
@@ -2096,7 +2110,8 @@ public:
 		cash_for_debt_service=0;
 		pv_cafds=0;
 		if (constant_dscr_mode)	size_of_debt=0;
-		if (ppa_interval_found)	ppa = (w0*x1+w1*x0)/(w0 + w1);
+		if (ppa_split_trial) ppa = ppa_split_price;
+		else if (ppa_interval_found)	ppa = (w0*x1+w1*x0)/(w0 + w1);
 
 		// debt pre calculation
 		for (i=1; i<=nyears; i++)
@@ -2515,9 +2530,6 @@ public:
 			cf.at(CF_project_return_pretax,i) = cf.at(CF_pretax_cashflow,i);
 			if (i==0) cf.at(CF_project_return_pretax,i) -= (issuance_of_equity); 
 
-			cf.at(CF_project_return_pretax_irr,i) = irr(CF_project_return_pretax,i)*100.0;
-			cf.at(CF_project_return_pretax_npv,i) = npv(CF_project_return_pretax,i,nom_discount_rate) +  cf.at(CF_project_return_pretax,0) ;
-
 			cf.at(CF_project_return_aftertax_cash,i) = cf.at(CF_project_return_pretax,i);
 		}
 
@@ -2650,7 +2662,14 @@ public:
 				irr_weighting_factor = fabs(itnpv_target);
 				irr_is_minimally_met = ((irr_weighting_factor < ppa_soln_tolerance));
 				irr_greater_than_target = (( itnpv_target >= 0.0) || irr_is_minimally_met );
-				if (ppa_interval_found)
+				ppa_split.add(ppa, cf, CF_project_return_aftertax, nyears);
+				if (ppa_split_trial)
+				{
+					// closed form price missed the target, resume the interval search where it left off unless tried again
+					ppa_split_trial = false;
+					if (!irr_is_minimally_met) ppa = ppa_resume;
+				}
+				else if (ppa_interval_found)
 				{// reset interval
 				
 					if (irr_greater_than_target) // too large
@@ -2718,6 +2737,18 @@ public:
 					//log( outm.str() );
 			}
 		}
+		// a few closed form trials, each from the latest two prices, before the interval search takes over
+		if ((ppa_mode == 0) && !solved && !irr_is_minimally_met && (ppa_split_trials < 4) && ppa_split.ready())
+		{
+			ppa_split_trials++;
+			if (ppa_split.solve(flip_target_year, flip_target_percent / 100.0, ppa_split_price) && (ppa_split_price >= 0))
+			{
+				ppa_resume = ppa;
+				ppa_split_trial = true;
+			}
+			else
+				ppa_split_trials = 4;
+		}
 		its++;
 
 	}	// target tax investor return in target year
@@ -2726,6 +2757,13 @@ public:
 
 		// 12/14/12 - address issue from Eric Lantz - ppa solution when target mode and ppa < 0
 	if (ppa < 0) ppa = ppa_old;	
+	assign("ppa_soln_iterations", var_data((ssc_number_t)its));
+	assign("ppa_soln_time", var_data((ssc_number_t)std::chrono::duration<double>(std::chrono::steady_clock::now() - ppa_soln_start).count()));
+
+	// running returns not read by the solution
+	cf.at(CF_project_return_pretax_irr,0) = irr(CF_project_return_pretax,0)*100.0;
+	cf.at(CF_project_return_pretax_npv,0) = cf.at(CF_project_return_pretax,0);
+	cf_running_returns(cf, CF_project_return_pretax, nyears, nom_discount_rate, CF_project_return_pretax_irr, CF_project_return_pretax_npv);
 
 /***************** end iterative solution *********************************************************************/
 
@@ -3889,214 +3927,387 @@ public:
 	}
 
 	double npv( int cf_line, int nyears, double rate ) throw ( general_error )
-	{		
-		//if (rate == -1.0) throw general_error("cannot calculate NPV with discount rate equal to -1.0");
-		double rr = 1.0;
-		if (rate != -1.0) rr = 1.0/(1.0+rate);
-		double result = 0;
-		for (int i=nyears;i>0;i--)
-			result = rr * result + cf.at(cf_line,i);
-
-		return result*rr;
-	}
-
-/* ported from http://code.google.com/p/irr-newtonraphson-calculator/ */
-	bool is_valid_iter_bound(double estimated_return_rate)
 	{
-		return estimated_return_rate != -1 && (estimated_return_rate < std::numeric_limits<int>::max()) && (estimated_return_rate > std::numeric_limits<int>::min());
+		return cf_npv(cf, cf_line, nyears, rate);
 	}
 
-	double irr_poly_sum(double estimated_return_rate, int cf_line, int count)
+	double irr( int cf_line, int count, double initial_guess=-2, double tolerance=1e-6, int max_iterations=100 )
 	{
-		double sum_of_polynomial = 0;
-		if (is_valid_iter_bound(estimated_return_rate))
-		{
-			for (int j = 0; j <= count ; j++)
-			{
-				double val = (pow((1 + estimated_return_rate), j));
-				if (val != 0.0)
-					sum_of_polynomial += cf.at(cf_line,j)/val;
-				else
-					break;
-			}
-		}
-		return sum_of_polynomial;
+		return cf_irr(cf, cf_line, count, initial_guess, tolerance, max_iterations);
 	}
 
-	double irr_derivative_sum(double estimated_return_rate,int cf_line, int count)
-	{
-		double sum_of_derivative = 0;
-		if (is_valid_iter_bound(estimated_return_rate))
-			for (int i = 1; i <= count ; i++)
-			{
-				sum_of_derivative += cf.at(cf_line,i)*(i)/pow((1 + estimated_return_rate), i+1);
-			}
-		return sum_of_derivative*-1;
+	double min(double a, double b)
+	{ // handle NaN
+		if ((a != a) || (b != b))
+			return 0;
+		else
+			return (a < b) ? a : b;
 	}
 
-	double irr_scale_factor( int cf_unscaled, int count)
-	{
-		// scale to max value for better irr convergence
-		if (count<1) return 1.0;
-		int i=0;
-		double max=fabs(cf.at(cf_unscaled,0));
-		for (i=0;i<=count;i++) 
-			if (fabs(cf.at(cf_unscaled,i))> max) max =fabs(cf.at(cf_unscaled,i));
-		return (max>0 ? max:1);
+	double max(double a, double b)
+	{ // handle NaN
+		if ((a != a) || (b != b))
+			return 0;
+		else
+			return (a > b) ? a : b;
 	}
 
-	bool is_valid_irr( int cf_line, int count, double residual, double tolerance, int number_of_iterations, int max_iterations, double calculated_irr, double scale_factor )
+	double min_cashflow_value(int cf_line, int nyears)
 	{
-		double npv_of_irr = npv(cf_line,count,calculated_irr)+cf.at(cf_line,0);
-		double npv_of_irr_plus_delta = npv(cf_line,count,calculated_irr+0.001)+cf.at(cf_line,0);
-		bool is_valid = ( (number_of_iterations<max_iterations) && (fabs(residual)<tolerance) && (npv_of_irr>npv_of_irr_plus_delta) && (fabs(npv_of_irr/scale_factor)<tolerance) );
-				//if (!is_valid)
-				//{
-				//std::stringstream outm;
-				//outm <<  "cf_line=" << cf_line << "count=" << count << "residual=" << residual << "number_of_iterations=" << number_of_iterations << "calculated_irr=" << calculated_irr
-				//	<< "npv of irr=" << npv_of_irr << "npv of irr plus delta=" << npv_of_irr_plus_delta;
-				//log( outm.str() );
-				//}
-		return is_valid;
+		// check for NaN
+		bool is_nan = true;
+		for (int i = 1; i <= nyears; i++)
+			is_nan &= std::isnan(cf.at(cf_line, i));
+		if (is_nan) return std::numeric_limits<double>::quiet_NaN();
+
+		double min_value = DBL_MAX;
+		for (int i = 1; i <= nyears; i++)
+			if ((cf.at(cf_line, i)<min_value) && (cf.at(cf_line, i) != 0)) min_value = cf.at(cf_line, i);
+		return min_value;
 	}
 
-	double irr( int cf_line, int count, double initial_guess=-2, double tolerance=1e-6, int max_iterations=100 )
-	{
-		int number_of_iterations=0;
-//		double calculated_irr = 0;
-		double calculated_irr = std::numeric_limits<double>::quiet_NaN();
-//		double calculated_irr = -999;
 
+};
 
-		if (count < 1) 
-			return calculated_irr;
 
-		// only possible for first value negative
-		if ( (cf.at(cf_line,0) <= 0))
-		{
-			// initial guess from http://zainco.blogspot.com/2008/08/internal-rate-of-return-using-newton.html
-			if ((initial_guess < -1) && (count > 1))// second order
-			{
-				if (cf.at(cf_line,0) !=0) 
-				{
-					double b = 2.0+ cf.at(cf_line,1)/cf.at(cf_line,0);
-					double c = 1.0+cf.at(cf_line,1)/cf.at(cf_line,0)+cf.at(cf_line,2)/cf.at(cf_line,0);
-					initial_guess = -0.5*b - 0.5*sqrt(b*b-4.0*c);
-					if ((initial_guess <= 0) || (initial_guess >= 1)) initial_guess = -0.5*b + 0.5*sqrt(b*b-4.0*c);
-				}
-			}
-			else if (initial_guess < 0) // first order
-			{
-				if (cf.at(cf_line,0) !=0) initial_guess = -(1.0 + cf.at(cf_line,1)/cf.at(cf_line,0));
-			}
 
-			double scale_factor = irr_scale_factor(cf_line,count);
-			double residual=DBL_MAX;
 
-			calculated_irr = irr_calc(cf_line,count,initial_guess,tolerance,max_iterations,scale_factor,number_of_iterations,residual);
+DEFINE_MODULE_ENTRY( singleowner, "DHF Single Owner Financial Model_", 1 );
 
-			if (!is_valid_irr(cf_line,count,residual,tolerance,number_of_iterations,max_iterations,calculated_irr,scale_factor)) // try 0.1 as initial guess
-			{
-				initial_guess=0.1;
-				number_of_iterations=0;
-				residual=0;
-				calculated_irr = irr_calc(cf_line,count,initial_guess,tolerance,max_iterations,scale_factor,number_of_iterations,residual);
-			}
 
-			if (!is_valid_irr(cf_line,count,residual,tolerance,number_of_iterations,max_iterations,calculated_irr,scale_factor)) // try -0.1 as initial guess
-			{
-				initial_guess=-0.1;
-				number_of_iterations=0;
-				residual=0;
-				calculated_irr = irr_calc(cf_line,count,initial_guess,tolerance,max_iterations,scale_factor,number_of_iterations,residual);
-			}
-			if (!is_valid_irr(cf_line,count,residual,tolerance,number_of_iterations,max_iterations,calculated_irr,scale_factor)) // try 0 as initial guess
-			{
-				initial_guess=0;
-				number_of_iterations=0;
-				residual=0;
-				calculated_irr = irr_calc(cf_line,count,initial_guess,tolerance,max_iterations,scale_factor,number_of_iterations,residual);
-			}
+static var_info _cm_vtab_singleowner_uncertainty[] = {
+/*   VARTYPE           DATATYPE         NAME                                 LABEL                                                      UNITS        META                                     GROUP            REQUIRED_IF         CONSTRAINTS            UI_HINTS*/
+	{ SSC_INPUT,        SSC_STRING,      "uncertainty_model",                 "Financial model",                                         "",          "singleowner,host_developer,levpartflip,equpartflip,saleleaseback", "Uncertainty", "?=singleowner", "", "" },
+	{ SSC_INPUT,        SSC_STRING,      "uncertainty_inputs",                "Model inputs to vary",                                    "",          "Comma separated names of number, array or matrix inputs", "Uncertainty", "*",       "",                    "" },
+	{ SSC_INPUT,        SSC_MATRIX,      "uncertainty_distributions",         "Distribution of the multiplier on each input",            "",          "One row per input: 0=normal with mean and std dev, 1=uniform with min and max, 2=triangular with min, mode and max, 3=lognormal with mean and std dev", "Uncertainty", "?", "", "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "uncertainty_nsamples",              "Number of samples drawn from the distributions",          "",          "",                                      "Uncertainty",   "?=1000",           "INTEGER,MIN=1",       "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "uncertainty_seed",                  "Random number seed",                                      "",          "",                                      "Uncertainty",   "?=0",              "INTEGER,MIN=0",       "" },
+	{ SSC_INPUT,        SSC_MATRIX,      "uncertainty_samples",               "Multiplier on each input for each sample",                "",          "One row per sample and one column per input, used instead of the distributions", "Uncertainty", "?", "", "" },
+	{ SSC_INPUT,        SSC_ARRAY,       "uncertainty_percentiles",           "Percentiles to report",                                   "%",         "Default 10, 50 and 90",                 "Uncertainty",   "?",                "",                    "" },
+	{ SSC_INPUT,        SSC_NUMBER,      "nthreads",                          "Number of threads",                                       "",          "0=all cores",                           "Uncertainty",   "?=0",              "INTEGER,MIN=0",       "" },
+
+	{ SSC_OUTPUT,       SSC_MATRIX,      "uncertainty_multipliers",           "Multiplier on each input for each sample",                "",          "One row per sample",                    "Uncertainty",   "*",                "",                    "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "uncertainty_status",                "Simulation status for each sample",                       "",          "0=success,-1=failed",                   "Uncertainty",   "*",                "",                    "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "uncertainty_npv",                   "After-tax NPV for each sample",                           "$",         "Project for singleowner and host_developer, tax investor otherwise", "Uncertainty", "*", "", "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "uncertainty_irr",                   "After-tax IRR for each sample",                           "%",         "Project for singleowner and host_developer, tax investor otherwise", "Uncertainty", "*", "", "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "uncertainty_lcoe_nom",              "Nominal LCOE for each sample",                            "cents/kWh", "",                                      "Uncertainty",   "*",                "",                    "" },
+	{ SSC_OUTPUT,       SSC_ARRAY,       "uncertainty_ppa",                   "PPA price in first year for each sample",                 "cents/kWh", "",                                      "Uncertainty",   "*",                "",                    "" },
+	{ SSC_OUTPUT,       SSC_MATRIX,      "uncertainty_percentile_table",      "Percentiles of NPV, IRR, nominal LCOE and PPA price",     "",          "One row per percentile: percentile, NPV, IRR, LCOE, PPA price", "Uncertainty", "*", "", "" },
+	{ SSC_OUTPUT,       SSC_MATRIX,      "uncertainty_correlation",           "Correlation of NPV, IRR, nominal LCOE and PPA price with each input multiplier", "", "One row per input", "Uncertainty", "*", "", "" },
+
+	// the remaining inputs are those of the financial model
+	var_info_invalid };
+
+class cm_singleowner_uncertainty : public compute_module
+{
+private:
+	enum { NPV, IRR, LCOE, PPA, NMETRICS };
 
-			if (!is_valid_irr(cf_line,count,residual,tolerance,number_of_iterations,max_iterations,calculated_irr,scale_factor)) // try 0.1 as initial guess
-			{
-//				calculated_irr = 0.0; // did not converge
-				calculated_irr = std::numeric_limits<double>::quiet_NaN(); // did not converge
-//				double calculated_irr = -999;
-			}
+	struct uncertainty_job
+	{
+		const char *model;
+		const char *metrics[NMETRICS];
+		const var_table *inputs;
+		const std::vector<std::string> *names;
+		const std::vector<var_data> *base;
+		const util::matrix_t<double> *multipliers;
+		std::vector<int> *status;
+		util::matrix_t<double> *results;
+		size_t first, stride;
+	};
+
+	/* copies the inputs of module 'name' which are assigned in this module into 'vt' */
+	void copy_module_inputs(const char *name, var_table &vt)
+	{
+		ssc_module_t p_mod = ssc_module_create(name);
+		if (!p_mod)
+			throw exec_error("singleowner_uncertainty", util::format("could not create module %s", name));
+
+		int i = 0;
+		ssc_info_t p_inf;
+		while ((p_inf = ssc_module_var_info(p_mod, i++)) != 0)
+		{
+			int var_type = ssc_info_var_type(p_inf);
+			if (var_type != SSC_INPUT && var_type != SSC_INOUT)
+				continue;
 
+			const char *var_name = ssc_info_name(p_inf);
+			if (var_data *value = lookup(var_name))
+				vt.assign(var_name, *value);
 		}
-		return calculated_irr;
+		ssc_module_free(p_mod);
 	}
 
-
-	double irr_calc( int cf_line, int count, double initial_guess, double tolerance, int max_iterations, double scale_factor, int &number_of_iterations, double &residual )
+	/* uniform on (0,1) from the 32 bit Mersenne twister, which is the same on every platform */
+	static double uniform(std::mt19937 &rng)
 	{
-//		double calculated_irr = 0;
-		double calculated_irr = std::numeric_limits<double>::quiet_NaN();
-//		double calculated_irr = -999;
-		double deriv_sum = irr_derivative_sum(initial_guess, cf_line, count);
-		if (deriv_sum != 0.0)
-			calculated_irr = initial_guess - irr_poly_sum(initial_guess,cf_line,count)/deriv_sum;
-		else
-			return initial_guess;
-
-		number_of_iterations++;
-
-
-		residual = irr_poly_sum(calculated_irr,cf_line,count) / scale_factor;
+		return (rng() + 0.5) / 4294967296.0;
+	}
 
-		while (!(fabs(residual) <= tolerance) && (number_of_iterations < max_iterations))
+	static double draw(std::mt19937 &rng, int type, double a, double b, double c)
+	{
+		switch (type)
 		{
-			deriv_sum = irr_derivative_sum(initial_guess,cf_line,count);
-			if (deriv_sum != 0.0)
-				calculated_irr = calculated_irr - irr_poly_sum(calculated_irr,cf_line,count)/deriv_sum;
-			else
-				break;
-
-			number_of_iterations++;
-			residual = irr_poly_sum(calculated_irr,cf_line,count) / scale_factor;
+		case 0: // normal
+		case 3: // lognormal
+		{
+			double z = sqrt(-2.0 * ::log(uniform(rng))) * cos(2.0 * M_PI * uniform(rng));
+			if (type == 0)
+				return a + b * z;
+			double sigma2 = ::log(1.0 + b * b / (a * a));
+			return exp(::log(a) - 0.5 * sigma2 + sqrt(sigma2) * z);
+		}
+		case 1: // uniform
+			return a + (b - a) * uniform(rng);
+		default: // triangular
+		{
+			double u = uniform(rng);
+			double f = (b - a) / (c - a);
+			if (u < f)
+				return a + sqrt(u * (c - a) * (b - a));
+			return c - sqrt((1.0 - u) * (c - a) * (c - b));
+		}
 		}
-		return calculated_irr;
 	}
 
+	/* runs every stride-th sample on one copy of the inputs, resetting only the varied inputs */
+	static void run_samples(uncertainty_job job)
+	{
+		const util::matrix_t<double> &multipliers = *job.multipliers;
+		var_table vt;
+		vt = *job.inputs;
+		for (size_t i = job.first; i < multipliers.nrows(); i += job.stride)
+		{
+			for (size_t k = 0; k < job.names->size(); k++)
+			{
+				// numbers are stored as a single cell, so every type is scaled the same way
+				var_data value((*job.base)[k]);
+				for (size_t j = 0; j < value.num.ncells(); j++)
+					value.num.data()[j] = (ssc_number_t)(value.num.data()[j] * multipliers.at(i, k));
+				vt.assign((*job.names)[k], value);
+			}
 
-	double min(double a, double b)
-	{ // handle NaN
-		if ((a != a) || (b != b))
-			return 0;
-		else
-			return (a < b) ? a : b;
+			ssc_module_t p_mod = ssc_module_create(job.model);
+			bool success = p_mod && ssc_module_exec_with_handler(p_mod, static_cast<ssc_data_t>(&vt), 0, 0) != 0;
+			if (p_mod)
+				ssc_module_free(p_mod);
+
+			(*job.status)[i] = success ? 0 : -1;
+			for (int m = 0; m < NMETRICS; m++)
+			{
+				var_data *value = success ? vt.lookup(job.metrics[m]) : 0;
+				job.results->at(i, m) = (value && value->type == SSC_NUMBER) ? (double)value->num : std::numeric_limits<double>::quiet_NaN();
+			}
+		}
 	}
 
-	double max(double a, double b)
-	{ // handle NaN
-		if ((a != a) || (b != b))
-			return 0;
-		else
-			return (a > b) ? a : b;
+	/* linear interpolation between the sorted values, NaN without values */
+	static double percentile(const std::vector<double> &sorted, double p)
+	{
+		if (sorted.empty())
+			return std::numeric_limits<double>::quiet_NaN();
+		double pos = std::min(std::max(p, 0.0), 100.0) / 100.0 * (sorted.size() - 1);
+		size_t lo = (size_t)pos;
+		if (lo + 1 >= sorted.size())
+			return sorted.back();
+		return sorted[lo] + (pos - lo) * (sorted[lo + 1] - sorted[lo]);
 	}
 
-	double min_cashflow_value(int cf_line, int nyears)
+	static double correlation(const std::vector<double> &x, const std::vector<double> &y)
 	{
-		// check for NaN
-		bool is_nan = true;
-		for (int i = 1; i <= nyears; i++)
-			is_nan &= std::isnan(cf.at(cf_line, i));
-		if (is_nan) return std::numeric_limits<double>::quiet_NaN();
+		size_t n = x.size();
+		if (n < 2)
+			return std::numeric_limits<double>::quiet_NaN();
+		double mx = 0, my = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			mx += x[i];
+			my += y[i];
+		}
+		mx /= n;
+		my /= n;
+		double sxy = 0, sxx = 0, syy = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			sxy += (x[i] - mx) * (y[i] - my);
+			sxx += (x[i] - mx) * (x[i] - mx);
+			syy += (y[i] - my) * (y[i] - my);
+		}
+		if (sxx <= 0 || syy <= 0)
+			return std::numeric_limits<double>::quiet_NaN();
+		return sxy / sqrt(sxx * syy);
+	}
 
-		double min_value = DBL_MAX;
-		for (int i = 1; i <= nyears; i++)
-			if ((cf.at(cf_line, i)<min_value) && (cf.at(cf_line, i) != 0)) min_value = cf.at(cf_line, i);
-		return min_value;
+public:
+
+	cm_singleowner_uncertainty()
+	{
+		add_var_info(_cm_vtab_singleowner_uncertainty);
 	}
 
+	void exec() throw(general_error)
+	{
+		std::string model = as_string("uncertainty_model");
+		uncertainty_job job;
+		if (model == "singleowner" || model == "host_developer")
+		{
+			job.metrics[NPV] = "project_return_aftertax_npv";
+			job.metrics[IRR] = "project_return_aftertax_irr";
+		}
+		else if (model == "levpartflip" || model == "equpartflip" || model == "saleleaseback")
+		{
+			job.metrics[NPV] = "tax_investor_aftertax_npv";
+			job.metrics[IRR] = "tax_investor_aftertax_irr";
+		}
+		else
+			throw exec_error("singleowner_uncertainty", "unknown financial model " + model);
+		job.metrics[LCOE] = "lcoe_nom";
+		job.metrics[PPA] = "ppa";
+
+		// model inputs are parsed and copied once, then each thread copies them once
+		var_table inputs;
+		copy_module_inputs(model.c_str(), inputs);
 
-};
+		std::vector<std::string> names = util::split(as_string("uncertainty_inputs"), ",");
+		std::vector<var_data> base;
+		for (size_t k = 0; k < names.size(); k++)
+		{
+			names[k].erase(0, names[k].find_first_not_of(" \t"));
+			names[k].erase(names[k].find_last_not_of(" \t") + 1);
+			var_data *value = inputs.lookup(names[k]);
+			if (!value || (value->type != SSC_NUMBER && value->type != SSC_ARRAY && value->type != SSC_MATRIX))
+				throw exec_error("singleowner_uncertainty", util::format("%s is not a number, array or matrix input of %s", names[k].c_str(), model.c_str()));
+			base.push_back(*value);
+		}
+		size_t ninputs = names.size();
+		if (ninputs < 1)
+			throw exec_error("singleowner_uncertainty", "no inputs to vary");
 
+		util::matrix_t<double> multipliers;
+		if (is_assigned("uncertainty_samples"))
+		{
+			multipliers = as_matrix("uncertainty_samples");
+			if (multipliers.ncols() != ninputs)
+				throw exec_error("singleowner_uncertainty", util::format("uncertainty_samples must have %d columns, one per input", (int)ninputs));
+		}
+		else if (is_assigned("uncertainty_distributions"))
+		{
+			util::matrix_t<double> dist = as_matrix("uncertainty_distributions");
+			if (dist.nrows() != ninputs || dist.ncols() < 3)
+				throw exec_error("singleowner_uncertainty", util::format("uncertainty_distributions must have %d rows, one per input, and at least 3 columns", (int)ninputs));
+			for (size_t k = 0; k < ninputs; k++)
+			{
+				int type = (int)dist.at(k, 0);
+				double a = dist.at(k, 1), b = dist.at(k, 2), c = dist.ncols() > 3 ? dist.at(k, 3) : 0;
+				bool valid = (type == 0 && b >= 0) || (type == 1 && a <= b) || (type == 2 && dist.ncols() > 3 && a <= b && b <= c && a < c) || (type == 3 && a > 0 && b >= 0);
+				if (!valid)
+					throw exec_error("singleowner_uncertainty", util::format("invalid distribution for %s", names[k].c_str()));
+			}
 
+			// drawn here in sample order so results do not depend on the number of threads
+			size_t nsamples = (size_t)as_integer("uncertainty_nsamples");
+			std::mt19937 rng((unsigned int)as_integer("uncertainty_seed"));
+			multipliers.resize_fill(nsamples, ninputs, 1.0);
+			for (size_t i = 0; i < nsamples; i++)
+				for (size_t k = 0; k < ninputs; k++)
+					multipliers.at(i, k) = draw(rng, (int)dist.at(k, 0), dist.at(k, 1), dist.at(k, 2), dist.ncols() > 3 ? dist.at(k, 3) : 0);
+		}
+		else
+			throw exec_error("singleowner_uncertainty", "either uncertainty_samples or uncertainty_distributions must be assigned");
+
+		size_t nsamples = multipliers.nrows();
+		std::vector<int> status(nsamples, -1);
+		util::matrix_t<double> results(nsamples, NMETRICS, std::numeric_limits<double>::quiet_NaN());
+
+		int nthreads = as_integer("nthreads");
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads <= 0)
+			nthreads = 1;
+		int nworkers = (int)std::min((size_t)nthreads, nsamples);
+		if (nworkers < 1) nworkers = 1;
+
+		job.model = model.c_str();
+		job.inputs = &inputs;
+		job.names = &names;
+		job.base = &base;
+		job.multipliers = &multipliers;
+		job.status = &status;
+		job.results = &results;
+		job.stride = (size_t)nworkers;
+
+		std::vector<std::thread> threads;
+		for (int t = 1; t < nworkers; t++)
+		{
+			job.first = (size_t)t;
+			threads.push_back(std::thread(run_samples, job));
+		}
+		job.first = 0;
+		run_samples(job);
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		ssc_number_t *p_mult = allocate("uncertainty_multipliers", nsamples, ninputs);
+		ssc_number_t *p_status = allocate("uncertainty_status", nsamples);
+		ssc_number_t *p_metric[NMETRICS] = { allocate("uncertainty_npv", nsamples), allocate("uncertainty_irr", nsamples),
+			allocate("uncertainty_lcoe_nom", nsamples), allocate("uncertainty_ppa", nsamples) };
+		size_t nfailed = 0;
+		for (size_t i = 0; i < nsamples; i++)
+		{
+			for (size_t k = 0; k < ninputs; k++)
+				p_mult[i * ninputs + k] = (ssc_number_t)multipliers.at(i, k);
+			p_status[i] = (ssc_number_t)status[i];
+			for (int m = 0; m < NMETRICS; m++)
+				p_metric[m][i] = (ssc_number_t)results.at(i, m);
+			if (status[i] != 0) nfailed++;
+		}
+		if (nfailed > 0)
+			log(util::format("%d of %d samples failed and are left out of the percentiles", (int)nfailed, (int)nsamples), SSC_WARNING);
 
+		std::vector<double> pct;
+		if (is_assigned("uncertainty_percentiles"))
+		{
+			std::vector<ssc_number_t> p = as_vector_ssc_number_t("uncertainty_percentiles");
+			pct.assign(p.begin(), p.end());
+		}
+		else
+		{
+			pct.push_back(10);
+			pct.push_back(50);
+			pct.push_back(90);
+		}
 
-DEFINE_MODULE_ENTRY( singleowner, "DHF Single Owner Financial Model_", 1 );
+		// samples without a value, such as an IRR that does not exist, are left out of that metric only
+		ssc_number_t *p_table = allocate("uncertainty_percentile_table", pct.size(), NMETRICS + 1);
+		ssc_number_t *p_corr = allocate("uncertainty_correlation", ninputs, NMETRICS);
+		for (int m = 0; m < NMETRICS; m++)
+		{
+			std::vector<double> sorted;
+			for (size_t i = 0; i < nsamples; i++)
+				if (status[i] == 0 && std::isfinite(results.at(i, m)))
+					sorted.push_back(results.at(i, m));
+			std::sort(sorted.begin(), sorted.end());
+			for (size_t j = 0; j < pct.size(); j++)
+			{
+				p_table[j * (NMETRICS + 1)] = (ssc_number_t)pct[j];
+				p_table[j * (NMETRICS + 1) + m + 1] = (ssc_number_t)percentile(sorted, pct[j]);
+			}
 
+			for (size_t k = 0; k < ninputs; k++)
+			{
+				std::vector<double> x, y;
+				for (size_t i = 0; i < nsamples; i++)
+				{
+					if (status[i] == 0 && std::isfinite(results.at(i, m)))
+					{
+						x.push_back(multipliers.at(i, k));
+						y.push_back(results.at(i, m));
+					}
+				}
+				p_corr[k * NMETRICS + m] = (ssc_number_t)correlation(x, y);
+			}
+		}
+	}
+};
 
+DEFINE_MODULE_ENTRY(singleowner_uncertainty, "Monte Carlo uncertainty of the PPA financial models", 1)
@@ -50,6 +50,7 @@
 #include "core.h"
 #include <algorithm>
 #include <sstream>
+#include <thread>
 
 
   
@@ -61,8 +62,6 @@ static var_info vtab_utility_rate5[] = {
 
 	{ SSC_INPUT, SSC_NUMBER, "system_use_lifetime_output", "Lifetime hourly system outputs", "0/1", "0=hourly first year,1=hourly lifetime", "", "*", "INTEGER,MIN=0,MAX=1", "" },
 
-	{ SSC_INPUT, SSC_NUMBER, "TOU_demand_single_peak", "Use single monthly peak for TOU demand charge", "0/1", "0=use TOU peak,1=use flat peak", "", "?=0", "INTEGER,MIN=0,MAX=1", "" },
-	
 	// First year or lifetime hourly or subhourly
 	// load and gen expected to be > 0
 	// grid positive if system generation > load, negative otherwise
@@ -78,53 +77,7 @@ static var_info vtab_utility_rate5[] = {
 	{ SSC_INPUT, SSC_ARRAY, "degradation", "Annual energy degradation", "%", "", "AnnualOutput", "*", "", "" },
 	{ SSC_INPUT, SSC_ARRAY, "load_escalation", "Annual load escalation", "%/year", "", "", "?=0", "", "" },
 	{ SSC_INPUT,        SSC_ARRAY,      "rate_escalation",          "Annual electricity rate escalation",  "%/year", "",                      "",             "?=0",                       "",                              "" },
-	{ SSC_INPUT, SSC_NUMBER, "ur_metering_option", "Metering options", "0=Single meter with monthly rollover credits in kWh,1=Single meter with monthly rollover credits in $,2=Single meter with no monthly rollover credits (Net Billing),3=Single meter with monthly rollover credits in $ (Net Billing $),4=Two meters with all generation sold and all load purchased", "Net metering monthly excess", "", "?=0", "INTEGER,MIN=0,MAX=4", "" },
-
-	
-	{ SSC_INPUT, SSC_NUMBER, "ur_nm_yearend_sell_rate", "Year end sell rate", "$/kWh", "", "", "?=0.0", "", "" },
-	{ SSC_INPUT,        SSC_NUMBER,     "ur_monthly_fixed_charge",  "Monthly fixed charge",            "$",      "",                      "",             "?=0.0",                     "",                              "" },
-
-
-// optional input that allows sell rates to be overridden with buy rates - defaults to not override
-	{ SSC_INPUT, SSC_NUMBER, "ur_sell_eq_buy", "Set sell rate equal to buy rate", "0/1", "Optional override", "", "?=0", "BOOLEAN", "" },
-
-
-
-	// urdb minimums
-	{ SSC_INPUT, SSC_NUMBER, "ur_monthly_min_charge", "Monthly minimum charge", "$", "", "", "?=0.0", "", "" },
-	{ SSC_INPUT, SSC_NUMBER, "ur_annual_min_charge", "Annual minimum charge", "$", "", "", "?=0.0", "", "" },
-
-
-	// time step sell rates
-	{ SSC_INPUT, SSC_NUMBER, "ur_en_ts_sell_rate", "Enable time step sell rates", "0/1", "", "", "?=0", "BOOLEAN", "" },
-	{ SSC_INPUT, SSC_ARRAY, "ur_ts_sell_rate", "Time step sell rates", "0/1", "", "", "", "", "" },
-
-
-
-	// Energy Charge Inputs
-	{ SSC_INPUT, SSC_MATRIX, "ur_ec_sched_weekday", "Energy charge weekday schedule", "", "12x24", "", "*", "", "" },
-	{ SSC_INPUT, SSC_MATRIX, "ur_ec_sched_weekend", "Energy charge weekend schedule", "", "12x24", "", "*", "", "" },
-
-	// ur_ec_tou_mat has 6 columns period, tier, max usage, max usage units, buy rate, sell rate
-	// replaces 12(P)*6(T)*(max usage+buy+sell) = 216 single inputs
-	{ SSC_INPUT, SSC_MATRIX, "ur_ec_tou_mat", "Energy rates table", "", "", "", "*", "", "" },
-
-
-	// Demand Charge Inputs
-	{ SSC_INPUT,        SSC_NUMBER,     "ur_dc_enable",            "Enable demand charge",        "0/1",    "",                      "",             "?=0",                       "BOOLEAN",                       "" },
-	// TOU demand charge
-	{ SSC_INPUT, SSC_MATRIX, "ur_dc_sched_weekday", "Demand charge weekday schedule", "", "12x24", "", "", "", "" },
-	{ SSC_INPUT, SSC_MATRIX, "ur_dc_sched_weekend", "Demand charge weekend schedule", "", "12x24", "", "", "", "" },
-
-	// ur_dc_tou_mat has 4 columns period, tier, peak demand (kW), demand charge
-	// replaces 12(P)*6(T)*(peak+charge) = 144 single inputs
-	{ SSC_INPUT, SSC_MATRIX, "ur_dc_tou_mat", "Demand rates (TOU) table", "", "", "", "ur_dc_enable=1", "", "" },
-
-
-	// flat demand charge
-	// ur_dc_tou_flat has 4 columns month, tier, peak demand (kW), demand charge
-	// replaces 12(P)*6(T)*(peak+charge) = 144 single inputs
-	{ SSC_INPUT, SSC_MATRIX, "ur_dc_flat_mat", "Demand rates (flat) table", "", "", "", "ur_dc_enable=1", "", "" },
+	{ SSC_INPUT, SSC_NUMBER, "nthreads", "Number of threads for the years after the first", "", "0=all cores", "", "?=1", "INTEGER,MIN=0", "" },
 	
 
 	// outputs
@@ -353,6 +306,62 @@ static var_info vtab_utility_rate5[] = {
 
 	var_info_invalid };
 
+/* rate inputs, shared by the modules that bill with cm_utilityrate5 */
+static var_info vtab_ur_tariff[] = {
+
+/*   VARTYPE           DATATYPE         NAME                         LABEL                                           UNITS     META                      GROUP          REQUIRED_IF                 CONSTRAINTS                      UI_HINTS*/
+	{ SSC_INPUT, SSC_NUMBER, "TOU_demand_single_peak", "Use single monthly peak for TOU demand charge", "0/1", "0=use TOU peak,1=use flat peak", "", "?=0", "INTEGER,MIN=0,MAX=1", "" },
+
+	{ SSC_INPUT, SSC_NUMBER, "ur_metering_option", "Metering options", "0=Single meter with monthly rollover credits in kWh,1=Single meter with monthly rollover credits in $,2=Single meter with no monthly rollover credits (Net Billing),3=Single meter with monthly rollover credits in $ (Net Billing $),4=Two meters with all generation sold and all load purchased", "Net metering monthly excess", "", "?=0", "INTEGER,MIN=0,MAX=4", "" },
+
+	
+	{ SSC_INPUT, SSC_NUMBER, "ur_nm_yearend_sell_rate", "Year end sell rate", "$/kWh", "", "", "?=0.0", "", "" },
+	{ SSC_INPUT,        SSC_NUMBER,     "ur_monthly_fixed_charge",  "Monthly fixed charge",            "$",      "",                      "",             "?=0.0",                     "",                              "" },
+
+
+// optional input that allows sell rates to be overridden with buy rates - defaults to not override
+	{ SSC_INPUT, SSC_NUMBER, "ur_sell_eq_buy", "Set sell rate equal to buy rate", "0/1", "Optional override", "", "?=0", "BOOLEAN", "" },
+
+
+
+	// urdb minimums
+	{ SSC_INPUT, SSC_NUMBER, "ur_monthly_min_charge", "Monthly minimum charge", "$", "", "", "?=0.0", "", "" },
+	{ SSC_INPUT, SSC_NUMBER, "ur_annual_min_charge", "Annual minimum charge", "$", "", "", "?=0.0", "", "" },
+
+
+	// time step sell rates
+	{ SSC_INPUT, SSC_NUMBER, "ur_en_ts_sell_rate", "Enable time step sell rates", "0/1", "", "", "?=0", "BOOLEAN", "" },
+	{ SSC_INPUT, SSC_ARRAY, "ur_ts_sell_rate", "Time step sell rates", "0/1", "", "", "", "", "" },
+
+
+
+	// Energy Charge Inputs
+	{ SSC_INPUT, SSC_MATRIX, "ur_ec_sched_weekday", "Energy charge weekday schedule", "", "12x24", "", "*", "", "" },
+	{ SSC_INPUT, SSC_MATRIX, "ur_ec_sched_weekend", "Energy charge weekend schedule", "", "12x24", "", "*", "", "" },
+
+	// ur_ec_tou_mat has 6 columns period, tier, max usage, max usage units, buy rate, sell rate
+	// replaces 12(P)*6(T)*(max usage+buy+sell) = 216 single inputs
+	{ SSC_INPUT, SSC_MATRIX, "ur_ec_tou_mat", "Energy rates table", "", "", "", "*", "", "" },
+
+
+	// Demand Charge Inputs
+	{ SSC_INPUT,        SSC_NUMBER,     "ur_dc_enable",            "Enable demand charge",        "0/1",    "",                      "",             "?=0",                       "BOOLEAN",                       "" },
+	// TOU demand charge
+	{ SSC_INPUT, SSC_MATRIX, "ur_dc_sched_weekday", "Demand charge weekday schedule", "", "12x24", "", "", "", "" },
+	{ SSC_INPUT, SSC_MATRIX, "ur_dc_sched_weekend", "Demand charge weekend schedule", "", "12x24", "", "", "", "" },
+
+	// ur_dc_tou_mat has 4 columns period, tier, peak demand (kW), demand charge
+	// replaces 12(P)*6(T)*(peak+charge) = 144 single inputs
+	{ SSC_INPUT, SSC_MATRIX, "ur_dc_tou_mat", "Demand rates (TOU) table", "", "", "", "ur_dc_enable=1", "", "" },
+
+
+	// flat demand charge
+	// ur_dc_tou_flat has 4 columns month, tier, peak demand (kW), demand charge
+	// replaces 12(P)*6(T)*(peak+charge) = 144 single inputs
+	{ SSC_INPUT, SSC_MATRIX, "ur_dc_flat_mat", "Demand rates (flat) table", "", "", "", "ur_dc_enable=1", "", "" },
+
+	var_info_invalid };
+
 
 class ur_month
 {
@@ -402,9 +411,65 @@ public:
 
 };
 
+/* monthly charges and credits of one year from ur_calc or ur_calc_timestep */
+struct ur_monthly_bill
+{
+	ssc_number_t fixed[12], minimum[12], dc_fixed[12], dc_tou[12], ec[12], ec_gross[12],
+		excess_dollars_earned[12], excess_dollars_applied[12], excess_kwhs_earned[12], excess_kwhs_applied[12],
+		cumulative_excess_energy[12], cumulative_excess_dollars[12], bill[12];
+};
+
+/*
+Year one bill of one load and generation profile, and the time step work arrays of ur_calc,
+which are kept between calls so that billing many profiles does not reallocate them.
+*/
+struct ur_year_bill : public ur_monthly_bill
+{
+	std::vector<ssc_number_t> e_grid, p_grid, revenue, payment, income, demand_charge, energy_charge, dc_hourly_peak;
+
+	void resize(size_t nrec)
+	{
+		e_grid.resize(nrec);
+		p_grid.resize(nrec);
+		revenue.resize(nrec);
+		payment.resize(nrec);
+		income.resize(nrec);
+		demand_charge.resize(nrec);
+		energy_charge.resize(nrec);
+		dc_hourly_peak.resize(nrec);
+	}
+};
+
+/* year one load and the generation with their annual scaling, shared by all analysis years */
+struct ur_scaling
+{
+	const ssc_number_t *p_load; // kW, negative
+	const ssc_number_t *gen; // kW, year one or lifetime
+	size_t nrec_gen;
+	bool lifetime;
+	ssc_number_t ts_hour;
+	const ssc_number_t *load_scale, *sys_scale, *rate_scale;
+};
+
+/*
+Bills without and with the system of one analysis year calculated ahead of the serial pass
+over the years in exec(), with the messages logged while calculating them.  Years do not
+depend on each other: rollover credits are reconciled within each year.
+*/
+struct ur_year_result
+{
+	bool done;
+	std::string error;
+	std::vector<compute_module::log_item> logs;
+	ur_monthly_bill wo_sys, w_sys;
+	std::vector<ssc_number_t> revenue_wo_sys, revenue_w_sys;
+
+	ur_year_result() : done(false) { }
+};
+
 class cm_utilityrate5 : public compute_module
 {
-private:
+protected:
 	// schedule outputs
 	std::vector<int> m_ec_tou_sched;
 	std::vector<int> m_dc_tou_sched;
@@ -418,12 +483,35 @@ private:
 	std::vector<int> m_dc_tou_periods; // period number
 	std::vector<std::vector<int> >  m_dc_tou_periods_tiers; // tier numbers
 	std::vector<std::vector<int> >  m_dc_flat_tiers; // tier numbers for each month of flat demand charge
+	// row of each time step's period in m_month[].ec_periods and dc_periods, -1 if not found
+	std::vector<int> m_ec_tou_row;
+	std::vector<int> m_dc_tou_row;
 	size_t m_num_rec_yearly;
 
+	// billing options read by setup() for ur_calc and ur_calc_timestep
+	int m_metering_option;
+	bool m_dc_enable;
+	bool m_tou_demand_single_peak;
+	ssc_number_t m_annual_min_charge;
+	ssc_number_t m_monthly_min_charge;
+	ssc_number_t m_monthly_fixed_charge;
+	ssc_number_t m_nm_yearend_sell_rate;
+
+protected:
+	// for modules that bill with the rate inputs and have their own inputs and outputs
+	explicit cm_utilityrate5(var_info vtab[])
+		: m_num_rec_yearly(0)
+	{
+		add_var_info( vtab );
+		add_var_info( vtab_ur_tariff );
+	}
+
 public:
 	cm_utilityrate5()
+		: m_num_rec_yearly(0)
 	{
 		add_var_info( vtab_utility_rate5 );
+		add_var_info( vtab_ur_tariff );
 	}
 
 	void exec( ) throw( general_error )
@@ -432,6 +520,7 @@ public:
 		if (is_assigned("en_electricity_rates")) {
 			if (!as_boolean("en_electricity_rates")) {
 				remove_var_info(vtab_utility_rate5);
+				remove_var_info(vtab_ur_tariff);
 				return;
 			}
 		}
@@ -762,68 +851,42 @@ public:
 		bool timestep_reconciliation = (metering_option == 2 || metering_option == 3 || metering_option == 4);
 
 
+		ur_scaling scaling;
+		scaling.p_load = &p_load[0];
+		scaling.gen = pgen;
+		scaling.nrec_gen = nrec_gen;
+		scaling.lifetime = (as_integer("system_use_lifetime_output") == 1);
+		scaling.ts_hour = ts_hour_gen;
+		scaling.load_scale = &load_scale[0];
+		scaling.sys_scale = &sys_scale[0];
+		scaling.rate_scale = &rate_scale[0];
+
+		// years after the first are billed ahead on other threads and added up in order below
+		std::vector<ur_year_result> year_results;
+		calc_years_parallel(scaling, nyears, as_integer("nthreads"), year_results);
+
 		idx = 0;
 		for (i=0;i<nyears;i++)
 		{
-			for (j = 0; j<m_num_rec_yearly; j++)
-			{
-				/* for future implementation for lifetime loads
-				// update e_load and p_load per year if lifetime output
-				// lifetime load values? sell values
-				if ((as_integer("system_use_lifetime_output") == 1) && (idx < nrec_load))
-				{
-					e_load[j] = p_load[j] = 0.0;
-					for (size_t ii = 0; (ii < step_per_hour_load) && (idx < nrec_load); ii++)
-					{
-						ts_load = (bload ? pload[idx] : 0);
-						e_load[i] += ts_load * ts_hour_load;
-						p_load[i] = ((ts_load > p_load[i]) ? ts_load : p_load[i]);
-						idx++;
-					}
-					lifetime_hourly_load[i*8760 + j] = e_load[i];
-					// sign correction for utility rate calculations
-					e_load[i] = -e_load[i];
-					p_load[i] = -p_load[i];
-				}
-				*/
-				// apply load escalation appropriate for current year
-//				e_load_cy[j] = e_load[j] * load_scale[i];
-//				p_load_cy[j] = p_load[j] * load_scale[i];
-				e_load_cy[j] = p_load[j] * load_scale[i] * ts_hour_gen;
-				p_load_cy[j] = p_load[j] * load_scale[i];
-
-
-				// update e_sys per year if lifetime output
-				if ((as_integer("system_use_lifetime_output") == 1) && ( idx < nrec_gen ))
-				{
-//					e_sys[j] = p_sys[j] = 0.0;
-//					ts_power = (idx < nrec_gen) ? pgen[idx] : 0;
-//					e_sys[j] = ts_power * ts_hour_gen;
-//					p_sys[j] = ((ts_power > p_sys[j]) ? ts_power : p_sys[j]);
-					e_sys_cy[j] = pgen[idx] * ts_hour_gen;
-					p_sys_cy[j] = pgen[idx];
-					// until lifetime load fully implemented
-					lifetime_load[idx] = -e_load_cy[j];
-					idx++;
-				}
-				else
-				{
-					e_sys_cy[j] = pgen[j] * ts_hour_gen;
-					p_sys_cy[j] = pgen[j];
-				}
-				e_sys_cy[j] *= sys_scale[i];
-				p_sys_cy[j] *= sys_scale[i];
-				// calculate e_grid value (e_sys + e_load)
-//				e_sys_cy[j] = e_sys[j] * sys_scale[i];
-//				p_sys_cy[j] = p_sys[j] * sys_scale[i];
-				// note: load is assumed to have negative sign
-				e_grid_cy[j] = e_sys_cy[j] + e_load_cy[j];
-				p_grid_cy[j] = p_sys_cy[j] + p_load_cy[j];
-			}
+			scale_year(scaling, i, idx, &e_load_cy[0], &p_load_cy[0], &e_sys_cy[0], &p_sys_cy[0], &e_grid_cy[0], &p_grid_cy[0], lifetime_load);
+			const ur_year_result &year_result = year_results[i];
 
 
 			// now calculate revenue without solar system (using load only)
-			if (timestep_reconciliation)
+			if (year_result.done)
+			{
+				load_year_result(year_result, false, &revenue_wo_sys[0],
+					&monthly_fixed_charges[0], &monthly_minimum_charges[0],
+					&monthly_dc_fixed[0], &monthly_dc_tou[0],
+					&monthly_ec_charges[0],
+					&monthly_ec_charges_gross[0],
+					&monthly_excess_dollars_earned[0],
+					&monthly_excess_dollars_applied[0],
+					&monthly_excess_kwhs_earned[0],
+					&monthly_excess_kwhs_applied[0],
+					&monthly_cumulative_excess_energy[0], &monthly_cumulative_excess_dollars[0], &monthly_bill[0]);
+			}
+			else if (timestep_reconciliation)
 			{
 				ur_calc_timestep(&e_load_cy[0], &p_load_cy[0],
 					&revenue_wo_sys[0], &payment[0], &income[0], &demand_charge_wo_sys[0], &energy_charge_wo_sys[0],
@@ -969,7 +1032,20 @@ public:
 			
 // with system
 
-			if (timestep_reconciliation)
+			if (year_result.done)
+			{
+				load_year_result(year_result, true, &revenue_w_sys[0],
+					&monthly_fixed_charges[0], &monthly_minimum_charges[0],
+					&monthly_dc_fixed[0], &monthly_dc_tou[0],
+					&monthly_ec_charges[0],
+					&monthly_ec_charges_gross[0],
+					&monthly_excess_dollars_earned[0],
+					&monthly_excess_dollars_applied[0],
+					&monthly_excess_kwhs_earned[0],
+					&monthly_excess_kwhs_applied[0],
+					&monthly_cumulative_excess_energy[0], &monthly_cumulative_excess_dollars[0], &monthly_bill[0]);
+			}
+			else if (timestep_reconciliation)
 			{
 				if (two_meter)
 				{
@@ -1373,6 +1449,288 @@ public:
 	}
 
 	void setup()
+	{
+		m_metering_option = as_integer("ur_metering_option");
+		m_dc_enable = as_boolean("ur_dc_enable");
+		m_tou_demand_single_peak = (as_integer("TOU_demand_single_peak") == 1);
+		m_annual_min_charge = as_number("ur_annual_min_charge");
+		m_monthly_min_charge = as_number("ur_monthly_min_charge");
+		m_monthly_fixed_charge = as_number("ur_monthly_fixed_charge");
+		m_nm_yearend_sell_rate = as_number("ur_nm_yearend_sell_rate");
+
+		compile_tariff();
+		index_tariff_periods();
+	}
+
+	/* takes the rate set up by another module, so bills can be calculated without a data container */
+	void copy_tariff(const cm_utilityrate5 &rate)
+	{
+		m_num_rec_yearly = rate.m_num_rec_yearly;
+		m_metering_option = rate.m_metering_option;
+		m_dc_enable = rate.m_dc_enable;
+		m_tou_demand_single_peak = rate.m_tou_demand_single_peak;
+		m_annual_min_charge = rate.m_annual_min_charge;
+		m_monthly_min_charge = rate.m_monthly_min_charge;
+		m_monthly_fixed_charge = rate.m_monthly_fixed_charge;
+		m_nm_yearend_sell_rate = rate.m_nm_yearend_sell_rate;
+		m_month = rate.m_month;
+		m_ec_periods = rate.m_ec_periods;
+		m_ec_periods_tiers_init = rate.m_ec_periods_tiers_init;
+		m_dc_tou_periods = rate.m_dc_tou_periods;
+		m_dc_tou_periods_tiers = rate.m_dc_tou_periods_tiers;
+		m_dc_flat_tiers = rate.m_dc_flat_tiers;
+		m_ec_tou_sched = rate.m_ec_tou_sched;
+		m_dc_tou_sched = rate.m_dc_tou_sched;
+		m_ec_tou_row = rate.m_ec_tou_row;
+		m_dc_tou_row = rate.m_dc_tou_row;
+		m_ec_ts_sell_rate = rate.m_ec_ts_sell_rate;
+	}
+
+	/* year one bill of a load and generation (may be NULL) profile in kW with the steps per year
+	   of the rate, calculated as the "with system" bill of exec() */
+	void bill_year_one(const ssc_number_t *load, const ssc_number_t *gen, ur_year_bill &b) throw(general_error)
+	{
+		size_t j, steps_per_hour = m_num_rec_yearly / 8760;
+		ssc_number_t ts_hour = 1.0f / steps_per_hour;
+		bool two_meter = (m_metering_option == 4);
+
+		b.resize(m_num_rec_yearly);
+		for (j = 0; j < m_num_rec_yearly; j++)
+		{
+			// note: load is assumed to have negative sign
+			ssc_number_t p_load = -load[j];
+			ssc_number_t p_sys = (gen && !two_meter) ? gen[j] : 0;
+			b.e_grid[j] = p_sys * ts_hour + p_load * ts_hour;
+			b.p_grid[j] = p_sys + p_load;
+		}
+		calc_year(&b.e_grid[0], &b.p_grid[0], b, 1, 1, false);
+		if (!two_meter || !gen)
+			return;
+
+		// two meters: the system meter is billed on its own and added to the load meter
+		ssc_number_t load_meter[7][12];
+		for (int m = 0; m < 12; m++)
+		{
+			load_meter[0][m] = b.fixed[m];
+			load_meter[1][m] = b.minimum[m];
+			load_meter[2][m] = b.dc_fixed[m];
+			load_meter[3][m] = b.dc_tou[m];
+			load_meter[4][m] = b.ec[m];
+			load_meter[5][m] = b.ec_gross[m];
+			load_meter[6][m] = b.bill[m];
+		}
+		for (j = 0; j < m_num_rec_yearly; j++)
+		{
+			b.e_grid[j] = gen[j] * ts_hour;
+			b.p_grid[j] = gen[j];
+		}
+		calc_year(&b.e_grid[0], &b.p_grid[0], b, 1, 1, true);
+		for (int m = 0; m < 12; m++)
+		{
+			b.fixed[m] += load_meter[0][m];
+			b.minimum[m] += load_meter[1][m];
+			b.dc_fixed[m] += load_meter[2][m];
+			b.dc_tou[m] += load_meter[3][m];
+			b.ec[m] += load_meter[4][m];
+			b.ec_gross[m] += load_meter[5][m];
+			b.bill[m] += load_meter[6][m];
+		}
+	}
+
+	/* one year's bill of energy e_in (kWh) and power p_in (kW) into b, as exec() calculates it */
+	void calc_year(ssc_number_t *e_in, ssc_number_t *p_in, ur_year_bill &b, ssc_number_t rate_esc, size_t year, bool gen_only) throw(general_error)
+	{
+		bool timestep_reconciliation = (m_metering_option == 2 || m_metering_option == 3 || m_metering_option == 4);
+		if (timestep_reconciliation)
+		{
+			ur_calc_timestep(e_in, p_in,
+				&b.revenue[0], &b.payment[0], &b.income[0], &b.demand_charge[0], &b.energy_charge[0],
+				b.fixed, b.minimum, b.dc_fixed, b.dc_tou, b.ec, b.ec_gross,
+				b.excess_dollars_earned, b.excess_dollars_applied, b.excess_kwhs_earned, b.excess_kwhs_applied,
+				&b.dc_hourly_peak[0], b.cumulative_excess_energy, b.cumulative_excess_dollars, b.bill, rate_esc, !gen_only, !gen_only, gen_only);
+		}
+		else
+		{
+			ur_calc(e_in, p_in,
+				&b.revenue[0], &b.payment[0], &b.income[0], &b.demand_charge[0], &b.energy_charge[0],
+				b.fixed, b.minimum, b.dc_fixed, b.dc_tou, b.ec, b.ec_gross,
+				b.excess_dollars_earned, b.excess_dollars_applied, b.excess_kwhs_earned, b.excess_kwhs_applied,
+				&b.dc_hourly_peak[0], b.cumulative_excess_energy, b.cumulative_excess_dollars, b.bill, rate_esc, year, !gen_only, !gen_only, gen_only);
+		}
+	}
+
+	/* load, system and grid energy (kWh) and power (kW) of analysis year i, advancing the lifetime index idx */
+	void scale_year(const ur_scaling &sc, size_t i, size_t &idx,
+		ssc_number_t *e_load_cy, ssc_number_t *p_load_cy, ssc_number_t *e_sys_cy, ssc_number_t *p_sys_cy,
+		ssc_number_t *e_grid_cy, ssc_number_t *p_grid_cy, ssc_number_t *lifetime_load)
+	{
+		for (size_t j = 0; j < m_num_rec_yearly; j++)
+		{
+			// apply load escalation appropriate for current year
+			e_load_cy[j] = sc.p_load[j] * sc.load_scale[i] * sc.ts_hour;
+			p_load_cy[j] = sc.p_load[j] * sc.load_scale[i];
+
+			// update e_sys per year if lifetime output
+			if (sc.lifetime && (idx < sc.nrec_gen))
+			{
+				e_sys_cy[j] = sc.gen[idx] * sc.ts_hour;
+				p_sys_cy[j] = sc.gen[idx];
+				// until lifetime load fully implemented
+				if (lifetime_load)
+					lifetime_load[idx] = -e_load_cy[j];
+				idx++;
+			}
+			else
+			{
+				e_sys_cy[j] = sc.gen[j] * sc.ts_hour;
+				p_sys_cy[j] = sc.gen[j];
+			}
+			e_sys_cy[j] *= sc.sys_scale[i];
+			p_sys_cy[j] *= sc.sys_scale[i];
+			// note: load is assumed to have negative sign
+			e_grid_cy[j] = e_sys_cy[j] + e_load_cy[j];
+			p_grid_cy[j] = p_sys_cy[j] + p_load_cy[j];
+		}
+	}
+
+	struct year_job
+	{
+		cm_utilityrate5 *rate;
+		const ur_scaling *scaling;
+		std::vector<ur_year_result> *results;
+		size_t first, stride;
+	};
+
+	/* bills every stride-th year from first on, the way the serial pass in exec() would */
+	static void calc_years(year_job job)
+	{
+		cm_utilityrate5 &rate = *job.rate;
+		std::vector<ur_year_result> &results = *job.results;
+		size_t nrec = rate.m_num_rec_yearly;
+		bool two_meter = (rate.m_metering_option == 4);
+		std::vector<ssc_number_t> e_load(nrec), p_load(nrec), e_sys(nrec), p_sys(nrec), e_grid(nrec), p_grid(nrec);
+		ur_year_bill b;
+		b.resize(nrec);
+
+		for (size_t i = job.first; i < results.size(); i += job.stride)
+		{
+			ur_year_result &r = results[i];
+			rate.clear_log();
+			try
+			{
+				size_t idx = i * nrec;
+				rate.scale_year(*job.scaling, i, idx, &e_load[0], &p_load[0], &e_sys[0], &p_sys[0], &e_grid[0], &p_grid[0], 0);
+				ssc_number_t rate_esc = job.scaling->rate_scale[i];
+
+				rate.calc_year(&e_load[0], &p_load[0], b, rate_esc, i + 1, false);
+				r.wo_sys = b;
+				r.revenue_wo_sys = b.revenue;
+				if (two_meter)
+					rate.calc_year(&e_sys[0], &p_sys[0], b, rate_esc, i + 1, true);
+				else
+					rate.calc_year(&e_grid[0], &p_grid[0], b, rate_esc, i + 1, false);
+				r.w_sys = b;
+				r.revenue_w_sys = b.revenue;
+			}
+			catch (general_error &e)
+			{
+				r.error = e.err_text;
+			}
+			compute_module::log_item *item;
+			for (int k = 0; (item = rate.log(k)) != 0; k++)
+				r.logs.push_back(*item);
+			r.done = true;
+		}
+	}
+
+	/* bills the years after the first on nthreads threads, each with its own copy of the rate */
+	void calc_years_parallel(const ur_scaling &scaling, size_t nyears, int nthreads, std::vector<ur_year_result> &results)
+	{
+		results.resize(nyears);
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		size_t nworkers = std::min((size_t)std::max(nthreads, 1), nyears - 1);
+		if (nworkers < 2)
+			return;
+
+		std::vector<cm_utilityrate5> workers(nworkers);
+		std::vector<std::thread> threads;
+		year_job job;
+		job.scaling = &scaling;
+		job.results = &results;
+		job.stride = nworkers;
+		for (size_t t = 0; t < nworkers; t++)
+		{
+			workers[t].copy_tariff(*this);
+			job.rate = &workers[t];
+			job.first = 1 + t;
+			threads.push_back(std::thread(calc_years, job));
+		}
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+	}
+
+	/* monthly outputs of a year billed by calc_years, into the arrays the serial pass uses */
+	void load_year_result(const ur_year_result &r, bool w_sys, ssc_number_t *revenue,
+		ssc_number_t monthly_fixed_charges[12], ssc_number_t monthly_minimum_charges[12],
+		ssc_number_t monthly_dc_fixed[12], ssc_number_t monthly_dc_tou[12],
+		ssc_number_t monthly_ec_charges[12], ssc_number_t monthly_ec_charges_gross[12],
+		ssc_number_t excess_dollars_earned[12], ssc_number_t excess_dollars_applied[12],
+		ssc_number_t excess_kwhs_earned[12], ssc_number_t excess_kwhs_applied[12],
+		ssc_number_t monthly_cumulative_excess_energy[12], ssc_number_t monthly_cumulative_excess_dollars[12],
+		ssc_number_t monthly_bill[12]) throw(general_error)
+	{
+		if (!w_sys)
+		{
+			for (size_t k = 0; k < r.logs.size(); k++)
+				log(r.logs[k].text, r.logs[k].type, r.logs[k].time);
+			if (!r.error.empty())
+				throw general_error(r.error);
+		}
+
+		const ur_monthly_bill &b = w_sys ? r.w_sys : r.wo_sys;
+		const std::vector<ssc_number_t> &rev = w_sys ? r.revenue_w_sys : r.revenue_wo_sys;
+		std::copy(rev.begin(), rev.end(), revenue);
+		for (int m = 0; m < 12; m++)
+		{
+			monthly_fixed_charges[m] = b.fixed[m];
+			monthly_minimum_charges[m] = b.minimum[m];
+			monthly_dc_fixed[m] = b.dc_fixed[m];
+			monthly_dc_tou[m] = b.dc_tou[m];
+			monthly_ec_charges[m] = b.ec[m];
+			monthly_ec_charges_gross[m] = b.ec_gross[m];
+			excess_dollars_earned[m] = b.excess_dollars_earned[m];
+			excess_dollars_applied[m] = b.excess_dollars_applied[m];
+			excess_kwhs_earned[m] = b.excess_kwhs_earned[m];
+			excess_kwhs_applied[m] = b.excess_kwhs_applied[m];
+			monthly_cumulative_excess_energy[m] = b.cumulative_excess_energy[m];
+			monthly_cumulative_excess_dollars[m] = b.cumulative_excess_dollars[m];
+			monthly_bill[m] = b.bill[m];
+		}
+	}
+
+	/* row of each time step's energy and demand period in its month's period list */
+	void index_tariff_periods()
+	{
+		size_t steps_per_hour = m_num_rec_yearly / 8760;
+		m_ec_tou_row.assign(m_num_rec_yearly, -1);
+		m_dc_tou_row.assign(m_num_rec_yearly, -1);
+		size_t c = 0;
+		for (size_t m = 0; m < m_month.size(); m++)
+		{
+			for (size_t step = 0; step < util::nday[m] * 24 * steps_per_hour && c < m_num_rec_yearly; step++, c++)
+			{
+				std::vector<int>::iterator ec = std::find(m_month[m].ec_periods.begin(), m_month[m].ec_periods.end(), m_ec_tou_sched[c]);
+				if (ec != m_month[m].ec_periods.end())
+					m_ec_tou_row[c] = (int)(ec - m_month[m].ec_periods.begin());
+				std::vector<int>::iterator dc = std::find(m_month[m].dc_periods.begin(), m_month[m].dc_periods.end(), m_dc_tou_sched[c]);
+				if (dc != m_month[m].dc_periods.end())
+					m_dc_tou_row[c] = (int)(dc - m_month[m].dc_periods.begin());
+			}
+		}
+	}
+
+	void compile_tariff()
 	{
 		size_t nrows, ncols, r, c, m, i, j;
 		int period, tier, month;
@@ -1923,15 +2281,15 @@ public:
 		3=Two meters with all generation sold and all load purchaseded
 		4=Single meter with monthly rollover credits in $ (Net Billing $)
 		*/
-		int metering_option = as_integer("ur_metering_option");
+		int metering_option = m_metering_option;
 		bool enable_nm = (metering_option == 0 || metering_option == 1);
 
 		bool ec_enabled = true; // per 2/25/16 meeting
-		bool dc_enabled = as_boolean("ur_dc_enable");
+		bool dc_enabled = m_dc_enable;
 
-		bool excess_monthly_dollars = (as_integer("ur_metering_option") == 1);
+		bool excess_monthly_dollars = (m_metering_option == 1);
 
-		bool tou_demand_single_peak = (as_integer("TOU_demand_single_peak") == 1);
+		bool tou_demand_single_peak = m_tou_demand_single_peak;
 
 
 		size_t steps_per_hour = m_num_rec_yearly / 8760;
@@ -1944,6 +2302,12 @@ public:
 			m_month[m].hours_per_month = 0;
 			m_month[m].dc_flat_peak = 0;
 			m_month[m].dc_flat_peak_hour = 0;
+			// TOU peaks are tracked in the same pass - no tier accumulation
+			if (dc_enabled)
+			{
+				m_month[m].dc_tou_peak.assign(m_month[m].dc_periods.size(), 0);
+				m_month[m].dc_tou_peak_hour.assign(m_month[m].dc_periods.size(), 0);
+			}
 			for (d = 0; d < util::nday[m]; d++)
 			{
 				for (h = 0; h < 24; h++)
@@ -1960,6 +2324,21 @@ public:
 							m_month[m].dc_flat_peak = -p_in[c];
 							m_month[m].dc_flat_peak_hour = c;
 						}
+						if (dc_enabled)
+						{
+							int row = m_dc_tou_row[c];
+							if (row < 0)
+							{
+								std::ostringstream ss;
+								ss << "Demand rate Period " << m_dc_tou_sched[c] << " not found for Month " << m << ".";
+								throw exec_error("utilityrate5", ss.str());
+							}
+							if (p_in[c] < 0 && p_in[c] < -m_month[m].dc_tou_peak[row])
+							{
+								m_month[m].dc_tou_peak[row] = -p_in[c];
+								m_month[m].dc_tou_peak_hour[row] = c;
+							}
+						}
 						c++;
 					}
 				}
@@ -2110,15 +2489,13 @@ public:
 						for (s = 0; s < (int)steps_per_hour && c < (int)m_num_rec_yearly; s++)
 						{
 							mon_e_net += e_in[c];
-							int toup = m_ec_tou_sched[c];
-							std::vector<int>::iterator per_num = std::find(m_month[m].ec_periods.begin(), m_month[m].ec_periods.end(), toup);
-							if (per_num == m_month[m].ec_periods.end())
+							int row = m_ec_tou_row[c];
+							if (row < 0)
 							{
 								std::ostringstream ss;
-								ss << "Energy rate TOU Period " << toup << " not found for Month " << util::schedule_int_to_month(m) << ".";
+								ss << "Energy rate TOU Period " << m_ec_tou_sched[c] << " not found for Month " << util::schedule_int_to_month(m) << ".";
 								throw exec_error("utilityrate5", ss.str());
 							}
-							int row = (int)(per_num - m_month[m].ec_periods.begin());
 							// place all in tier 0 initially and then update appropriately
 							// net energy per period per month
 							m_month[m].ec_energy_use(row, 0) += e_in[c];
@@ -2286,45 +2663,6 @@ public:
 			} // end month
 		}
 
-		// set peak per period - no tier accumulation
-		if (dc_enabled)
-		{
-			c = 0;
-			for (m = 0; m < (int)m_month.size(); m++)
-			{
-				m_month[m].dc_tou_peak.clear();
-				m_month[m].dc_tou_peak_hour.clear();
-				for (i = 0; i < (int)m_month[m].dc_periods.size(); i++)
-				{
-					m_month[m].dc_tou_peak.push_back(0);
-					m_month[m].dc_tou_peak_hour.push_back(0);
-				}
-				for (d = 0; d < util::nday[m]; d++)
-				{
-					for (h = 0; h < 24; h++)
-					{
-						for (s = 0; s < (int)steps_per_hour && c < (int)m_num_rec_yearly; s++)
-						{
-							int todp = m_dc_tou_sched[c];
-							std::vector<int>::iterator per_num = std::find(m_month[m].dc_periods.begin(), m_month[m].dc_periods.end(), todp);
-							if (per_num == m_month[m].dc_periods.end())
-							{
-								std::ostringstream ss;
-								ss << "Demand rate Period " << todp << " not found for Month " << m << ".";
-								throw exec_error("utilityrate5", ss.str());
-							}
-							int row = (int)(per_num - m_month[m].dc_periods.begin());
-							if (p_in[c] < 0 && p_in[c] < -m_month[m].dc_tou_peak[row])
-							{
-								m_month[m].dc_tou_peak[row] = -p_in[c];
-								m_month[m].dc_tou_peak_hour[row] = c;
-							}
-							c++;
-						}
-					}
-				}
-			}
-		}
 
 
 		
@@ -2569,9 +2907,9 @@ public:
 		// compute revenue ( = income - payment ) and monthly bill ( = payment - income) and apply fixed and minimum charges
 		c = 0;
 		ssc_number_t mon_bill = 0, ann_bill = 0;
-		ssc_number_t ann_min_charge = as_number("ur_annual_min_charge")*rate_esc;
-		ssc_number_t mon_min_charge = as_number("ur_monthly_min_charge")*rate_esc;
-		ssc_number_t mon_fixed = as_number("ur_monthly_fixed_charge")*rate_esc;
+		ssc_number_t ann_min_charge = m_annual_min_charge*rate_esc;
+		ssc_number_t mon_min_charge = m_monthly_min_charge*rate_esc;
+		ssc_number_t mon_fixed = m_monthly_fixed_charge*rate_esc;
 
 		// process one month at a time
 		for (m = 0; m < 12; m++)
@@ -2619,7 +2957,7 @@ public:
 									// monthly rollover with year end sell at reduced rate
 									if (!excess_monthly_dollars && (monthly_cumulative_excess_energy[11] > 0))
 									{
-										ssc_number_t year_end_dollars = monthly_cumulative_excess_energy[11] * as_number("ur_nm_yearend_sell_rate")*rate_esc;
+										ssc_number_t year_end_dollars = monthly_cumulative_excess_energy[11] * m_nm_yearend_sell_rate*rate_esc;
 										income[8759] += year_end_dollars;
 										monthly_cumulative_excess_dollars[11] = year_end_dollars;
 										excess_dollars_earned[11] += year_end_dollars;
@@ -2690,7 +3028,7 @@ public:
 		ssc_number_t monthly_deficit_energy;
 
 		bool ec_enabled = true; // per 2/25/16 meeting
-		bool dc_enabled = as_boolean("ur_dc_enable");
+		bool dc_enabled = m_dc_enable;
 
 		/*
 		0=Single meter with monthly rollover credits in kWh
@@ -2700,9 +3038,9 @@ public:
 		4=Two meters with all generation sold and all load purchaseded
 		*/
 		//int metering_option = as_integer("ur_metering_option");
-		bool excess_monthly_dollars = (as_integer("ur_metering_option") == 3);
+		bool excess_monthly_dollars = (m_metering_option == 3);
 
-		bool tou_demand_single_peak = (as_integer("TOU_demand_single_peak") == 1);
+		bool tou_demand_single_peak = m_tou_demand_single_peak;
 
 
 		size_t steps_per_hour = m_num_rec_yearly / 8760;
@@ -2717,6 +3055,12 @@ public:
 			m_month[m].hours_per_month = 0;
 			m_month[m].dc_flat_peak = 0;
 			m_month[m].dc_flat_peak_hour = 0;
+			// TOU peaks are tracked in the same pass - no tier accumulation
+			if (dc_enabled)
+			{
+				m_month[m].dc_tou_peak.assign(m_month[m].dc_periods.size(), 0);
+				m_month[m].dc_tou_peak_hour.assign(m_month[m].dc_periods.size(), 0);
+			}
 			for (d = 0; d < util::nday[m]; d++)
 			{
 				for (h = 0; h < 24; h++)
@@ -2733,6 +3077,21 @@ public:
 							m_month[m].dc_flat_peak = -p_in[c];
 							m_month[m].dc_flat_peak_hour = (int)c;
 						}
+						if (dc_enabled)
+						{
+							int row = m_dc_tou_row[c];
+							if (row < 0)
+							{
+								std::ostringstream ss;
+								ss << "Demand charge Period " << m_dc_tou_sched[c] << " not found for Month " << m << ".";
+								throw exec_error("utilityrate5", ss.str());
+							}
+							if (p_in[c] < 0 && p_in[c] < -m_month[m].dc_tou_peak[row])
+							{
+								m_month[m].dc_tou_peak[row] = -p_in[c];
+								m_month[m].dc_tou_peak_hour[row] = (int)c;
+							}
+						}
 						c++;
 					}
 				}
@@ -2845,45 +3204,6 @@ public:
 		}
 
 
-		// set peak per period - no tier accumulation
-		if (dc_enabled)
-		{
-			c = 0;
-			for (m = 0; m < (int)m_month.size(); m++)
-			{
-				m_month[m].dc_tou_peak.clear();
-				m_month[m].dc_tou_peak_hour.clear();
-				for (i = 0; i < (int)m_month[m].dc_periods.size(); i++)
-				{
-					m_month[m].dc_tou_peak.push_back(0);
-					m_month[m].dc_tou_peak_hour.push_back(0);
-				}
-				for (d = 0; d < util::nday[m]; d++)
-				{
-					for (h = 0; h < 24; h++)
-					{
-						for (s = 0; s < (int)steps_per_hour && c < (int)m_num_rec_yearly; s++)
-						{
-							int todp = m_dc_tou_sched[c];
-							std::vector<int>::iterator per_num = std::find(m_month[m].dc_periods.begin(), m_month[m].dc_periods.end(), todp);
-							if (per_num == m_month[m].dc_periods.end())
-							{
-								std::ostringstream ss;
-								ss << "Demand charge Period " << todp << " not found for Month " << m << ".";
-								throw exec_error("utilityrate5", ss.str());
-							}
-							int row = (int)(per_num - m_month[m].dc_periods.begin());
-							if (p_in[c] < 0 && p_in[c] < -m_month[m].dc_tou_peak[row])
-							{
-								m_month[m].dc_tou_peak[row] = -p_in[c];
-								m_month[m].dc_tou_peak_hour[row] = (int)c;
-							}
-							c++;
-						}
-					}
-				}
-			}
-		}
 
 // main loop
 		c = 0; // hourly count
@@ -2905,16 +3225,15 @@ public:
 						if (ec_enabled)
 						{
 							period = m_ec_tou_sched[c];
-							// find corresponding monthly period
+							// corresponding monthly period
 							// check for valid period
-							std::vector<int>::iterator per_num = std::find(m_month[m].ec_periods.begin(), m_month[m].ec_periods.end(), period);
-							if (per_num == m_month[m].ec_periods.end())
+							int row = m_ec_tou_row[c];
+							if (row < 0)
 							{
 								std::ostringstream ss;
 								ss << "Energy rate Period " << period << " not found for Month " << m << ".";
 								throw exec_error("utilityrate5", ss.str());
 							}
-							int row = (int)(per_num - m_month[m].ec_periods.begin());
 
 							if (e_in[c] >= 0.0)
 							{ // calculate income or credit
@@ -3172,9 +3491,9 @@ public:
 		// compute revenue ( = income - payment ) and monthly bill ( = payment - income) and apply fixed and minimum charges
 		c = 0;
 		ssc_number_t mon_bill = 0, ann_bill = 0;
-		ssc_number_t ann_min_charge = as_number("ur_annual_min_charge")*rate_esc;
-		ssc_number_t mon_min_charge = as_number("ur_monthly_min_charge")*rate_esc;
-		ssc_number_t mon_fixed = as_number("ur_monthly_fixed_charge")*rate_esc;
+		ssc_number_t ann_min_charge = m_annual_min_charge*rate_esc;
+		ssc_number_t mon_min_charge = m_monthly_min_charge*rate_esc;
+		ssc_number_t mon_fixed = m_monthly_fixed_charge*rate_esc;
 
 		// process one month at a time
 		for (m = 0; m < 12; m++)
@@ -3329,4 +3648,234 @@ public:
 
 DEFINE_MODULE_ENTRY( utilityrate5, "Complex utility rate structure net revenue calculator OpenEI Version 4 with net billing", 1 );
 
+///////////////////////////////////////////////////
+static var_info vtab_utility_rate5_fleet[] = {
+/*   VARTYPE           DATATYPE         NAME                         LABEL                                           UNITS     META                      GROUP          REQUIRED_IF                 CONSTRAINTS                      UI_HINTS*/
+	{ SSC_INPUT, SSC_MATRIX, "fleet_load", "Electricity load of each customer (year 1)", "kW", "One row per customer", "Fleet", "", "", "" },
+	{ SSC_INPUT, SSC_MATRIX, "fleet_gen", "System power generated for each customer", "kW", "One row per customer, or one row for all customers", "Fleet", "", "", "" },
+	{ SSC_INPUT, SSC_STRING, "fleet_load_file", "Electricity load file", "kW", "Binary 32-bit floats, one year profile per customer after the other", "Fleet", "", "", "" },
+	{ SSC_INPUT, SSC_STRING, "fleet_gen_file", "System power generated file", "kW", "Same layout as fleet_load_file", "Fleet", "", "", "" },
+	{ SSC_INPUT, SSC_NUMBER, "fleet_steps_per_hour", "Time steps per hour of the profile files", "", "", "Fleet", "?=1", "INTEGER,MIN=1,MAX=60", "" },
+	{ SSC_INPUT, SSC_NUMBER, "nthreads", "Number of threads", "", "0=all cores", "Fleet", "?=0", "INTEGER,MIN=0", "" },
+
+	{ SSC_OUTPUT, SSC_MATRIX, "fleet_bill_ym", "Electricity bill of each customer by month (year 1)", "$", "One row per customer", "Fleet", "*", "", "" },
+	{ SSC_OUTPUT, SSC_MATRIX, "fleet_charge_ec_ym", "Energy charge of each customer by month (year 1)", "$", "One row per customer", "Fleet", "*", "", "" },
+	{ SSC_OUTPUT, SSC_MATRIX, "fleet_charge_dc_fixed_ym", "Fixed demand charge of each customer by month (year 1)", "$", "One row per customer", "Fleet", "*", "", "" },
+	{ SSC_OUTPUT, SSC_MATRIX, "fleet_charge_dc_tou_ym", "TOU demand charge of each customer by month (year 1)", "$", "One row per customer", "Fleet", "*", "", "" },
+	{ SSC_OUTPUT, SSC_ARRAY, "fleet_bill", "Electricity bill of each customer (year 1)", "$", "", "Fleet", "*", "", "" },
+
+	var_info_invalid };
+
+/*
+Year one bills of many customers on one rate.  The rate is set up once, and each thread bills
+its share of the customers with its own copy.  Profiles come from matrices, or are read from
+files a batch of customers at a time so that memory does not grow with the number of customers.
+*/
+class cm_utilityrate5_fleet : public cm_utilityrate5
+{
+private:
+	enum { batch_customers = 256 };
+
+	/* a source of profiles, one row per customer */
+	struct fleet_profiles
+	{
+		ssc_number_t *matrix;
+		size_t nrows;
+		FILE *fp;
+		std::vector<ssc_number_t> buffer;
+
+		fleet_profiles() : matrix(0), nrows(0), fp(0) { }
+		~fleet_profiles() { if (fp) fclose(fp); }
+
+		const ssc_number_t *row(size_t customer, size_t batch_first, size_t nrec) const
+		{
+			if (fp)
+				return &buffer[(customer - batch_first) * nrec];
+			return matrix + (nrows == 1 ? 0 : customer) * nrec;
+		}
+	};
+
+	struct fleet_worker
+	{
+		cm_utilityrate5 rate;
+		ur_year_bill bill;
+		std::string error;
+		std::vector< std::pair<size_t, compute_module::log_item> > logs; // first message of each customer in the batch
+	};
+
+	struct fleet_job
+	{
+		fleet_worker *worker;
+		const fleet_profiles *load;
+		const fleet_profiles *gen;
+		size_t batch_first; // first customer in the profile buffers
+		size_t first, last, stride, nrec;
+		ssc_number_t *bill_ym, *ec_ym, *dc_fixed_ym, *dc_tou_ym, *bill;
+	};
+
+	static void bill_customers(fleet_job job)
+	{
+		fleet_worker &w = *job.worker;
+		try
+		{
+			for (size_t i = job.first; i < job.last; i += job.stride)
+			{
+				// only the first message of a customer is kept so the log does not grow with the fleet
+				w.rate.clear_log();
+				w.rate.bill_year_one(job.load->row(i, job.batch_first, job.nrec),
+					job.gen ? job.gen->row(i, job.batch_first, job.nrec) : 0, w.bill);
+				if (compute_module::log_item *item = w.rate.log(0))
+					w.logs.push_back(std::make_pair(i, *item));
+
+				job.bill[i] = 0;
+				for (size_t m = 0; m < 12; m++)
+				{
+					job.bill_ym[i * 12 + m] = w.bill.bill[m];
+					job.ec_ym[i * 12 + m] = w.bill.ec[m];
+					job.dc_fixed_ym[i * 12 + m] = w.bill.dc_fixed[m];
+					job.dc_tou_ym[i * 12 + m] = w.bill.dc_tou[m];
+					job.bill[i] += w.bill.bill[m];
+				}
+			}
+		}
+		catch (general_error &e)
+		{
+			w.error = e.err_text;
+		}
+	}
+
+	/* opens a profile file, returns the number of customers in it */
+	size_t open_profiles(const char *name, fleet_profiles &p, size_t nrec)
+	{
+		std::string file = as_string(name);
+		p.fp = fopen(file.c_str(), "rb");
+		if (!p.fp)
+			throw exec_error("utilityrate5_fleet", "could not open " + file);
+		fseek(p.fp, 0, SEEK_END);
+		long size = ftell(p.fp);
+		fseek(p.fp, 0, SEEK_SET);
+		size_t profile_size = nrec * sizeof(ssc_number_t);
+		if (size < 0 || (size_t)size % profile_size != 0)
+			throw exec_error("utilityrate5_fleet", util::format("%s must hold whole profiles of %d values", file.c_str(), (int)nrec));
+		return (size_t)size / profile_size;
+	}
+
+	void read_profiles(fleet_profiles &p, size_t count, size_t nrec)
+	{
+		p.buffer.resize(count * nrec);
+		if (fread(&p.buffer[0], sizeof(ssc_number_t), count * nrec, p.fp) != count * nrec)
+			throw exec_error("utilityrate5_fleet", "could not read profile file");
+	}
+
+public:
+	cm_utilityrate5_fleet()
+		: cm_utilityrate5(vtab_utility_rate5_fleet)
+	{
+	}
+
+	void exec() throw(general_error)
+	{
+		fleet_profiles load, gen;
+		bool from_file = is_assigned("fleet_load_file");
+		bool bgen = from_file ? is_assigned("fleet_gen_file") : is_assigned("fleet_gen");
+		size_t ncustomers, nrec, ncols;
+
+		if (from_file)
+		{
+			nrec = 8760 * (size_t)as_integer("fleet_steps_per_hour");
+			ncustomers = open_profiles("fleet_load_file", load, nrec);
+			if (bgen && open_profiles("fleet_gen_file", gen, nrec) != ncustomers)
+				throw exec_error("utilityrate5_fleet", "fleet_gen_file must have a profile for each customer");
+		}
+		else
+		{
+			if (!is_assigned("fleet_load"))
+				throw exec_error("utilityrate5_fleet", "fleet_load or fleet_load_file must be assigned");
+			load.matrix = as_matrix("fleet_load", &load.nrows, &nrec);
+			ncustomers = load.nrows;
+			if (bgen)
+			{
+				gen.matrix = as_matrix("fleet_gen", &gen.nrows, &ncols);
+				if (ncols != nrec || (gen.nrows != 1 && gen.nrows != ncustomers))
+					throw exec_error("utilityrate5_fleet", "fleet_gen must have the columns of fleet_load and one row or a row for each customer");
+			}
+		}
+		size_t steps_per_hour = nrec / 8760;
+		if (steps_per_hour < 1 || steps_per_hour > 60 || steps_per_hour * 8760 != nrec)
+			throw exec_error("utilityrate5_fleet", util::format("invalid number of profile records (%d): must be an integer multiple of 8760", (int)nrec));
+
+		// rate tables are compiled here once, each worker bills with a copy
+		m_num_rec_yearly = nrec;
+		setup();
+
+		int nthreads = as_integer("nthreads");
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads <= 0)
+			nthreads = 1;
+		size_t nworkers = std::max((size_t)1, std::min((size_t)nthreads, ncustomers));
+		std::vector<fleet_worker> workers(nworkers);
+		for (size_t t = 0; t < nworkers; t++)
+			workers[t].rate.copy_tariff(*this);
+
+		fleet_job job;
+		job.load = &load;
+		job.gen = bgen ? &gen : 0;
+		job.nrec = nrec;
+		job.stride = nworkers;
+		job.bill_ym = allocate("fleet_bill_ym", ncustomers, 12);
+		job.ec_ym = allocate("fleet_charge_ec_ym", ncustomers, 12);
+		job.dc_fixed_ym = allocate("fleet_charge_dc_fixed_ym", ncustomers, 12);
+		job.dc_tou_ym = allocate("fleet_charge_dc_tou_ym", ncustomers, 12);
+		job.bill = allocate("fleet_bill", ncustomers);
+
+		size_t batch = from_file ? (size_t)batch_customers : ncustomers;
+		for (size_t first = 0; first < ncustomers; first += batch)
+		{
+			size_t last = std::min(first + batch, ncustomers);
+			if (from_file)
+			{
+				read_profiles(load, last - first, nrec);
+				if (bgen)
+					read_profiles(gen, last - first, nrec);
+			}
+
+			job.batch_first = first;
+			std::vector<std::thread> threads;
+			for (size_t t = 1; t < nworkers; t++)
+			{
+				job.worker = &workers[t];
+				job.first = first + t;
+				job.last = last;
+				threads.push_back(std::thread(bill_customers, job));
+			}
+			job.worker = &workers[0];
+			job.first = first;
+			job.last = last;
+			bill_customers(job);
+			for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+
+			for (size_t t = 0; t < nworkers; t++)
+				if (!workers[t].error.empty())
+					throw exec_error("utilityrate5_fleet", workers[t].error);
+
+			// forward the batch's messages in customer order, customer i was billed by worker (i - first) % nworkers
+			std::vector<size_t> next(nworkers, 0);
+			for (size_t i = first; i < last; i++)
+			{
+				fleet_worker &w = workers[(i - first) % nworkers];
+				size_t &k = next[(i - first) % nworkers];
+				if (k < w.logs.size() && w.logs[k].first == i)
+				{
+					log(util::format("customer %d: ", (int)i) + w.logs[k].second.text, w.logs[k].second.type, w.logs[k].second.time);
+					k++;
+				}
+			}
+			for (size_t t = 0; t < nworkers; t++)
+				workers[t].logs.clear();
+		}
+	}
+};
 
+DEFINE_MODULE_ENTRY( utilityrate5_fleet, "Year one bills of many load and generation profiles with one utility rate", 1 );
@@ -53,6 +53,8 @@
 #include "common.h"
 #include "lib_util.h"
 #include "cmod_windpower.h"
+#include <algorithm>
+#include <thread>
 
 static var_info _cm_vtab_windpower[] = {
 	// VARTYPE   DATATYPE		NAME								LABEL										UNITS		META	GROUP			REQUIRED_IF						CONSTRAINTS                                        UI_HINTS
@@ -83,6 +85,10 @@ static var_info _cm_vtab_windpower[] = {
 	{ SSC_INPUT, SSC_NUMBER,  "en_icing_cutoff",					"Enable Icing Cutoff",						"0/1",		"",		"WindPower",	"?=0",							"INTEGER",											"" },
 	{ SSC_INPUT, SSC_NUMBER,  "icing_cutoff_temp",					"Icing Cutoff Temperature",					"C",		"",		"WindPower",	"en_icing_cutoff=1",			"",													"" },
 	{ SSC_INPUT, SSC_NUMBER,  "icing_cutoff_rh",					"Icing Cutoff Relative Humidity",			"%",		"",		"WindPower",	"en_icing_cutoff=1",			"MIN=0",											"" },
+	{ SSC_INPUT, SSC_NUMBER,  "wind_farm_binned",					"Interpolate farm output from direction and speed bins",	"0/1",	"",	"WindPower",	"?=0",					"INTEGER,MIN=0,MAX=1",								"" },
+	{ SSC_INPUT, SSC_NUMBER,  "wind_farm_bin_direction",			"Wind direction bin width",					"deg",		"",		"WindPower",	"?=2",							"POSITIVE",											"" },
+	{ SSC_INPUT, SSC_NUMBER,  "wind_farm_bin_speed",				"Wind speed bin width",						"m/s",		"",		"WindPower",	"?=0.25",						"POSITIVE",											"" },
+	{ SSC_INPUT, SSC_NUMBER,  "nthreads",							"Number of threads for the farm bins",		"",			"0=all cores",	"WindPower",	"?=0",					"INTEGER,MIN=0",									"" },
 
 
 	// OUTPUTS ----------------------------------------------------------------------------													annual_energy									                            
@@ -100,6 +106,8 @@ static var_info _cm_vtab_windpower[] = {
 	{ SSC_OUTPUT, SSC_NUMBER, "kwh_per_kw",						"First year kWh/kW",						"kWh/kW",	"", "Annual", "*", "", "" },
 
 	{ SSC_OUTPUT, SSC_NUMBER, "cutoff_losses",                  "Cutoff losses",                            "%",		"", "Annual", "", "", "" },
+	{ SSC_OUTPUT, SSC_NUMBER, "wind_farm_binned_error",         "Binned farm output mean error on checked steps", "%",	"", "Annual", "", "", "" },
+	{ SSC_OUTPUT, SSC_NUMBER, "wind_farm_binned_error_max",     "Binned farm output largest error on checked steps", "kW", "", "Annual", "", "", "" },
 
 
 
@@ -198,6 +206,27 @@ bool winddata::read_line(std::vector<double> &values)
 }
 
 
+static std::shared_ptr<wakeModelBase> create_wake_model(int wakeModelChoice, size_t nTurbines, windTurbine *wt, double turbulenceCoeff)
+{
+	if (wakeModelChoice == 0)
+		return std::make_shared<simpleWakeModel>(simpleWakeModel(nTurbines, wt));
+	else if (wakeModelChoice == 1)
+		return std::make_shared<parkWakeModel>(parkWakeModel(nTurbines, wt));
+	else if (wakeModelChoice == 2)
+		return std::make_shared<eddyViscosityWakeModel>(eddyViscosityWakeModel(nTurbines, wt, turbulenceCoeff));
+	return std::shared_ptr<wakeModelBase>(nullptr);
+}
+
+/* fills cells first, first + stride, ... of the farm bins, with its own copies of the turbine and calculator and its own wake model */
+static void fill_farm_bins(farmEfficiencyTable *farmBins, windTurbine wt, windPowerCalculator wpc, int wakeModelChoice, double turbulenceCoeff,
+	size_t first, size_t stride, std::string *error)
+{
+	wpc.windTurb = &wt;
+	wpc.InitializeModel(create_wake_model(wakeModelChoice, wpc.nTurbines, &wt, turbulenceCoeff));
+	if (!farmBins->fill(wpc, first, stride))
+		*error = wt.errDetails.length() > 0 ? wt.errDetails : wpc.GetErrorDetails();
+}
+
 cm_windpower::cm_windpower(){
 	add_var_info(_cm_vtab_windpower);
 	// performance adjustment factors
@@ -345,20 +374,34 @@ void cm_windpower::exec() throw(general_error)
 		throw exec_error("windpower", util::format("invalid number of data records (%d): must be an integer multiple of 8760", (int)nstep));
 
 	// create wakeModel
-	std::shared_ptr<wakeModelBase> wakeModel(nullptr);
 	int wakeModelChoice = as_integer("wind_farm_wake_model");
-	if (wakeModelChoice == 0)
-		wakeModel = std::make_shared<simpleWakeModel>(simpleWakeModel(wpc.nTurbines, &wt));
-	else if (wakeModelChoice == 1)
-		wakeModel = std::make_shared<parkWakeModel>(parkWakeModel(wpc.nTurbines, &wt));
-	else if (wakeModelChoice == 2)
-	{
+	if (wakeModelChoice == 2)
 		wpc.turbulenceIntensity *= 100;	
-		wakeModel = std::make_shared<eddyViscosityWakeModel>(eddyViscosityWakeModel(wpc.nTurbines, &wt, as_double("wind_resource_turbulence_coeff")));
-	}
-	if (!wpc.InitializeModel(wakeModel))
+	if (!wpc.InitializeModel(create_wake_model(wakeModelChoice, wpc.nTurbines, &wt, as_double("wind_resource_turbulence_coeff"))))
 		throw exec_error("windpower", util::format("Wake model choice must be 0, 1 or 2"));
 
+	// binned mode runs the farm model once per direction and speed bin, spread over nthreads threads, and interpolates at each step
+	std::shared_ptr<farmEfficiencyTable> farmBins(nullptr);
+	if (as_boolean("wind_farm_binned"))
+	{
+		farmBins = std::make_shared<farmEfficiencyTable>(as_double("wind_farm_bin_direction"), as_double("wind_farm_bin_speed"), windSpeeds.back());
+		int nthreads = as_integer("nthreads");
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		size_t nworkers = std::min((size_t)std::max(nthreads, 1), farmBins->cells());
+		std::vector<std::string> errors(nworkers);
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < nworkers; t++)
+			threads.push_back(std::thread(fill_farm_bins, farmBins.get(), wt, wpc, wakeModelChoice, as_double("wind_resource_turbulence_coeff"), t, nworkers, &errors[t]));
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+		for (size_t t = 0; t < nworkers; t++)
+			if (errors[t].length() > 0)
+				throw exec_error("windpower", "error in binned farm calculation, details: " + errors[t]);
+		farmBins->finish();
+	}
+	double binnedError = 0.0, binnedErrorMax = 0.0, binnedChecked = 0.0;
+
 	// allocate output data
 	ssc_number_t *farmpwr = allocate("gen", nstep);
 	ssc_number_t *wspd = allocate("wind_speed", nstep);
@@ -433,7 +476,9 @@ void cm_windpower::exec() throw(general_error)
 
 			double farmp = 0;
 
-			if ((int)wpc.nTurbines != wpc.windPowerUsingResource(
+			// every hundredth binned step is also run through the wake model to report the binning error
+			bool exact = !farmBins || (i % 100 == 0);
+			if (exact && (int)wpc.nTurbines != wpc.windPowerUsingResource(
 				/* inputs */
 				wind,	/* m/s */
 				dir,	/* degrees */
@@ -451,6 +496,20 @@ void cm_windpower::exec() throw(general_error)
 				&DistCross[0]))
 				throw exec_error("windpower", util::format("error in wind calculation at time %d, details: %s", i, wpc.GetErrorDetails().c_str()));
 
+			if (farmBins)
+			{
+				double binned = 0;
+				if (!farmBins->farmPower(wpc, wind, dir, pres, temp, &binned))
+					throw exec_error("windpower", util::format("error in binned wind calculation at time %d, details: %s", i, wt.errDetails.c_str()));
+				if (exact)
+				{
+					binnedError += fabs(binned - farmp);
+					binnedErrorMax = std::max(binnedErrorMax, fabs(binned - farmp));
+					binnedChecked += farmp;
+				}
+				farmp = binned;
+			}
+
 			// apply losses
 			withoutLosses += farmp * haf(hr);
 			if (lowTempCutoff){
@@ -483,6 +542,11 @@ void cm_windpower::exec() throw(general_error)
 	assign("capacity_factor", var_data((ssc_number_t)(kWhperkW / 87.6)));
 	assign("kwh_per_kw", var_data((ssc_number_t)kWhperkW));
 	assign("cutoff_losses", var_data((ssc_number_t)((withoutLosses-annual)/ withoutLosses)));
+	if (farmBins)
+	{
+		assign("wind_farm_binned_error", var_data((ssc_number_t)(binnedChecked > 0 ? 100.0 * binnedError / binnedChecked : 0.0)));
+		assign("wind_farm_binned_error_max", var_data((ssc_number_t)binnedErrorMax));
+	}
 
 } // exec
 
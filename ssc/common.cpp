@@ -48,6 +48,8 @@
 *******************************************************************************************************/
 
 #include <string>
+#include <algorithm>
+#include <cmath>
 #include "common.h"
 #include "lib_weatherfile.h"
 
@@ -446,10 +448,103 @@ int sf_adjustment_factors::size()
 shading_factor_calculator::shading_factor_calculator()
 {
 	m_enAzAlt = false;
+	m_azalFast = false;
+	m_azalAltStep = m_azalAziStep = 0.0;
 	m_enMxH = false;
 	m_diffFactor = 1.0;
 	m_beam_shade_factor = 1.0;
 	m_dc_shade_factor = 1.0;
+	m_beamRows = 0;
+	m_beamCols = 1;
+	m_lastRun = 0;
+}
+
+void shading_factor_calculator::add_timestep_row(size_t r, const std::vector<double> &row)
+{
+	// extend the current run when the row repeats the previous one (typical of 0% / 100% scene shading)
+	if (m_runStart.size() > 0
+		&& std::equal(row.begin(), row.end(), m_runFactors.end() - m_beamCols))
+		return;
+
+	m_runStart.push_back(r);
+	m_runFactors.insert(m_runFactors.end(), row.begin(), row.end());
+}
+
+const double *shading_factor_calculator::timestep_row(size_t irow)
+{
+	// time steps are normally visited in order, so check the last run and the one after it before searching
+	size_t k = m_lastRun;
+	size_t nruns = m_runStart.size();
+	if (k >= nruns || irow < m_runStart[k])
+		k = std::upper_bound(m_runStart.begin(), m_runStart.end(), irow) - m_runStart.begin() - 1;
+	else if (k + 1 < nruns && irow >= m_runStart[k + 1])
+	{
+		if (k + 2 >= nruns || irow < m_runStart[k + 2])
+			k++;
+		else
+			k = std::upper_bound(m_runStart.begin(), m_runStart.end(), irow) - m_runStart.begin() - 1;
+	}
+	m_lastRun = k;
+	return &m_runFactors[k * m_beamCols];
+}
+
+// index of the upper bracketing point on an azimuth x altitude axis, identical to the linear search in util::bilinear
+static size_t azal_axis_index(double x, const std::vector<double> &axis, double step)
+{
+	size_t n = axis.size();
+	if (step <= 0)
+	{
+		size_t i = std::lower_bound(axis.begin() + 2, axis.end(), x) - axis.begin();
+		return (i == n) ? n - 1 : i;
+	}
+
+	double t = (x - axis[1]) / step;
+	size_t i = 2;
+	if (t >= (double)(n - 2)) i = n - 1;
+	else if (t > 1) i = (size_t)std::ceil(t) + 1;
+
+	// correct for round-off in the estimate
+	while (i > 2 && x <= axis[i - 1]) i--;
+	while (i < n - 1 && x > axis[i]) i++;
+	return i;
+}
+
+double shading_factor_calculator::azal_factor(double solalt, double solazi)
+{
+	if (!m_azalFast)
+		return util::bilinear(solalt, solazi, m_azaltvals);
+
+	size_t ridx = azal_axis_index(solalt, m_azalAlt, m_azalAltStep);
+	size_t cidx = azal_axis_index(solazi, m_azalAzi, m_azalAziStep);
+
+	// same arithmetic as util::bilinear so results do not change
+	double r1 = m_azalAlt[ridx - 1];
+	double r2 = m_azalAlt[ridx];
+	double c1 = m_azalAzi[cidx - 1];
+	double c2 = m_azalAzi[cidx];
+
+	double denom = (r2 - r1)*(c2 - c1);
+
+	return m_azaltvals.at(ridx - 1, cidx - 1) * (r2 - solalt)*(c2 - solazi) / denom
+		+ m_azaltvals.at(ridx, cidx - 1) * (solalt - r1)*(c2 - solazi) / denom
+		+ m_azaltvals.at(ridx - 1, cidx) * (r2 - solalt)*(solazi - c1) / denom
+		+ m_azaltvals.at(ridx, cidx) * (solalt - r1)*(solazi - c1) / denom;
+}
+
+// grid spacing when the axis (entries 1..n-1) is evenly spaced, 0 when it is only sorted, -1 when unsorted
+static double azal_axis_step(const std::vector<double> &axis)
+{
+	size_t n = axis.size();
+	for (size_t i = 2; i < n; i++)
+		if (axis[i] < axis[i - 1])
+			return -1;
+
+	double step = (axis[n - 1] - axis[1]) / (double)(n - 2);
+	if (step <= 0) return 0;
+	for (size_t i = 2; i < n; i++)
+		if (std::fabs(axis[i] - (axis[1] + step*(i - 1))) > 1e-9 * step)
+			return 0;
+	return step;
 }
 
 
@@ -472,7 +567,11 @@ bool shading_factor_calculator::setup( compute_module *cm, const std::string &pr
 
 	// initialize to 8760x1 for mxh and change based on shading:timestep
 	size_t nrecs = 8760;
-	m_beamFactors.resize_fill(nrecs, 1, 1.0);
+	m_beamRows = nrecs;
+	m_beamCols = 1;
+	m_runStart.assign(1, 0);
+	m_runFactors.assign(1, 1.0);
+	m_lastRun = 0;
 
 	m_enTimestep = false;
 	if (cm->is_assigned(prefix + "shading:timestep"))
@@ -482,67 +581,50 @@ bool shading_factor_calculator::setup( compute_module *cm, const std::string &pr
 		if (nrows % 8760 == 0)
 		{
 			nrecs = nrows;
-			m_beamFactors.resize_fill(nrows, ncols, 1.0);
-			if (m_string_option == 0) // use percent shaded to lookup in database
+			// the shading database needs every string, all other options reduce to column zero
+			m_beamRows = nrows;
+			m_beamCols = (m_string_option == 0) ? ncols : 1;
+			m_runStart.clear();
+			m_runFactors.clear();
+			m_lastRun = 0;
+
+			std::vector<double> row(m_beamCols, 1.0);
+			for (size_t r = 0; r < nrows; r++)
 			{
-				for (size_t r = 0; r < nrows; r++)
+				ssc_number_t *p = mat + r*ncols;
+				if (m_string_option == 0) // use percent shaded to lookup in database
+				{
 					for (size_t c = 0; c < ncols; c++)
-						m_beamFactors.at(r, c) = mat[r*ncols + c]; //entered in % shaded 
-			}
-			else if (m_string_option == 1) // use average of all strings in column zero
-			{
-				for (size_t r = 0; r < nrows; r++)
+						row[c] = p[c]; //entered in % shaded 
+				}
+				else if (m_string_option == 1) // use average of all strings in column zero
 				{
 					double sum_percent_shaded = 0;
 					for (size_t c = 0; c < ncols; c++)
-					{
-						sum_percent_shaded += mat[r*ncols + c];//entered in % shaded 
-					}
+						sum_percent_shaded += p[c];//entered in % shaded 
 					sum_percent_shaded /= ncols;
-					//cm->log(util::format("hour %d avg percent beam factor %lg",
-					//	r, sum_percent_shaded),
-					//	SSC_WARNING);
-					m_beamFactors.at(r, 0) = 1.0 - sum_percent_shaded / 100;
+					row[0] = 1.0 - sum_percent_shaded / 100;
 				}
-			}
-			else if (m_string_option == 2) // use max of all strings in column zero
-			{
-				for (size_t r = 0; r < nrows; r++)
+				else if (m_string_option == 2) // use max of all strings in column zero
 				{
 					double max_percent_shaded = 0;
 					for (size_t c = 0; c < ncols; c++)
-					{
-						if (mat[r*ncols + c]>max_percent_shaded)
-							max_percent_shaded = mat[r*ncols + c];//entered in % shaded 
-					}
-					//cm->log(util::format("hour %d max percent beam factor %lg",
-					//	r, max_percent_shaded),
-					//	SSC_WARNING);
-
-					m_beamFactors.at(r, 0) = 1.0 - max_percent_shaded / 100;
+						if (p[c]>max_percent_shaded)
+							max_percent_shaded = p[c];//entered in % shaded 
+					row[0] = 1.0 - max_percent_shaded / 100;
 				}
-			}
-			else if (m_string_option == 3) // use min of all strings in column zero
-			{
-				for (size_t r = 0; r < nrows; r++)
+				else if (m_string_option == 3) // use min of all strings in column zero
 				{
 					double min_percent_shaded = 100;
 					for (size_t c = 0; c < ncols; c++)
-					{
-						if (mat[r*ncols + c]<min_percent_shaded)
-							min_percent_shaded = mat[r*ncols + c];//entered in % shaded 
-					}
-					//cm->log(util::format("hour %d min percent beam factor %lg",
-					//	r, min_percent_shaded),
-					//	SSC_WARNING);
-					m_beamFactors.at(r, 0) = 1.0 - min_percent_shaded / 100;
+						if (p[c]<min_percent_shaded)
+							min_percent_shaded = p[c];//entered in % shaded 
+					row[0] = 1.0 - min_percent_shaded / 100;
 				}
-			}
-			else // use unshaded factors to apply to beam ( column zero only is used)
-			{
-				for (size_t r = 0; r < nrows; r++)
-					for (size_t c = 0; c < ncols; c++)
-						m_beamFactors.at(r, c) = 1 - mat[r*ncols + c] / 100; //all other entries must be converted from % to factor unshaded for beam
+				else // use unshaded factors to apply to beam ( column zero only is used)
+					row[0] = 1 - p[0] / 100; //all other entries must be converted from % to factor unshaded for beam
+
+				add_timestep_row(r, row);
 			}
 			m_steps_per_hour = (int)nrows / 8760;
 			m_enTimestep = true;
@@ -601,6 +683,22 @@ bool shading_factor_calculator::setup( compute_module *cm, const std::string &pr
 			}
 		}
 		m_enAzAlt = true;
+
+		// copy out the axes and check for a sorted or evenly spaced grid to skip the linear search in util::bilinear
+		m_azalFast = false;
+		if (nrows >= 3 && ncols >= 3)
+		{
+			m_azalAlt.resize(nrows);
+			for (size_t r = 0; r < nrows; r++)
+				m_azalAlt[r] = m_azaltvals.at(r, 0);
+			m_azalAzi.resize(ncols);
+			for (size_t c = 0; c < ncols; c++)
+				m_azalAzi[c] = m_azaltvals.at(0, c);
+
+			m_azalAltStep = azal_axis_step(m_azalAlt);
+			m_azalAziStep = azal_axis_step(m_azalAzi);
+			m_azalFast = (m_azalAltStep >= 0 && m_azalAziStep >= 0);
+		}
 	}
 
 
@@ -640,15 +738,15 @@ bool shading_factor_calculator::fbeam(size_t hour, double solalt, double solazi,
 	bool ok = false;
 	double factor = 1.0;
 	size_t irow = get_row_index_for_input(hour,hour_step,steps_per_hour);
-	if (irow < m_beamFactors.nrows())
+	if (irow < m_beamRows)
 	{
-		factor = m_beamFactors.at(irow, 0);
+		factor = timestep_row(irow)[0];
 		// apply mxh factor
 		if (m_enMxH && (irow < m_mxhFactors.nrows()))
 			factor *= m_mxhFactors(irow, 0);
 		// apply azi alt shading factor
 		if (m_enAzAlt)
-			factor *= util::bilinear(solalt, solazi, m_azaltvals);
+			factor *= azal_factor(solalt, solazi);
 
 		m_beam_shade_factor = factor;
 
@@ -664,18 +762,17 @@ bool shading_factor_calculator::fbeam_shade_db(ShadeDB8_mpp * p_shadedb, size_t
 	double dc_factor = 1.0;
 	double beam_factor = 1.0;
 	size_t irow = get_row_index_for_input(hour, hour_step, steps_per_hour);
-	if (irow < m_beamFactors.nrows())
+	if (irow < m_beamRows)
 	{
-		std::vector<double> shad_fracs;
-		for (size_t icol = 0; icol < m_beamFactors.ncols(); icol++)
-			shad_fracs.push_back(m_beamFactors.at(irow, icol));
-		dc_factor = 1.0 - p_shadedb->get_shade_loss(gpoa, dpoa, shad_fracs, true, pv_cell_temp, mods_per_str, str_vmp_stc, mppt_lo, mppt_hi);
+		const double *row = timestep_row(irow);
+		m_shadFracs.assign(row, row + m_beamCols);
+		dc_factor = 1.0 - p_shadedb->get_shade_loss(gpoa, dpoa, m_shadFracs, true, pv_cell_temp, mods_per_str, str_vmp_stc, mppt_lo, mppt_hi);
 		// apply mxh factor
 		if (m_enMxH && (irow < m_mxhFactors.nrows()))
 			beam_factor *= m_mxhFactors(irow, 0);
 		// apply azi alt shading factor
 		if (m_enAzAlt)
-			beam_factor *= util::bilinear(solalt, solazi, m_azaltvals);
+			beam_factor *= azal_factor(solalt, solazi);
 
 		m_dc_shade_factor = dc_factor;
 		m_beam_shade_factor = beam_factor;
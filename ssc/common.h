@@ -104,6 +104,12 @@ class shading_factor_calculator
 	bool m_enAzAlt;
 	double m_diffFactor;
 
+	// azimuth x altitude axes copied out of m_azaltvals (index 0 unused) for direct cell lookup.
+	// step is the grid spacing for uniform axes, 0 for sorted non-uniform axes (binary search)
+	bool m_azalFast;
+	std::vector<double> m_azalAlt, m_azalAzi;
+	double m_azalAltStep, m_azalAziStep;
+
 	// shading database mods
 	int m_string_option;// 0=shading db, 1=average, 2=max, 3=min
 	//ShadeDB8_mpp *m_db8;
@@ -114,10 +120,21 @@ class shading_factor_calculator
 	// subhourly modifications
 	int m_steps_per_hour;
 	bool m_enTimestep;
-	util::matrix_t<double> m_beamFactors;
+	// time step beam factors stored as runs of identical rows: run k covers rows
+	// m_runStart[k] through m_runStart[k+1]-1 with m_beamCols values at m_runFactors[k*m_beamCols]
+	size_t m_beamRows;
+	size_t m_beamCols;
+	std::vector<size_t> m_runStart;
+	std::vector<double> m_runFactors;
+	size_t m_lastRun;
+	std::vector<double> m_shadFracs;
 	bool m_enMxH;
 	util::matrix_t<double> m_mxhFactors;
 
+	void add_timestep_row(size_t r, const std::vector<double> &row);
+	const double *timestep_row(size_t irow);
+	double azal_factor(double solalt, double solazi);
+
 public:
 	shading_factor_calculator();
 	bool setup(compute_module *cm, const std::string &prefix = "");
@@ -49,8 +49,11 @@
 
 #include "common_financial.h"
 #include "core.h"
+#include "lib_financial.h"
 #include <sstream>
 #include <sstream>
+#include <cmath>
+#include <limits>
 
 #ifndef WIN32
 #include <float.h>
@@ -65,6 +68,105 @@ void save_cf(compute_module *cm, util::matrix_t<double>& mat, int cf_line, int m
 		arrp[i] = (ssc_number_t)mat.at(cf_line, i);
 }
 
+double cf_npv(util::matrix_t<double> &cf, int cf_line, int nyears, double rate)
+{
+	const double *line = &cf.at(cf_line, 0);
+	double rr = 1.0;
+	if (rate != -1.0) rr = 1.0 / (1.0 + rate);
+	double result = 0;
+	for (int i = nyears; i > 0; i--)
+		result = rr * result + line[i];
+	return result*rr;
+}
+
+double cf_irr(util::matrix_t<double> &cf, int cf_line, int count, double initial_guess, double tolerance, int max_iterations)
+{
+	const double *line = &cf.at(cf_line, 0);
+
+	// only possible for first value negative
+	if ((count < 1) || (line[0] > 0))
+		return std::numeric_limits<double>::quiet_NaN();
+
+	// root nearest 10%, as the Excel IRR function
+	if (initial_guess < -1) initial_guess = 0.1;
+	return libfin::irr_bracketed(line, count, initial_guess, tolerance, max_iterations);
+}
+
+void cf_running_returns(util::matrix_t<double> &cf, int cf_line, int nyears, double rate, int cf_irr_line, int cf_npv_line)
+{
+	const double *line = &cf.at(cf_line, 0);
+	double *irr = &cf.at(cf_irr_line, 0);
+	if (line[0] > 0)
+	{
+		for (int i = 1; i <= nyears; i++)
+			irr[i] = std::numeric_limits<double>::quiet_NaN();
+	}
+	else
+		libfin::irr_running(line, nyears, irr);
+
+	for (int i = 1; i <= nyears; i++)
+	{
+		irr[i] *= 100.0;
+		cf.at(cf_npv_line, i) = cf_npv(cf, cf_line, i, rate) + line[0];
+	}
+}
+
+
+
+ppa_price_split::ppa_price_split()
+	: m_ppa(0), m_ready(false)
+{
+}
+
+void ppa_price_split::add(double ppa, util::matrix_t<double> &cf, int cf_line, int nyears)
+{
+	// both parts come from the two most recent distinct prices, so a line bent between them is followed locally
+	std::vector<double> line(nyears + 1);
+	for (int i = 0; i <= nyears; i++)
+		line[i] = cf.at(cf_line, i);
+	if (!m_line.empty() && ppa != m_ppa && m_line.size() == line.size())
+	{
+		m_base.resize(line.size());
+		m_slope.resize(line.size());
+		for (size_t i = 0; i < line.size(); i++)
+		{
+			m_slope[i] = (line[i] - m_line[i]) / (ppa - m_ppa);
+			m_base[i] = line[i] - ppa * m_slope[i];
+		}
+		m_ready = true;
+	}
+	m_line.swap(line);
+	m_ppa = ppa;
+}
+
+// same convention as the financial models: years 1 through year discounted, plus year 0
+double ppa_price_split::npv(std::vector<double> &line, int year, double rate)
+{
+	double rr = 1.0;
+	if (rate != -1.0) rr = 1.0 / (1.0 + rate);
+	double result = 0;
+	for (int i = year; i > 0; i--)
+		result = rr * result + line[i];
+	return result*rr + line[0];
+}
+
+double ppa_price_split::npv(double ppa, int year, double rate)
+{
+	if (!m_ready) return std::numeric_limits<double>::quiet_NaN();
+	return npv(m_base, year, rate) + ppa * npv(m_slope, year, rate);
+}
+
+bool ppa_price_split::solve(int year, double rate, double &ppa)
+{
+	if (!m_ready || year < 0 || year >= (int)m_base.size()) return false;
+	double npv_slope = npv(m_slope, year, rate);
+	if (npv_slope == 0.0) return false;
+	double price = -npv(m_base, year, rate) / npv_slope;
+	if (!std::isfinite(price)) return false;
+	ppa = price;
+	return true;
+}
+
 
 
 enum {
@@ -56,6 +56,16 @@
 
 void save_cf(compute_module *cm, util::matrix_t<double>& mat, int cf_line, int nyears, const std::string &name);
 
+/* Return calculations on a cash flow line, shared by the financial models.  Years run along a row of the
+   cash flow matrix, which is contiguous.  cf_npv discounts years 1 through nyears and callers add year 0. */
+double cf_npv(util::matrix_t<double> &cf, int cf_line, int nyears, double rate);
+double cf_irr(util::matrix_t<double> &cf, int cf_line, int count, double initial_guess = -2, double tolerance = 1e-6, int max_iterations = 100);
+
+/* Fills the running irr (%) and npv lines for years 1 through nyears of a cash flow line, year 0 is left
+   to the model.  Lines that are reported but not read by the ppa solution are filled once from the final
+   cash flow instead of on every iteration. */
+void cf_running_returns(util::matrix_t<double> &cf, int cf_line, int nyears, double rate, int cf_irr_line, int cf_npv_line);
+
 
 
 class dispatch_calculations
@@ -114,7 +124,31 @@ public:
 };
 
 
+/* Splits a return cash flow line into a part that does not depend on the PPA price and a part proportional
+   to it, from the two latest evaluations of the full cash flow at different prices.  Revenue is linear in the PPA price
+   for a fixed escalation, so the NPV of the line at a target IRR is affine in the price and its root is the
+   price that meets the target.  Tax credit limits and flip allocations can bend the line, so the price must
+   still be checked with a full cash flow evaluation.  Not used by the partnership flip models, where the tax investor
+   return stays near the target over a range of prices and the split would select a different price than the
+   interval search. */
+class ppa_price_split
+{
+private:
+	std::vector<double> m_line; // latest evaluation
+	double m_ppa;
+	std::vector<double> m_base; // $ at a price of zero
+	std::vector<double> m_slope; // $ per cent/kWh
+	bool m_ready;
 
+	double npv(std::vector<double> &line, int year, double rate);
+
+public:
+	ppa_price_split();
+	void add(double ppa, util::matrix_t<double> &cf, int cf_line, int nyears);
+	bool ready() { return m_ready; }
+	double npv(double ppa, int year, double rate);
+	bool solve(int year, double rate, double &ppa);
+};
 
 /*
 extern var_info vtab_advanced_financing_cost[];
@@ -52,6 +52,7 @@
 
 #include "core.h"
 #include "sscapi.h"
+#include "lib_pvwatts.h"
 
 SSCEXPORT int ssc_version()
 {
@@ -76,6 +77,7 @@ extern module_entry_info
 	cm_entry_iec61853par,
 	cm_entry_iec61853interp,
 	cm_entry_6parsolve,
+	cm_entry_6parsolve_batch,
 	cm_entry_pvsamv1,
 	cm_entry_pvwattsv0,
 	cm_entry_pvwattsv1,
@@ -83,6 +85,7 @@ extern module_entry_info
 	cm_entry_pvwattsv1_poa,
 	cm_entry_pvwattsv5,
 	cm_entry_pvwattsv5_1ts,
+	cm_entry_pvwattsv5_fleet,
 	cm_entry_pv6parmod,
 	cm_entry_pvsandiainv,
 	cm_entry_wfreader,
@@ -92,6 +95,7 @@ extern module_entry_info
 	cm_entry_utilityrate3,
 	cm_entry_utilityrate4,
 	cm_entry_utilityrate5,
+	cm_entry_utilityrate5_fleet,
 	cm_entry_annualoutput,
 	cm_entry_cashloan,
 	cm_entry_thirdpartyownership,
@@ -101,6 +105,7 @@ extern module_entry_info
 	cm_entry_equpartflip,
 	cm_entry_saleleaseback,
 	cm_entry_singleowner,
+	cm_entry_singleowner_uncertainty,
 	cm_entry_host_developer,
 	cm_entry_swh,
 	cm_entry_geothermal,
@@ -146,6 +151,7 @@ extern module_entry_info
 	cm_entry_cb_empirical_hce_heat_loss,
 	cm_entry_iscc_design_point,
 	cm_entry_battery,
+	cm_entry_battery_sizing,
 	cm_entry_battwatts,
    	cm_entry_lcoefcr,
 	cm_entry_pv_get_shade_loss_mpp,
@@ -158,6 +164,7 @@ static module_entry_info *module_table[] = {
 	&cm_entry_iec61853par,
 	&cm_entry_iec61853interp,
 	&cm_entry_6parsolve,
+	&cm_entry_6parsolve_batch,
 	&cm_entry_pv6parmod,
 	&cm_entry_pvsamv1,
 	//&cm_entry_pvwattsv0,
@@ -166,6 +173,7 @@ static module_entry_info *module_table[] = {
 	&cm_entry_pvwattsv1_poa,
 	&cm_entry_pvwattsv5,
 	&cm_entry_pvwattsv5_1ts,
+	&cm_entry_pvwattsv5_fleet,
 	&cm_entry_pvsandiainv,
 	&cm_entry_wfreader,
 	&cm_entry_irradproc,
@@ -174,6 +182,7 @@ static module_entry_info *module_table[] = {
 	&cm_entry_utilityrate3,
 	&cm_entry_utilityrate4,
 	&cm_entry_utilityrate5,
+	&cm_entry_utilityrate5_fleet,
 	&cm_entry_annualoutput,
 	&cm_entry_cashloan,
 	&cm_entry_thirdpartyownership,
@@ -183,6 +192,7 @@ static module_entry_info *module_table[] = {
 	&cm_entry_equpartflip,
 	&cm_entry_saleleaseback,
 	&cm_entry_singleowner,
+	&cm_entry_singleowner_uncertainty,
 	&cm_entry_host_developer,
 	&cm_entry_swh,
 	&cm_entry_geothermal,
@@ -228,6 +238,7 @@ static module_entry_info *module_table[] = {
 	&cm_entry_cb_empirical_hce_heat_loss,
 	&cm_entry_iscc_design_point,
 	&cm_entry_battery,
+	&cm_entry_battery_sizing,
 	&cm_entry_battwatts,
 	&cm_entry_lcoefcr,
 	&cm_entry_pv_get_shade_loss_mpp,
@@ -682,6 +693,39 @@ SSCEXPORT const char *ssc_module_log( ssc_module_t p_mod, int index, int *item_t
 	return l->text.c_str();
 }
 
+SSCEXPORT ssc_pvwatts_t ssc_pvwatts_create( ssc_data_t p_data )
+{
+	extern pvwatts_engine *pvwattsv1_1ts_create_engine( var_table *data );
+
+	var_table *vt = static_cast<var_table*>(p_data);
+	if (!vt) return 0;
+
+	return static_cast<ssc_pvwatts_t>( pvwattsv1_1ts_create_engine( vt ) );
+}
+
+SSCEXPORT void ssc_pvwatts_free( ssc_pvwatts_t p_pvw )
+{
+	pvwatts_engine *pvw = static_cast<pvwatts_engine*>(p_pvw);
+	if ( pvw ) delete pvw;
+}
+
+SSCEXPORT ssc_bool_t ssc_pvwatts_step( ssc_pvwatts_t p_pvw, int year, int month, int day, int hour, ssc_number_t minute,
+	ssc_number_t ghi, ssc_number_t dni, ssc_number_t dhi, ssc_number_t tamb, ssc_number_t wspd,
+	ssc_number_t *poa, ssc_number_t *tcell, ssc_number_t *dc, ssc_number_t *ac )
+{
+	pvwatts_engine *pvw = static_cast<pvwatts_engine*>(p_pvw);
+	if ( !pvw ) return 0;
+
+	if ( pvw->step( year, month, day, hour, minute, ghi, dni, dhi, tamb, wspd ) != 0 )
+		return 0;
+
+	if ( poa ) *poa = (ssc_number_t)pvw->poa();
+	if ( tcell ) *tcell = (ssc_number_t)pvw->tcell();
+	if ( dc ) *dc = (ssc_number_t)pvw->dc();
+	if ( ac ) *ac = (ssc_number_t)pvw->ac();
+	return 1;
+}
+
 SSCEXPORT void __ssc_segfault()
 {
 	std::string *pstr = 0;
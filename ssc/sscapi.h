@@ -324,6 +324,20 @@ SSCEXPORT ssc_bool_t ssc_module_exec_with_handler(
 /** Retrive notices, warnings, and error messages from the simulation. Returns a NULL-terminated ASCII C string with the message text, or NULL if the index passed in was invalid. */
 SSCEXPORT const char *ssc_module_log( ssc_module_t p_mod, int index, int *item_type, float *time );
 
+/** An opaque reference to a persistent single time step PVWatts (V1) model. Unlike the pvwattsv1_1ts compute module, it is created once per system and keeps the module thermal state between calls, so it can be stepped in real time with only the new weather observation. */
+typedef void* ssc_pvwatts_t;
+
+/** Creates a PVWatts model from the system inputs of the pvwattsv1_1ts compute module in a data object: lat, lon, tz, system_size, derate, track_mode, azimuth, tilt, and optionally rotlim, t_noct, t_ref, gamma, inv_eff, fd, i_ref, poa_cutin, w_stow and time_step. The inputs are checked against the module's requirements and constraints, and its defaults are applied without modifying the data object. Returns 0 (NULL) if a required input is missing or a constraint is violated. */
+SSCEXPORT ssc_pvwatts_t ssc_pvwatts_create( ssc_data_t p_data );
+
+/** Releases a PVWatts model created with ssc_pvwatts_create */
+SSCEXPORT void ssc_pvwatts_free( ssc_pvwatts_t p_pvw );
+
+/** Advances a PVWatts model by one time step. Irradiance is in W/m2, temperature in C, wind speed in m/s. The ghi value is only used when dhi is negative (missing). Outputs plane of array irradiance (W/m2), module temperature (C), and DC and AC power (W); any output pointer may be NULL. Returns 1 on success, 0 if the inputs were rejected, in which case the outputs are not changed. */
+SSCEXPORT ssc_bool_t ssc_pvwatts_step( ssc_pvwatts_t p_pvw, int year, int month, int day, int hour, ssc_number_t minute,
+	ssc_number_t ghi, ssc_number_t dni, ssc_number_t dhi, ssc_number_t tamb, ssc_number_t wspd,
+	ssc_number_t *poa, ssc_number_t *tcell, ssc_number_t *dc, ssc_number_t *ac );
+
 /** DO NOT CALL THIS FUNCTION: immediately causes a segmentation fault within the library. This is only useful for testing crash handling from an external application that is dynamically linked to the SSC library */
 SSCEXPORT void __ssc_segfault();
 
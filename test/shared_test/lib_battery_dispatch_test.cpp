@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <lib_battery_dispatch.h>
+
+#include "lib_battery_test.h"
+
+namespace {
+	// optimized front-of-meter dispatch with grid charging only, planning a full day at the first step
+	dispatch_automatic_front_of_meter_t * build_optimized_dispatch(battery_t * battery, double price_night, double price_day, double cycle_cost)
+	{
+		std::vector<double> ppa_factors = { price_night, price_day };
+		util::matrix_t<size_t> schedule(12, 24, 1);
+		for (size_t m = 0; m < 12; m++)
+			for (size_t h = 12; h < 24; h++)
+				schedule(m, h) = 2;
+
+		return new dispatch_automatic_front_of_meter_t(battery, 1, 15, 95, dispatch_t::RESTRICT_POWER, 1000, 1000, 20, 20, 0,
+			dispatch_t::FOM_OPTIMIZED_LOOK_AHEAD, dispatch_t::FRONT, 1, 24, 24, false, false, true, 1000, 0,
+			dispatch_t::INPUT_CYCLE_COST, cycle_cost, ppa_factors, schedule, schedule, NULL, 96, 96, 96);
+	}
+
+	std::vector<double> planned_day(dispatch_automatic_front_of_meter_t * dispatch)
+	{
+		dispatch->update_pv_data(double_vec(8760, 0.));
+		dispatch->update_cliploss_data(double_vec(8760, 0.));
+		std::vector<double> plan;
+		for (size_t hour = 0; hour < 24; hour++)
+		{
+			dispatch->update_dispatch(hour, 0, hour);
+			plan.push_back(dispatch->getBatteryPower()->powerBatteryTarget);
+		}
+		return plan;
+	}
+}
+
+TEST(BatteryDispatchOptimized, ChargesWhenCheapDischargesWhenExpensive)
+{
+	battery_t * battery = build_li_ion_battery();
+	dispatch_automatic_front_of_meter_t * dispatch = build_optimized_dispatch(battery, 0.02, 0.10, 0.01);
+	std::vector<double> plan = planned_day(dispatch);
+
+	double energyMax = battery->battery_charge_maximum() * battery->battery_voltage_nominal() * util::watt_to_kilowatt;
+	double energy = energyMax * battery->battery_soc() * 0.01;
+	for (size_t hour = 0; hour < 24; hour++)
+	{
+		if (hour < 12)
+			EXPECT_LE(plan[hour], 1e-6) << "hour " << hour;
+		else
+			EXPECT_GE(plan[hour], -1e-6) << "hour " << hour;
+		EXPECT_LE(std::fabs(plan[hour]), 20 + 1e-6) << "hour " << hour;
+		energy -= plan[hour];
+
+		// full before the expensive period, empty at the end of the day
+		if (hour == 11)
+			EXPECT_NEAR(energy, energyMax * 0.95, 1e-4);
+	}
+	EXPECT_NEAR(energy, energyMax * 0.15, 1e-4);
+
+	delete dispatch;
+	battery->delete_clone();
+	delete battery;
+}
+
+TEST(BatteryDispatchOptimized, NoGridChargeWithoutPriceSpread)
+{
+	battery_t * battery = build_li_ion_battery();
+	dispatch_automatic_front_of_meter_t * dispatch = build_optimized_dispatch(battery, 0.05, 0.05, 0.01);
+	std::vector<double> plan = planned_day(dispatch);
+
+	// round-trip losses make grid charging unprofitable, stored energy is still sold
+	double energyMax = battery->battery_charge_maximum() * battery->battery_voltage_nominal() * util::watt_to_kilowatt;
+	double energy = energyMax * battery->battery_soc() * 0.01;
+	for (size_t hour = 0; hour < 24; hour++)
+	{
+		EXPECT_GE(plan[hour], -1e-6) << "hour " << hour;
+		energy -= plan[hour];
+	}
+	EXPECT_NEAR(energy, energyMax * 0.15, 1e-4);
+
+	delete dispatch;
+	battery->delete_clone();
+	delete battery;
+}
+
+TEST(BatteryDispatchBehindTheMeter, PeakShavingTargetsMatchFullSort)
+{
+	// four days of evening peaks: a new monthly target, a lower peak, a higher peak with two equal hours, and a flat evening
+	double peaks[4] = { 90, 70, 120, 50 };
+	std::vector<double> load(8760, 25.), pv(8760, 0.);
+	for (size_t day = 0; day < 4; day++)
+	{
+		for (size_t hour = 0; hour < 24; hour++)
+		{
+			size_t i = day * 24 + hour;
+			if (hour >= 7 && hour <= 9) load[i] = 40;
+			if (hour >= 17 && hour <= 20) load[i] = (day == 3) ? 50 : peaks[day] - 10. * std::fabs(hour - 18.5);
+			if (hour > 6 && hour < 18) pv[i] = 30. * std::sin(3.14159265358979 * (hour - 6.) / 12.);
+		}
+	}
+
+	// daily targets from the implementation that sorted the whole day and computed the recharge energy at every candidate target,
+	// the small battery is limited by its usable energy and the large one by the energy to recharge below the target
+	double capacity_Ah[2] = { 200, 2000 };
+	double targets[2][4] = { { 82.820239999999998, 82.820239999999998, 113.72024, 113.72024 },
+		{ 56.751822876583006, 56.751822876583006, 87.651822876583012, 87.651822876583012 } };
+	for (size_t b = 0; b < 2; b++)
+	{
+		battery_t * battery = build_li_ion_battery(capacity_Ah[b]);
+		dispatch_automatic_behind_the_meter_t * dispatch = new dispatch_automatic_behind_the_meter_t(battery, 1, 15, 95, dispatch_t::RESTRICT_POWER,
+			1000, 1000, 20, 20, 0, dispatch_t::LOOK_AHEAD, dispatch_t::MEET_LOAD, 1, 24, 1, true, false, true);
+		dispatch->update_load_data(load);
+		dispatch->update_pv_data(pv);
+
+		for (size_t hour = 0; hour < 96; hour++)
+		{
+			dispatch->update_dispatch(hour, 0, hour);
+			EXPECT_DOUBLE_EQ(dispatch->power_grid_target(), targets[b][hour / 24]) << "battery " << capacity_Ah[b] << " Ah hour " << hour;
+			EXPECT_NEAR(dispatch->power_batt_target(), load[hour] - pv[hour] - targets[b][hour / 24], 1e-9) << "battery " << capacity_Ah[b] << " Ah hour " << hour;
+		}
+		delete dispatch;
+		battery->delete_clone();
+		delete battery;
+	}
+}
+
+/// Benchmark of peak shaving dispatch over a year of 1-minute steps, dominated by target_power and the recharge energy search.
+/// Run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST(BatteryDispatchBehindTheMeter, DISABLED_BenchmarkPeakShavingOneMinute)
+{
+	size_t steps_per_hour = 60;
+	double dt_hour = 1. / steps_per_hour;
+	size_t nsteps = 8760 * steps_per_hour;
+
+	// evening load peak with noise, and a midday PV profile
+	std::vector<double> load(nsteps), pv(nsteps);
+	unsigned seed = 1;
+	for (size_t i = 0; i < nsteps; i++)
+	{
+		double hour = std::fmod(i * dt_hour, 24.);
+		seed = seed * 1103515245u + 12345u;
+		load[i] = 30 + 20 * std::exp(-std::pow(hour - 18, 2) / 4) + ((seed >> 16) % 1000) * 0.01;
+		pv[i] = std::max(0., 40 * std::sin(3.14159265358979 * (hour - 6) / 12));
+	}
+
+	double capacity_Ah[2] = { 200, 2000 };
+	for (size_t b = 0; b < 2; b++)
+	{
+		battery_t * battery = build_li_ion_battery(capacity_Ah[b], dt_hour);
+		dispatch_automatic_behind_the_meter_t * dispatch = new dispatch_automatic_behind_the_meter_t(battery, dt_hour, 15, 95, dispatch_t::RESTRICT_POWER,
+			1000, 1000, 20, 20, 0, dispatch_t::LOOK_AHEAD, dispatch_t::MEET_LOAD, 1, 24, 1, true, false, true);
+		dispatch->update_load_data(load);
+		dispatch->update_pv_data(pv);
+
+		double checksum = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t hour = 0; hour < 8760; hour++)
+		{
+			for (size_t step = 0; step < steps_per_hour; step++)
+			{
+				dispatch->update_dispatch(hour, step, hour * steps_per_hour + step);
+				checksum += dispatch->power_grid_target();
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("BTM peak shaving, %g Ah, 1-minute steps: %.3f s per year (target sum %.6g)\n", capacity_Ah[b], seconds, checksum);
+
+		delete dispatch;
+		battery->delete_clone();
+		delete battery;
+	}
+}
@@ -121,4 +121,83 @@ TEST_F(BatteryPowerFlowTest, TestDCConnected)
 	EXPECT_NEAR(m_batteryPower->powerGridToBattery, 0, error);
 	EXPECT_NEAR(m_batteryPower->powerGridToLoad, 58.68, error);
 	EXPECT_NEAR(m_batteryPower->powerConversionLoss, 8.68, error);
-}
\ No newline at end of file
+}
+TEST_F(BatteryPowerFlowTest, TestACConnectedIdle)
+{
+	m_batteryPower->connectionMode = ChargeController::AC_CONNECTED;
+	m_batteryPower->canPVCharge = true;
+	m_batteryPower->canDischarge = true;
+	m_batteryPower->powerSystemLoss = 1;
+
+	// Excess PV goes to the grid
+	m_batteryPower->powerPV = 100;
+	m_batteryPower->powerLoad = 50;
+	m_batteryPower->powerBattery = 0;
+	m_batteryPowerFlow->calculate();
+
+	EXPECT_EQ(m_batteryPower->powerBattery, 0);
+	EXPECT_NEAR(m_batteryPower->powerPVToLoad, 50, error);
+	EXPECT_NEAR(m_batteryPower->powerPVToGrid, 50, error);
+	EXPECT_NEAR(m_batteryPower->powerGridToLoad, 0, error);
+	EXPECT_NEAR(m_batteryPower->powerGeneratedBySystem, 99, error);
+	EXPECT_NEAR(m_batteryPower->powerGrid, 49, error);
+	EXPECT_EQ(m_batteryPower->powerConversionLoss, 0);
+
+	// Grid serves the remaining load
+	m_batteryPower->powerPV = 20;
+	m_batteryPower->powerBattery = 0;
+	m_batteryPowerFlow->calculate();
+
+	EXPECT_NEAR(m_batteryPower->powerPVToLoad, 20, error);
+	EXPECT_NEAR(m_batteryPower->powerPVToGrid, 0, error);
+	EXPECT_NEAR(m_batteryPower->powerGridToLoad, 30, error);
+	EXPECT_NEAR(m_batteryPower->powerGrid, -31, error);
+	EXPECT_EQ(m_batteryPower->powerBatteryToLoad, 0);
+	EXPECT_EQ(m_batteryPower->powerGridToBattery, 0);
+}
+
+TEST_F(BatteryPowerFlowTest, TestSeriesMatchesSingleStep)
+{
+	m_batteryPower->canPVCharge = true;
+	m_batteryPower->canGridCharge = true;
+	m_batteryPower->canDischarge = true;
+
+	BatteryPowerSeries series;
+	series.powerPV = { 0, 100, 100, 50, 300, 200, 0 };
+	series.powerLoad = { 40, 50, 50, 100, 200, 300, 40 };
+	series.powerBattery = { 0, -50, 0, 48, -100, 50, 0 };
+	series.powerSystemLoss = { 0, 0, 1, 1, 0, 2, 0 };
+
+	for (int connectionMode = ChargeController::DC_CONNECTED; connectionMode <= ChargeController::AC_CONNECTED; connectionMode++)
+	{
+		m_batteryPower->connectionMode = connectionMode;
+		BatteryPowerSeries result = series;
+		m_batteryPowerFlow->calculate(result);
+		ASSERT_EQ(result.powerGrid.size(), series.powerPV.size());
+
+		for (size_t i = 0; i < series.powerPV.size(); i++)
+		{
+			m_batteryPower->powerPV = series.powerPV[i];
+			m_batteryPower->powerLoad = series.powerLoad[i];
+			m_batteryPower->powerBattery = series.powerBattery[i];
+			m_batteryPower->powerSystemLoss = series.powerSystemLoss[i];
+			m_batteryPowerFlow->calculate();
+
+			EXPECT_DOUBLE_EQ(result.powerBattery[i], m_batteryPower->powerBattery) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerGrid[i], m_batteryPower->powerGrid) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerGeneratedBySystem[i], m_batteryPower->powerGeneratedBySystem) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerPVToLoad[i], m_batteryPower->powerPVToLoad) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerPVToBattery[i], m_batteryPower->powerPVToBattery) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerPVToGrid[i], m_batteryPower->powerPVToGrid) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerGridToBattery[i], m_batteryPower->powerGridToBattery) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerGridToLoad[i], m_batteryPower->powerGridToLoad) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerBatteryToLoad[i], m_batteryPower->powerBatteryToLoad) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerBatteryToGrid[i], m_batteryPower->powerBatteryToGrid) << "mode " << connectionMode << " step " << i;
+			EXPECT_DOUBLE_EQ(result.powerConversionLoss[i], m_batteryPower->powerConversionLoss) << "mode " << connectionMode << " step " << i;
+		}
+	}
+
+	// mismatched inputs are rejected
+	series.powerLoad.pop_back();
+	EXPECT_THROW(m_batteryPowerFlow->calculate(series), std::invalid_argument);
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include <lib_battery.h>
 
+#include "lib_battery_test.h"
+
 class BatteryProperties : public ::testing::Test
 {
 protected:
@@ -165,4 +167,213 @@ TEST_F(LeadAcidBattery, LeadAcidCapacityUnitTest_lib_battery)
 	*/
 	
 
-}
\ No newline at end of file
+}
+namespace {
+	void compare_engine_to_polymorphic(battery_t * engine, battery_t * polymorphic)
+	{
+		// two years of daily charge/discharge cycles with rest periods
+		size_t nsteps = 2 * 8760 * 4;
+		for (size_t i = 0; i < nsteps; i++)
+		{
+			size_t step_of_day = i % 96;
+			double I = 0;
+			if (step_of_day < 30) I = -40;
+			else if (step_of_day >= 60 && step_of_day < 80) I = 60;
+			size_t idx = i % (8760 * 4);
+
+			engine->run(idx, I);
+			polymorphic->run_polymorphic(idx, I);
+
+			ASSERT_EQ(engine->battery_soc(), polymorphic->battery_soc()) << "step " << i;
+			ASSERT_EQ(engine->battery_voltage(), polymorphic->battery_voltage()) << "step " << i;
+			ASSERT_EQ(engine->capacity_model()->I(), polymorphic->capacity_model()->I()) << "step " << i;
+			ASSERT_EQ(engine->thermal_model()->T_battery(), polymorphic->thermal_model()->T_battery()) << "step " << i;
+			ASSERT_EQ(engine->lifetime_model()->capacity_percent(), polymorphic->lifetime_model()->capacity_percent()) << "step " << i;
+		}
+		EXPECT_LT(engine->lifetime_model()->capacity_percent(), 100);
+	}
+}
+
+/// The compile-time composed battery engine reproduces the polymorphic step exactly
+TEST(BatteryEngine, LithiumIonDynamicVoltageMatchesPolymorphic)
+{
+	battery_t * batteries[2];
+	for (int k = 0; k < 2; k++)
+		batteries[k] = build_li_ion_battery(200, 0.25);
+	compare_engine_to_polymorphic(batteries[0], batteries[1]);
+	for (int k = 0; k < 2; k++)
+	{
+		batteries[k]->delete_clone();
+		delete batteries[k];
+	}
+}
+
+TEST(BatteryEngine, LeadAcidTableVoltageMatchesPolymorphic)
+{
+	double voltage_vals[] = { 0, 2.1, 50, 2.0, 90, 1.9, 100, 1.7 };
+	util::matrix_t<double> voltage_table;
+	voltage_table.assign(voltage_vals, 4, 2);
+	battery_t * batteries[2];
+	for (int k = 0; k < 2; k++)
+		batteries[k] = build_battery(battery_t::LEAD_ACID,
+			new capacity_kibam_t(250, 10, 225, 230, 50, 95, 15),
+			new voltage_table_t(6, 1, 12, voltage_table, 0.01), 0.25);
+	compare_engine_to_polymorphic(batteries[0], batteries[1]);
+	for (int k = 0; k < 2; k++)
+	{
+		batteries[k]->delete_clone();
+		delete batteries[k];
+	}
+}
+
+namespace {
+	double daily_current(size_t i, double scale)
+	{
+		size_t step_of_day = i % 96;
+		if (step_of_day < 30) return -40 * scale;
+		else if (step_of_day >= 60 && step_of_day < 80) return 60 * scale;
+		return 0;
+	}
+
+	// age two identical batteries, then check that a day rewound with restore_state matches the untouched twin
+	void compare_restore_to_twin(battery_t * battery, battery_t * reference)
+	{
+		size_t i = 0;
+		for (; i < 200 * 96; i++)
+		{
+			battery->run(i, daily_current(i, 1));
+			reference->run(i, daily_current(i, 1));
+		}
+
+		battery_state_t state;
+		battery->save_state(state);
+
+		// a different plan over the next day, then rewind
+		for (size_t j = i; j < i + 96; j++)
+			battery->run(j, daily_current(j, 1.5));
+		battery->restore_state(state);
+
+		for (size_t j = i; j < i + 96; j++)
+		{
+			battery->run(j, daily_current(j, 1));
+			reference->run(j, daily_current(j, 1));
+			ASSERT_EQ(battery->battery_soc(), reference->battery_soc()) << "step " << j;
+			ASSERT_EQ(battery->battery_voltage(), reference->battery_voltage()) << "step " << j;
+			ASSERT_EQ(battery->thermal_model()->T_battery(), reference->thermal_model()->T_battery()) << "step " << j;
+			ASSERT_EQ(battery->lifetime_model()->capacity_percent(), reference->lifetime_model()->capacity_percent()) << "step " << j;
+			ASSERT_EQ(battery->lifetime_model()->cycleModel()->cycles_elapsed(), reference->lifetime_model()->cycleModel()->cycles_elapsed()) << "step " << j;
+		}
+	}
+}
+
+/// Restoring a saved state rewinds every model to the checkpoint
+TEST(BatteryState, LithiumIonRestoreMatchesTwin)
+{
+	battery_t * batteries[2];
+	for (int k = 0; k < 2; k++)
+		batteries[k] = build_li_ion_battery(200, 0.25);
+	compare_restore_to_twin(batteries[0], batteries[1]);
+	for (int k = 0; k < 2; k++)
+	{
+		batteries[k]->delete_clone();
+		delete batteries[k];
+	}
+}
+
+TEST(BatteryState, LeadAcidRestoreMatchesTwin)
+{
+	double voltage_vals[] = { 0, 2.1, 50, 2.0, 90, 1.9, 100, 1.7 };
+	util::matrix_t<double> voltage_table;
+	voltage_table.assign(voltage_vals, 4, 2);
+	battery_t * batteries[2];
+	for (int k = 0; k < 2; k++)
+		batteries[k] = build_battery(battery_t::LEAD_ACID,
+			new capacity_kibam_t(250, 10, 225, 230, 50, 95, 15),
+			new voltage_table_t(6, 1, 12, voltage_table, 0.01), 0.25);
+	compare_restore_to_twin(batteries[0], batteries[1]);
+	for (int k = 0; k < 2; k++)
+	{
+		batteries[k]->delete_clone();
+		delete batteries[k];
+	}
+}
+
+class LifetimeCycle : public ::testing::Test
+{
+protected:
+	lifetime_cycle_t * cycle_model;
+
+	void SetUp()
+	{
+		double lifetime_vals[] = { 20, 0, 100, 20, 5000, 80, 80, 0, 100, 80, 1000, 80, 100, 0, 100, 100, 500, 80 };
+		util::matrix_t<double> cycles_vs_DOD;
+		cycles_vs_DOD.assign(lifetime_vals, 6, 3);
+		cycle_model = new lifetime_cycle_t(cycles_vs_DOD);
+	}
+	void TearDown()
+	{
+		if (cycle_model)
+			delete cycle_model;
+	}
+};
+
+TEST_F(LifetimeCycle, RainflowHistogram_lib_battery)
+{
+	for (int i = 0; i < 201; i++)
+		cycle_model->runCycleLifetime(i % 2 ? 90 : 10);
+
+	EXPECT_EQ(cycle_model->cycles_elapsed(), 100);
+	EXPECT_DOUBLE_EQ(cycle_model->cycle_range(), 80);
+	EXPECT_EQ(cycle_model->cycles_in_range_bin(16), 100);
+
+	int total = 0;
+	for (int bin = 0; bin < RAINFLOW_HISTOGRAM_BINS; bin++)
+		total += cycle_model->cycles_in_range_bin(bin);
+	EXPECT_EQ(total, cycle_model->cycles_elapsed());
+}
+
+TEST_F(LifetimeCycle, CheckpointRestore_lib_battery)
+{
+	double DOD[] = { 10, 60, 30, 95, 5, 70, 40, 80, 20, 50 };
+	for (int i = 0; i < 25; i++)
+		cycle_model->runCycleLifetime(DOD[i % 10]);
+
+	lifetime_cycle_state_t state;
+	cycle_model->save_state(state);
+
+	double q_first[40];
+	for (int i = 0; i < 40; i++)
+		q_first[i] = cycle_model->runCycleLifetime(DOD[(i * 3) % 10]);
+	int cycles_first = cycle_model->cycles_elapsed();
+
+	cycle_model->restore_state(state);
+	for (int i = 0; i < 40; i++)
+		EXPECT_EQ(cycle_model->runCycleLifetime(DOD[(i * 3) % 10]), q_first[i]) << "step " << i;
+	EXPECT_EQ(cycle_model->cycles_elapsed(), cycles_first);
+}
+
+TEST_F(LifetimeCycle, RainflowDeepStack_lib_battery)
+{
+	// a damped oscillation keeps every reversal on the stack, past the reserved depth, without counting a cycle
+	double amplitude = 45;
+	for (int i = 0; i < 3 * RAINFLOW_STACK_RESERVE; i++)
+	{
+		cycle_model->runCycleLifetime(50 + (i % 2 ? amplitude : -amplitude));
+		amplitude *= 0.99;
+	}
+	EXPECT_EQ(cycle_model->cycles_elapsed(), 0);
+
+	lifetime_cycle_state_t state;
+	cycle_model->save_state(state);
+
+	// a full swing closes the nested ranges
+	double q_first = cycle_model->runCycleLifetime(100);
+	q_first = cycle_model->runCycleLifetime(0);
+	int cycles_first = cycle_model->cycles_elapsed();
+	EXPECT_EQ(cycles_first, 47);
+
+	cycle_model->restore_state(state);
+	cycle_model->runCycleLifetime(100);
+	EXPECT_EQ(cycle_model->runCycleLifetime(0), q_first);
+	EXPECT_EQ(cycle_model->cycles_elapsed(), cycles_first);
+}
@@ -0,0 +1,38 @@
+#ifndef __LIB_BATTERY_TEST_H__
+#define __LIB_BATTERY_TEST_H__
+
+#include <lib_battery.h>
+
+// build a battery with the given capacity and voltage models, with shared lifetime, thermal and loss models
+inline battery_t * build_battery(int chem, capacity_t * capacity, voltage_t * voltage, double dt_hour)
+{
+	double lifetime_vals[] = { 20, 0, 100, 20, 5000, 80, 80, 0, 100, 80, 1000, 80, 100, 0, 100, 100, 500, 80 };
+	util::matrix_t<double> cycles_vs_DOD;
+	cycles_vs_DOD.assign(lifetime_vals, 6, 3);
+	util::matrix_t<double> calendar_matrix;
+	lifetime_cycle_t * lifetime_cycle = new lifetime_cycle_t(cycles_vs_DOD);
+	lifetime_calendar_t * lifetime_calendar = new lifetime_calendar_t(lifetime_calendar_t::LITHIUM_ION_CALENDAR_MODEL, calendar_matrix, dt_hour);
+	lifetime_t * lifetime = new lifetime_t(lifetime_cycle, lifetime_calendar, battery_t::REPLACE_BY_CAPACITY, 85);
+
+	double temp_vals[] = { -10, 60, 0, 80, 25, 100, 40, 100 };
+	util::matrix_t<double> cap_vs_temp;
+	cap_vs_temp.assign(temp_vals, 4, 2);
+	thermal_t * thermal = new thermal_t(100, 0.6, 0.4, 0.3, 1000, 7.5, 273.15 + 20, cap_vs_temp);
+
+	size_t steps_per_year = (size_t)(8760 / dt_hour + 0.5);
+	double_vec charge_loss(steps_per_year, 0.), discharge_loss(steps_per_year, 0.), idle_loss(steps_per_year, 0.), system_loss(steps_per_year, 0.);
+	losses_t * losses = new losses_t(lifetime, thermal, capacity, losses_t::MONTHLY, charge_loss, discharge_loss, idle_loss, system_loss);
+
+	battery_t * battery = new battery_t(dt_hour, chem);
+	battery->initialize(capacity, voltage, lifetime, thermal, losses);
+	return battery;
+}
+
+// build a lithium-ion battery with 50% initial state of charge, hourly unless a time step is given
+inline battery_t * build_li_ion_battery(double capacity_Ah = 200, double dt_hour = 1)
+{
+	return build_battery(battery_t::LITHIUM_ION, new capacity_lithium_ion_t(capacity_Ah, 50, 95, 15),
+		new voltage_dynamic_t(14, 1, 50, 4.1, 4.05, 3.4, 2.25, 0.04, 2.0, 0.2, 0.2), dt_hour);
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include <lib_financial.h>
+
+namespace {
+	double npv_at(const std::vector<double> &cf, int count, double rate)
+	{
+		double npv = 0;
+		for (int j = count; j >= 0; j--)
+			npv = npv / (1 + rate) + cf[j];
+		return npv;
+	}
+}
+
+TEST(FinancialIrr, ConventionalCashFlow)
+{
+	std::vector<double> cf(11, 20.0);
+	cf[0] = -100;
+	double irr = libfin::irr_bracketed(&cf[0], 10, 0.1, 1e-12);
+	EXPECT_NEAR(npv_at(cf, 10, irr), 0, 1e-9);
+	EXPECT_NEAR(irr, 0.150984, 1e-6);
+	EXPECT_NEAR(libfin::irr(1e-12, 100, cf, 11), irr, 1e-12);
+}
+
+TEST(FinancialIrr, SignChangingCashFlow)
+{
+	// npv is zero at 10% and 20%, only the second is a return the npv falls through
+	std::vector<double> cf = { -100, 230, -132 };
+	EXPECT_NEAR(libfin::irr_bracketed(&cf[0], 2, 0.1, 1e-12), 0.2, 1e-9);
+	EXPECT_NEAR(libfin::irr_bracketed(&cf[0], 2, -0.5, 1e-12), 0.2, 1e-9);
+
+	// a large loss in the first year
+	std::vector<double> loss = { -100, 4, 0.1 };
+	double irr = libfin::irr_bracketed(&loss[0], 2);
+	EXPECT_NEAR(npv_at(loss, 2, irr), 0, 1e-6);
+	EXPECT_LT(irr, -0.9);
+
+	std::vector<double> never = { -100, -10, -10 };
+	EXPECT_TRUE(std::isnan(libfin::irr_bracketed(&never[0], 2)));
+}
+
+TEST(FinancialIrr, RootsOutsideTheFallingScan)
+{
+	// returns above 10000%
+	std::vector<double> high = { -1, 1000 };
+	EXPECT_NEAR(libfin::irr_bracketed(&high[0], 1, 0.1, 1e-12), 999, 1e-6);
+	std::vector<double> higher = { -1, 0, 1e6 };
+	EXPECT_NEAR(libfin::irr_bracketed(&higher[0], 2, 0.1, 1e-12), 999, 1e-6);
+
+	// a loan: the npv only rises through zero
+	std::vector<double> loan = { 0, 100, -150 };
+	EXPECT_NEAR(libfin::irr_bracketed(&loan[0], 2, 0.1, 1e-12), 0.5, 1e-9);
+
+	// two roots between the same scanned rates, about -37.6% and -31.5%, the npv falls through the second
+	std::vector<double> close = { -684.788, 56.1144, -21.4734, 73.5046, 109.365, 98.5701, 6.46461, -56.1263 };
+	double irr = libfin::irr_bracketed(&close[0], 7, 0.1, 1e-12);
+	EXPECT_NEAR(npv_at(close, 7, irr), 0, 1e-6);
+	EXPECT_NEAR(irr, -0.315166, 1e-6);
+}
+
+TEST(FinancialIrr, RunningMatchesEachYear)
+{
+	// construction spending, a mid-life repowering and decommissioning
+	std::vector<double> cf(26, 14.0);
+	cf[0] = -100;
+	cf[1] = -40;
+	cf[12] = -90;
+	cf[25] = -60;
+
+	std::vector<double> running(26, 0.0);
+	libfin::irr_running(&cf[0], 25, &running[0], 0.1, 1e-12);
+	for (int i = 1; i <= 25; i++)
+	{
+		double irr = libfin::irr_bracketed(&cf[0], i, 0.1, 1e-12);
+		if (std::isnan(irr))
+			EXPECT_TRUE(std::isnan(running[i])) << "year " << i;
+		else
+			EXPECT_NEAR(running[i], irr, 1e-9) << "year " << i;
+	}
+	EXPECT_NEAR(npv_at(cf, 2, running[2]), 0, 1e-6);
+	EXPECT_NEAR(npv_at(cf, 25, running[25]), 0, 1e-6);
+}
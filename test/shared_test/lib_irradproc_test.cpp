@@ -575,4 +575,122 @@ TEST_F(BifacialIrradTest, TestRearSurfaceIrradiance)
 			ASSERT_NEAR(rearIrradiance[i], expectedRearIrradiance[i], e) << "Failed at t = " << t << " i = " << i;
 		}
 	}
-}
\ No newline at end of file
+}
+/**
+*   Test the whole-series rear-side calculation, which reuses the view factors across timesteps, against the bifacialvf rear irradiance
+*/
+TEST_F(BifacialIrradTest, TestRearSideSeries)
+{
+	std::vector<double> weather, averageIrradiance;
+	readDataFromTextFile(weatherFile, weather);
+	readDataFromTextFile(averageIrradianceFile, averageIrradiance);
+	ASSERT_EQ(weather.size(), 10 * numberOfTimeSteps);
+	ASSERT_EQ(averageIrradiance.size(), 2 * numberOfTimeSteps);
+
+	std::vector<double> beamSeries, diffuseSeries, azimuthSeries, zenithSeries, elevationSeries;
+	for (size_t t = 0; t < numberOfTimeSteps; t++) {
+		beamSeries.push_back(weather[10 * t + 5]);
+		diffuseSeries.push_back(weather[10 * t + 6]);
+		azimuthSeries.push_back(weather[10 * t + 7]);
+		zenithSeries.push_back(weather[10 * t + 8]);
+		elevationSeries.push_back(weather[10 * t + 9]);
+	}
+
+	std::vector<double> rearIrradiance;
+	ASSERT_EQ(irr->calc_rear_side_series(transmissionFactor, bifaciality, clearanceGround, slopeLength, azimuthSeries, zenithSeries, elevationSeries, beamSeries, diffuseSeries, rearIrradiance), 0);
+	ASSERT_EQ(rearIrradiance.size(), numberOfTimeSteps);
+
+	for (size_t t = 0; t < numberOfTimeSteps; t++) {
+		ASSERT_NEAR(rearIrradiance[t], averageIrradiance[2 * t + 1] * bifaciality, e) << "Failed at t = " << t;
+	}
+}
+
+/**
+*   Test the whole-series POA decomposition against poaDecomp run one step at a time, with and without threads and warm starts
+*/
+TEST(PoaDecompBatchTest, MatchesPerStepDecomposition)
+{
+	const size_t ndays = 4, nsteps = 24 * ndays;
+	const double lat = 33.45, lon = -112.07, tz = -7, tilt = 40, azimuth = 180;
+
+	// synthetic measured POA from Perez with a fixed sky, missing (-999) while the sun is down
+	poaDecompReq req;
+	req.elev = 339;
+	std::vector<double> alb(nsteps, 0.2), tDew(nsteps, 0.0);
+	for (size_t i = 0; i < nsteps; i++) {
+		double sun[9], angle[5], poa[3], diffc[3];
+		solarpos(2018, 6, 1 + (int)(i / 24), (int)(i % 24), 30.0, lat, lon, tz, sun);
+		tDew[i] = 5.0 + 0.5 * (i % 24);
+		if (sun[2] > 0) {
+			incidence(0, tilt, azimuth, 45.0, sun[1], sun[0], false, 0.4, angle);
+			double dn = 900 * sin(sun[2]), df = 60 + 10 * (i % 5);
+			perez(sun[8], dn, df, 0.2, angle[0], angle[1], sun[1], poa, diffc);
+			req.POA.push_back(poa[0] + poa[1] + poa[2]);
+			req.inc.push_back(angle[0]);
+			req.tilt.push_back(angle[1]);
+			req.zen.push_back(sun[1]);
+			req.exTer.push_back(sun[8]);
+		}
+		else {
+			req.POA.push_back(-999);
+			req.inc.push_back(-999);
+			req.tilt.push_back(-999);
+			req.zen.push_back(-999);
+			req.exTer.push_back(-999);
+		}
+	}
+
+	poaDecompSeries serial, threaded, warm;
+	size_t coldIterations = poaDecompBatch(req, alb, tDew, false, 1, serial);
+	EXPECT_EQ(poaDecompBatch(req, alb, tDew, false, 3, threaded), coldIterations);
+	size_t warmIterations = poaDecompBatch(req, alb, tDew, true, 2, warm);
+	EXPECT_LT(warmIterations, coldIterations);
+
+	size_t nsolved = 0, nbehind = 0;
+	double coldTotal = 0, warmTotal = 0;
+	for (size_t i = 0; i < nsteps; i++) {
+		ASSERT_EQ(serial.solved[i], req.zen[i] > -998 ? 1 : 0) << "Step " << i;
+		if (!serial.solved[i]) continue;
+		nsolved++;
+		if (req.inc[i] >= M_PI / 2) nbehind++;
+
+		double angle[5] = { req.inc[i], req.tilt[i], 0, 0, 0 };
+		double sun[9] = { 0, req.zen[i], 0, 0, 0, 0, 0, 0, req.exTer[i] };
+		double dn, df, gh, poa[3], diffc[3];
+		req.i = i;
+		req.dayStart = i - i % 24;
+		req.doy = (int)(i / 24);
+		req.tDew = tDew[i];
+		int code = poaDecomp(req.POA[i], angle, sun, alb[i], &req, dn, df, gh, poa, diffc);
+
+		EXPECT_EQ(serial.errorcode[i], code) << "Step " << i;
+		EXPECT_DOUBLE_EQ(serial.dn[i], dn) << "Step " << i;
+		EXPECT_DOUBLE_EQ(serial.df[i], df) << "Step " << i;
+		EXPECT_DOUBLE_EQ(serial.gh[i], gh) << "Step " << i;
+		for (int k = 0; k < 3; k++)
+			EXPECT_DOUBLE_EQ(serial.poa[k][i], poa[k]) << "Step " << i;
+		EXPECT_DOUBLE_EQ(threaded.dn[i], dn) << "Step " << i;
+		EXPECT_DOUBLE_EQ(threaded.df[i], df) << "Step " << i;
+
+		coldTotal += serial.poa[0][i] + serial.poa[1][i] + serial.poa[2][i];
+		warmTotal += warm.poa[0][i] + warm.poa[1][i] + warm.poa[2][i];
+	}
+	EXPECT_GT(nsolved, 40);
+	EXPECT_GT(nbehind, 0);
+	EXPECT_NEAR(warmTotal, coldTotal, coldTotal * 0.01);
+
+	// poaDecomp returns the batch results once they are attached
+	req.batch = serial;
+	req.useBatch = true;
+	size_t i = 12;
+	double angle[5] = { req.inc[i], req.tilt[i], 0, 0, 0 };
+	double sun[9] = { 0, req.zen[i], 0, 0, 0, 0, 0, 0, req.exTer[i] };
+	double dn, df, gh, poa[3], diffc[3];
+	req.i = i;
+	req.dayStart = 0;
+	req.doy = 0;
+	req.tDew = tDew[i];
+	poaDecomp(req.POA[i], angle, sun, alb[i], &req, dn, df, gh, poa, diffc);
+	EXPECT_DOUBLE_EQ(serial.dn[i], dn);
+	EXPECT_DOUBLE_EQ(serial.gh[i], gh);
+}
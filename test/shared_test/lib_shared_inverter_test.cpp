@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <lib_shared_inverter.h>
+#include <bsplinebuilder.h>
+#include <datatable.h>
 
 /**
 * Shared Inverter Class test
@@ -186,3 +188,109 @@ TEST_F(sharedInverterTest, tempDerateTest_lib_shared_inverter) {
 	EXPECT_NEAR(pAC, 60, e) << "case 9";
 
 }
+
+/// DC power series covering night, charging (negative), part load and clipping
+static void batchInputs(std::vector<double> &dc_kW, std::vector<double> &V, std::vector<double> &T)
+{
+	for (int i = 0; i < 200; i++) {
+		dc_kW.push_back(-1.0 + 0.06 * i);
+		V.push_back(250. + 2.5 * i);
+		T.push_back(10. + 0.2 * i);
+	}
+}
+
+/// Checks the batch calculation against one calculateACPower call per step
+static void checkBatch(SharedInverter &inv)
+{
+	std::vector<double> dc_kW, V, T, ac_kW, eff;
+	batchInputs(dc_kW, V, T);
+	inv.calculateACPowerBatch(dc_kW, V, T, ac_kW, eff);
+	ASSERT_EQ(ac_kW.size(), dc_kW.size());
+	for (size_t i = 0; i < dc_kW.size(); i++) {
+		inv.calculateACPower(dc_kW[i], V[i], T[i]);
+		EXPECT_DOUBLE_EQ(ac_kW[i], inv.powerAC_kW) << "step " << i;
+		EXPECT_DOUBLE_EQ(eff[i], inv.efficiencyAC) << "step " << i;
+	}
+}
+
+TEST_F(sharedInverterTest, batchSandia_lib_shared_inverter) {
+	sinv.Paco = 3800.; sinv.Pdco = 3928.9; sinv.Vdco = 398.5; sinv.Pso = 19.4; sinv.Pntare = 0.99;
+	sinv.C0 = -6.5e-6; sinv.C1 = 1.9e-5; sinv.C2 = 0.0012; sinv.C3 = 0.001;
+	SharedInverter sandia(SharedInverter::SANDIA_INVERTER, 2, &sinv, &plinv, &ondinv);
+	checkBatch(sandia);
+
+	std::vector<double> c1 = { 300., 30., -0.01 };
+	std::vector<std::vector<double>> curves = { c1 };
+	sandia.setTempDerateCurves(curves);
+	checkBatch(sandia);
+}
+
+TEST_F(sharedInverterTest, batchLengthMismatch_lib_shared_inverter) {
+	plinv.Paco = 3800.; plinv.Pdco = 3928.9; plinv.Vdco = 398.5; plinv.Pntare = 0.99;
+	plinv.Partload = { 0., 5., 10., 20., 50., 75., 100., 120. };
+	plinv.Efficiency = { 0., 80., 90., 95., 97., 96.8, 96.5, 96. };
+	SharedInverter partload(SharedInverter::PARTLOAD_INVERTER, 2, &sinv, &plinv, &ondinv);
+
+	std::vector<double> dc_kW, V, T, ac_kW, eff;
+	batchInputs(dc_kW, V, T);
+	std::vector<double> shortV(V.begin(), V.end() - 1), shortT(T.begin(), T.end() - 1);
+	EXPECT_THROW(partload.calculateACPowerBatch(dc_kW, shortV, T, ac_kW, eff), std::invalid_argument);
+	EXPECT_THROW(partload.calculateACPowerBatch(dc_kW, V, shortT, ac_kW, eff), std::invalid_argument);
+	EXPECT_THROW(partload.calculateACPowerBatch(dc_kW, V, std::vector<double>(), ac_kW, eff), std::invalid_argument);
+}
+
+TEST_F(sharedInverterTest, batchPartload_lib_shared_inverter) {
+	plinv.Paco = 3800.; plinv.Pdco = 3928.9; plinv.Vdco = 398.5; plinv.Pntare = 0.99;
+	plinv.Partload = { 0., 5., 10., 20., 50., 75., 100., 120. };
+	plinv.Efficiency = { 0., 80., 90., 95., 97., 96.8, 96.5, 96. };
+	SharedInverter partload(SharedInverter::PARTLOAD_INVERTER, 2, &sinv, &plinv, &ondinv);
+	checkBatch(partload);
+}
+
+TEST_F(sharedInverterTest, batchOnd_lib_shared_inverter) {
+	ondinv.PNomConv = 4000.; ondinv.PMaxOUT = 4200.; ondinv.VOutConv = 240.;
+	ondinv.VMppMin = 200.; ondinv.VMPPMax = 600.; ondinv.VAbsMax = 700.; ondinv.PSeuil = 20.;
+	ondinv.ModeOper = "MPPT"; ondinv.CompPMax = "Lim"; ondinv.CompVMax = "Lim"; ondinv.ModeAffEnum = "Efficiencyf_PIn";
+	ondinv.PNomDC = 4100.; ondinv.PMaxDC = 4400.; ondinv.IMaxDC = 20.; ondinv.INomDC = 15.;
+	ondinv.INomAC = 17.; ondinv.IMaxAC = 18.;
+	ondinv.TPNom = 45.; ondinv.TPMax = 30.; ondinv.TPLim1 = 55.; ondinv.TPLimAbs = 65.;
+	ondinv.PLim1 = 3500.; ondinv.PLimAbs = 3000.;
+	ondinv.VNomEff[0] = 250.; ondinv.VNomEff[1] = 400.; ondinv.VNomEff[2] = 550.;
+	ondinv.NbInputs = 1; ondinv.NbMPPT = 1;
+	ondinv.Aux_Loss = 5.; ondinv.Night_Loss = 1.; ondinv.lossRDc = 0.01; ondinv.lossRAc = 0.01;
+	ondinv.doAllowOverpower = 1; ondinv.doUseTemperatureLimit = 1;
+
+	double pdc[] = { 40., 100., 200., 400., 800., 1200., 2000., 3000., 4000., 4400. };
+	double eta[] = { 0.80, 0.88, 0.925, 0.948, 0.962, 0.967, 0.969, 0.968, 0.966, 0.964 };
+	ondinv.effCurve_elements = 10;
+	for (int j = 0; j < 3; j++) {
+		for (int i = 0; i < 100; i++) {
+			ondinv.effCurve_Pdc[j][i] = (i < 10) ? pdc[i] : 0.;
+			ondinv.effCurve_eta[j][i] = (i < 10) ? eta[i] - 0.004 * j : 0.;
+			ondinv.effCurve_Pac[j][i] = ondinv.effCurve_Pdc[j][i] * ondinv.effCurve_eta[j][i];
+		}
+	}
+	ondinv.initializeManual();
+
+	SharedInverter ond(SharedInverter::OND_INVERTER, 1, &sinv, &plinv, &ondinv);
+	checkBatch(ond);
+
+	// tabulated efficiency curves differ from the B-spline through the same points by less than 1e-6 over the whole spline range,
+	// so AC power differs from the spline evaluation by less than 1e-6 of the DC power
+	for (int j = 0; j < 3; j++) {
+		SPLINTER::DataTable samples;
+		SPLINTER::DenseVector x(1);
+		for (int i = 2; i < 10; i++) {
+			x(0) = ondinv.effCurve_Pdc[j][i];
+			samples.addSample(x, ondinv.effCurve_eta[j][i]);
+		}
+		SPLINTER::BSpline spline = SPLINTER::BSpline::Builder(samples).degree(3).build();
+		double max_diff = 0;
+		for (double p = pdc[2]; p <= pdc[9]; p += 0.5) {
+			x(0) = p;
+			max_diff = fmax(max_diff, fabs(ondinv.calcEfficiency(p, j) - spline.eval(x)));
+		}
+		EXPECT_LT(max_diff, 1e-6) << "curve " << j;
+		EXPECT_GT(max_diff, 0) << "curve " << j << " is interpolated, not evaluated";
+	}
+}
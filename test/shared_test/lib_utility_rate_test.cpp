@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <lib_utility_rate.h>
+
+namespace {
+	// period 2 on weekday afternoons, period 1 otherwise, with a flat demand charge tiered at 10 kW
+	UtilityRate * build_demand_rate(bool singlePeak)
+	{
+		util::matrix_t<size_t> ecSchedule(12, 24, 1);
+		double ecVals[] = { 1, 1, 1e38, 0, 0.10, 0 };
+		util::matrix_t<double> ecRates;
+		ecRates.assign(ecVals, 1, 6);
+
+		util::matrix_t<size_t> dcWeekday(12, 24, 1), dcWeekend(12, 24, 1);
+		for (size_t m = 0; m < 12; m++)
+			for (size_t h = 12; h < 18; h++)
+				dcWeekday(m, h) = 2;
+		double dcVals[] = { 1, 1, 1e38, 5, 2, 1, 20, 10, 2, 2, 1e38, 15 };
+		util::matrix_t<double> dcRates;
+		dcRates.assign(dcVals, 3, 4);
+
+		util::matrix_t<double> dcFlat(24, 4);
+		for (size_t m = 0; m < 12; m++)
+		{
+			double tiers[] = { (double)m, 1, 10, 2, (double)m, 2, 1e38, 3 };
+			for (size_t k = 0; k < 8; k++)
+				dcFlat(2 * m + k / 4, k % 4) = tiers[k];
+		}
+		return new UtilityRate(ecSchedule, ecSchedule, ecRates, dcWeekday, dcWeekend, dcRates, dcFlat, singlePeak);
+	}
+}
+
+TEST(UtilityRateDemandCharge, TracksMonthlyAndPeriodPeaks)
+{
+	UtilityRate * rate = build_demand_rate(false);
+	UtilityRateCalculator calculator(rate, 1);
+
+	// first day of the year is a Monday: 8 kW at night, 25 kW at 1 pm, 30 kW at 8 pm
+	for (size_t hour = 0; hour < 24; hour++)
+		calculator.updateLoad(hour == 13 ? 25 : (hour == 20 ? 30 : 8));
+
+	// flat 10 * 2 + 20 * 3, period 1 30 * 5, period 2 20 * 10 + 5 * 15
+	EXPECT_NEAR(calculator.getDemandCharge(), 80 + 150 + 275, 1e-9);
+
+	// below both peaks costs nothing, a new afternoon peak only adds its own period and the flat charge
+	EXPECT_NEAR(calculator.getMarginalDemandCost(20), 0, 1e-9);
+	for (size_t hour = 24; hour < 36; hour++)
+		calculator.updateLoad(0);
+	EXPECT_NEAR(calculator.getMarginalDemandCost(29), 4 * 15, 1e-9);
+	EXPECT_NEAR(calculator.getMarginalDemandCost(32), 2 * 3 + 7 * 15, 1e-9);
+
+	// the first hour of February starts new peaks
+	for (size_t hour = 36; hour < 744; hour++)
+		calculator.updateLoad(1);
+	EXPECT_NEAR(calculator.getMarginalDemandCost(4), 4 * 2 + 4 * 5, 1e-9);
+	calculator.updateLoad(4);
+	EXPECT_NEAR(calculator.getDemandCharge(), 4 * 2 + 4 * 5, 1e-9);
+	delete rate;
+}
+
+TEST(UtilityRateDemandCharge, MarginalCostMatchesChargeIncrease)
+{
+	for (int singlePeak = 0; singlePeak < 2; singlePeak++)
+	{
+		UtilityRate * rate = build_demand_rate(singlePeak != 0);
+		UtilityRateCalculator calculator(rate, 4);
+
+		// a week of quarter hours ending in the first days of February
+		for (size_t step = 0; step < 4 * 24 * 35; step++)
+		{
+			double load = 12 + 10 * std::sin(0.05 * step) + 6 * std::sin(0.013 * step);
+			UtilityRateCalculator candidate(calculator);
+			double before = (step % (4 * 744) == 0) ? 0 : calculator.getDemandCharge();
+			double marginal = calculator.getMarginalDemandCost(load);
+			candidate.updateLoad(load);
+			EXPECT_NEAR(candidate.getDemandCharge() - before, marginal, 1e-9) << "step " << step << " single peak " << singlePeak;
+			calculator.updateLoad(load);
+		}
+		delete rate;
+	}
+}
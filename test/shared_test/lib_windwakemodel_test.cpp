@@ -184,4 +184,22 @@ TEST_F(eddyViscosityWakeModelTest, wakeCalcTriangleInterference_lib_windwakemode
 		EXPECT_NEAR(turbIntensity[i], 0.1, e) << "Turb intensity at turbine " << i;
 	}
 	EXPECT_EQ(turbIntensity[1], turbIntensity[2]);
-}
\ No newline at end of file
+}
+/// Two columns of turbines far apart crosswind: the second column's upwind turbine reuses the first's wake
+TEST_F(eddyViscosityWakeModelTest, wakeCalcSeparateColumns_lib_windwakemodel){
+	eddyViscosityWakeModel columns(4, &wt, 0.1);
+	distDownwind = { 0, 0, 10, 10 };
+	distCrosswind = { 0, 40, 0, 40 };
+	thrust.assign(4, 0.47669);
+	power.assign(4, 1190);
+	eff.assign(4, 0);
+	windSpeed.assign(4, 10.);
+	turbIntensity.assign(4, 0.1);
+
+	columns.wakeCalculations(seaLevelAirDensity, &distDownwind[0], &distCrosswind[0], &power[0], &eff[0], &thrust[0], &windSpeed[0], &turbIntensity[0]);
+	EXPECT_EQ(windSpeed[1], 10.) << "Turbine 1 is outside the wake of turbine 0";
+	EXPECT_LT(windSpeed[2], 10.);
+	EXPECT_EQ(windSpeed[2], windSpeed[3]);
+	EXPECT_EQ(power[2], power[3]);
+	EXPECT_EQ(turbIntensity[2], turbIntensity[3]);
+}
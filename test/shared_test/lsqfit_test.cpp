@@ -0,0 +1,71 @@
+#include <math.h>
+#include <gtest/gtest.h>
+
+#include "lsqfit.h"
+
+namespace {
+	double rsh_eqn(double x, double *par, void *)
+	{
+		return par[0] + par[1] * (pow(1000 / x, par[2]) - 1);
+	}
+
+	void rsh_deriv(double x, double *par, void *, double *dfdp)
+	{
+		double p = pow(1000 / x, par[2]);
+		dfdp[0] = 1;
+		dfdp[1] = p - 1;
+		dfdp[2] = par[1] * p * log(1000 / x);
+	}
+
+	const size_t npts = 7;
+	double irr[npts] = { 100, 200, 400, 600, 800, 1000, 1100 };
+}
+
+/// Analytic derivatives recover the same parameters as finite differences
+TEST(LsqfitTest, AnalyticDerivativesMatchFiniteDifferences){
+	double truth[3] = { 300, 45, 1.3 };
+	double y[npts];
+	for (size_t i = 0; i < npts; i++) y[i] = rsh_eqn(irr[i], truth, 0);
+
+	double numeric[3] = { 1000, 100, 0.25 };
+	ASSERT_GT(lsqfit(rsh_eqn, 0, numeric, 3, irr, y, npts, 1e-10, 500, 50000), 0);
+
+	double analytic[3] = { 1000, 100, 0.25 };
+	double chisq = -1;
+	ASSERT_GT(lsqfit_deriv(rsh_eqn, rsh_deriv, 0, analytic, 3, irr, y, npts, 1e-10, 500, 50000, &chisq), 0);
+
+	for (int j = 0; j < 3; j++)
+	{
+		EXPECT_NEAR(analytic[j], truth[j], 1e-4 * truth[j]) << "par " << j;
+		EXPECT_NEAR(analytic[j], numeric[j], 1e-4 * truth[j]) << "par " << j;
+	}
+	EXPECT_LT(chisq, 1e-8);
+}
+
+/// Multi-start keeps the best converged fit and gives the same answer for any thread count
+TEST(LsqfitTest, MultistartIndependentOfThreads){
+	double truth[3] = { 300, 45, 1.3 };
+	double y[npts];
+	for (size_t i = 0; i < npts; i++) y[i] = rsh_eqn(irr[i], truth, 0) * (1 + 0.01 * ((i % 3) - 1.0));
+
+	const double starts[12] = { 1000, 100, 0.25,   1000, 1000, 0.5,   100, 10, 1.0,   300, 50, 2.0 };
+	double serial[3], threaded[3];
+	ASSERT_GT(lsqfit_multistart(rsh_eqn, rsh_deriv, 0, serial, 3, starts, 4, irr, y, npts, 1e-9, 500, 50000, 1), 0);
+	ASSERT_GT(lsqfit_multistart(rsh_eqn, rsh_deriv, 0, threaded, 3, starts, 4, irr, y, npts, 1e-9, 500, 50000, 3), 0);
+
+	double best = 0, single = 0;
+	for (size_t i = 0; i < npts; i++)
+	{
+		double r = y[i] - rsh_eqn(irr[i], serial, 0);
+		best += r * r;
+	}
+	for (int k = 0; k < 4; k++)
+	{
+		double p[3] = { starts[3 * k], starts[3 * k + 1], starts[3 * k + 2] };
+		if (lsqfit_deriv(rsh_eqn, rsh_deriv, 0, p, 3, irr, y, npts, 1e-9, 500, 50000, &single) > 0)
+			EXPECT_LE(best, single * (1 + 1e-12)) << "start " << k;
+	}
+
+	for (int j = 0; j < 3; j++)
+		EXPECT_EQ(serial[j], threaded[j]) << "par " << j;
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../ssc/sscapi.h"
+
+namespace {
+	// celltype, Vmp, Imp, Voc, Isc, alpha_isc, beta_voc, gamma_pmp, Nser
+	const int nmods = 4;
+	const double modules[nmods][9] = {
+		{ 0, 31.4, 8.6, 38.9, 9.16, 0.00412, -0.118, -0.41, 60 },
+		{ 1, 30.2, 8.28, 37.8, 8.83, 0.00452, -0.123, -0.45, 60 },
+		{ 2, 71.2, 1.64, 88.0, 1.83, 0.00073, -0.25, -0.34, 216 },
+		{ 0, 40.0, 8.0, 30.0, 9.0, 0.004, -0.12, -0.4, 60 }, // Vmp > Voc, cannot be solved
+	};
+	const char *names[] = { "Vmp", "Imp", "Voc", "Isc", "alpha_isc", "beta_voc", "gamma_pmp", "Nser" };
+	const char *outputs[] = { "a", "Il", "Io", "Rs", "Rsh", "Adj", "status" };
+
+	ssc_data_t batch_data(int nthreads)
+	{
+		ssc_data_t data = ssc_data_create();
+		ssc_number_t col[nmods];
+		for (int i = 0; i < nmods; i++) col[i] = (ssc_number_t)modules[i][0];
+		ssc_data_set_array(data, "celltype", col, nmods);
+		for (int j = 0; j < 8; j++)
+		{
+			for (int i = 0; i < nmods; i++) col[i] = (ssc_number_t)modules[i][j + 1];
+			ssc_data_set_array(data, names[j], col, nmods);
+		}
+		ssc_data_set_number(data, "nthreads", (ssc_number_t)nthreads);
+		return data;
+	}
+}
+
+/// Batch fitting matches 6parsolve module by module and does not depend on the number of threads
+TEST(CM6parsolveBatch, MatchesSingleModuleSolver){
+	ssc_data_t serial = batch_data(1);
+	ssc_data_t threaded = batch_data(3);
+	const char *csv = "6parsolve_batch_test.csv";
+	ssc_data_set_string(threaded, "output_file", csv);
+
+	ssc_module_t batch = ssc_module_create("6parsolve_batch");
+	ASSERT_TRUE(batch != NULL);
+	ASSERT_TRUE(ssc_module_exec(batch, serial) != 0);
+	ASSERT_TRUE(ssc_module_exec(batch, threaded) != 0);
+	ssc_module_free(batch);
+
+	ssc_number_t nsolved;
+	ssc_data_get_number(threaded, "nsolved", &nsolved);
+	EXPECT_EQ(nsolved, nmods - 1);
+
+	for (int k = 0; k < 7; k++)
+	{
+		int n1 = 0, n2 = 0;
+		ssc_number_t *v1 = ssc_data_get_array(serial, outputs[k], &n1);
+		ssc_number_t *v2 = ssc_data_get_array(threaded, outputs[k], &n2);
+		ASSERT_EQ(n1, nmods);
+		ASSERT_EQ(n2, nmods);
+		for (int i = 0; i < nmods; i++)
+			EXPECT_EQ(v1[i], v2[i]) << outputs[k] << " module " << i;
+	}
+
+	int n = 0;
+	ssc_number_t *status = ssc_data_get_array(threaded, "status", &n);
+	EXPECT_LT(status[nmods - 1], 0);
+
+	const char *celltypes[] = { "mono", "multi", "cdte" };
+	for (int i = 0; i < nmods - 1; i++)
+	{
+		EXPECT_GE(status[i], 0) << "module " << i;
+
+		ssc_data_t single = ssc_data_create();
+		ssc_data_set_string(single, "celltype", celltypes[(int)modules[i][0]]);
+		for (int j = 0; j < 8; j++)
+			ssc_data_set_number(single, names[j], (ssc_number_t)modules[i][j + 1]);
+		ssc_module_t mod = ssc_module_create("6parsolve");
+		ASSERT_TRUE(ssc_module_exec(mod, single) != 0) << "module " << i;
+		ssc_module_free(mod);
+
+		for (int k = 0; k < 6; k++)
+		{
+			ssc_number_t expected;
+			ssc_data_get_number(single, outputs[k], &expected);
+			ssc_number_t *v = ssc_data_get_array(threaded, outputs[k], &n);
+			EXPECT_EQ(v[i], expected) << outputs[k] << " module " << i;
+		}
+		ssc_data_free(single);
+	}
+
+	// the CSV has a header and one row per module
+	FILE *fp = fopen(csv, "r");
+	ASSERT_TRUE(fp != NULL);
+	char line[512];
+	int rows = 0;
+	while (fgets(line, sizeof(line), fp)) rows++;
+	fclose(fp);
+	remove(csv);
+	EXPECT_EQ(rows, nmods + 1);
+
+	ssc_data_free(serial);
+	ssc_data_free(threaded);
+}
+
+/// Benchmark of library fitting throughput: 6parsolve run once per module against 6parsolve_batch with one thread and with all cores.
+/// Run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST(CM6parsolveBatch, DISABLED_BenchmarkModulesPerSecond){
+	// library of solvable modules, varying the datasheet values of the first three test modules by up to +/-5%
+	const int nlib = 300;
+	const char *celltypes[] = { "mono", "multi", "cdte" };
+	std::vector<std::vector<ssc_number_t> > cols(9, std::vector<ssc_number_t>(nlib));
+	for (int i = 0; i < nlib; i++)
+	{
+		const double *m = modules[i % 3];
+		double f = 0.95 + 0.1 * ((i * 37) % 101) / 100.0;
+		cols[0][i] = (ssc_number_t)m[0];
+		for (int j = 1; j < 9; j++)
+			cols[j][i] = (ssc_number_t)((j == 1 || j == 3) ? m[j] * f : m[j]);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int nsolved_single = 0;
+	for (int i = 0; i < nlib; i++)
+	{
+		ssc_data_t single = ssc_data_create();
+		ssc_data_set_string(single, "celltype", celltypes[(int)cols[0][i]]);
+		for (int j = 0; j < 8; j++)
+			ssc_data_set_number(single, names[j], cols[j + 1][i]);
+		ssc_module_t mod = ssc_module_create("6parsolve");
+		if (ssc_module_exec(mod, single) != 0) nsolved_single++;
+		ssc_module_free(mod);
+		ssc_data_free(single);
+	}
+	double t_single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("6parsolve, one module per run: %d modules (%d solved) in %.2f s, %.0f modules/s\n", nlib, nsolved_single, t_single, nlib / t_single);
+
+	for (int nthreads = 1; nthreads >= 0; nthreads--)
+	{
+		ssc_data_t data = ssc_data_create();
+		ssc_data_set_array(data, "celltype", &cols[0][0], nlib);
+		for (int j = 0; j < 8; j++)
+			ssc_data_set_array(data, names[j], &cols[j + 1][0], nlib);
+		ssc_data_set_number(data, "nthreads", (ssc_number_t)nthreads);
+
+		start = std::chrono::steady_clock::now();
+		ssc_module_t batch = ssc_module_create("6parsolve_batch");
+		ASSERT_TRUE(ssc_module_exec(batch, data) != 0);
+		ssc_module_free(batch);
+		double t_batch = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ssc_number_t nsolved;
+		ssc_data_get_number(data, "nsolved", &nsolved);
+		printf("6parsolve_batch, nthreads=%d: %d modules (%d solved) in %.2f s, %.0f modules/s\n", nthreads, nlib, (int)nsolved, t_batch, nlib / t_batch);
+		ssc_data_free(data);
+	}
+}
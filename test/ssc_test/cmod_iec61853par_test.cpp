@@ -0,0 +1,103 @@
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../ssc/sscapi.h"
+#include "lib_pvmodel.h"
+
+namespace {
+	/// IEC 61853-1 power matrix of a 60 cell mono-Si module generated from a single diode model with known parameters
+	ssc_data_t iec61853_data()
+	{
+		const double irr[] = { 100, 100, 200, 200, 200, 400, 400, 400, 400, 600, 600, 600, 600,
+			800, 800, 800, 800, 1000, 1000, 1000, 1000, 1100, 1100, 1100 };
+		const double tc[] = { 15, 25, 15, 25, 50, 15, 25, 50, 75, 15, 25, 50, 75,
+			15, 25, 50, 75, 15, 25, 50, 75, 25, 50, 75 };
+		const size_t nrows = sizeof(irr) / sizeof(irr[0]);
+
+		// reference parameters at 1000 W/m2 and 25 C
+		const double Il_ref = 8.8, Io_ref = 1e-10, a_ref = 1.619, Rs = 0.35, Rsh_ref = 300, Eg_ref = 1.121, alpha = 0.0005;
+		const double k = 8.618e-5, Tref = 298.15;
+
+		std::vector<ssc_number_t> input(nrows * 6);
+		for (size_t i = 0; i < nrows; i++)
+		{
+			double T = tc[i] + 273.15;
+			double Eg = Eg_ref * (1 - 0.0002677 * (T - Tref));
+			double Il = Il_ref * irr[i] / 1000 * (1 + alpha * (tc[i] - 25));
+			double Io = Io_ref * pow(T / Tref, 3) * exp(Eg_ref / (k * Tref) - Eg / (k * T));
+			double a = a_ref * T / Tref;
+			double Rsh = Rsh_ref * 1000 / irr[i];
+
+			double Voc = openvoltage_5par(45, a, Il, Io, Rsh);
+			double Vmp, Imp;
+			double Pmp = maxpower_5par(Voc, a, Il, Io, Rs, Rsh, &Vmp, &Imp);
+			double Isc = current_5par(0, Il, a, Il, Io, Rs, Rsh);
+
+			ssc_number_t row[6] = { (ssc_number_t)irr[i], (ssc_number_t)tc[i], (ssc_number_t)Pmp, (ssc_number_t)Vmp, (ssc_number_t)Voc, (ssc_number_t)Isc };
+			for (size_t j = 0; j < 6; j++)
+				input[i * 6 + j] = row[j];
+		}
+
+		ssc_data_t data = ssc_data_create();
+		ssc_data_set_matrix(data, "input", &input[0], (int)nrows, 6);
+		ssc_data_set_number(data, "nser", 60);
+		ssc_data_set_number(data, "type", 0);
+		ssc_data_set_number(data, "verbose", 0);
+		return data;
+	}
+
+	const char *outputs[] = { "alphaIsc", "betaVoc", "gammaPmp", "n", "Il", "Io", "C1", "C2", "C3", "D1", "D2", "D3", "Egref" };
+	const int noutputs = sizeof(outputs) / sizeof(outputs[0]);
+}
+
+/// Fitted parameters for a module matrix generated with known parameters, independent of the number of threads.
+/// The multi-start sub-fits keep the lowest chi^2 of several starting points, so they can select a different fit than the
+/// single starting point used before. On this matrix both give the same parameters to within 1e-6.
+TEST(CMIec61853par, FitsGeneratedMatrix){
+	ssc_number_t expected[noutputs] = { 0.0043948642f, -0.135370478f, -0.410401255f, 1.05167019f, 8.77517986f, 1.05542436e-10f,
+		304.907806f, 302.276489f, 1.00046635f, 0.346414119f, 0, -0.000702485908f, 1.07961512f };
+
+	ssc_number_t results[2][noutputs];
+	for (int t = 0; t < 2; t++)
+	{
+		ssc_data_t data = iec61853_data();
+		ssc_data_set_number(data, "nthreads", (ssc_number_t)(t == 0 ? 1 : 3));
+		ssc_module_t module = ssc_module_create("iec61853par");
+		ASSERT_TRUE(module != NULL);
+		ASSERT_TRUE(ssc_module_exec(module, data) != 0);
+		ssc_module_free(module);
+		for (int k = 0; k < noutputs; k++)
+			ssc_data_get_number(data, outputs[k], &results[t][k]);
+		ssc_data_free(data);
+	}
+
+	for (int k = 0; k < noutputs; k++)
+	{
+		EXPECT_NEAR(results[0][k], expected[k], 1e-5 * fabs(expected[k])) << outputs[k];
+		EXPECT_EQ(results[0][k], results[1][k]) << outputs[k];
+	}
+
+	// close to the parameters the matrix was generated with
+	EXPECT_NEAR(results[0][3], 1.05, 0.01) << "Diode factor";
+	EXPECT_NEAR(results[0][4], 8.8, 0.05) << "Light current";
+	EXPECT_NEAR(results[0][9], 0.35, 0.01) << "Series resistance";
+}
+
+/// Benchmark of a complete parameter fit on the generated IEC 61853 matrix.
+/// Run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST(CMIec61853par, DISABLED_BenchmarkFit){
+	ssc_module_exec_set_print(0);
+	ssc_data_t data = iec61853_data();
+	ssc_module_t module = ssc_module_create("iec61853par");
+	const int reps = 300;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int r = 0; r < reps; r++)
+		ASSERT_TRUE(ssc_module_exec(module, data) != 0);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / reps;
+	printf("iec61853par: %.3f ms per fit\n", ms);
+	ssc_module_free(module);
+	ssc_data_free(data);
+	ssc_module_exec_set_print(1);
+}
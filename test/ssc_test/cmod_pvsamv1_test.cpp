@@ -217,6 +217,33 @@ TEST_F(CMPvsamv1PowerIntegration, NoFinancialModelSkyDiffuseAndIrradModels)
 		EXPECT_NEAR(calculated_value, annual_energy_expected[count], m_error_tolerance_hi);
 	}
 }
+
+
+/// Test PVSAMv1 POA weather file inputs with the warm-started POA decomposition, which is independent of the number of threads
+TEST_F(CMPvsamv1PowerIntegration, NoFinancialModelPoaDecompWarmStart)
+{
+	// within 0.1% of the cold-started decomposition in NoFinancialModelSkyDiffuseAndIrradModels
+	std::vector<double> annual_energy_expected = { 7623, 7303 };
+	std::map<std::string, double> pairs;
+	pairs["sky_model"] = 2;
+	pairs["poa_decomp_warm_start"] = 1;
+
+	// POA reference cell, POA pyranometer
+	for (int irrad_mode = 3; irrad_mode < 5; irrad_mode++)
+	{
+		ssc_number_t annual_energy[2];
+		for (int nthreads = 1; nthreads < 3; nthreads++)
+		{
+			pairs["irrad_mode"] = irrad_mode;
+			pairs["poa_decomp_nthreads"] = nthreads;
+			int pvsam_errors = modify_ssc_data_and_run_module(data, "pvsamv1", pairs);
+			ASSERT_FALSE(pvsam_errors);
+			ssc_data_get_number(data, "annual_energy", &annual_energy[nthreads - 1]);
+		}
+		EXPECT_NEAR(annual_energy[0], annual_energy_expected[irrad_mode - 3], m_error_tolerance_hi) << "Annual energy.";
+		EXPECT_EQ(annual_energy[0], annual_energy[1]) << "Annual energy with two threads.";
+	}
+}
 	
 /// Test PVSAMv1 with default no-financial model and combinations of module and inverter models
 TEST_F(CMPvsamv1PowerIntegration, NoFinancialModelModuleAndInverterModels)
@@ -603,4 +630,297 @@ TEST_F(CMPvsamv1PowerIntegration, SnowModel)
 	ssc_data_get_number(data, "annual_energy", &annual_energy);
 	EXPECT_NEAR(annual_energy, 11354.7, m_error_tolerance_hi) << "Annual energy.";
 
-}
\ No newline at end of file
+}
+/// Test battery sizing sweep on the residential PV output against a direct battery and utility rate run
+TEST_F(CMPvsamv1PowerIntegration, BatterySizingSweep)
+{
+	ssc_data_t data = ssc_data_create();
+	belpe_default(data);
+	int errors = run_module(data, "belpe");
+	pvsamv1_with_residential_default(data);
+	errors += run_module(data, "pvsamv1");
+	utility_rate5_default(data);
+	EXPECT_FALSE(errors);
+
+	// base battery and a battery with twice the strings and power
+	ssc_number_t bank_capacity[2] = { 9.9791994094848633, 19.958398818969727 };
+	ssc_number_t power[2] = { 4.9895997047424316, 9.9791994094848633 };
+	// battery inputs the residential defaults leave to the financial model or the UI
+	ssc_data_set_number(data, "batt_dispatch_choice", 0);
+	ssc_data_set_number(data, "batt_dispatch_auto_can_charge", 1);
+	ssc_data_set_number(data, "batt_dispatch_auto_can_gridcharge", 0);
+	ssc_data_set_number(data, "batt_initial_SOC", 50);
+	ssc_data_set_number(data, "batt_replacement_cost", 0);
+	ssc_data_set_array(data, "sizing_bank_capacity", bank_capacity, 2);
+	ssc_data_set_array(data, "sizing_power", power, 2);
+	ssc_data_set_number(data, "sizing_en_rate", 1);
+	ssc_data_set_number(data, "nthreads", 2);
+	ssc_data_set_number(data, "en_batt", 1);
+	errors = run_module(data, "battery_sizing");
+	EXPECT_FALSE(errors);
+
+	if (!errors)
+	{
+		int n;
+		ssc_number_t * status = ssc_data_get_array(data, "sizing_status", &n);
+		ssc_number_t * capacity = ssc_data_get_array(data, "sizing_bank_capacity_computed", &n);
+		ssc_number_t * discharge = ssc_data_get_array(data, "sizing_annual_discharge_energy", &n);
+		ssc_number_t * savings = ssc_data_get_array(data, "sizing_savings_year1", &n);
+		ASSERT_EQ(n, 2);
+		EXPECT_EQ(status[0], 0);
+		EXPECT_EQ(status[1], 0);
+		EXPECT_NEAR(capacity[1], 2 * capacity[0], 1e-4) << "Doubled strings";
+		EXPECT_GT(discharge[1], discharge[0]) << "Larger battery discharges more";
+
+		// the base case must match running the battery and utility rate modules directly
+		errors = run_module(data, "battery");
+		errors += run_module(data, "utilityrate5");
+		ASSERT_FALSE(errors);
+
+		int n_annual;
+		ssc_number_t * batt_annual_discharge_energy = ssc_data_get_array(data, "batt_annual_discharge_energy", &n_annual);
+		ssc_number_t savings_year1;
+		ssc_data_get_number(data, "savings_year1", &savings_year1);
+		EXPECT_NEAR(discharge[0], batt_annual_discharge_energy[n_annual > 1 ? 1 : 0], 1e-3) << "Battery annual discharge energy";
+		EXPECT_NEAR(savings[0], savings_year1, 1e-3) << "Net savings with system (year 1)";
+	}
+	ssc_data_free(data);
+}
+
+/// Test that battery sizing checks the battery inputs, and the utility rate inputs only when the cases are billed
+TEST_F(CMPvsamv1PowerIntegration, BatterySizingChecksInputs)
+{
+	ssc_data_t data = ssc_data_create();
+	belpe_default(data);
+	int errors = run_module(data, "belpe");
+	pvsamv1_with_residential_default(data);
+	errors += run_module(data, "pvsamv1");
+	utility_rate5_default(data);
+	ASSERT_FALSE(errors);
+
+	ssc_number_t bank_capacity = 9.9791994094848633, power = 4.9895997047424316;
+	ssc_data_set_number(data, "en_batt", 1);
+	ssc_data_set_number(data, "batt_dispatch_choice", 0);
+	ssc_data_set_number(data, "batt_dispatch_auto_can_charge", 1);
+	ssc_data_set_number(data, "batt_dispatch_auto_can_gridcharge", 0);
+	ssc_data_set_number(data, "batt_initial_SOC", 50);
+	ssc_data_set_number(data, "batt_replacement_cost", 0);
+	ssc_data_set_array(data, "sizing_bank_capacity", &bank_capacity, 1);
+	ssc_data_set_array(data, "sizing_power", &power, 1);
+	ssc_data_unassign(data, "inflation_rate");
+
+	ssc_module_t module = ssc_module_create("battery_sizing");
+	ssc_data_set_number(data, "sizing_en_rate", 0);
+	EXPECT_NE(ssc_module_exec(module, data), 0) << "Rate inputs are not needed without billing";
+	ssc_module_free(module);
+
+	module = ssc_module_create("battery_sizing");
+	ssc_data_set_number(data, "sizing_en_rate", 1);
+	EXPECT_EQ(ssc_module_exec(module, data), 0);
+	const char * message = ssc_module_log(module, 0, 0, 0);
+	ASSERT_TRUE(message != NULL);
+	EXPECT_TRUE(std::string(message).find("inflation_rate") != std::string::npos) << message;
+	ssc_module_free(module);
+
+	module = ssc_module_create("battery_sizing");
+	ssc_data_set_number(data, "sizing_en_rate", 0);
+	ssc_data_unassign(data, "batt_chem");
+	EXPECT_EQ(ssc_module_exec(module, data), 0);
+	message = ssc_module_log(module, 0, 0, 0);
+	ASSERT_TRUE(message != NULL);
+	EXPECT_TRUE(std::string(message).find("batt_chem") != std::string::npos) << message;
+	ssc_module_free(module);
+	ssc_data_free(data);
+}
+
+/// Test that the optimized look ahead dispatch, which is front of meter only, is rejected behind the meter
+TEST_F(CMPvsamv1PowerIntegration, BatteryBehindTheMeterRejectsOptimizedDispatch)
+{
+	ssc_data_t data = ssc_data_create();
+	belpe_default(data);
+	int errors = run_module(data, "belpe");
+	pvsamv1_with_residential_default(data);
+	errors += run_module(data, "pvsamv1");
+	ASSERT_FALSE(errors);
+
+	ssc_data_set_number(data, "en_batt", 1);
+	ssc_data_set_number(data, "batt_meter_position", 0);
+	ssc_data_set_number(data, "batt_dispatch_choice", 5);
+	ssc_data_set_number(data, "batt_dispatch_auto_can_charge", 1);
+	ssc_data_set_number(data, "batt_dispatch_auto_can_gridcharge", 0);
+	ssc_data_set_number(data, "batt_initial_SOC", 50);
+	ssc_data_set_number(data, "batt_replacement_cost", 0);
+
+	ssc_module_t module = ssc_module_create("battery");
+	EXPECT_EQ(ssc_module_exec(module, data), 0);
+	const char * message = ssc_module_log(module, 0, 0, 0);
+	ASSERT_TRUE(message != NULL);
+	EXPECT_TRUE(std::string(message).find("front of meter") != std::string::npos) << message;
+	ssc_module_free(module);
+	ssc_data_free(data);
+}
+
+/// Test that repeated utility rate runs on the same data compile the tariff from the current rate inputs
+TEST_F(CMPvsamv1PowerIntegration, UtilityRateRepeatedRuns)
+{
+	ssc_data_t data = ssc_data_create();
+	belpe_default(data);
+	int errors = run_module(data, "belpe");
+	pvsamv1_with_residential_default(data);
+	errors += run_module(data, "pvsamv1");
+	utility_rate5_default(data);
+	errors += run_module(data, "utilityrate5");
+	ASSERT_FALSE(errors);
+
+	ssc_number_t cost_base, cost;
+	ssc_data_get_number(data, "elec_cost_without_system_year1", &cost_base);
+
+	// same tariff again
+	errors = run_module(data, "utilityrate5");
+	ASSERT_FALSE(errors);
+	ssc_data_get_number(data, "elec_cost_without_system_year1", &cost);
+	EXPECT_NEAR(cost, cost_base, 1e-6) << "Electricity bill without system (year 1), same tariff";
+
+	// doubled buy rates in every period
+	int nrows, ncols;
+	ssc_number_t * ec_tou_mat = ssc_data_get_matrix(data, "ur_ec_tou_mat", &nrows, &ncols);
+	std::vector<ssc_number_t> ec_tou(ec_tou_mat, ec_tou_mat + nrows * ncols);
+	std::vector<ssc_number_t> ec_tou_doubled(ec_tou);
+	for (int r = 0; r < nrows; r++)
+		ec_tou_doubled[r * ncols + 4] *= 2;
+	ssc_data_set_matrix(data, "ur_ec_tou_mat", &ec_tou_doubled[0], nrows, ncols);
+	errors = run_module(data, "utilityrate5");
+	ASSERT_FALSE(errors);
+	ssc_data_get_number(data, "elec_cost_without_system_year1", &cost);
+	EXPECT_GT(cost, cost_base + 1) << "Electricity bill without system (year 1), doubled buy rates";
+
+	// back to the original tariff
+	ssc_data_set_matrix(data, "ur_ec_tou_mat", &ec_tou[0], nrows, ncols);
+	errors = run_module(data, "utilityrate5");
+	ASSERT_FALSE(errors);
+	ssc_data_get_number(data, "elec_cost_without_system_year1", &cost);
+	EXPECT_NEAR(cost, cost_base, 1e-6) << "Electricity bill without system (year 1), original tariff";
+
+	ssc_data_free(data);
+}
+
+/// Test fleet billing of the residential load and PV output against the utility rate module for each metering option
+TEST_F(CMPvsamv1PowerIntegration, UtilityRateFleet)
+{
+	ssc_data_t data = ssc_data_create();
+	belpe_default(data);
+	int errors = run_module(data, "belpe");
+	pvsamv1_with_residential_default(data);
+	errors += run_module(data, "pvsamv1");
+	utility_rate5_default(data);
+	ASSERT_FALSE(errors);
+
+	// two customers: the residential load and 1.5 times that load, both with the PV output
+	int n;
+	ssc_number_t * load = ssc_data_get_array(data, "load", &n);
+	ASSERT_EQ(n, 8760);
+	ssc_number_t * gen = ssc_data_get_array(data, "gen", &n);
+	std::vector<ssc_number_t> fleet_load(load, load + 8760), fleet_gen(gen, gen + 8760);
+	for (size_t i = 0; i < 8760; i++)
+		fleet_load.push_back(load[i] * 1.5f);
+	ssc_data_set_matrix(data, "fleet_load", &fleet_load[0], 2, 8760);
+	ssc_data_set_matrix(data, "fleet_gen", &fleet_gen[0], 1, 8760);
+	ssc_data_set_number(data, "nthreads", 2);
+
+	for (int metering_option = 0; metering_option <= 4; metering_option++)
+	{
+		ssc_data_set_number(data, "ur_metering_option", metering_option);
+		errors = run_module(data, "utilityrate5");
+		errors += run_module(data, "utilityrate5_fleet");
+		ASSERT_FALSE(errors) << "Metering option " << metering_option;
+
+		int nrows, ncols;
+		ssc_number_t * bill_ym = ssc_data_get_matrix(data, "utility_bill_w_sys_ym", &nrows, &ncols);
+		ssc_number_t * ec_ym = ssc_data_get_matrix(data, "charge_w_sys_ec_ym", &nrows, &ncols);
+		ssc_number_t * fleet_bill_ym = ssc_data_get_matrix(data, "fleet_bill_ym", &nrows, &ncols);
+		ssc_number_t * fleet_ec_ym = ssc_data_get_matrix(data, "fleet_charge_ec_ym", &nrows, &ncols);
+		ssc_number_t * fleet_bill = ssc_data_get_array(data, "fleet_bill", &n);
+		ASSERT_EQ(nrows, 2);
+		ASSERT_EQ(ncols, 12);
+		for (int m = 0; m < 12; m++)
+		{
+			EXPECT_NEAR(fleet_bill_ym[m], bill_ym[12 + m], 1e-3) << "Metering option " << metering_option << " month " << m;
+			EXPECT_NEAR(fleet_ec_ym[m], ec_ym[12 + m], 1e-3) << "Metering option " << metering_option << " month " << m;
+		}
+		ssc_number_t * utility_bill_w_sys = ssc_data_get_array(data, "utility_bill_w_sys", &n);
+		EXPECT_NEAR(fleet_bill[0], utility_bill_w_sys[1], 1e-2) << "Metering option " << metering_option;
+		EXPECT_GT(fleet_bill[1], fleet_bill[0]) << "Metering option " << metering_option;
+	}
+
+	// same customers read from profile files
+	std::string load_file = std::string(SSCDIR) + "/test/fleet_load.bin";
+	std::string gen_file = std::string(SSCDIR) + "/test/fleet_gen.bin";
+	FILE * fp = fopen(load_file.c_str(), "wb");
+	ASSERT_TRUE(fp != NULL);
+	fwrite(&fleet_load[0], sizeof(ssc_number_t), fleet_load.size(), fp);
+	fclose(fp);
+	fp = fopen(gen_file.c_str(), "wb");
+	ASSERT_TRUE(fp != NULL);
+	fwrite(&fleet_gen[0], sizeof(ssc_number_t), fleet_gen.size(), fp);
+	fwrite(&fleet_gen[0], sizeof(ssc_number_t), fleet_gen.size(), fp);
+	fclose(fp);
+
+	ssc_number_t * bill_matrix = ssc_data_get_array(data, "fleet_bill", &n);
+	std::vector<ssc_number_t> fleet_bill_matrix(bill_matrix, bill_matrix + n);
+	ssc_data_unassign(data, "fleet_load");
+	ssc_data_unassign(data, "fleet_gen");
+	ssc_data_set_string(data, "fleet_load_file", load_file.c_str());
+	ssc_data_set_string(data, "fleet_gen_file", gen_file.c_str());
+	errors = run_module(data, "utilityrate5_fleet");
+	remove(load_file.c_str());
+	remove(gen_file.c_str());
+	ASSERT_FALSE(errors);
+
+	ssc_number_t * fleet_bill = ssc_data_get_array(data, "fleet_bill", &n);
+	ASSERT_EQ(n, 2);
+	EXPECT_EQ(fleet_bill[0], fleet_bill_matrix[0]);
+	EXPECT_EQ(fleet_bill[1], fleet_bill_matrix[1]);
+
+	ssc_data_free(data);
+}
+
+/// Test that billing the analysis years on several threads gives the bills of the serial calculation
+TEST_F(CMPvsamv1PowerIntegration, UtilityRateParallelYears)
+{
+	ssc_data_t data = ssc_data_create();
+	belpe_default(data);
+	int errors = run_module(data, "belpe");
+	pvsamv1_with_residential_default(data);
+	errors += run_module(data, "pvsamv1");
+	utility_rate5_default(data);
+	ssc_data_set_number(data, "ur_dc_enable", 1);
+	ASSERT_FALSE(errors);
+
+	const char * outputs[] = { "utility_bill_w_sys", "utility_bill_wo_sys", "annual_energy_value", "charge_w_sys_ec", "charge_w_sys_dc_tou", 0 };
+	for (int metering_option = 0; metering_option <= 4; metering_option += 2)
+	{
+		ssc_data_set_number(data, "ur_metering_option", metering_option);
+		std::vector<std::vector<ssc_number_t> > serial;
+		for (int nthreads = 1; nthreads <= 3; nthreads += 2)
+		{
+			ssc_data_set_number(data, "nthreads", nthreads);
+			errors = run_module(data, "utilityrate5");
+			ASSERT_FALSE(errors) << "Metering option " << metering_option;
+
+			for (int k = 0; outputs[k] != 0; k++)
+			{
+				int n;
+				ssc_number_t * values = ssc_data_get_array(data, outputs[k], &n);
+				ASSERT_GT(n, 2) << outputs[k];
+				if (nthreads == 1)
+				{
+					serial.push_back(std::vector<ssc_number_t>(values, values + n));
+					continue;
+				}
+				for (int y = 0; y < n; y++)
+					EXPECT_EQ(values[y], serial[k][y]) << outputs[k] << " year " << y << ", metering option " << metering_option;
+			}
+		}
+	}
+	ssc_data_free(data);
+}
@@ -0,0 +1,100 @@
+#include <math.h>
+#include <gtest/gtest.h>
+
+#include "../ssc/sscapi.h"
+
+/// Persistent PVWatts model stepped through the C API matches the pvwattsv1_1ts compute module with state fed back
+TEST(CMPvwattsV1_1tsIntegration, PersistentModelMatchesModule){
+	ssc_data_t data = ssc_data_create();
+	ssc_data_set_number(data, "lat", 33.45f);
+	ssc_data_set_number(data, "lon", -111.98f);
+	ssc_data_set_number(data, "tz", -7);
+	ssc_data_set_number(data, "system_size", 4);
+	ssc_data_set_number(data, "derate", 0.77f);
+	ssc_data_set_number(data, "track_mode", 1);
+	ssc_data_set_number(data, "azimuth", 180);
+	ssc_data_set_number(data, "tilt", 20);
+
+	ssc_pvwatts_t pvw = ssc_pvwatts_create(data);
+	ASSERT_TRUE(pvw != NULL);
+
+	ssc_module_t module = ssc_module_create("pvwattsv1_1ts");
+	ASSERT_TRUE(module != NULL);
+
+	ssc_number_t tcell = 20, poa = 0;
+	double ac_total = 0;
+	for (int hour = 0; hour < 24; hour++)
+	{
+		// synthetic clear day
+		double s = sin(3.14159265 * (hour - 5.5) / 14.0);
+		ssc_number_t dni = (ssc_number_t)(s > 0 ? 900 * s : 0);
+		ssc_number_t dhi = (ssc_number_t)(s > 0 ? 100 * s : 0);
+		ssc_number_t tamb = (ssc_number_t)(25 + 10 * (s > 0 ? s : 0));
+		ssc_number_t wspd = 2;
+
+		ssc_data_set_number(data, "year", 2017);
+		ssc_data_set_number(data, "month", 6);
+		ssc_data_set_number(data, "day", 21);
+		ssc_data_set_number(data, "hour", (ssc_number_t)hour);
+		ssc_data_set_number(data, "minute", 30);
+		ssc_data_set_number(data, "beam", dni);
+		ssc_data_set_number(data, "diffuse", dhi);
+		ssc_data_set_number(data, "tamb", tamb);
+		ssc_data_set_number(data, "wspd", wspd);
+		ssc_data_set_number(data, "tcell", tcell);
+		ssc_data_set_number(data, "poa", poa);
+		ASSERT_TRUE(ssc_module_exec(module, data) != 0);
+
+		ssc_number_t dc, ac;
+		ssc_data_get_number(data, "tcell", &tcell);
+		ssc_data_get_number(data, "poa", &poa);
+		ssc_data_get_number(data, "dc", &dc);
+		ssc_data_get_number(data, "ac", &ac);
+
+		ssc_number_t e_poa, e_tcell, e_dc, e_ac;
+		ASSERT_TRUE(ssc_pvwatts_step(pvw, 2017, 6, 21, hour, 30, -1, dni, dhi, tamb, wspd, &e_poa, &e_tcell, &e_dc, &e_ac) != 0);
+		EXPECT_NEAR(e_poa, poa, 1e-3) << "hour " << hour;
+		EXPECT_NEAR(e_tcell, tcell, 1e-3) << "hour " << hour;
+		EXPECT_NEAR(e_dc, dc, 1e-2) << "hour " << hour;
+		EXPECT_NEAR(e_ac, ac, 1e-2) << "hour " << hour;
+		ac_total += e_ac;
+	}
+	EXPECT_GT(ac_total, 10000);
+
+	ssc_module_free(module);
+	ssc_pvwatts_free(pvw);
+	ssc_data_free(data);
+}
+
+/// Persistent PVWatts model inputs are checked against the pvwattsv1_1ts requirements and constraints
+TEST(CMPvwattsV1_1tsIntegration, PersistentModelValidatesInputs){
+	ssc_data_t data = ssc_data_create();
+	ssc_data_set_number(data, "lat", 33.45f);
+	ssc_data_set_number(data, "lon", -111.98f);
+	ssc_data_set_number(data, "tz", -7);
+	ssc_data_set_number(data, "system_size", 4);
+	ssc_data_set_number(data, "derate", 0.77f);
+	ssc_data_set_number(data, "track_mode", 0);
+	ssc_data_set_number(data, "azimuth", 180);
+
+	// tilt is required unless tilt_eq_lat is set
+	EXPECT_TRUE(ssc_pvwatts_create(data) == NULL);
+	ssc_data_set_number(data, "tilt", 20);
+
+	// module defaults are applied without being written back to the data
+	ssc_pvwatts_t pvw = ssc_pvwatts_create(data);
+	ASSERT_TRUE(pvw != NULL);
+	EXPECT_EQ(ssc_data_query(data, "inv_eff"), SSC_INVALID);
+	ssc_pvwatts_free(pvw);
+
+	ssc_data_set_number(data, "derate", 1.5f);
+	EXPECT_TRUE(ssc_pvwatts_create(data) == NULL) << "derate above 1";
+	ssc_data_set_number(data, "derate", 0.77f);
+	ssc_data_set_number(data, "track_mode", 1.5f);
+	EXPECT_TRUE(ssc_pvwatts_create(data) == NULL) << "non-integer tracking mode";
+	ssc_data_set_number(data, "track_mode", 0);
+	ssc_data_set_number(data, "rotlim", 0);
+	EXPECT_TRUE(ssc_pvwatts_create(data) == NULL) << "rotation limit below 1";
+
+	ssc_data_free(data);
+}
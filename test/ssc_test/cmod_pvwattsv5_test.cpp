@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <chrono>
 
 #include "../ssc/core.h"
 #include "../ssc/vartab.h"
@@ -37,4 +38,231 @@ TEST_F(CMPvwattsV5Integration, DefaultNoFinancialModel){
 	ssc_data_get_number(data, "capacity_factor", &capacity_factor);
 	EXPECT_NEAR(capacity_factor, 19.7197, error_tolerance) << "Capacity factor";
 
-}
\ No newline at end of file
+}
+
+/// Each system in a fleet run matches a standalone PVWattsV5 run with the same configuration
+TEST_F(CMPvwattsV5Integration, FleetMatchesSingleSystem){
+	const int nsys = 4;
+	ssc_number_t systems[nsys * 9] = {
+		4, 0, 1.2f, 96, 14.075660705566406f, 0, 20, 180, 0.4f,
+		10, 1, 1.3f, 97, 14, 2, 0, 180, 0.3f,
+		10, 2, 1.1f, 96, 10, 3, 0, 180, 0.4f,
+		2, 0, 1.2f, 96, 14, 4, 0, 180, 0.4f };
+
+	ssc_data_t fleet = ssc_data_create();
+	const char *file = ssc_data_get_string(data, "solar_resource_file");
+	ssc_data_set_string(fleet, "solar_resource_file", file);
+	ssc_data_set_matrix(fleet, "fleet_systems", systems, nsys, 9);
+
+	ssc_module_t module = ssc_module_create("pvwattsv5_fleet");
+	ASSERT_TRUE(module != NULL);
+	ASSERT_TRUE(ssc_module_exec(module, fleet) != 0);
+	ssc_module_free(module);
+
+	int nrows, ncols, count;
+	ssc_number_t *gen = ssc_data_get_matrix(fleet, "gen", &nrows, &ncols);
+	ssc_number_t *annual = ssc_data_get_array(fleet, "annual_energy", &count);
+	ASSERT_EQ(nrows, 8760);
+	ASSERT_EQ(ncols, nsys);
+	ASSERT_EQ(count, nsys);
+
+	for (int s = 0; s < nsys; s++)
+	{
+		ssc_data_set_number(data, "system_capacity", systems[s * 9 + 0]);
+		ssc_data_set_number(data, "module_type", systems[s * 9 + 1]);
+		ssc_data_set_number(data, "dc_ac_ratio", systems[s * 9 + 2]);
+		ssc_data_set_number(data, "inv_eff", systems[s * 9 + 3]);
+		ssc_data_set_number(data, "losses", systems[s * 9 + 4]);
+		ssc_data_set_number(data, "array_type", systems[s * 9 + 5]);
+		ssc_data_set_number(data, "tilt", systems[s * 9 + 6]);
+		ssc_data_set_number(data, "azimuth", systems[s * 9 + 7]);
+		ssc_data_set_number(data, "gcr", systems[s * 9 + 8]);
+		compute();
+
+		ssc_number_t annual_energy;
+		ssc_data_get_number(data, "annual_energy", &annual_energy);
+		EXPECT_NEAR(annual[s], annual_energy, annual_energy * 1e-6) << "Annual energy of system " << s;
+
+		ssc_number_t *single_gen = ssc_data_get_array(data, "gen", &count);
+		for (int i = 0; i < nrows; i++)
+			EXPECT_NEAR(gen[i * ncols + s], single_gen[i], 1e-4) << "System " << s << " hour " << i;
+	}
+	EXPECT_NEAR(annual[0], 6909.79, error_tolerance) << "Annual energy.";
+	ssc_data_free(fleet);
+}
+
+/// Fleet rows outside the single system input ranges are rejected instead of producing inf or negative generation
+TEST_F(CMPvwattsV5Integration, FleetRejectsInvalidSystems){
+	// zero inverter efficiency, losses over 100%, ground coverage ratio over 3, 1-axis tracking with zero ground coverage ratio
+	ssc_number_t invalid[4][9] = {
+		{ 4, 0, 1.2f, 0, 14, 0, 20, 180, 0.4f },
+		{ 4, 0, 1.2f, 96, 150, 0, 20, 180, 0.4f },
+		{ 4, 0, 1.2f, 96, 14, 0, 20, 180, 5 },
+		{ 4, 0, 1.2f, 96, 14, 2, 0, 180, 0 } };
+
+	const char *file = ssc_data_get_string(data, "solar_resource_file");
+	for (int k = 0; k < 4; k++)
+	{
+		ssc_number_t systems[2 * 9] = { 4, 0, 1.2f, 96, 14, 0, 20, 180, 0.4f };
+		for (int c = 0; c < 9; c++)
+			systems[9 + c] = invalid[k][c];
+
+		ssc_data_t fleet = ssc_data_create();
+		ssc_data_set_string(fleet, "solar_resource_file", file);
+		ssc_data_set_matrix(fleet, "fleet_systems", systems, 2, 9);
+		ssc_module_t module = ssc_module_create("pvwattsv5_fleet");
+		ASSERT_TRUE(module != NULL);
+		EXPECT_EQ(ssc_module_exec(module, fleet), 0) << "Invalid row " << k;
+		ssc_module_free(module);
+		ssc_data_free(fleet);
+	}
+}
+
+/// Beam shading from a mostly 0%/100% time step matrix combined with azimuth x altitude tables on uniform and non-uniform grids
+TEST_F(CMPvwattsV5Integration, TimestepAndAzalShading){
+	// one fully shaded day per week and a partially shaded noon hour every fifth day
+	std::vector<ssc_number_t> timestep(8760, 0);
+	for (size_t h = 0; h < 8760; h++)
+	{
+		size_t day = h / 24;
+		if (day % 7 == 3) timestep[h] = 100;
+		else if (day % 5 == 0 && h % 24 == 12) timestep[h] = 50;
+	}
+	ssc_data_set_matrix(data, "shading:timestep", &timestep[0], 8760, 1);
+
+	// uniform 10 deg altitude by 30 deg azimuth grid
+	const size_t nalt = 10, nazi = 13;
+	std::vector<ssc_number_t> azal((nalt + 1) * (nazi + 1), 0);
+	for (size_t c = 1; c <= nazi; c++)
+		azal[c] = (ssc_number_t)(30 * (c - 1));
+	for (size_t r = 1; r <= nalt; r++)
+	{
+		double alt = 10.0 * (r - 1);
+		azal[r * (nazi + 1)] = (ssc_number_t)alt;
+		for (size_t c = 1; c <= nazi; c++)
+		{
+			double azi = 30.0 * (c - 1);
+			double loss = (alt < 40 ? 40 - alt : 0) + (azi >= 90 && azi <= 150 ? 20 : 0);
+			azal[r * (nazi + 1) + c] = (ssc_number_t)loss;
+		}
+	}
+	ssc_data_set_matrix(data, "shading:azal", &azal[0], nalt + 1, nazi + 1);
+	compute();
+
+	int count;
+	ssc_number_t *shad_beam = ssc_data_get_array(data, "shad_beam_factor", &count);
+	ssc_number_t *sunup = ssc_data_get_array(data, "sunup", &count);
+	ASSERT_EQ(count, 8760);
+	double shad_sum = 0;
+	for (int i = 0; i < count; i++)
+		if (sunup[i] > 0) shad_sum += shad_beam[i];
+	ssc_number_t annual_energy;
+	ssc_data_get_number(data, "annual_energy", &annual_energy);
+	EXPECT_NEAR(shad_sum, 3154.532, error_tolerance) << "Sum of beam shading factors while sun is up";
+	EXPECT_NEAR(annual_energy, 5589.924, error_tolerance) << "Annual energy";
+
+	// non-uniform altitude axis
+	const ssc_number_t alts[nalt] = { 0, 5, 10, 15, 20, 30, 40, 55, 70, 90 };
+	for (size_t r = 1; r <= nalt; r++)
+		azal[r * (nazi + 1)] = alts[r - 1];
+	ssc_data_set_matrix(data, "shading:azal", &azal[0], nalt + 1, nazi + 1);
+	compute();
+
+	shad_beam = ssc_data_get_array(data, "shad_beam_factor", &count);
+	sunup = ssc_data_get_array(data, "sunup", &count);
+	shad_sum = 0;
+	for (int i = 0; i < count; i++)
+		if (sunup[i] > 0) shad_sum += shad_beam[i];
+	ssc_data_get_number(data, "annual_energy", &annual_energy);
+	EXPECT_NEAR(shad_sum, 3404.526, error_tolerance) << "Sum of beam shading factors while sun is up";
+	EXPECT_NEAR(annual_energy, 5759.034, error_tolerance) << "Annual energy";
+}
+
+/// Runs the shading factor calculator over a year of 1-minute steps, timing setup and the per-step fbeam lookups
+class shading_benchmark_module : public compute_module
+{
+public:
+	double setup_ms, fbeam_ns, factor_sum;
+	size_t calls;
+
+	shading_benchmark_module() : setup_ms(0), fbeam_ns(0), factor_sum(0), calls(0)
+	{
+		add_var_info(vtab);
+	}
+
+	void exec() throw(general_error)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		shading_factor_calculator shad;
+		if (!shad.setup(this, ""))
+			throw exec_error("shading_benchmark", shad.get_error());
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+		const size_t steps_per_hour = 60, steps = 8760 * steps_per_hour;
+		for (size_t i = 0; i < steps; i++)
+		{
+			// sun moving across the sky each day, up from 6am to 6pm
+			double hour_of_day = (i % (24 * steps_per_hour)) / (double)steps_per_hour;
+			double solalt = 70 * sin(3.14159265 * (hour_of_day - 6) / 12);
+			double solazi = 90 + 15 * (hour_of_day - 6);
+			if (solalt <= 0) continue;
+			calls++;
+			if (shad.fbeam(i / steps_per_hour, solalt, solazi, i % steps_per_hour, steps_per_hour))
+				factor_sum += shad.beam_shade_factor();
+		}
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+		setup_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+		fbeam_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / calls;
+	}
+
+	static var_info vtab[];
+};
+
+var_info shading_benchmark_module::vtab[] = {
+	{ SSC_INPUT, SSC_MATRIX, "shading:timestep", "Time step beam shading loss", "%", "", "", "?", "", "" },
+	{ SSC_INPUT, SSC_MATRIX, "shading:azal", "Azimuth x altitude beam shading loss", "%", "", "", "?", "", "" },
+	var_info_invalid };
+
+class shading_benchmark_handler : public handler_interface
+{
+public:
+	shading_benchmark_handler(compute_module *cm) : handler_interface(cm) {}
+	virtual void on_log(const std::string &, int, float) {}
+	virtual bool on_update(const std::string &, float, float) { return true; }
+};
+
+/// Benchmark of beam shading lookups for a mostly 0%/100% 1-minute time step matrix and a 10 deg x 10 deg azimuth x altitude table.
+/// Run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST(ShadingFactorCalculator, DISABLED_BenchmarkTimestepAndAzal){
+	const size_t steps_per_hour = 60, nrows = 8760 * steps_per_hour;
+	std::vector<ssc_number_t> timestep(nrows, 0);
+	for (size_t i = 0; i < nrows; i++)
+	{
+		// a fully shaded hour after sunrise and before sunset, with 20 minutes of partial shade every third day
+		size_t minute_of_day = i % (24 * steps_per_hour), day = i / (24 * steps_per_hour);
+		if (minute_of_day >= 6 * 60 && minute_of_day < 7 * 60) timestep[i] = 100;
+		else if (minute_of_day >= 17 * 60 && minute_of_day < 18 * 60) timestep[i] = 100;
+		else if (day % 3 == 0 && minute_of_day >= 12 * 60 && minute_of_day < 12 * 60 + 20) timestep[i] = 35;
+	}
+
+	const size_t nalt = 10, nazi = 37;
+	std::vector<ssc_number_t> azal((nalt + 1) * (nazi + 1), 0);
+	for (size_t c = 1; c <= nazi; c++)
+		azal[c] = (ssc_number_t)(10 * (c - 1));
+	for (size_t r = 1; r <= nalt; r++)
+	{
+		azal[r * (nazi + 1)] = (ssc_number_t)(10 * (r - 1));
+		for (size_t c = 1; c <= nazi; c++)
+			azal[r * (nazi + 1) + c] = (ssc_number_t)(r < 4 ? 60 - 20 * (r - 1) : 0);
+	}
+
+	ssc_data_t data = ssc_data_create();
+	ssc_data_set_matrix(data, "shading:timestep", &timestep[0], (int)nrows, 1);
+	ssc_data_set_matrix(data, "shading:azal", &azal[0], nalt + 1, nazi + 1);
+
+	shading_benchmark_module cm;
+	shading_benchmark_handler handler(&cm);
+	ASSERT_TRUE(cm.compute(&handler, static_cast<var_table*>(data)));
+	printf("shading setup: %.1f ms, fbeam: %.1f ns/call over %d calls (factor sum %.3f)\n", cm.setup_ms, cm.fbeam_ns, (int)cm.calls, cm.factor_sum);
+	ssc_data_free(data);
+}
@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+#include <chrono>
+
+#include "cmod_singleowner_test.h"
+
+/// Test the single owner uncertainty module with explicit samples against direct single owner runs
+TEST_F(CMSingleOwner, UncertaintySamples) {
+	// unchanged inputs, then 10% more energy with 5% higher installed cost
+	ssc_number_t samples[4] = { 1, 1, 1.1f, 1.05f };
+	ssc_data_set_string(data, "uncertainty_inputs", "gen, total_installed_cost");
+	ssc_data_set_matrix(data, "uncertainty_samples", samples, 2, 2);
+	ssc_number_t percentiles[2] = { 0, 100 };
+	ssc_data_set_array(data, "uncertainty_percentiles", percentiles, 2);
+	ssc_data_set_number(data, "nthreads", 2);
+	int errors = run_module(data, "singleowner_uncertainty");
+	ASSERT_FALSE(errors);
+
+	int n, nrows, ncols;
+	ssc_number_t * status = ssc_data_get_array(data, "uncertainty_status", &n);
+	ASSERT_EQ(n, 2);
+	EXPECT_EQ(status[0], 0);
+	EXPECT_EQ(status[1], 0);
+	ssc_number_t * p_ppa = ssc_data_get_array(data, "uncertainty_ppa", &n);
+	std::vector<ssc_number_t> ppa(p_ppa, p_ppa + n);
+	ssc_number_t * p_npv = ssc_data_get_array(data, "uncertainty_npv", &n);
+	std::vector<ssc_number_t> npv(p_npv, p_npv + n);
+	EXPECT_LT(ppa[1], ppa[0]) << "More energy at a slightly higher cost lowers the PPA price";
+
+	ssc_number_t * table = ssc_data_get_matrix(data, "uncertainty_percentile_table", &nrows, &ncols);
+	ASSERT_EQ(nrows, 2);
+	ASSERT_EQ(ncols, 5);
+	EXPECT_NEAR(table[4], ppa[1], 1e-6) << "Lowest PPA price";
+	EXPECT_NEAR(table[ncols + 4], ppa[0], 1e-6) << "Highest PPA price";
+
+	// the first sample must match running the single owner model directly
+	errors = run_module(data, "singleowner");
+	ASSERT_FALSE(errors);
+	ssc_number_t ppa_direct, npv_direct;
+	ssc_data_get_number(data, "ppa", &ppa_direct);
+	ssc_data_get_number(data, "project_return_aftertax_npv", &npv_direct);
+	EXPECT_NEAR(ppa[0], ppa_direct, 1e-6) << "PPA price";
+	EXPECT_NEAR(npv[0], npv_direct, 1e-3) << "After-tax NPV";
+}
+
+/// Test that multipliers drawn from distributions depend on the seed only, not on the number of threads
+TEST_F(CMSingleOwner, UncertaintyDistributions) {
+	const int nsamples = 16;
+	// normal energy multiplier with a 5% standard deviation, triangular installed cost multiplier from 0.9 to 1.2
+	ssc_number_t distributions[8] = { 0, 1, 0.05f, 0, 2, 0.9f, 1, 1.2f };
+	ssc_data_set_string(data, "uncertainty_inputs", "gen, total_installed_cost");
+	ssc_data_set_matrix(data, "uncertainty_distributions", distributions, 2, 4);
+	ssc_data_set_number(data, "uncertainty_nsamples", nsamples);
+	ssc_data_set_number(data, "uncertainty_seed", 42);
+
+	std::vector<ssc_number_t> multipliers[2], ppa[2];
+	for (int nthreads = 1; nthreads <= 2; nthreads++)
+	{
+		ssc_data_set_number(data, "nthreads", nthreads);
+		int errors = run_module(data, "singleowner_uncertainty");
+		ASSERT_FALSE(errors) << "Threads " << nthreads;
+
+		int n, nrows, ncols;
+		ssc_number_t * p_mult = ssc_data_get_matrix(data, "uncertainty_multipliers", &nrows, &ncols);
+		ASSERT_EQ(nrows, nsamples);
+		ASSERT_EQ(ncols, 2);
+		multipliers[nthreads - 1].assign(p_mult, p_mult + nrows * ncols);
+		ssc_number_t * p_ppa = ssc_data_get_array(data, "uncertainty_ppa", &n);
+		ppa[nthreads - 1].assign(p_ppa, p_ppa + n);
+
+		ssc_number_t * status = ssc_data_get_array(data, "uncertainty_status", &n);
+		for (int i = 0; i < n; i++)
+			EXPECT_EQ(status[i], 0) << "Sample " << i;
+	}
+
+	bool varied = false;
+	for (int i = 0; i < nsamples; i++)
+	{
+		EXPECT_EQ(multipliers[0][i * 2], multipliers[1][i * 2]) << "Energy multiplier of sample " << i;
+		EXPECT_EQ(multipliers[0][i * 2 + 1], multipliers[1][i * 2 + 1]) << "Installed cost multiplier of sample " << i;
+		EXPECT_EQ(ppa[0][i], ppa[1][i]) << "PPA price of sample " << i;
+		EXPECT_GE(multipliers[0][i * 2 + 1], 0.9f) << "Installed cost multiplier of sample " << i;
+		EXPECT_LE(multipliers[0][i * 2 + 1], 1.2f) << "Installed cost multiplier of sample " << i;
+		if (multipliers[0][i * 2] != multipliers[0][0])
+			varied = true;
+	}
+	EXPECT_TRUE(varied) << "Energy multipliers are drawn, not constant";
+
+	// default percentiles 10, 50 and 90, each metric nondecreasing down the table
+	int nrows, ncols;
+	ssc_number_t * table = ssc_data_get_matrix(data, "uncertainty_percentile_table", &nrows, &ncols);
+	ASSERT_EQ(nrows, 3);
+	ASSERT_EQ(ncols, 5);
+	EXPECT_EQ(table[0], 10);
+	EXPECT_EQ(table[ncols], 50);
+	EXPECT_EQ(table[2 * ncols], 90);
+	for (int m = 1; m < ncols; m++)
+	{
+		EXPECT_LE(table[m], table[ncols + m]) << "Metric " << m;
+		EXPECT_LE(table[ncols + m], table[2 * ncols + m]) << "Metric " << m;
+	}
+	EXPECT_LT(table[4], table[2 * ncols + 4]) << "PPA price varies across samples";
+
+	// another seed draws other multipliers
+	ssc_data_set_number(data, "uncertainty_seed", 7);
+	ASSERT_FALSE(run_module(data, "singleowner_uncertainty"));
+	ssc_number_t * p_mult = ssc_data_get_matrix(data, "uncertainty_multipliers", &nrows, &ncols);
+	EXPECT_NE(p_mult[0], multipliers[0][0]);
+}
+
+/// Test that the PPA price solution of each PPA financial model is the price found by the interval search alone,
+/// for the default and a higher IRR target, and that each model reports its number of cash flow evaluations
+TEST_F(CMSingleOwner, PpaSolutionAllModels) {
+	const char *models[5] = { "singleowner", "host_developer", "levpartflip", "equpartflip", "saleleaseback" };
+	// prices from the interval search before the closed form trials, cents/kWh
+	ssc_number_t ppa_expected[2][5] = { { 13.30422688f, 13.30422688f, 13.60048485f, 19.03599358f, 18.9146862f },
+		{ 13.8639946f, 13.8639946f, 14.2444191f, 22.80170631f, 22.60713196f } };
+	// two evaluations and one closed form trial, the flip models keep the interval search
+	ssc_number_t iterations_expected[2][5] = { { 3, 3, 14, 6, 3 }, { 3, 3, 14, 12, 3 } };
+
+	// host energy value and bills, not read by the PPA solution
+	std::vector<ssc_number_t> host_annual(26, 0);
+	ssc_number_t flip_target_percent[2] = { 11, 14 };
+	for (int t = 0; t < 2; t++)
+	{
+		for (int m = 0; m < 5; m++)
+		{
+			// separate inputs for each model, outputs of one model are inputs of another
+			ssc_data_t model_data = create_default_data();
+			ssc_data_set_array(model_data, "annual_energy_value", &host_annual[0], 26);
+			ssc_data_set_array(model_data, "elec_cost_with_system", &host_annual[0], 26);
+			ssc_data_set_array(model_data, "elec_cost_without_system", &host_annual[0], 26);
+			ssc_data_set_number(model_data, "host_real_discount_rate", 6.4f);
+			ssc_data_set_number(model_data, "flip_target_percent", flip_target_percent[t]);
+			int errors = run_module(model_data, models[m]);
+			ASSERT_FALSE(errors) << models[m];
+
+			ssc_number_t ppa, iterations;
+			ssc_data_get_number(model_data, "ppa", &ppa);
+			ssc_data_get_number(model_data, "ppa_soln_iterations", &iterations);
+			EXPECT_NEAR(ppa, ppa_expected[t][m], 1e-5) << models[m] << " IRR target " << flip_target_percent[t];
+			EXPECT_EQ(iterations, iterations_expected[t][m]) << models[m] << " IRR target " << flip_target_percent[t];
+			ssc_data_free(model_data);
+		}
+	}
+}
+
+/// Test the IRR outputs of the single owner and sale leaseback models, refined to the root of the npv.
+/// Years 3 to 9 of the running pre-tax project IRR were NaN when the solver only searched from a few guesses.
+TEST_F(CMSingleOwner, IrrOutputs) {
+	ssc_number_t pretax_irr_expected[13] = { 0, -96.65192f, -79.89311f, -62.91215f, -49.71038f, -39.82765f, -32.37355f,
+		-26.65005f, -22.1704f, -18.60087f, -15.71044f, -13.33637f, -11.36178f };
+	int errors = run_module(data, "singleowner");
+	ASSERT_FALSE(errors);
+
+	ssc_number_t irr;
+	ssc_data_get_number(data, "flip_actual_irr", &irr);
+	EXPECT_NEAR(irr, 11, 1e-4) << "IRR in target year, previously 10.99998";
+	ssc_data_get_number(data, "project_return_aftertax_irr", &irr);
+	EXPECT_NEAR(irr, 12.75464f, 1e-4) << "After-tax project IRR, previously 12.75462";
+	int n;
+	ssc_number_t * pretax_irr = ssc_data_get_array(data, "cf_project_return_pretax_irr", &n);
+	ASSERT_EQ(n, 26);
+	for (int i = 1; i < 13; i++)
+		EXPECT_NEAR(pretax_irr[i], pretax_irr_expected[i], 1e-4) << "Pre-tax project IRR year " << i;
+
+	ssc_data_t saleleaseback_data = create_default_data();
+	errors = run_module(saleleaseback_data, "saleleaseback");
+	ASSERT_FALSE(errors);
+	ssc_data_get_number(saleleaseback_data, "flip_actual_irr", &irr);
+	EXPECT_NEAR(irr, 11, 1e-4) << "Tax investor IRR in target year, previously 10.999996";
+	ssc_data_get_number(saleleaseback_data, "sponsor_aftertax_irr", &irr);
+	EXPECT_NEAR(irr, 15.23344f, 1e-4) << "Sponsor after-tax IRR, previously 15.23342";
+	ssc_data_get_number(saleleaseback_data, "sponsor_pretax_irr", &irr);
+	EXPECT_NEAR(irr, 24.27932f, 1e-4) << "Sponsor pre-tax IRR, previously 24.27926";
+	ssc_number_t * running_irr = ssc_data_get_array(saleleaseback_data, "cf_sponsor_aftertax_irr", &n);
+	ASSERT_EQ(n, 26);
+	EXPECT_NEAR(running_irr[4], -22.50698f, 1e-4) << "Sponsor after-tax IRR year 4, previously NaN";
+	running_irr = ssc_data_get_array(saleleaseback_data, "cf_tax_investor_pretax_irr", &n);
+	ASSERT_EQ(n, 26);
+	EXPECT_NEAR(running_irr[4], -28.97855f, 1e-4) << "Tax investor pre-tax IRR year 4, previously NaN";
+	ssc_data_free(saleleaseback_data);
+}
+
+/// Test the sale leaseback financing costs, which include the lease payment reserve of the final cash flow iteration.
+/// They were computed before the reserve was set, from the previous iteration when solving for the PPA price,
+/// and without the reserve at all for a specified PPA price.
+TEST_F(CMSingleOwner, SaleLeasebackFinancingCosts) {
+	// solve for the PPA price, then the specified price
+	ssc_number_t cost_financing_expected[2] = { 95379424, 81778600 };
+	ssc_number_t cost_installed_expected[2] = { 768844928, 755244160 };
+	ssc_number_t cost_installed_previous[2] = { 748345664, 733346752 };
+	for (int mode = 0; mode < 2; mode++)
+	{
+		ssc_data_t model_data = create_default_data();
+		ssc_data_set_number(model_data, "ppa_soln_mode", mode);
+		int errors = run_module(model_data, "saleleaseback");
+		ASSERT_FALSE(errors) << "PPA solution mode " << mode;
+
+		ssc_number_t cost_financing, cost_installed, size_of_equity;
+		ssc_data_get_number(model_data, "cost_financing", &cost_financing);
+		ssc_data_get_number(model_data, "cost_installed", &cost_installed);
+		ssc_data_get_number(model_data, "size_of_equity", &size_of_equity);
+		EXPECT_NEAR(cost_financing, cost_financing_expected[mode], 1e3) << "PPA solution mode " << mode;
+		EXPECT_NEAR(cost_installed, cost_installed_expected[mode], 1e3) << "PPA solution mode " << mode << ", previously " << cost_installed_previous[mode];
+		EXPECT_NEAR(size_of_equity, cost_installed, 1e3) << "PPA solution mode " << mode;
+
+		int n;
+		ssc_number_t * reserve = ssc_data_get_array(model_data, "cf_reserve_leasepayment", &n);
+		ASSERT_GT(n, 0);
+		if (mode == 1)
+			EXPECT_NEAR(cost_installed - cost_installed_previous[mode], reserve[0], 1e3) << "Lease payment reserve was left out";
+		ssc_data_free(model_data);
+	}
+}
+
+/// Benchmark of the five PPA financial models on the default case, dominated by the PPA price solution and the IRR outputs.
+/// Run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+TEST_F(CMSingleOwner, DISABLED_BenchmarkPpaModels) {
+	const char *models[5] = { "singleowner", "host_developer", "levpartflip", "equpartflip", "saleleaseback" };
+	std::vector<ssc_number_t> host_annual(26, 0);
+	const int reps = 20;
+	for (int m = 0; m < 5; m++)
+	{
+		double seconds = 0;
+		ssc_number_t ppa = 0;
+		for (int r = 0; r < reps; r++)
+		{
+			ssc_data_t model_data = create_default_data();
+			ssc_data_set_array(model_data, "annual_energy_value", &host_annual[0], 26);
+			ssc_data_set_array(model_data, "elec_cost_with_system", &host_annual[0], 26);
+			ssc_data_set_array(model_data, "elec_cost_without_system", &host_annual[0], 26);
+			ssc_data_set_number(model_data, "host_real_discount_rate", 6.4f);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			ASSERT_FALSE(run_module(model_data, models[m])) << models[m];
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			ssc_data_get_number(model_data, "ppa", &ppa);
+			ssc_data_free(model_data);
+		}
+		printf("%s: %.2f ms per run (ppa %.6g)\n", models[m], 1000 * seconds / reps, ppa);
+	}
+}
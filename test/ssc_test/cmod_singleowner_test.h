@@ -0,0 +1,49 @@
+#ifndef _CMOD_SINGLEOWNER_TEST_H_
+#define _CMOD_SINGLEOWNER_TEST_H_
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../ssc/core.h"
+#include "../ssc/vartab.h"
+#include "../ssc/common.h"
+#include "../input_cases/singleowner_common_data.h"
+
+/**
+* CMSingleOwner tests the PPA financial models on a synthetic generation profile, 90 MW during the day and 15 MW at night,
+* with a flat PPA price over the day.
+* SetUp() creates the default single owner case, which can be modified within each test.
+*/
+class CMSingleOwner : public ::testing::Test {
+protected:
+	ssc_data_t data;
+
+	void SetUp() {
+		data = create_default_data();
+	}
+	void TearDown() {
+		if (data)
+			ssc_data_free(data);
+	}
+
+	/// new data container with the default case, for tests that run several models on separate inputs
+	ssc_data_t create_default_data() {
+		ssc_data_t data = ssc_data_create();
+		single_owner_default(data);
+		std::vector<ssc_number_t> gen(8760);
+		for (size_t h = 0; h < 8760; h++)
+			gen[h] = (h % 24 > 6 && h % 24 < 19) ? 90000 : 15000;
+		ssc_data_set_array(data, "gen", &gen[0], 8760);
+
+		// one time of delivery period with a factor of 1
+		ssc_data_set_number(data, "ppa_multiplier_model", 0);
+		for (int p = 1; p <= 9; p++)
+			ssc_data_set_number(data, ("dispatch_factor" + std::to_string(p)).c_str(), 1);
+		std::vector<ssc_number_t> schedule(12 * 24, 1);
+		ssc_data_set_matrix(data, "dispatch_sched_weekday", &schedule[0], 12, 24);
+		ssc_data_set_matrix(data, "dispatch_sched_weekend", &schedule[0], 12, 24);
+		return data;
+	}
+};
+
+#endif // _CMOD_SINGLEOWNER_TEST_H_
@@ -75,6 +75,28 @@ TEST_F(CMWindPowerIntegration, WakeModelsUsingFile_cmod_windpower){
 
 }
 
+/// Binned farm output, interpolated by wind direction and speed, against the wake model run at every step
+TEST_F(CMWindPowerIntegration, BinnedFarmOutput_cmod_windpower) {
+	double exactEnergy[] = { 33224154, 32346158, 31081848 };
+	ssc_data_set_number(data, "wind_farm_binned", 1);
+	ssc_data_set_number(data, "nthreads", 2);
+	for (int wakeModel = 0; wakeModel < 3; wakeModel++)
+	{
+		ssc_data_set_number(data, "wind_farm_wake_model", wakeModel);
+		compute();
+
+		ssc_number_t annual_energy;
+		ssc_data_get_number(data, "annual_energy", &annual_energy);
+		EXPECT_NEAR(annual_energy, exactEnergy[wakeModel], 1e-3 * exactEnergy[wakeModel]) << "Wake model " << wakeModel;
+
+		ssc_number_t binned_error, binned_error_max;
+		ssc_data_get_number(data, "wind_farm_binned_error", &binned_error);
+		ssc_data_get_number(data, "wind_farm_binned_error_max", &binned_error_max);
+		EXPECT_LT(binned_error, 0.1) << "Wake model " << wakeModel;
+		EXPECT_LT(binned_error_max, 0.01 * 48000) << "Wake model " << wakeModel;
+	}
+}
+
 /// Using Interpolated Subhourly Wind Data
 TEST_F(CMWindPowerIntegration, UsingInterpolatedSubhourly_cmod_windpower){
 	// Using AR Northwestern-Flat Lands